@@ -0,0 +1,781 @@
+/*
+ * Copyright (c) 2021 Sebastian Kylander https://gaztin.com/
+ *
+ * This software is provided 'as-is', without any express or implied warranty. In no event will
+ * the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not claim that you wrote the
+ *    original software. If you use this software in a product, an acknowledgment in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+ *    being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+/*
+ * Microbenchmarks of the public API.
+ * The results are printed to stdout as JSON, one benchmark per line and always in the same order and layout, so that the output of two
+ * releases can be compared line by line. Benchmarks that need a display are reported as skipped when there is none, so build hosts
+ * should run this under xvfb-run to get all of them.
+ *
+ * Usage: xy-bench [--filter <text>] [--repetitions <count>]
+ */
+
+#define XY_IMPLEMENT
+#include "xy-main.h"
+
+#include <cinttypes>
+
+#if defined( XY_OS_LINUX )
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif // XY_OS_LINUX
+
+//////////////////////////////////////////////////////////////////////////
+/// Data structures
+
+struct xyBenchResult
+{
+	std::string                                     Name;
+	std::string                                     SkipReason;
+	uint64_t                                        Iterations        = 0; // Per repetition
+	std::vector< double >                           Samples;               // Nanoseconds per iteration, one per repetition
+	double                                          BytesPerIteration = 0;
+	std::vector< std::pair< std::string, double > > Metrics;               // Anything else worth tracking, like memory use
+
+}; // xyBenchResult
+
+struct xyBenchOptions
+{
+	std::string               Filter;
+	size_t                    Repetitions  = 9;
+	std::chrono::milliseconds MinBatchTime = std::chrono::milliseconds( 20 );
+
+}; // xyBenchOptions
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Globals
+
+static xyBenchOptions               gOptions;
+static std::vector< xyBenchResult > gResults;
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Helpers
+
+// Keeps the compiler from throwing away a result that is never read
+template< typename T >
+static void xyBenchKeep( T&& rrValue )
+{
+	asm volatile( "" : : "g"( &rrValue ) : "memory" );
+
+} // xyBenchKeep
+
+//////////////////////////////////////////////////////////////////////////
+
+static bool xyBenchSelected( std::string_view Name )
+{
+	return Name.find( gOptions.Filter ) != std::string_view::npos;
+
+} // xyBenchSelected
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyBenchSkip( std::string_view Name, std::string_view Reason )
+{
+	if( !xyBenchSelected( Name ) )
+		return;
+
+	xyBenchResult& rResult = gResults.emplace_back();
+	rResult.Name           = Name;
+	rResult.SkipReason     = Reason;
+
+} // xyBenchSkip
+
+//////////////////////////////////////////////////////////////////////////
+
+/*
+ * Times a function that runs a given number of iterations.
+ * The count is doubled until one batch takes long enough for the clock to be negligible, and then the batch is repeated.
+ * The median of the repetitions is what gets compared, since it ignores the odd batch that was interrupted by the scheduler.
+ */
+template< typename Function >
+static xyBenchResult* xyBenchRun( std::string_view Name, Function&& rrFunction )
+{
+	using Clock = std::chrono::steady_clock;
+
+	if( !xyBenchSelected( Name ) )
+		return nullptr;
+
+	auto Time = [ & ]( uint64_t Iterations )
+	{
+		const Clock::time_point Start = Clock::now();
+		rrFunction( Iterations );
+		return Clock::now() - Start;
+	};
+
+	uint64_t Iterations = 1;
+	while( Time( Iterations ) < gOptions.MinBatchTime && Iterations < ( uint64_t( 1 ) << 40 ) )
+		Iterations *= 2;
+
+	xyBenchResult& rResult = gResults.emplace_back();
+	rResult.Name           = Name;
+	rResult.Iterations     = Iterations;
+
+	for( size_t i = 0; i < gOptions.Repetitions; ++i )
+		rResult.Samples.push_back( std::chrono::duration< double, std::nano >( Time( Iterations ) ).count() / Iterations );
+
+	return &rResult;
+
+} // xyBenchRun
+
+//////////////////////////////////////////////////////////////////////////
+
+// Same as above, for functions that run a single iteration
+template< typename Function >
+static xyBenchResult* xyBenchRunEach( std::string_view Name, Function&& rrFunction )
+{
+	return xyBenchRun( Name, [ & ]( uint64_t Iterations )
+	{
+		for( uint64_t i = 0; i < Iterations; ++i )
+			rrFunction();
+	} );
+
+} // xyBenchRunEach
+
+//////////////////////////////////////////////////////////////////////////
+
+static double xyBenchMedian( std::vector< double > Samples )
+{
+	std::sort( Samples.begin(), Samples.end() );
+
+	return Samples[ Samples.size() / 2 ];
+
+} // xyBenchMedian
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyBenchPrint( void )
+{
+	// Numbers are printed with a fixed precision, so that only the values change between runs and never the layout
+	std::printf( "{\n" );
+	std::printf( "\t\"repetitions\": %zu,\n", gOptions.Repetitions );
+	std::printf( "\t\"display\": %s,\n", ( xyGetContext().UIMode & XY_UI_MODE_DESKTOP ) ? "true" : "false" );
+	std::printf( "\t\"benchmarks\":\n" );
+	std::printf( "\t[\n" );
+
+	for( size_t i = 0; i < gResults.size(); ++i )
+	{
+		xyBenchResult& rResult = gResults[ i ];
+		std::string    Name;
+
+		xyAppendJSONString( Name, rResult.Name );
+		std::printf( "\t\t{ \"name\": %s", Name.c_str() );
+
+		if( !rResult.SkipReason.empty() )
+		{
+			std::string Reason;
+			xyAppendJSONString( Reason, rResult.SkipReason );
+			std::printf( ", \"skipped\": %s", Reason.c_str() );
+		}
+		else
+		{
+			std::sort( rResult.Samples.begin(), rResult.Samples.end() );
+
+			const double Median = xyBenchMedian( rResult.Samples );
+
+			std::printf( ", \"iterations\": %" PRIu64 ", \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"max_ns_per_op\": %.3f", rResult.Iterations, Median, rResult.Samples.front(), rResult.Samples.back() );
+
+			if( rResult.BytesPerIteration > 0 )
+				std::printf( ", \"bytes_per_second\": %.0f", rResult.BytesPerIteration * 1e9 / Median );
+
+			for( auto& [ rMetric, Value ] : rResult.Metrics )
+				std::printf( ", \"%s\": %.3f", rMetric.c_str(), Value );
+		}
+
+		std::printf( " }%s\n", ( i + 1 < gResults.size() ) ? "," : "" );
+	}
+
+	std::printf( "\t]\n" );
+	std::printf( "}\n" );
+
+} // xyBenchPrint
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Benchmarks
+
+static void xyBenchTranscoding( void )
+{
+	// Plain text, and text that needs every length of sequence. The emoji is a surrogate pair where wchar_t is 16 bits.
+	std::string ASCII;
+	std::string Mixed;
+
+	while( ASCII.size() < 64 * 1024 ) ASCII += "The quick brown fox jumps over the lazy dog. 0123456789\n";
+	while( Mixed.size() < 64 * 1024 ) Mixed += "Grüße, 你好, こんにちは, Привет, 🙂 ";
+
+	for( auto& [ pLabel, rText ] : { std::pair< const char*, const std::string& >{ "ascii", ASCII }, { "mixed", Mixed } } )
+	{
+		const std::wstring Wide   = xyUnicode( rText );
+		const std::string  Suffix = std::string( "/" ) + pLabel + "-64k";
+		std::wstring       WideBuffer( Wide.size(), L'\0' );
+		std::string        NarrowBuffer( rText.size(), '\0' );
+
+		if( xyBenchResult* pResult = xyBenchRunEach( "transcode/xyUnicode" + Suffix, [ & ]{ xyBenchKeep( xyUnicode( rText ) ); } ) )
+			pResult->BytesPerIteration = static_cast< double >( rText.size() );
+
+		if( xyBenchResult* pResult = xyBenchRunEach( "transcode/xyUnicode-buffer" + Suffix, [ & ]{ xyBenchKeep( xyUnicode( rText, std::span< wchar_t >( WideBuffer ) ) ); } ) )
+			pResult->BytesPerIteration = static_cast< double >( rText.size() );
+
+		if( xyBenchResult* pResult = xyBenchRunEach( "transcode/xyUTF" + Suffix, [ & ]{ xyBenchKeep( xyUTF( Wide ) ); } ) )
+			pResult->BytesPerIteration = static_cast< double >( rText.size() );
+
+		if( xyBenchResult* pResult = xyBenchRunEach( "transcode/xyUTF-buffer" + Suffix, [ & ]{ xyBenchKeep( xyUTF( Wide, std::span< char >( NarrowBuffer ) ) ); } ) )
+			pResult->BytesPerIteration = static_cast< double >( rText.size() );
+	}
+
+} // xyBenchTranscoding
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyBenchContext( void )
+{
+	xyBenchRun( "context/xyGetContext", []( uint64_t Iterations )
+	{
+		for( uint64_t i = 0; i < Iterations; ++i )
+			xyBenchKeep( xyGetContext() );
+	} );
+
+} // xyBenchContext
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyBenchSystemQueries( void )
+{
+	xyBenchRunEach( "query/xyGetDevice",          []{ xyBenchKeep( xyGetDevice() ); } );
+	xyBenchRunEach( "query/xyGetLanguage",        []{ xyBenchKeep( xyGetLanguage() ); } );
+	xyBenchRunEach( "query/xyGetPreferredTheme",  []{ xyBenchKeep( xyGetPreferredTheme() ); } );
+	xyBenchRunEach( "query/xyGetBatteryState",    []{ xyBenchKeep( xyGetBatteryState() ); } );
+	xyBenchRunEach( "query/xyGetDisplayAdapters", []{ xyBenchKeep( xyGetDisplayAdapters() ); } );
+	xyBenchRunEach( "query/xyGetSystemSnapshot",  []{ xyBenchKeep( xyGetSystemSnapshot() ); } );
+
+	// What the cached queries above cost when they do go to the system
+	xyBenchRunEach( "query/xyRefreshSystemInfo",  []{ xyRefreshSystemInfo(); } );
+
+} // xyBenchSystemQueries
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyBenchDispatch( void )
+{
+
+#if defined( XY_OS_LINUX )
+
+	// Both wake the main thread and wait for it to run the job
+	xyBenchRunEach( "dispatch/xyRunOnMainThread",      []{ xyRunOnMainThread( []{ } ); } );
+	xyBenchRunEach( "dispatch/xyRunOnMainThreadAsync", []{ xyBenchKeep( xyRunOnMainThreadAsync( []{ return 0; } ).get() ); } );
+
+#else // XY_OS_LINUX
+
+	xyBenchSkip( "dispatch/xyRunOnMainThread",      "not supported on this platform" );
+	xyBenchSkip( "dispatch/xyRunOnMainThreadAsync", "not supported on this platform" );
+
+#endif // !XY_OS_LINUX
+
+} // xyBenchDispatch
+
+//////////////////////////////////////////////////////////////////////////
+
+#if defined( XY_OS_LINUX )
+
+// Calls that block on a reply from the server. They are counted by wrapping their entries in the function table, so the count doesn't
+// depend on the code under test remembering to count them.
+static std::atomic< uint64_t > gBenchRoundTrips = 0;
+
+template< auto pFunction, typename Function = std::remove_reference_t< decltype( xyXCB.*pFunction ) > >
+struct xyBenchCountedCall;
+
+template< auto pFunction, typename Return, typename... Args >
+struct xyBenchCountedCall< pFunction, Return( * )( Args... ) >
+{
+	static Return Call( Args... Arguments )
+	{
+		gBenchRoundTrips.fetch_add( 1, std::memory_order_relaxed );
+		return pOriginal( Arguments... );
+	}
+
+	static void Install( void ) { pOriginal = std::exchange( xyXCB.*pFunction, &Call ); }
+	static void Remove ( void ) { xyXCB.*pFunction = pOriginal; }
+
+	static inline Return( *pOriginal )( Args... ) = nullptr;
+
+}; // xyBenchCountedCall
+
+// Wraps every *_reply function, and xcb_request_check, for as long as it lives
+struct xyBenchRoundTripCounter
+{
+#define XY_BENCH_COUNT_CALL( Name, Action ) \
+	if constexpr( std::string_view( #Name ).ends_with( "_reply" ) || std::string_view( #Name ) == "request_check" ) \
+		xyBenchCountedCall< &xyXCBLibrary::Name >::Action();
+#define XY_BENCH_INSTALL( Name ) XY_BENCH_COUNT_CALL( Name, Install )
+#define XY_BENCH_REMOVE( Name )  XY_BENCH_COUNT_CALL( Name, Remove )
+
+	xyBenchRoundTripCounter( void )
+	{
+		XY_XCB_FUNCTIONS( XY_BENCH_INSTALL )
+#if defined( XY_HAS_XCB_RANDR )
+		XY_XCB_RANDR_FUNCTIONS( XY_BENCH_INSTALL )
+		XY_XCB_RANDR_MONITOR_FUNCTIONS( XY_BENCH_INSTALL )
+#endif // XY_HAS_XCB_RANDR
+#if defined( XY_HAS_XCB_XINPUT )
+		XY_XCB_XINPUT_FUNCTIONS( XY_BENCH_INSTALL )
+#endif // XY_HAS_XCB_XINPUT
+#if defined( XY_HAS_XCB_SHM )
+		XY_XCB_SHM_FUNCTIONS( XY_BENCH_INSTALL )
+#endif // XY_HAS_XCB_SHM
+	}
+
+	~xyBenchRoundTripCounter( void )
+	{
+		XY_XCB_FUNCTIONS( XY_BENCH_REMOVE )
+#if defined( XY_HAS_XCB_RANDR )
+		XY_XCB_RANDR_FUNCTIONS( XY_BENCH_REMOVE )
+		XY_XCB_RANDR_MONITOR_FUNCTIONS( XY_BENCH_REMOVE )
+#endif // XY_HAS_XCB_RANDR
+#if defined( XY_HAS_XCB_XINPUT )
+		XY_XCB_XINPUT_FUNCTIONS( XY_BENCH_REMOVE )
+#endif // XY_HAS_XCB_XINPUT
+#if defined( XY_HAS_XCB_SHM )
+		XY_XCB_SHM_FUNCTIONS( XY_BENCH_REMOVE )
+#endif // XY_HAS_XCB_SHM
+	}
+
+#undef XY_BENCH_REMOVE
+#undef XY_BENCH_INSTALL
+#undef XY_BENCH_COUNT_CALL
+
+}; // xyBenchRoundTripCounter
+
+//////////////////////////////////////////////////////////////////////////
+
+// Closes a box the way a window manager closes it, so the time includes the trip through the server and back
+static void xyBenchCloseMessageBox( xyXCBConnection& rXCB, xcb_window_t Window )
+{
+	xcb_client_message_event_t Event = { };
+	Event.response_type  = XCB_CLIENT_MESSAGE;
+	Event.format         = 32;
+	Event.window         = Window;
+	Event.type           = rXCB.WMProtocols;
+	Event.data.data32[0] = rXCB.WMDeleteWindow;
+
+	xyXCB.send_event( rXCB.pConnection, 0, Window, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast< const char* >( &Event ) );
+	xyXCB.flush( rXCB.pConnection );
+
+} // xyBenchCloseMessageBox
+
+//////////////////////////////////////////////////////////////////////////
+
+// Sends the box a press or release of the left mouse button, which the server hands right back to us
+static void xyBenchSendButton( xyXCBConnection& rXCB, xcb_window_t Window, bool Pressed, int16_t X, int16_t Y )
+{
+	xcb_button_press_event_t Event = { };
+	Event.response_type = Pressed ? XCB_BUTTON_PRESS : XCB_BUTTON_RELEASE;
+	Event.detail        = XCB_BUTTON_INDEX_1;
+	Event.root          = rXCB.pScreen->root;
+	Event.event         = Window;
+	Event.event_x       = X;
+	Event.event_y       = Y;
+	Event.same_screen   = 1;
+
+	xyXCB.send_event( rXCB.pConnection, 0, Window, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast< const char* >( &Event ) );
+
+} // xyBenchSendButton
+
+//////////////////////////////////////////////////////////////////////////
+
+// Waits until the server has handled everything that was sent before
+static void xyBenchSync( xyXCBConnection& rXCB, xcb_window_t Window )
+{
+	free( xyXCB.query_pointer_reply( rXCB.pConnection, xyXCB.query_pointer( rXCB.pConnection, Window ), nullptr ) );
+
+} // xyBenchSync
+
+//////////////////////////////////////////////////////////////////////////
+
+// Returns the window of the box that was opened last, or zero when it isn't on X. Clients can't ask a compositor to close their
+// surfaces, so a box on Wayland is closed right here, the way our close handler closes it.
+static xcb_window_t xyBenchFindMessageBox( xyPlatformImpl& rPlatformImpl )
+{
+	if( !rPlatformImpl.MessageBoxes.empty() )
+		return rPlatformImpl.MessageBoxes.begin()->first;
+
+	if( !rPlatformImpl.WaylandMessageBoxes.empty() )
+	{
+		rPlatformImpl.WaylandMessageBoxes.begin()->second->m_pSurface->Close();
+		rPlatformImpl.ResolveWaylandMessageBoxes();
+	}
+
+	return 0;
+
+} // xyBenchFindMessageBox
+
+#endif // XY_OS_LINUX
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyBenchMessageBox( void )
+{
+	constexpr std::string_view Name        = "messagebox/show-close";
+	constexpr std::string_view RepaintName = "messagebox/repaint";
+
+#if defined( XY_OS_LINUX )
+
+	xyPlatformImpl&  rPlatformImpl = *xyGetContext().pPlatformImpl;
+	xyXCBConnection* pXCB          = rPlatformImpl.GetXCB();
+
+	if( !pXCB && !rPlatformImpl.GetWayland() )
+	{
+		xyBenchSkip( Name,        "no display server" );
+		xyBenchSkip( RepaintName, "no display server" );
+		return;
+	}
+
+	xyBenchRunEach( Name, [ & ]
+	{
+		std::future< xyMessageResult > Result = xyMessageBoxAsync( "xy-bench", "Benchmark", xyMessageButtons::Ok );
+
+		// Jobs run in the order they were posted, so the box has been created by the time this runs
+		if( const xcb_window_t Window = xyRunOnMainThread( [ & ]{ return xyBenchFindMessageBox( rPlatformImpl ); } ) )
+			xyBenchCloseMessageBox( *pXCB, Window );
+
+		xyBenchKeep( Result.get() );
+	} );
+
+	if( !xyBenchSelected( RepaintName ) )
+		return;
+
+	std::future< xyMessageResult > Result = xyMessageBoxAsync( "xy-bench", "Benchmark", xyMessageButtons::YesNoCancel );
+	const xcb_window_t             Window = xyRunOnMainThread( [ & ]{ return xyBenchFindMessageBox( rPlatformImpl ); } );
+
+	// Wayland boxes are drawn on our side, and presented through the window code that window/present measures
+	if( !Window )
+	{
+		xyBenchKeep( Result.get() );
+		xyBenchSkip( RepaintName, "the box is on Wayland" );
+		return;
+	}
+
+	// The server repaints exposed parts of a box from its pixmap, so only input makes the box draw. The buttons are 80x28, 8 apart, and
+	// right-aligned along the bottom with a 16 pixel margin.
+	const auto [ Width, Height ] = xyRunOnMainThread( [ & ]{ auto& rpBox = rPlatformImpl.MessageBoxes.at( Window ); return std::pair( rpBox->m_Width, rpBox->m_Height ); } );
+	const int16_t ButtonX        = static_cast< int16_t >( Width - 16 - 3 * 80 - 2 * 8 + 40 );
+	const int16_t ButtonY        = static_cast< int16_t >( Height - 16 - 14 );
+
+	xyBenchRoundTripCounter Counter;
+	uint64_t                Repaints   = 0;
+	uint64_t                RoundTrips = 0;
+
+	// A press on the first button that is released beside it, which draws the button held down and then let go without closing the box.
+	// Both events are handled by the same OnXCBEvents call that the event loop makes, and make for one repaint.
+	if( xyBenchResult* pResult = xyBenchRunEach( RepaintName, [ & ]
+	{
+		xyRunOnMainThread( [ & ]
+		{
+			xyBenchSendButton( *pXCB, Window, true,  ButtonX, ButtonY );
+			xyBenchSendButton( *pXCB, Window, false, 4, 4 );
+
+			// The events are waiting in the queue once the reply is here
+			xyBenchSync( *pXCB, Window );
+
+			const uint64_t OldRoundTrips = gBenchRoundTrips.load( std::memory_order_relaxed );
+
+			rPlatformImpl.OnXCBEvents();
+
+			RoundTrips += gBenchRoundTrips.load( std::memory_order_relaxed ) - OldRoundTrips;
+			++Repaints;
+
+			// Include the time that the server takes to draw it
+			xyBenchSync( *pXCB, Window );
+		} );
+	} ) )
+	{
+		pResult->Metrics.emplace_back( "round_trips_per_repaint", static_cast< double >( RoundTrips ) / static_cast< double >( Repaints ) );
+	}
+
+	xyBenchCloseMessageBox( *pXCB, Window );
+	xyBenchKeep( Result.get() );
+
+#else // XY_OS_LINUX
+
+	xyBenchSkip( Name,        "not supported on this platform" );
+	xyBenchSkip( RepaintName, "not supported on this platform" );
+
+#endif // !XY_OS_LINUX
+
+} // xyBenchMessageBox
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyBenchWindow( void )
+{
+	static constexpr std::pair< uint32_t, uint32_t > Sizes[] = { { 1920, 1080 }, { 3840, 2160 } };
+
+	for( auto [ Width, Height ] : Sizes )
+	{
+		const std::string Name        = "window/present/" + std::to_string( Width ) + "x" + std::to_string( Height );
+		const std::string PartialName = Name + "/damage-64x64";
+
+#if defined( XY_OS_LINUX )
+
+		if( !xyBenchSelected( Name ) && !xyBenchSelected( PartialName ) )
+			continue;
+
+		xyWindow Window;
+		if( !Window.Create( "xy-bench", Width, Height ) )
+		{
+			xyBenchSkip( Name,        "no display server" );
+			xyBenchSkip( PartialName, "no display server" );
+			continue;
+		}
+
+		// Only one pixel is touched per frame, so this measures presenting and not drawing
+		uint32_t Color = 0;
+
+		if( xyBenchResult* pResult = xyBenchRunEach( Name, [ & ]
+		{
+			xyWindow::Framebuffer Frame = Window.BeginFrame();
+			if( Frame.pPixels )
+				Frame.pPixels[ 0 ] = ++Color;
+
+			Window.Present();
+		} ) )
+		{
+			pResult->BytesPerIteration = static_cast< double >( Width ) * Height * sizeof( uint32_t );
+			pResult->Metrics.emplace_back( "shared_memory", Window.IsSharingMemory() ? 1.0 : 0.0 );
+		}
+
+		// A small change, which should cost about the same no matter how large the window is
+		const xyRect Damage = { .Left=0, .Top=0, .Right=64, .Bottom=64 };
+
+		if( xyBenchResult* pResult = xyBenchRunEach( PartialName, [ & ]
+		{
+			xyWindow::Framebuffer Frame = Window.BeginFrame();
+			if( Frame.pPixels )
+				Frame.pPixels[ 0 ] = ++Color;
+
+			Window.Present( std::span< const xyRect >( &Damage, 1 ) );
+		} ) )
+		{
+			pResult->BytesPerIteration = static_cast< double >( Damage.Right ) * Damage.Bottom * sizeof( uint32_t );
+			pResult->Metrics.emplace_back( "shared_memory", Window.IsSharingMemory() ? 1.0 : 0.0 );
+		}
+
+#else // XY_OS_LINUX
+
+		xyBenchSkip( Name,        "not supported on this platform" );
+		xyBenchSkip( PartialName, "not supported on this platform" );
+
+#endif // !XY_OS_LINUX
+
+	}
+
+} // xyBenchWindow
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyBenchText( void )
+{
+	// One line of each, drawn over and over into the same buffer. Every glyph is in the atlas after the first iteration, so this
+	// measures shaping and blending.
+	static constexpr std::tuple< const char*, std::string_view, uint32_t > Lines[] =
+	{
+		{ "latin-13px", "The quick brown fox jumps over the lazy dog. 0123456789", 13 },
+		{ "mixed-16px", "Grüße, Привет, Γειά σου κόσμε, Ça va? Ærø Ångström",      16 },
+	};
+
+	for( auto& [ pLabel, Line, PixelSize ] : Lines )
+	{
+		const std::string DrawName    = std::string( "text/draw/" ) + pLabel;
+		const std::string MeasureName = std::string( "text/measure/" ) + pLabel;
+
+#if defined( XY_OS_LINUX )
+
+		if( !xyBenchSelected( DrawName ) && !xyBenchSelected( MeasureName ) )
+			continue;
+
+		int32_t Ascent;
+		int32_t Descent;
+		if( !xyGetFontMetrics( PixelSize, Ascent, Descent ) )
+		{
+			xyBenchSkip( DrawName,    "no font" );
+			xyBenchSkip( MeasureName, "no font" );
+			continue;
+		}
+
+		std::vector< uint32_t >     Pixels( 1024 * 64, 0x343434 );
+		const xyWindow::Framebuffer Frame  = { .pPixels=Pixels.data(), .Width=1024, .Height=64, .Stride=1024, .Stale={ } };
+		const double                Glyphs = static_cast< double >( xyUnicode( Line ).size() );
+		xyGlyphRun                  Run;
+
+		if( xyBenchResult* pResult = xyBenchRunEach( DrawName, [ & ]{ xyBenchKeep( xyDrawText( Frame, Line, 4, 4 + Ascent, PixelSize, 0xFFFFFF, Run ) ); } ) )
+		{
+			pResult->BytesPerIteration = static_cast< double >( Line.size() );
+			pResult->Metrics.emplace_back( "glyphs_per_second", Glyphs * 1e9 / xyBenchMedian( pResult->Samples ) );
+		}
+
+		if( xyBenchResult* pResult = xyBenchRunEach( MeasureName, [ & ]{ xyBenchKeep( xyMeasureText( Line, PixelSize ) ); } ) )
+		{
+			pResult->BytesPerIteration = static_cast< double >( Line.size() );
+			pResult->Metrics.emplace_back( "glyphs_per_second", Glyphs * 1e9 / xyBenchMedian( pResult->Samples ) );
+		}
+
+#else // XY_OS_LINUX
+
+		xyBenchSkip( DrawName,    "not supported on this platform" );
+		xyBenchSkip( MeasureName, "not supported on this platform" );
+
+#endif // !XY_OS_LINUX
+
+	}
+
+} // xyBenchText
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyBenchStartup( void )
+{
+
+#if defined( XY_OS_LINUX )
+
+	// A fresh process of our own, which returns from xyMain right away. This covers process creation, the dynamic loader and everything
+	// that happens before xyMain, but none of the benchmarks. It may first ask for the system info, which then comes from a cold start.
+	auto Spawn = []( bool Headless, const char* pQueries, long& rMaxRSS )
+	{
+		std::vector< char* > Environment;
+		for( char** ppVariable = environ; *ppVariable; ++ppVariable )
+		{
+			const std::string_view Variable( *ppVariable );
+			if( !Headless || ( !Variable.starts_with( "DISPLAY=" ) && !Variable.starts_with( "WAYLAND_DISPLAY=" ) ) )
+				Environment.push_back( *ppVariable );
+		}
+		Environment.push_back( nullptr );
+
+		char  Path[]   = "/proc/self/exe";
+		char  Probe[]  = "--startup-probe";
+		char* ppArgs[] = { Path, Probe, const_cast< char* >( pQueries ), nullptr };
+		pid_t PID      = 0;
+
+		if( posix_spawn( &PID, Path, nullptr, nullptr, ppArgs, Environment.data() ) != 0 )
+			return;
+
+		int           Status = 0;
+		struct rusage Usage  = { };
+		wait4( PID, &Status, 0, &Usage );
+
+		rMaxRSS = std::max( rMaxRSS, Usage.ru_maxrss );
+	};
+
+	for( bool Headless : { true, false } )
+	{
+		const std::string_view Name = Headless ? "startup/headless" : "startup/desktop";
+
+		if( !Headless && !( xyGetContext().UIMode & XY_UI_MODE_DESKTOP ) )
+		{
+			xyBenchSkip( Name, "no display server" );
+			continue;
+		}
+
+		long MaxRSS = 0;
+
+		if( xyBenchResult* pResult = xyBenchRunEach( Name, [ & ]{ Spawn( Headless, nullptr, MaxRSS ); } ) )
+			pResult->Metrics.emplace_back( "max_rss_kb", static_cast< double >( MaxRSS ) );
+	}
+
+	// The same start, followed by the five queries one after the other or all at once. The difference to startup/* is what they cost cold.
+	const bool Headless = !( xyGetContext().UIMode & XY_UI_MODE_DESKTOP );
+
+	for( const char* pQueries : { "serial", "snapshot" } )
+	{
+		long MaxRSS = 0;
+
+		if( xyBenchResult* pResult = xyBenchRunEach( std::string( "startup/queries/" ) + pQueries, [ & ]{ Spawn( Headless, pQueries, MaxRSS ); } ) )
+			pResult->Metrics.emplace_back( "max_rss_kb", static_cast< double >( MaxRSS ) );
+	}
+
+#else // XY_OS_LINUX
+
+	xyBenchSkip( "startup/headless",         "not supported on this platform" );
+	xyBenchSkip( "startup/desktop",          "not supported on this platform" );
+	xyBenchSkip( "startup/queries/serial",   "not supported on this platform" );
+	xyBenchSkip( "startup/queries/snapshot", "not supported on this platform" );
+
+#endif // !XY_OS_LINUX
+
+} // xyBenchStartup
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Entry point
+
+int xyMain( void )
+{
+	std::span< char* > Args = xyGetContext().CommandLineArgs;
+
+	for( size_t i = 1; i < Args.size(); ++i )
+	{
+		const std::string_view Arg( Args[ i ] );
+
+		if( Arg == "--startup-probe" )
+		{
+			const std::string_view Queries = ( i + 1 < Args.size() ) ? Args[ i + 1 ] : "";
+
+			if( Queries == "serial" )
+			{
+				xyBenchKeep( xyGetDevice() );
+				xyBenchKeep( xyGetLanguage() );
+				xyBenchKeep( xyGetPreferredTheme() );
+				xyBenchKeep( xyGetBatteryState() );
+				xyBenchKeep( xyGetDisplayAdapters() );
+			}
+			else if( Queries == "snapshot" )
+			{
+				xyBenchKeep( xyGetSystemSnapshot() );
+			}
+
+			return 0;
+		}
+
+		if( Arg == "--filter" && i + 1 < Args.size() )
+		{
+			gOptions.Filter = Args[ ++i ];
+		}
+		else if( Arg == "--repetitions" && i + 1 < Args.size() )
+		{
+			gOptions.Repetitions = std::max< size_t >( std::strtoul( Args[ ++i ], nullptr, 10 ), 1 );
+		}
+		else
+		{
+			std::fprintf( stderr, "Usage: %s [--filter <text>] [--repetitions <count>]\n", Args[ 0 ] );
+			return 1;
+		}
+	}
+
+	xyBenchStartup();
+	xyBenchTranscoding();
+	xyBenchContext();
+	xyBenchSystemQueries();
+	xyBenchDispatch();
+	xyBenchMessageBox();
+	xyBenchWindow();
+	xyBenchText();
+
+	xyBenchPrint();
+
+	return 0;
+
+} // xyMain
@@ -45,14 +45,19 @@ int main( int ArgC, char** ppArgV )
 {
 	xyContext& rContext      = xyGetContext();
 	rContext.CommandLineArgs = std::span< char* >( ppArgV, ArgC );
-	rContext.pPlatformImpl   = std::make_unique< xyPlatformImpl >();
 	rContext.UIMode          = XY_UI_MODE_DESKTOP;
 
+	rContext.Startup.BeginPhase( "PlatformImpl" );
+	rContext.pPlatformImpl = std::make_shared< xyPlatformImpl >();
+
 	// Store the handle to the application instance
 	rContext.pPlatformImpl->ApplicationInstanceHandle = GetModuleHandle( NULL );
 
+	rContext.Startup.BeginPhase( "Locale" );
 	std::setlocale( LC_ALL, "en_US.utf8" );
+	rContext.Startup.EndPhase();
 
+	rContext.Startup.Mark( "xyMain" );
 	return xyMain();
 
 } // main
@@ -61,14 +66,19 @@ INT WINAPI WinMain( _In_ HINSTANCE Instance, _In_opt_ HINSTANCE /*PrevInstance*/
 {
 	xyContext& rContext      = xyGetContext();
 	rContext.CommandLineArgs = std::span< char* >( __argv, __argc );
-	rContext.pPlatformImpl   = std::make_unique< xyPlatformImpl >();
 	rContext.UIMode          = XY_UI_MODE_DESKTOP;
 
+	rContext.Startup.BeginPhase( "PlatformImpl" );
+	rContext.pPlatformImpl = std::make_shared< xyPlatformImpl >();
+
 	// Store the handle to the application instance
 	rContext.pPlatformImpl->ApplicationInstanceHandle = Instance;
 
+	rContext.Startup.BeginPhase( "Locale" );
 	std::setlocale( LC_ALL, "en_US.utf8" );
+	rContext.Startup.EndPhase();
 
+	rContext.Startup.Mark( "xyMain" );
 	return xyMain();
 
 } // WinMain
@@ -83,8 +93,11 @@ int main( int ArgC, char** ppArgV )
 	rContext.CommandLineArgs = std::span< char* >( ppArgV, ArgC );
 	rContext.UIMode          = XY_UI_MODE_DESKTOP;
 
+	rContext.Startup.BeginPhase( "Locale" );
 	setlocale( LC_CTYPE, "UTF-8" );
+	rContext.Startup.EndPhase();
 
+	rContext.Startup.Mark( "xyMain" );
 	return xyMain();
 
 } // main
@@ -97,13 +110,16 @@ int main( int ArgC, char** ppArgV )
 
 [[maybe_unused]] JNIEXPORT void ANativeActivity_onCreate( ANativeActivity* pActivity, void* /*pSavedState*/, size_t /*SavedStateSize*/ )
 {
-	xyContext& rContext    = xyGetContext();
-	rContext.pPlatformImpl = std::make_unique< xyPlatformImpl >();
+	xyContext& rContext = xyGetContext();
+
+	rContext.Startup.BeginPhase( "PlatformImpl" );
+	rContext.pPlatformImpl = std::make_shared< xyPlatformImpl >();
 
 	// Store the activity data
 	rContext.pPlatformImpl->pNativeActivity = pActivity;
 
 	// Obtain the configuration
+	rContext.Startup.BeginPhase( "Configuration" );
 	rContext.pPlatformImpl->pConfiguration = AConfiguration_new();
 	AConfiguration_fromAssetManager( rContext.pPlatformImpl->pConfiguration, rContext.pPlatformImpl->pNativeActivity->assetManager );
 
@@ -119,6 +135,7 @@ int main( int ArgC, char** ppArgV )
 	}
 
 	// Obtain the looper for the main thread
+	rContext.Startup.BeginPhase( "Looper" );
 	ALooper* pMainLooper = ALooper_forThread();
 	ALooper_acquire( pMainLooper );
 
@@ -137,7 +154,13 @@ int main( int ArgC, char** ppArgV )
 
 	}, nullptr );
 
-	std::thread AppThread( &xyMain );
+	rContext.Startup.EndPhase();
+
+	std::thread AppThread( []
+	{
+		xyGetContext().Startup.Mark( "xyMain" );
+		xyMain();
+	} );
 	AppThread.detach();
 
 } // ANativeActivity_onCreate
@@ -167,7 +190,13 @@ int main( int ArgC, char** ppArgV )
 	pWindow.rootViewController        = pViewController;
 	[ pWindow makeKeyAndVisible ];
 
-	std::thread Thread( &xyMain );
+	xyGetContext().Startup.Mark( "DidFinishLaunching" );
+
+	std::thread Thread( []
+	{
+		xyGetContext().Startup.Mark( "xyMain" );
+		xyMain();
+	} );
 	Thread.detach();
 
 } // didFinishLaunchingWithOptions
@@ -180,7 +209,9 @@ int main( int ArgC, char** ppArgV )
 	rContext.CommandLineArgs = std::span< char* >( ppArgV, ArgC );
 	rContext.UIMode          = XY_UI_MODE_PHONE;
 
+	rContext.Startup.BeginPhase( "Locale" );
 	setlocale( LC_CTYPE, "UTF-8" );
+	rContext.Startup.EndPhase();
 
 	@autoreleasepool
 	{
@@ -197,11 +228,42 @@ int main( int ArgC, char** ppArgV )
 {
 	xyContext& rContext      = xyGetContext();
 	rContext.CommandLineArgs = std::span< char* >( ppArgV, ArgC );
-	rContext.UIMode          = XY_UI_MODE_DESKTOP; // We assume Linux is running with a GUI, we might want to create a function to test if we are.
 
+	rContext.Startup.BeginPhase( "PlatformImpl" );
+	rContext.pPlatformImpl = std::make_shared< xyPlatformImpl >();
+
+	rContext.Startup.BeginPhase( "UIMode" );
+	rContext.UIMode = xyHasDisplayServer() ? XY_UI_MODE_DESKTOP : XY_UI_MODE_HEADLESS;
+
+	rContext.Startup.BeginPhase( "Locale" );
 	std::setlocale( LC_ALL, "en_US.utf8" );
 
-	return xyMain();
+	// The main thread runs the event loop until the app has finished
+	rContext.pPlatformImpl->MainThreadID = std::this_thread::get_id();
+
+	// Every thread inherits the blocked signals from this one, so it has to happen before any of them start
+	rContext.pPlatformImpl->EventLoop.BlockSignals();
+
+	XY_TRACE_THREAD_NAME( "Main" );
+
+	rContext.Startup.BeginPhase( "AppThread" );
+
+	int         ExitCode = 0;
+	std::thread AppThread( [ &ExitCode ]
+	{
+		xyGetContext().Startup.EndPhase();
+		xyGetContext().Startup.Mark( "xyMain" );
+		XY_TRACE_THREAD_NAME( "App" );
+
+		ExitCode = xyMain();
+		xyPostToMainThread( []{ xyGetContext().pPlatformImpl->EventLoop.Quit(); } );
+	} );
+
+	rContext.pPlatformImpl->EventLoop.Run();
+
+	AppThread.join();
+
+	return ExitCode;
 	
 } // main
 
@@ -213,6 +275,7 @@ int main( int ArgC, char** ppArgV )
 	rContext.CommandLineArgs = std::span< char* >( ppArgV, ArgC );
 	rContext.UIMode          = XY_UI_MODE_HEADLESS; // We don't know the UI mode. Might as well assume the worst.
 
+	rContext.Startup.Mark( "xyMain" );
 	return xyMain();
 
 } // main
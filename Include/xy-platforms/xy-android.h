@@ -40,31 +40,10 @@ struct xyPlatformImpl
 
 }; // xyPlatformImpl
 
-struct xyRunnable
-{
-	virtual ~xyRunnable( void ) = default;
-
-	virtual void Execute( void ) = 0;
-
-}; // xyRunnable
-
 
 //////////////////////////////////////////////////////////////////////////
 /// Android-specific template functions
 
-/**
- * Invokes a callable object with arguments from a packed tuple.
- *
- * @param rrFunction The object that gets called.
- * @param rTuple The tuple that gets unpacked into arguments.
- */
-template< typename Function, typename Tuple, size_t... Is >
-auto xyInvokeWithTuple( Function&& rrFunction, const Tuple& rTuple, std::integer_sequence< size_t, Is... > )
-{
-	return std::invoke( std::forward< Function >( rrFunction ), ( std::get< Is >( rTuple ) )... );
-
-} // xyInvokeWithTuple
-
 /**
  * Runs a callable object on the java thread and waits for it to finish.
  *
@@ -80,29 +59,28 @@ void xyRunOnJavaThread( Function&& rrFunction, Args&&... rrArgs )
 		virtual void Execute( void ) override
 		{
 			xyInvokeWithTuple( Callback, Arguments, std::index_sequence_for< Args... >{ } );
-			Finished = true;
+			Finished.Signal();
 
 		} // Execute
 
 		std::decay_t< Function > Callback;
 		std::tuple< Args... >    Arguments;
-		bool                     Finished = false;
+		xyCompletion             Finished;
 
 	}; // JavaRunnable
 
-	xyContext& rContext  = xyGetContext();
-	auto*      pRunnable = new JavaRunnable();
-	pRunnable->Callback  = std::forward< Function >( rrFunction );
-	pRunnable->Arguments = std::forward_as_tuple( std::forward< Args >( rrArgs )... );
+	// The caller is blocked until the runnable has finished, so it can live on the stack
+	xyContext&    rContext  = xyGetContext();
+	JavaRunnable  Runnable;
+	JavaRunnable* pRunnable = &Runnable;
+	Runnable.Callback       = std::forward< Function >( rrFunction );
+	Runnable.Arguments      = std::forward_as_tuple( std::forward< Args >( rrArgs )... );
 
 	if( write( rContext.pPlatformImpl->JavaThreadPipe[ 1 ], &pRunnable, sizeof( pRunnable ) ) == sizeof( pRunnable ) )
 	{
-		while( !pRunnable->Finished )
-			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+		Runnable.Finished.Wait();
 	}
 
-	delete pRunnable;
-
 } // xyRunOnJavaThread
 
 /**
@@ -123,33 +101,30 @@ auto xyRunOnJavaThread( Function&& rrFunction, Args&&... rrArgs )
 		virtual void Execute( void ) override
 		{
 			ReturnValue = xyInvokeWithTuple( Callback, Arguments, std::index_sequence_for< Args... >{ } );
-			Finished    = true;
+			Finished.Signal();
 
 		} // Execute
 
 		std::decay_t< Function > Callback;
 		std::tuple< Args... >    Arguments;
 		ReturnType               ReturnValue;
-		bool                     Finished = false;
+		xyCompletion             Finished;
 
 	}; // JavaRunnable
 
-	xyContext& rContext  = xyGetContext();
-	auto* pRunnable      = new JavaRunnable();
-	pRunnable->Callback  = std::forward< Function >( rrFunction );
-	pRunnable->Arguments = std::forward_as_tuple( std::forward< Args >( rrArgs )... );
+	// The caller is blocked until the runnable has finished, so it can live on the stack
+	xyContext&    rContext  = xyGetContext();
+	JavaRunnable  Runnable;
+	JavaRunnable* pRunnable = &Runnable;
+	Runnable.Callback       = std::forward< Function >( rrFunction );
+	Runnable.Arguments      = std::forward_as_tuple( std::forward< Args >( rrArgs )... );
 
 	if( write( rContext.pPlatformImpl->JavaThreadPipe[ 1 ], &pRunnable, sizeof( pRunnable ) ) == sizeof( pRunnable ) )
 	{
-		while( !pRunnable->Finished )
-			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
-
-		ReturnType ReturnValue = std::move( pRunnable->ReturnValue );
-		delete pRunnable;
-		return ReturnValue;
+		Runnable.Finished.Wait();
+		return ReturnType( std::move( Runnable.ReturnValue ) );
 	}
 
-	delete pRunnable;
 	return ReturnType{};
 
 } // xyRunOnJavaThread
@@ -93,6 +93,16 @@ xyMouse xyGetMouse( void )
 
 #elif defined( XY_OS_LINUX ) // XY_OS_MACOS
 
+	// The position is kept current by the main thread, so this is usually just an atomic load
+	int32_t X;
+	int32_t Y;
+	if( xyPointerSampler* pSampler = xyGetContext().pPlatformImpl->GetPointerSampler(); pSampler && pSampler->GetLatest( X, Y ) )
+	{
+		return { .X=X, .Y=Y, .Active=true };
+	}
+
+	return { .Active=false };
+
 #endif // XY_OS_LINUX
 
 } // xyGetMouse
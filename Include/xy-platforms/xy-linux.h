@@ -27,292 +27,5785 @@
 #include <vector>
 #include <unordered_map>
 #include <chrono>
-#include <xcb/xcb.h>
-#include <X11/Xlib-xcb.h>
-#include <xcb/xcb_icccm.h> // install libxcb-icccm4-dev
+#include <xcb/xcb.h>    // install libxcb1-dev. The library itself is loaded at runtime, so there is nothing to link with.
+#include <xcb/xcbext.h> // xcb_poll_for_reply
+#if __has_include( <xcb/randr.h> )
+#define XY_HAS_XCB_RANDR
+#include <xcb/randr.h> // install libxcb-randr0-dev
+#endif // __has_include( <xcb/randr.h> )
+#if __has_include( <xcb/xinput.h> )
+#define XY_HAS_XCB_XINPUT
+#include <xcb/xinput.h> // install libxcb-xinput-dev
+#endif // __has_include( <xcb/xinput.h> )
+#if __has_include( <xcb/shm.h> )
+#define XY_HAS_XCB_SHM
+#include <xcb/shm.h> // install libxcb-shm0-dev
+#endif // __has_include( <xcb/shm.h> )
+#if __has_include( <ft2build.h> )
+#define XY_HAS_FREETYPE
+#include <ft2build.h> // install libfreetype-dev. Like libxcb, the library is loaded at runtime.
+#include FT_FREETYPE_H
+#endif // __has_include( <ft2build.h> )
+#if __has_include( <wayland-client-core.h> )
+#include <wayland-client-core.h> // libwayland-dev. Not required, since the few types that we need are stable and declared below if it's missing.
+#else // __has_include( <wayland-client-core.h> )
+struct wl_display;
+struct wl_proxy;
+struct wl_interface;
+struct wl_message   { const char* name; const char* signature; const wl_interface** types; };
+struct wl_interface { const char* name; int version; int method_count; const wl_message* methods; int event_count; const wl_message* events; };
+struct wl_array     { size_t size; size_t alloc; void* data; };
+typedef int32_t wl_fixed_t;
+#endif // !__has_include( <wayland-client-core.h> )
 #include <string>
 #include <cstring>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <optional>
 #include <signal.h>
+#include <thread>
+#include <unistd.h>
+#include <dirent.h>
+#include <dlfcn.h> // link with dl on glibc older than 2.34
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// Linux-specific macros
+
+// The functions that are looked up in libxcb and its extensions, without their "xcb_" prefix
+#define XY_XCB_FUNCTIONS( X ) \
+	X( connect ) \
+	X( disconnect ) \
+	X( connection_has_error ) \
+	X( get_setup ) \
+	X( setup_roots_iterator ) \
+	X( screen_next ) \
+	X( get_file_descriptor ) \
+	X( generate_id ) \
+	X( flush ) \
+	X( poll_for_event ) \
+	X( poll_for_reply ) \
+	X( prefetch_extension_data ) \
+	X( get_extension_data ) \
+	X( get_maximum_request_length ) \
+	X( request_check ) \
+	X( setup_pixmap_formats ) \
+	X( setup_pixmap_formats_length ) \
+	X( intern_atom ) \
+	X( intern_atom_reply ) \
+	X( query_font ) \
+	X( query_font_reply ) \
+	X( open_font ) \
+	X( close_font ) \
+	X( create_gc ) \
+	X( free_gc ) \
+	X( change_window_attributes ) \
+	X( get_property ) \
+	X( get_property_reply ) \
+	X( get_property_value ) \
+	X( get_property_value_length ) \
+	X( query_pointer ) \
+	X( query_pointer_reply ) \
+	X( create_window ) \
+	X( destroy_window ) \
+	X( map_window ) \
+	X( send_event ) \
+	X( create_pixmap ) \
+	X( free_pixmap ) \
+	X( change_property ) \
+	X( clear_area ) \
+	X( poly_fill_rectangle ) \
+	X( poly_rectangle ) \
+	X( poly_text_8 ) \
+	X( put_image ) \
+	X( get_atom_name ) \
+	X( get_atom_name_reply ) \
+	X( get_atom_name_name ) \
+	X( get_atom_name_name_length )
+
+#if defined( XY_HAS_XCB_RANDR )
+#define XY_XCB_RANDR_FUNCTIONS( X ) \
+	X( randr_select_input ) \
+	X( randr_query_version ) \
+	X( randr_query_version_reply ) \
+	X( randr_get_screen_resources_current ) \
+	X( randr_get_screen_resources_current_reply ) \
+	X( randr_get_screen_resources_current_outputs ) \
+	X( randr_get_screen_resources_current_outputs_length ) \
+	X( randr_get_screen_resources_current_crtcs ) \
+	X( randr_get_screen_resources_current_crtcs_length ) \
+	X( randr_get_screen_resources_current_modes_iterator ) \
+	X( randr_mode_info_next ) \
+	X( randr_get_output_primary ) \
+	X( randr_get_output_primary_reply ) \
+	X( randr_get_output_info ) \
+	X( randr_get_output_info_reply ) \
+	X( randr_get_output_info_name ) \
+	X( randr_get_output_info_name_length ) \
+	X( randr_get_crtc_info ) \
+	X( randr_get_crtc_info_reply )
+
+// Monitors came with RandR 1.5, later than the rest. A library without them still has everything else.
+#define XY_XCB_RANDR_MONITOR_FUNCTIONS( X ) \
+	X( randr_get_monitors ) \
+	X( randr_get_monitors_reply ) \
+	X( randr_get_monitors_monitors_iterator ) \
+	X( randr_monitor_info_next ) \
+	X( randr_monitor_info_outputs ) \
+	X( randr_monitor_info_outputs_length )
+#endif // XY_HAS_XCB_RANDR
+
+#if defined( XY_HAS_XCB_XINPUT )
+#define XY_XCB_XINPUT_FUNCTIONS( X ) \
+	X( input_xi_select_events ) \
+	X( input_xi_query_version ) \
+	X( input_xi_query_version_reply )
+#endif // XY_HAS_XCB_XINPUT
+
+#if defined( XY_HAS_XCB_SHM )
+#define XY_XCB_SHM_FUNCTIONS( X ) \
+	X( shm_query_version ) \
+	X( shm_query_version_reply ) \
+	X( shm_attach_fd ) \
+	X( shm_attach_fd_checked ) \
+	X( shm_detach ) \
+	X( shm_put_image )
+#endif // XY_HAS_XCB_SHM
+
+// The functions that are looked up in libwayland-client, without their "wl_" prefix. Their types are spelled out, since the header may be missing.
+#define XY_WAYLAND_FUNCTIONS( X ) \
+	X( display_connect,          wl_display*, ( const char* ) ) \
+	X( display_disconnect,       void,        ( wl_display* ) ) \
+	X( display_get_fd,           int,         ( wl_display* ) ) \
+	X( display_get_error,        int,         ( wl_display* ) ) \
+	X( display_roundtrip,        int,         ( wl_display* ) ) \
+	X( display_flush,            int,         ( wl_display* ) ) \
+	X( display_prepare_read,     int,         ( wl_display* ) ) \
+	X( display_read_events,      int,         ( wl_display* ) ) \
+	X( display_cancel_read,      void,        ( wl_display* ) ) \
+	X( display_dispatch_pending, int,         ( wl_display* ) ) \
+	X( proxy_marshal_flags,      wl_proxy*,   ( wl_proxy*, uint32_t, const wl_interface*, uint32_t, uint32_t, ... ) ) \
+	X( proxy_add_listener,       int,         ( wl_proxy*, void( ** )( void ), void* ) ) \
+	X( proxy_destroy,            void,        ( wl_proxy* ) ) \
+	X( proxy_get_version,        uint32_t,    ( wl_proxy* ) )
+
+// The interfaces of the core protocol that libwayland-client describes for us, without their "wl_" prefix and "_interface" suffix
+#define XY_WAYLAND_INTERFACES( X ) \
+	X( registry ) \
+	X( compositor ) \
+	X( surface ) \
+	X( callback ) \
+	X( shm ) \
+	X( shm_pool ) \
+	X( buffer ) \
+	X( seat ) \
+	X( pointer )
+
+#if defined( XY_HAS_FREETYPE )
+// The functions that are looked up in FreeType, without their "FT_" prefix
+#define XY_FREETYPE_FUNCTIONS( X ) \
+	X( Init_FreeType ) \
+	X( Done_FreeType ) \
+	X( New_Face ) \
+	X( Done_Face ) \
+	X( Set_Pixel_Sizes ) \
+	X( Get_Char_Index ) \
+	X( Get_Kerning ) \
+	X( Load_Glyph )
+#endif // XY_HAS_FREETYPE
+
 
 //////////////////////////////////////////////////////////////////////////
 /// Linux-specific data structures
 
-class xyMessageBoxData
-{
-public:
-	xyMessageBoxData( const char* pTitle, const char* pMessageContent, xyMessageButtons MessageButtons ) : m_pTitle( pTitle ), m_pMessageContent( pMessageContent ) { m_MessageButtons = MessageButtons; }
+/*
+ * The functions of libxcb, looked up when the first connection is made.
+ * Processes that never open a window don't load the X libraries at all, which keeps headless startup fast and small.
+ * The extensions are optional. Their functions are left null if their library is missing.
+ */
+class xyXCBLibrary
+{
+public:
+
+	bool Load( void );
+
+public:
+
+#define XY_XCB_DECLARE_FUNCTION( Name ) decltype( &::xcb_##Name ) Name = nullptr;
+
+	XY_XCB_FUNCTIONS( XY_XCB_DECLARE_FUNCTION )
+
+#if defined( XY_HAS_XCB_RANDR )
+	XY_XCB_RANDR_FUNCTIONS( XY_XCB_DECLARE_FUNCTION )
+	XY_XCB_RANDR_MONITOR_FUNCTIONS( XY_XCB_DECLARE_FUNCTION )
+	xcb_extension_t* randr_id       = nullptr;
+	bool             randr_monitors = false;
+#endif // XY_HAS_XCB_RANDR
+
+#if defined( XY_HAS_XCB_XINPUT )
+	XY_XCB_XINPUT_FUNCTIONS( XY_XCB_DECLARE_FUNCTION )
+	xcb_extension_t* input_id = nullptr;
+#endif // XY_HAS_XCB_XINPUT
+
+#if defined( XY_HAS_XCB_SHM )
+	XY_XCB_SHM_FUNCTIONS( XY_XCB_DECLARE_FUNCTION )
+	xcb_extension_t* shm_id = nullptr;
+#endif // XY_HAS_XCB_SHM
+
+#undef XY_XCB_DECLARE_FUNCTION
+
+}; // xyXCBLibrary
+
+inline xyXCBLibrary xyXCB; // Only valid once xyPlatformImpl::GetXCB has returned a connection
+
+#if defined( XY_HAS_FREETYPE )
+
+/*
+ * The functions of FreeType, looked up the first time that text is drawn.
+ */
+class xyFreeTypeLibrary
+{
+public:
+
+	bool Load( void );
+
+public:
+
+#define XY_FREETYPE_DECLARE_FUNCTION( Name ) decltype( &::FT_##Name ) Name = nullptr;
+
+	XY_FREETYPE_FUNCTIONS( XY_FREETYPE_DECLARE_FUNCTION )
+
+#undef XY_FREETYPE_DECLARE_FUNCTION
+
+}; // xyFreeTypeLibrary
+
+inline xyFreeTypeLibrary xyFT; // Only valid once xyPlatformImpl::GetTextEngine has returned an engine
+
+#endif // XY_HAS_FREETYPE
+
+/*
+ * The functions of libwayland-client, and the interfaces of the core protocol that it describes.
+ */
+class xyWaylandLibrary
+{
+public:
+
+	bool Load( void );
+
+public:
+
+#define XY_WAYLAND_DECLARE_FUNCTION( Name, Return, Parameters ) Return ( *Name ) Parameters = nullptr;
+#define XY_WAYLAND_DECLARE_INTERFACE( Name ) const wl_interface* Name##_interface = nullptr;
+
+	XY_WAYLAND_FUNCTIONS( XY_WAYLAND_DECLARE_FUNCTION )
+	XY_WAYLAND_INTERFACES( XY_WAYLAND_DECLARE_INTERFACE )
+
+#undef XY_WAYLAND_DECLARE_INTERFACE
+#undef XY_WAYLAND_DECLARE_FUNCTION
+
+}; // xyWaylandLibrary
+
+inline xyWaylandLibrary xyWL; // Only valid once xyPlatformImpl::GetWayland has returned a connection
+
+// xdg-shell is not part of the core protocol, so libwayland-client doesn't describe it. These are version 1 of its interfaces, written out
+// the way that wayland-scanner would have generated them.
+extern const wl_interface xyXdgWmBaseInterface;
+extern const wl_interface xyXdgSurfaceInterface;
+extern const wl_interface xyXdgToplevelInterface;
+
+/*
+ * The X connection shared by everything in the framework that talks to the X server.
+ * It is opened once, and the screen, atoms and graphic contexts that every window needs are set up along with it.
+ */
+class xyXCBConnection
+{
+public:
+
+	~xyXCBConnection( void );
+
+	bool                            Connect             ( void );
+	std::vector< xyDisplayAdapter > QueryDisplayAdapters( void );
+
+public:
+
+	using ErrorCallback = std::function< void( const xcb_generic_error_t& rError ) >;
+
+	ErrorCallback           OnError;        // Called on the main thread for every request that failed
+	std::atomic< uint64_t > RoundTrips = 0; // How many times we have blocked on a reply from the server
+
+	xcb_connection_t* pConnection    = nullptr;
+	xcb_screen_t*     pScreen        = nullptr;
+	xcb_visualid_t    VisualID       = 0;
+	xcb_atom_t        WMProtocols    = XCB_ATOM_NONE;
+	xcb_atom_t        WMDeleteWindow = XCB_ATOM_NONE;
+	xcb_atom_t        NetWorkArea    = XCB_ATOM_NONE;
+	xcb_atom_t        NetCurrentDesk = XCB_ATOM_NONE;
+	uint8_t           RandREventBase = 0; // Zero if the server doesn't support RandR 1.3
+	bool              RandRMonitors  = false; // Set if the server supports RandR 1.5, which groups outputs into monitors
+	uint8_t           XInputOpcode   = 0; // Zero if the server doesn't support XInput 2.0
+	uint8_t           ShmEventBase   = 0; // Zero if the server can't share memory with us through file descriptors (MIT-SHM 1.2)
+	uint8_t           BitsPerPixel   = 0; // Of images in the root depth
+	xcb_gcontext_t    ForegroundGC   = 0;
+	xcb_gcontext_t    FillGC         = 0;
+	xcb_gcontext_t    FontGC         = 0;
+	int16_t           FontAscent     = 10;
+	int16_t           FontDescent    = 3;
+	int16_t           CharWidth      = 6; // The fixed font is monospaced, so this is all we need to measure text
+
+}; // xyXCBConnection
+
+/*
+ * The connection to the Wayland compositor, which windows and message boxes use instead of X when the session has one.
+ * Only the globals that a window needs are bound. The pointer is followed here too, since its events go to the seat and not to a surface.
+ */
+class xyWaylandConnection
+{
+public:
+
+	~xyWaylandConnection( void );
+
+	bool Connect ( void );
+	bool Dispatch( void ); // Reads and handles what the compositor sent. Returns false once the connection is lost.
+
+	// Sends a request. Objects that the request creates are returned, and objects that it destroys are destroyed along with it.
+	template< typename... Args >
+	static wl_proxy* Send( wl_proxy* pProxy, uint32_t Opcode, const wl_interface* pInterface, bool Destroy, Args... Arguments )
+	{
+		return xyWL.proxy_marshal_flags( pProxy, Opcode, pInterface, xyWL.proxy_get_version( pProxy ), Destroy ? 1 : 0, Arguments... );
+	}
+
+	// Listeners are structs of function pointers, one for every event of the interface in the order they are listed in the protocol
+	template< typename Listener >
+	static void AddListener( wl_proxy* pProxy, const Listener& rListener, void* pData )
+	{
+		xyWL.proxy_add_listener( pProxy, reinterpret_cast< void( ** )( void ) >( const_cast< Listener* >( &rListener ) ), pData );
+	}
+
+	wl_display* pDisplay          = nullptr;
+	wl_proxy*   pRegistry         = nullptr;
+	wl_proxy*   pCompositor       = nullptr;
+	wl_proxy*   pShm              = nullptr;
+	wl_proxy*   pWmBase           = nullptr;
+	wl_proxy*   pSeat             = nullptr;
+	wl_proxy*   pPointer          = nullptr;
+	wl_proxy*   pPointerFocus     = nullptr; // The surface that the pointer is over
+	int32_t     PointerX          = 0;       // Relative to that surface
+	int32_t     PointerY          = 0;
+	std::mutex  DispatchMutex;               // Held while events are dispatched, so that other threads can add listeners to new objects in time
+
+}; // xyWaylandConnection
+
+/*
+ * The parts of a window that need to be repainted.
+ * Rectangles are merged as they are added whenever their union covers no more than the two of them did apart. Past a handful of them,
+ * the two whose union wastes the least area are merged anyway, since every rectangle costs a request of its own.
+ */
+class xyDamageRegion
+{
+public:
+
+	static xyRect Intersect( const xyRect& rA, const xyRect& rB );
+
+	void                      Add      ( const xyRect& rRect );
+	void                      Clear    ( void )       { Count = 0; }
+	bool                      IsEmpty  ( void ) const { return Count == 0; }
+	std::span< const xyRect > GetRects ( void ) const { return { Rects.data(), Count }; }
+
+private:
+
+	static constexpr size_t MaxRects = 8;
+
+	std::array< xyRect, MaxRects + 1 > Rects; // One more, which is merged away before Add returns
+	size_t                             Count = 0;
+
+}; // xyDamageRegion
+
+class xyWindow;
+
+class xyMessageBoxData
+{
+public:
+	xyMessageBoxData( std::string_view Title, std::string_view MessageContent, xyMessageButtons MessageButtons ) : m_Title( Title ), m_MessageContent( MessageContent ) { m_MessageButtons = MessageButtons; }
+
+	~xyMessageBoxData();
+
+	void Create( xyXCBConnection& rXCB );
+
+	// Opens the box as a Wayland surface instead. Fails if there is no font to draw its text with, since Wayland has no fonts of its own.
+	bool CreateSurface( void );
+
+	// Handles an event that was sent to our window. Returns the result once the box has been dismissed.
+	std::optional< xyMessageResult > HandleEvent( xcb_generic_event_t* pEvent );
+
+	// Handles a press or release of the left mouse button, the same way
+	std::optional< xyMessageResult > HandleButton( bool Pressed, int16_t X, int16_t Y );
+
+	// The result that closing the window counts as
+	xyMessageResult GetCloseResult() const;
+
+	// Redraws what the events since the last call changed, and copies it to the window
+	void Repaint();
+
+public:
+
+	struct Button
+	{
+		std::string_view Label;
+		xyMessageResult  Result;
+
+	}; // Button
+
+	// Owned copies, since the views we are given aren't guaranteed to be null-terminated nor to outlive the box
+	std::string m_Title;
+	std::string m_MessageContent;
+
+	uint16_t m_Width = 0;
+	uint16_t m_Height = 0;
+
+	xyMessageButtons m_MessageButtons = xyMessageButtons::Ok;
+
+	std::promise< xyMessageResult > m_Result;
+
+	// XCB Data
+
+	xyXCBConnection* m_pXCB = nullptr;
+	xcb_window_t m_Window = 0;
+	xcb_drawable_t m_PixelMap = 0;
+
+	// Wayland Data
+
+	std::unique_ptr< xyWindow >      m_pSurface;
+	std::optional< xyMessageResult > m_Dismissed; // Input is handled while events are dispatched, which is no time to destroy the box
+
+private:
+
+	std::span< const Button > GetButtons() const;
+	xcb_rectangle_t           GetButtonRectangle( size_t Index ) const;
+	int                       HitTest( int16_t X, int16_t Y ) const;
+
+	void    DrawText( int16_t X, int16_t Y, std::string_view Text );
+	int32_t MeasureText( std::string_view Text ) const;
+	void    Layout( size_t MaxWidth, size_t MaxHeight );
+	void    DrawMessageBox( const xyRect& rArea );
+	void    InvalidateButton( int Index );
+
+	int m_PressedButton = -1;
+
+	xyDamageRegion m_Damage; // Parts of the pixmap that are out of date
+
+	// Text is drawn on our side when there is a font for it, into pixels that are then copied to the pixmap.
+	// Otherwise it is drawn by the server with its "fixed" font, and there are no pixels.
+	bool                    m_ClientText  = false;
+	std::vector< uint32_t > m_Pixels;
+	int16_t                 m_FontAscent  = 0;
+	int16_t                 m_FontDescent = 0;
+
+};
+
+/*
+ * Bounded lock-free queue that any number of threads may push to, but only one thread may pop from.
+ * Every cell carries a sequence number that tells producers and the consumer whose turn it is to touch it.
+ * Values are written and consumed in place, so the cells double as a pool of preallocated slots.
+ */
+template< typename T, size_t Capacity >
+class xyMPSCQueue
+{
+	static_assert( std::has_single_bit( Capacity ), "Capacity must be a power of two" );
+
+public:
+
+	 xyMPSCQueue( void );
+
+	template< typename Writer > bool TryPush( Writer&& rrWrite );
+	template< typename Reader > bool TryPop ( Reader&& rrRead );
+
+private:
+
+	struct Cell
+	{
+		std::atomic< size_t > Sequence;
+		T                     Value;
+
+	}; // Cell
+
+	alignas( 64 ) std::array< Cell, Capacity > Cells;
+	alignas( 64 ) std::atomic< size_t >        Head = 0; // Next cell to be claimed by a producer
+	alignas( 64 ) size_t                       Tail = 0; // Next cell to be read by the consumer
+
+}; // xyMPSCQueue
+
+/*
+ * Queue of jobs for one consumer thread.
+ * The eventfd is only signaled when the queue goes from empty to non-empty, and the consumer runs every queued job per wakeup.
+ */
+class xyDispatchQueue
+{
+public:
+
+	 xyDispatchQueue( void );
+	~xyDispatchQueue( void );
+
+	template< typename Function >
+	void   Post ( Function&& rrFunction );
+	size_t Drain( void );
+	int    GetFD( void ) const { return EventFD; }
+
+private:
+
+	template< typename Function >
+	void PostUntraced( Function&& rrFunction );
+
+	xyMPSCQueue< xyJob, 2048 >        Jobs;
+	std::atomic< size_t >             Pending = 0; // Jobs that have been claimed by producers but not yet run
+	std::atomic< std::thread::id >    ConsumerThreadID;
+	int                               EventFD = -1;
+
+}; // xyDispatchQueue
+
+/*
+ * Single-threaded reactor built on one epoll set.
+ * File descriptors, timers and signals all end up as epoll sources, so the thread that runs the loop sleeps until one of them is ready.
+ * Sources may only be added or removed on the thread that runs the loop. Other threads should go through xyPostToMainThread.
+ *
+ * A signalfd only receives the signals that every thread has blocked, and threads inherit their mask from whoever started them.
+ * main() in xy-main.h calls BlockSignals before it starts any other thread, so only the signals in CatchableSignals are supported.
+ * A caught signal that has no callback gets its default action, just as if it had never been blocked.
+ * Programs with their own main() have to call BlockSignals themselves before they start any threads.
+ * Child processes inherit the blocked signals too, and should unblock them with POSIX_SPAWN_SETSIGMASK or before exec.
+ */
+class xyEventLoop
+{
+public:
+
+	static constexpr int CatchableSignals[] = { SIGHUP, SIGINT, SIGQUIT, SIGTERM, SIGUSR1, SIGUSR2 };
+
+	using FDCallback     = std::function< void( uint32_t Events ) >;
+	using TimerCallback  = std::function< void( void ) >;
+	using SignalCallback = std::function< void( const signalfd_siginfo& rInfo ) >;
+
+	 xyEventLoop( void );
+	~xyEventLoop( void );
+
+	bool AddFD       ( int FD, uint32_t Events, FDCallback Callback );
+	bool ModifyFD    ( int FD, uint32_t Events );
+	void RemoveFD    ( int FD );
+	int  AddTimer    ( std::chrono::nanoseconds Delay, std::chrono::nanoseconds Interval, TimerCallback Callback );
+	void RemoveTimer ( int TimerID );
+	void BlockSignals( void );
+	bool AddSignal   ( int Signal, SignalCallback Callback );
+	void RemoveSignal( int Signal );
+	bool RunOnce     ( int TimeoutMilliseconds );
+	void Run         ( void );
+	void Quit        ( void );
+
+private:
+
+	struct Source
+	{
+		FDCallback Callback;
+		uint32_t   Generation;
+		bool       OwnsFD;
+
+	}; // Source
+
+	bool AddSource( int FD, uint32_t Events, FDCallback Callback, bool OwnsFD );
+	void OnSignal ( void );
+
+	std::unordered_map< int, std::unique_ptr< Source > > Sources;
+	std::vector< std::unique_ptr< Source > >             RemovedSources; // Kept alive until the current batch of events has been handled
+	std::unordered_map< int, SignalCallback >            SignalCallbacks;
+	sigset_t                                             SignalMask;
+	uint32_t                                             NextGeneration = 0;
+	uint32_t                                             Depth          = 0; // How many RunOnce calls are on the stack
+	int                                                  EpollFD        = -1;
+	int                                                  SignalFD       = -1;
+	bool                                                 Quitting       = false;
+
+}; // xyEventLoop
+
+/*
+ * Reads the battery state from the power supply class in sysfs.
+ * Batteries are found once up front. After that their attribute files are kept open and reread in place with pread,
+ * so polling doesn't walk any paths nor allocate anything.
+ */
+class xyPowerSupplyMonitor
+{
+public:
+
+	explicit xyPowerSupplyMonitor( std::string_view Root = "/sys/class/power_supply" );
+	        ~xyPowerSupplyMonitor( void );
+
+	xyPowerSupplyMonitor( const xyPowerSupplyMonitor& ) = delete;
+	xyPowerSupplyMonitor& operator=( const xyPowerSupplyMonitor& ) = delete;
+
+	void           Discover( void );
+	xyBatteryState Read    ( void ) const;
+
+private:
+
+	struct Battery
+	{
+		int      CapacityFD = -1;
+		int      StatusFD   = -1;
+		uint64_t Weight     = 1; // Full charge or energy, so that a bigger battery counts for more
+
+	}; // Battery
+
+	void Close( void );
+
+	mutable std::mutex     Mutex; // Batteries are rediscovered on the main thread when one is plugged in or out
+	std::string            Root;
+	std::vector< Battery > Batteries;
+
+}; // xyPowerSupplyMonitor
+
+/*
+ * Watches the system for the changes that xySubscribe covers and calls the subscribers.
+ * Every source is served by the main event loop. A change is only reported after a short delay, so that a burst of events ends up as one call,
+ * and only if the value actually differs from the last one that was reported.
+ */
+class xyChangeNotifier
+{
+public:
+
+	explicit xyChangeNotifier( xyPlatformImpl& rPlatformImpl );
+	        ~xyChangeNotifier( void );
+
+	uint64_t Subscribe  ( xyChange Change, std::function< void( void ) > Callback );
+	void     Unsubscribe( uint64_t SubscriptionID );
+	void     Notify     ( xyChange Change );
+
+private:
+
+	static constexpr size_t ChangeCount = static_cast< size_t >( xyChange::Displays ) + 1;
+
+	struct Subscription
+	{
+		uint64_t                      ID;
+		xyChange                      Change;
+		std::function< void( void ) > Callback;
+
+	}; // Subscription
+
+	// What is set up for one kind of change, all of which is torn down again when its last subscriber leaves
+	struct Watch
+	{
+		std::vector< int > Directories;            // inotify watch descriptors, which Theme and Language may share
+		size_t             Subscribers   = 0;
+		int                PollTimerID   = -1;
+		int                NotifyTimerID = -1;     // The check that Notify has scheduled, if any
+		int                UEventFD      = -1;
+		bool               Watching      = false;
+
+	}; // Watch
+
+	void StartWatching ( xyChange Change );
+	void StopWatching  ( xyChange Change );
+	void WatchDirectory( xyChange Change, const std::string& rPath );
+	void OnUEvent      ( void );
+	void OnINotify     ( void );
+	bool Refresh       ( xyChange Change );
+
+	xyPlatformImpl&                        rPlatformImpl;
+	std::vector< Subscription >            Subscriptions;
+	std::unordered_map< int, std::string > WatchedDirectories; // inotify watch descriptor to path
+	std::array< Watch, ChangeCount >       Watches;
+	xyBatteryState                         LastBattery;
+	xyTheme                                LastTheme     = xyTheme::Light;
+	const xyLanguage*                      pLastLanguage = nullptr; // A snapshot, so it can be compared by address
+	std::string                            ThemeSettingsPath;
+	uint64_t                               NextID        = 1;
+	int                                    INotifyFD     = -1;
+
+}; // xyChangeNotifier
+
+/*
+ * A position of the mouse pointer and when it got there.
+ */
+struct xyMouseSample
+{
+	int32_t                               X = 0;
+	int32_t                               Y = 0;
+	std::chrono::steady_clock::time_point Time;
+
+}; // xyMouseSample
+
+/*
+ * Keeps track of the mouse pointer without asking the X server every time it is read.
+ * Raw motion events from XInput2 tell the main thread that the pointer moved. Each one sends off a pointer query, and the reply is picked up
+ * by the main loop instead of being waited for. The latest position is packed into a single atomic, and every position is also written to
+ * a ring buffer that can be drained by one reader at a time.
+ */
+class xyPointerSampler
+{
+public:
+
+	using Clock = std::chrono::steady_clock;
+
+	explicit xyPointerSampler( xyXCBConnection& rXCB );
+
+	void   Start       ( void );
+	bool   HandleEvent ( const xcb_generic_event_t* pEvent );
+	void   PollReplies ( void );
+	bool   GetLatest   ( int32_t& rX, int32_t& rY );
+	size_t DrainHistory( std::span< xyMouseSample > Samples );
+
+private:
+
+	static constexpr size_t MaxQueriesInFlight = 8;
+	static constexpr size_t HistoryCapacity    = 1024;
+
+	struct Query
+	{
+		xcb_query_pointer_cookie_t Cookie;
+		Clock::time_point          Time; // When the motion that caused the query arrived
+
+	}; // Query
+
+	struct Slot
+	{
+		std::atomic< uint64_t > Sequence = 0; // Odd while the slot is being written
+		std::atomic< uint64_t > Position = 0;
+		std::atomic< int64_t >  Time     = 0;
+
+	}; // Slot
+
+	static uint64_t Pack( const xcb_query_pointer_reply_t& rReply );
+
+	void SendQuery( Clock::time_point Time );
+	void Publish  ( const xcb_query_pointer_reply_t& rReply, Clock::time_point Time );
+
+	xyXCBConnection&                    rXCB;
+	std::deque< Query >                 Queries;          // Only touched on the main thread
+	std::optional< Clock::time_point >  MovedWhileBusy;   // Motion that arrived while too many queries were in flight
+	std::atomic< bool >                 Streaming = false;
+	std::atomic< uint64_t >             Latest    = 0;    // Valid bit, X and Y. Zero until the first position is known.
+	std::array< Slot, HistoryCapacity > History;
+	std::atomic< uint64_t >             Head      = 0;    // Total number of samples written
+	std::mutex                          DrainMutex;
+	uint64_t                            Tail      = 0;    // Total number of samples drained or skipped
+
+}; // xyPointerSampler
+
+/*
+ * A window that is drawn into by the CPU.
+ * The framebuffer is memory that is shared with the X server through MIT-SHM, so presenting a frame sends a small request instead of the pixels.
+ * There are two buffers, one to draw into while the server reads from the other. The server tells us when it is done with a buffer, and
+ * BeginFrame waits for that if both are taken, which keeps a renderer from queuing up frames faster than the server can show them.
+ * Servers that can't share memory with us, like those on other hosts, are sent the pixels through the socket instead.
+ * In a Wayland session the window is a surface of the compositor instead, which always shares memory. There BeginFrame also waits for
+ * the compositor to ask for the next frame, which paces drawing to the display.
+ */
+class xyWindow
+{
+public:
+
+	/*
+	 * The pixels of a frame, top row first. Each pixel is 0x00RRGGBB.
+	 */
+	struct Framebuffer
+	{
+		uint32_t* pPixels = nullptr;
+		uint32_t  Width   = 0;
+		uint32_t  Height  = 0;
+		uint32_t  Stride  = 0; // Pixels from the start of one row to the next
+
+		// Parts that changed in the frame before, which was drawn into the other buffer. They have to be redrawn along with whatever
+		// changes in this frame. Everything is stale in a new buffer.
+		std::span< const xyRect > Stale;
+
+	}; // Framebuffer
+
+	 xyWindow( void ) = default;
+	 xyWindow( const xyWindow& ) = delete;
+	~xyWindow( void );
+
+	xyWindow& operator=( const xyWindow& ) = delete;
+
+	// Opens the window. The framebuffer follows the size of the window, which may be changed by the user unless told otherwise.
+	bool Create( std::string_view Title, uint32_t Width, uint32_t Height, bool Resizable = true );
+
+	// Waits until a buffer is free to be drawn into and returns it. It stays valid until the next call to Present.
+	Framebuffer BeginFrame( void );
+
+	// Whether BeginFrame would return without waiting
+	bool IsFrameReady( void );
+
+	// Shows the buffer that was returned by BeginFrame. Only the damaged parts are sent, if they are given.
+	void Present( void );
+	void Present( std::span< const xyRect > Damage );
+
+	// False once the user has asked to close the window, or the connection to the server was lost
+	bool IsOpen( void ) const { return Open.load( std::memory_order_acquire ); }
+
+	// Whether frames are presented from shared memory rather than sent through the socket
+	bool IsSharingMemory( void ) const { return SharedMemory; }
+
+	// The surface of the window in a Wayland session, or null under X
+	wl_proxy* GetWaylandSurface( void ) const { return pSurface; }
+
+	// Called on the main thread
+	void HandleEvent( const xcb_generic_event_t* pEvent );
+	void Repaint    ( void );
+	void Close      ( void );
+
+private:
+
+	struct Buffer
+	{
+		uint32_t*      pPixels  = nullptr;
+		uint32_t       Offset   = 0; // From the start of the shared memory
+		uint32_t       InFlight = 0; // Presents of this buffer that the server hasn't finished reading
+		wl_proxy*      pBuffer  = nullptr; // On Wayland
+		xyDamageRegion Stale;
+
+	}; // Buffer
+
+	bool CreateSurface ( const std::string& rTitle, uint32_t NewWidth, uint32_t NewHeight, bool Resizable );
+	void DestroySurface( void );
+	bool Allocate      ( uint32_t NewWidth, uint32_t NewHeight, bool Verify );
+	void Release       ( void );
+	void Put           ( Buffer& rBuffer, std::span< const xyRect > Rects );
+
+	xyXCBConnection*        pXCB         = nullptr;
+	xcb_window_t            Window       = 0;
+	xcb_gcontext_t          GC           = 0;
+	std::atomic< bool >     Open         = false;
+	bool                    SharedMemory = false;
+	std::mutex              Mutex;                  // Guards the members below, which the main thread touches as well
+	std::condition_variable Released;               // Notified when a buffer is no longer in flight, or the window was closed
+	std::array< Buffer, 2 > Buffers;
+	size_t                  Current      = 0;       // The buffer that is being drawn into
+	bool                    Presented    = false;   // Whether the other buffer holds a frame that has been shown
+	xyDamageRegion          Exposed;                // Parts of the window that the server has lost since they were presented
+	void*                   pMemory      = nullptr;
+	size_t                  MemorySize   = 0;
+	uint32_t                Segment      = 0;       // The shared memory, as the server knows it
+	uint32_t                Width        = 0;       // Of the framebuffer
+	uint32_t                Height       = 0;
+	uint32_t                Stride       = 0;
+	uint32_t                WindowWidth  = 0;       // Of the window, once the server has told us
+	uint32_t                WindowHeight = 0;
+
+	// Wayland
+	xyWaylandConnection*    pWayland       = nullptr;
+	wl_proxy*               pSurface       = nullptr;
+	wl_proxy*               pXdgSurface    = nullptr;
+	wl_proxy*               pToplevel      = nullptr;
+	wl_proxy*               pPool          = nullptr;
+	wl_proxy*               pFrameCallback = nullptr; // Until the compositor asks for the next frame
+	bool                    Configured     = false;   // Nothing may be attached to the surface before the compositor has configured it
+
+}; // xyWindow
+
+/*
+ * Rasterised glyphs of one pixel size, packed into a map of 8-bit coverage.
+ * Every glyph of a size fits in the same height, so the map is cut into rows of that height which are filled from left to right. Once the
+ * map has reached its full size, the row that was used the longest ago is emptied to make room. That makes a whole row the unit of
+ * eviction, which is coarser than single glyphs but leaves no holes to keep track of.
+ */
+class xyGlyphAtlas
+{
+public:
+
+	static constexpr uint32_t Width     = 1024;
+	static constexpr uint32_t MaxHeight = 1024;
+
+	struct Entry
+	{
+		uint16_t X       = 0;
+		uint16_t Y       = 0;
+		uint16_t Width   = 0;
+		uint16_t Height  = 0;
+		int16_t  Left    = 0;          // From the pen position to the left edge of the bitmap
+		int16_t  Top     = 0;          // From the baseline up to the top edge of the bitmap
+		int32_t  Advance = 0;          // In 1/64 pixels
+		uint32_t Row     = UINT32_MAX; // Glyphs without pixels, like spaces, aren't in any row
+
+	}; // Entry
+
+	explicit xyGlyphAtlas( uint32_t RowHeight );
+
+	const Entry*   Find     ( uint32_t GlyphIndex, uint64_t Stamp );
+	const Entry&   Insert   ( uint32_t GlyphIndex, const uint8_t* pBitmap, int32_t Pitch, uint32_t BitmapWidth, uint32_t BitmapHeight, int32_t Left, int32_t Top, int32_t Advance, uint64_t Stamp );
+	const uint8_t* GetPixels( void ) const { return Pixels.data(); }
+
+	// Kerning of pairs of glyphs in 1/64 pixels, which FreeType is slow to look up. Cleared when it grows too large.
+	std::unordered_map< uint64_t, int32_t > Kerning;
+
+private:
+
+	struct Row
+	{
+		uint32_t                Used     = 0; // Pixels taken from the left
+		uint64_t                LastUsed = 0;
+		std::vector< uint32_t > Glyphs;
+
+	}; // Row
+
+	uint32_t FindRow( uint32_t GlyphWidth, uint64_t Stamp );
+
+	uint32_t                                RowHeight;
+	std::vector< uint8_t >                  Pixels;
+	std::vector< Row >                      Rows;
+	std::unordered_map< uint32_t, Entry >   Entries;
+
+}; // xyGlyphAtlas
+
+/*
+ * A line of text that has been turned into glyphs and positioned.
+ * Shaping into the same run again reuses its memory, so keep one around for text that is drawn every frame.
+ */
+struct xyGlyphRun
+{
+	struct Glyph
+	{
+		int32_t  X      = 0; // Top left corner, relative to the start of the baseline
+		int32_t  Y      = 0;
+		uint16_t AtlasX = 0;
+		uint16_t AtlasY = 0;
+		uint16_t Width  = 0;
+		uint16_t Height = 0;
+
+	}; // Glyph
+
+	std::vector< Glyph > Glyphs;
+	std::wstring         Codepoints;       // The decoded text, which is only kept to reuse its memory
+	int32_t              Width  = 0;       // From the start of the baseline to the pen position after the last glyph
+	const xyGlyphAtlas*  pAtlas = nullptr; // Where the pixels of the glyphs are
+
+}; // xyGlyphRun
+
+#if defined( XY_HAS_FREETYPE )
+
+/*
+ * Draws text on the CPU with FreeType.
+ * Glyphs are rasterised once into an atlas for their size, and composited from there into any framebuffer. Shaping goes as far as
+ * kerning, which is as far as Latin, Greek and Cyrillic need.
+ */
+class xyTextEngine
+{
+public:
+
+	~xyTextEngine( void );
+
+	bool   Load      ( void );
+	bool   GetMetrics( uint32_t NewPixelSize, int32_t& rAscent, int32_t& rDescent );
+	void   Shape     ( std::string_view Text, uint32_t NewPixelSize, xyGlyphRun& rRun );
+	xyRect Composite ( const xyGlyphRun& rRun, const xyWindow::Framebuffer& rFrame, int32_t X, int32_t Baseline, uint32_t Color ) const;
+
+	std::mutex Mutex; // Neither FreeType faces nor the atlases may be used by several threads at once
+
+private:
+
+	xyGlyphAtlas& SelectSize( uint32_t NewPixelSize );
+
+	FT_Library                                                 Library   = nullptr;
+	FT_Face                                                    Face      = nullptr;
+	uint32_t                                                   PixelSize = 0;
+	uint64_t                                                   Stamp     = 0; // Bumped for every run, which is what the atlases count as a use
+	std::unordered_map< uint32_t, std::unique_ptr< xyGlyphAtlas > > Atlases;
+	std::unordered_map< wchar_t, FT_UInt >                     GlyphIndices; // Looking through the character map of the face takes longer than this
+
+}; // xyTextEngine
+
+#endif // XY_HAS_FREETYPE
+
+/*
+ * Small pool of threads for work that should not block the caller nor the main thread.
+ */
+class xyWorkerPool
+{
+public:
+
+	explicit xyWorkerPool( size_t ThreadCount );
+	        ~xyWorkerPool( void );
+
+	template< typename Function >
+	void Post( Function&& rrFunction );
+
+private:
+
+	void WorkerMain( void );
+
+	std::mutex                 Mutex;
+	std::condition_variable    Condition;
+	std::deque< xyJob >        Jobs;
+	std::vector< std::thread > Threads;
+	bool                       Stopping = false;
+
+}; // xyWorkerPool
+
+/*
+ * Threads for queries that may never return, such as a read from a hung file system or a display server that stopped answering.
+ * Unlike those of xyWorkerPool, the threads are never joined. They share their state with the pool, so one that is stuck keeps the state
+ * alive after the pool is gone rather than holding up its destruction. Threads are started as jobs need them, up to MaxThreads.
+ */
+class xyQueryPool
+{
+public:
+
+	explicit xyQueryPool( size_t MaxThreads );
+	        ~xyQueryPool( void );
+
+	template< typename Function >
+	void Post( Function&& rrFunction );
+
+private:
+
+	struct Shared
+	{
+		std::mutex              Mutex;
+		std::condition_variable Condition;
+		std::deque< xyJob >     Jobs;
+		size_t                  IdleThreads = 0;
+		bool                    Stopping    = false;
+
+	}; // Shared
+
+	static void WorkerMain( std::shared_ptr< Shared > pShared );
+
+	std::shared_ptr< Shared > pShared;
+	size_t                    MaxThreads;
+	size_t                    Threads = 0;
+
+}; // xyQueryPool
+
+/*
+ * Awaitable that continues a coroutine on the main thread.
+ */
+struct xyMainThreadAwaiter
+{
+	bool await_ready  ( void ) const;
+	void await_suspend( std::coroutine_handle<> Handle ) const;
+	void await_resume ( void ) const { }
+
+}; // xyMainThreadAwaiter
+
+/*
+ * Awaitable that continues a coroutine on one of the worker threads.
+ */
+struct xyWorkerAwaiter
+{
+	bool await_ready  ( void ) const { return false; }
+	void await_suspend( std::coroutine_handle<> Handle ) const;
+	void await_resume ( void ) const { }
+
+}; // xyWorkerAwaiter
+
+struct xyPlatformImpl
+{
+	xyPlatformImpl( void );
+
+	std::future< xyMessageResult > xyCreateMsgBox( std::string_view Title, std::string_view Message, xyMessageButtons = xyMessageButtons::Ok );
+
+	// Only touched on the main thread. Wayland has no window IDs, so its boxes and windows are found by their surfaces.
+	std::unordered_map< xcb_window_t, std::unique_ptr< xyMessageBoxData > > MessageBoxes;
+	std::unordered_map< xcb_window_t, xyWindow* >                           Windows;
+	std::unordered_map< wl_proxy*, std::unique_ptr< xyMessageBoxData > >    WaylandMessageBoxes;
+	std::unordered_map< wl_proxy*, xyWindow* >                              WaylandWindows;
+
+	xyXCBConnection*     GetXCB                    ( void );
+	void                 OnXCBEvents               ( void );
+	xyWaylandConnection* GetWayland                ( void );
+	void                 OnWaylandEvents           ( void );
+	void                 OnWaylandButton           ( wl_proxy* pSurface, int32_t X, int32_t Y, bool Pressed );
+	void                 ResolveWaylandMessageBoxes( void );
+	xyWorkerPool&        GetWorkerPool             ( void );
+
+	xyPowerSupplyMonitor& GetPowerSupplyMonitor( void );
+	xyChangeNotifier&     GetChangeNotifier    ( void );
+	xyPointerSampler*     GetPointerSampler    ( void );
+#if defined( XY_HAS_FREETYPE )
+	xyTextEngine*         GetTextEngine        ( void );
+#endif // XY_HAS_FREETYPE
+
+	std::vector< xyDisplayAdapter >                  GetDisplayAdapters       ( void );
+	std::optional< std::vector< xyDisplayAdapter > > PeekDisplayAdapters      ( void );
+	void                                             InvalidateDisplayAdapters( void );
+
+	xyEventLoop     EventLoop;
+	xyDispatchQueue MainThreadQueue;
+	std::thread::id MainThreadID;
+
+	std::once_flag                     XCBFlag;
+	std::unique_ptr< xyXCBConnection > pXCB;
+
+	std::once_flag                         WaylandFlag;
+	std::unique_ptr< xyWaylandConnection > pWayland;
+
+	std::once_flag                          PowerSupplyMonitorFlag;
+	std::unique_ptr< xyPowerSupplyMonitor > pPowerSupplyMonitor;
+
+	std::unique_ptr< xyChangeNotifier > pChangeNotifier; // Only touched on the main thread
+
+	std::once_flag                      PointerSamplerFlag;
+	std::unique_ptr< xyPointerSampler > pPointerSampler;
+	xyPointerSampler*                   pActivePointerSampler = nullptr; // Set on the main thread once the sampler is listening for motion
+
+#if defined( XY_HAS_FREETYPE )
+	std::once_flag                  TextEngineFlag;
+	std::unique_ptr< xyTextEngine > pTextEngine;
+#endif // XY_HAS_FREETYPE
+
+	std::mutex                      DisplayAdaptersMutex;
+	std::vector< xyDisplayAdapter > DisplayAdapters;
+	uint64_t                        DisplayAdaptersGeneration = 1; // Bumped on every change. The cache is valid while it matches CachedGeneration.
+	uint64_t                        CachedGeneration          = 0;
+
+	// Snapshot queries hold a reference to us for as long as they run, so they are free to outlive the app. See xyGetSystemSnapshot.
+	xyQueryPool            QueryPool{ 5 };     // A thread for each field of the snapshot, since no field has more than one query running
+	std::atomic< uint8_t > RunningQueries = 0; // XY_SNAPSHOT_* bits of the fields whose queries haven't returned yet
+
+	// Declared last so that it is destroyed first, since the jobs that are still queued may use any of the above
+	std::once_flag                  WorkerPoolFlag;
+	std::unique_ptr< xyWorkerPool > pWorkerPool;
+
+}; // xyPlatformImpl
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Linux-specific functions
+
+/**
+ * Suspends the calling coroutine and resumes it on the main thread.
+ * Nothing is suspended if the coroutine is already running on the main thread.
+ *
+ * Example: co_await xyResumeOnMainThread();
+ *
+ * @return The awaitable object.
+ */
+extern xyMainThreadAwaiter xyResumeOnMainThread( void );
+
+/**
+ * Suspends the calling coroutine and resumes it on a worker thread.
+ *
+ * Example: co_await xyResumeOnWorker();
+ *
+ * @return The awaitable object.
+ */
+extern xyWorkerAwaiter xyResumeOnWorker( void );
+
+/**
+ * Sets the function that is called when the X server reports that one of our requests failed.
+ * Requests are sent without waiting for the server, so the errors arrive later on and are handled on the main thread.
+ * By default the errors are ignored.
+ *
+ * @param Callback The function that receives the error.
+ */
+extern void xySetXCBErrorCallback( xyXCBConnection::ErrorCallback Callback );
+
+/**
+ * Checks whether there is a display server to connect to, without connecting to it nor loading any of its libraries.
+ * A Wayland compositor is found through $WAYLAND_DISPLAY, and a local X server through $DISPLAY and its socket.
+ * X servers on other hosts are assumed to be there, since finding out would take a trip over the network.
+ *
+ * @return True if a display server was found.
+ */
+extern bool xyHasDisplayServer( void );
+
+/**
+ * Obtains the directory where the user's configuration files are kept.
+ * This is $XDG_CONFIG_HOME if it is set, or ~/.config otherwise.
+ *
+ * @return The path to the directory.
+ */
+extern std::string xyGetConfigDirectory( void );
+
+/**
+ * Reads a value from a file made up of 'Key=Value' lines, like locale.conf or GTK's settings.ini.
+ * Whitespace around the key and value is ignored, as are quotes around the value.
+ *
+ * @param rPath The path to the file.
+ * @param Key The key of the value to read.
+ * @return The value, or nothing if either the file or the key doesn't exist.
+ */
+extern std::optional< std::string > xyReadConfigValue( const std::string& rPath, std::string_view Key );
+
+/**
+ * Moves the mouse positions that were recorded since the last call into a buffer, oldest first.
+ * Positions that don't fit are kept for the next call. The history holds the last 1024 positions, so older ones are lost if it isn't
+ * drained often enough. Recording starts with the first call to this function or to xyGetMouse, and needs XInput2.
+ *
+ * Example: Call once per frame to get every position the pointer passed through since the last frame.
+ *
+ * @param Samples The buffer that receives the positions.
+ * @return The number of positions that were written to the buffer.
+ */
+extern size_t xyDrainMouseHistory( std::span< xyMouseSample > Samples );
+
+/**
+ * Obtains the vertical metrics of the font that text is drawn with.
+ * The font is $XY_FONT if it is set, or the first of a few common sans-serif fonts that is installed. Text needs FreeType, which is
+ * looked for when the framework is built and loaded when text is first used.
+ *
+ * @param PixelSize The size of the font in pixels.
+ * @param rAscent Receives the distance from the baseline to the top of the tallest glyph.
+ * @param rDescent Receives the distance from the baseline to the bottom of the lowest glyph.
+ * @return True if there is a font to draw text with.
+ */
+extern bool xyGetFontMetrics( uint32_t PixelSize, int32_t& rAscent, int32_t& rDescent );
+
+/**
+ * Measures how wide a line of text is when drawn.
+ *
+ * @param Text The text, in UTF-8.
+ * @param PixelSize The size of the font in pixels.
+ * @return The width in pixels, or 0 if there is no font to draw text with.
+ */
+extern int32_t xyMeasureText( std::string_view Text, uint32_t PixelSize );
+
+/**
+ * Draws a line of text into a framebuffer, blending it over what is already there.
+ * Glyphs are rasterised the first time they are used at a size and copied from a cache after that, so drawing is mostly a matter of
+ * blending. Text that falls outside of the framebuffer is clipped.
+ *
+ * Example: Pass the rectangle that is returned on to xyWindow::Present as damage.
+ *
+ * @param rFrame The framebuffer to draw into.
+ * @param Text The text, in UTF-8.
+ * @param X The left edge of the text.
+ * @param Baseline The line that the text sits on.
+ * @param PixelSize The size of the font in pixels.
+ * @param Color The color of the text, as 0x00RRGGBB.
+ * @param rRun The buffer that the text is shaped into. Reusing it between calls saves allocating a new one every time.
+ * @return The part of the framebuffer that was drawn to, which is empty if nothing was.
+ */
+extern xyRect xyDrawText( const xyWindow::Framebuffer& rFrame, std::string_view Text, int32_t X, int32_t Baseline, uint32_t PixelSize, uint32_t Color, xyGlyphRun& rRun );
+
+/**
+ * Draws a line of text into a framebuffer, blending it over what is already there.
+ * Same as the above, with a glyph run that is kept for each thread.
+ *
+ * @param rFrame The framebuffer to draw into.
+ * @param Text The text, in UTF-8.
+ * @param X The left edge of the text.
+ * @param Baseline The line that the text sits on.
+ * @param PixelSize The size of the font in pixels.
+ * @param Color The color of the text, as 0x00RRGGBB.
+ * @return The part of the framebuffer that was drawn to, which is empty if nothing was.
+ */
+extern xyRect xyDrawText( const xyWindow::Framebuffer& rFrame, std::string_view Text, int32_t X, int32_t Baseline, uint32_t PixelSize, uint32_t Color );
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Linux-specific template functions
+
+/**
+ * Queues a callable object to be run on the main thread and returns immediately.
+ *
+ * @param rrFunction The object that gets called.
+ */
+template< typename Function >
+void xyPostToMainThread( Function&& rrFunction )
+{
+	xyGetContext().pPlatformImpl->MainThreadQueue.Post( std::forward< Function >( rrFunction ) );
+
+} // xyPostToMainThread
+
+/**
+ * Queues a callable object to be run on the main thread and returns a future for its result.
+ * The arguments are copied so that the caller does not have to keep them alive.
+ *
+ * @param rrFunction The object that gets called.
+ * @param rrArgs Optional arguments that gets passed to the function.
+ * @return A future that receives the return value, or the exception thrown by the call.
+ */
+template< typename Function, typename... Args >
+auto xyRunOnMainThreadAsync( Function&& rrFunction, Args&&... rrArgs )
+{
+	using ReturnType = std::invoke_result_t< std::decay_t< Function >, std::decay_t< Args >... >;
+
+	std::promise< ReturnType > Promise;
+	std::future< ReturnType >  Future = Promise.get_future();
+
+	xyPostToMainThread( [ Promise = std::move( Promise ), Callback = std::forward< Function >( rrFunction ), Arguments = std::make_tuple( std::forward< Args >( rrArgs )... ) ]( void ) mutable
+	{
+		try
+		{
+			if constexpr( std::is_void_v< ReturnType > )
+			{
+				std::apply( Callback, std::move( Arguments ) );
+				Promise.set_value();
+			}
+			else
+			{
+				Promise.set_value( std::apply( Callback, std::move( Arguments ) ) );
+			}
+		}
+		catch( ... )
+		{
+			Promise.set_exception( std::current_exception() );
+		}
+	} );
+
+	return Future;
+
+} // xyRunOnMainThreadAsync
+
+/**
+ * Runs a callable object on the main thread and waits for it to finish.
+ * If this is called from the main thread, the object is called immediately.
+ *
+ * @param rrFunction The object that gets called.
+ * @param rrArgs Optional arguments that gets passed to the function.
+ */
+template< typename Function, typename... Args
+        , typename = typename std::enable_if_t< std::is_void_v< std::invoke_result_t< Function, Args... > > > >
+void xyRunOnMainThread( Function&& rrFunction, Args&&... rrArgs )
+{
+	xyContext& rContext = xyGetContext();
+
+	if( std::this_thread::get_id() == rContext.pPlatformImpl->MainThreadID )
+		return std::invoke( std::forward< Function >( rrFunction ), std::forward< Args >( rrArgs )... );
+
+	// The caller is blocked until the call has finished, so the job only needs to capture references to its stack
+	xyCompletion Finished;
+	rContext.pPlatformImpl->MainThreadQueue.Post( [ & ]
+	{
+		std::invoke( std::forward< Function >( rrFunction ), std::forward< Args >( rrArgs )... );
+		Finished.Signal();
+	} );
+
+	Finished.Wait();
+
+} // xyRunOnMainThread
+
+/**
+ * Runs a callable object on the main thread and waits for it to finish.
+ * If this is called from the main thread, the object is called immediately.
+ *
+ * @param rrFunction The object that gets called.
+ * @param rrArgs Optional arguments that gets passed to the function.
+ * @return The return value of the call.
+ */
+template< typename Function, typename... Args
+        , typename = typename std::enable_if_t< !std::is_void_v< std::invoke_result_t< Function, Args... > > > >
+auto xyRunOnMainThread( Function&& rrFunction, Args&&... rrArgs )
+{
+	using ReturnType = std::invoke_result_t< Function, Args... >;
+
+	xyContext& rContext = xyGetContext();
+
+	if( std::this_thread::get_id() == rContext.pPlatformImpl->MainThreadID )
+		return std::invoke( std::forward< Function >( rrFunction ), std::forward< Args >( rrArgs )... );
+
+	// The caller is blocked until the call has finished, so the job only needs to capture references to its stack
+	std::optional< ReturnType > ReturnValue;
+	xyCompletion                Finished;
+	rContext.pPlatformImpl->MainThreadQueue.Post( [ & ]
+	{
+		ReturnValue.emplace( std::invoke( std::forward< Function >( rrFunction ), std::forward< Args >( rrArgs )... ) );
+		Finished.Signal();
+	} );
+
+	Finished.Wait();
+
+	return ReturnType( std::move( *ReturnValue ) );
+
+} // xyRunOnMainThread
+
+//////////////////////////////////////////////////////////////////////////
+/*
+
+██╗███╗   ███╗██████╗ ██╗     ███████╗███╗   ███╗███████╗███╗   ██╗████████╗ █████╗ ████████╗██╗ ██████╗ ███╗   ██╗
+██║████╗ ████║██╔══██╗██║     ██╔════╝████╗ ████║██╔════╝████╗  ██║╚══██╔══╝██╔══██╗╚══██╔══╝██║██╔═══██╗████╗  ██║
+██║██╔████╔██║██████╔╝██║     █████╗  ██╔████╔██║█████╗  ██╔██╗ ██║   ██║   ███████║   ██║   ██║██║   ██║██╔██╗ ██║
+██║██║╚██╔╝██║██╔═══╝ ██║     ██╔══╝  ██║╚██╔╝██║██╔══╝  ██║╚██╗██║   ██║   ██╔══██║   ██║   ██║██║   ██║██║╚██╗██║
+██║██║ ╚═╝ ██║██║     ███████╗███████╗██║ ╚═╝ ██║███████╗██║ ╚████║   ██║   ██║  ██║   ██║   ██║╚██████╔╝██║ ╚████║
+╚═╝╚═╝     ╚═╝╚═╝     ╚══════╝╚══════╝╚═╝     ╚═╝╚══════╝╚═╝  ╚═══╝   ╚═╝   ╚═╝  ╚═╝   ╚═╝   ╚═╝ ╚═════╝ ╚═╝  ╚═══╝
+*/
+#if defined( XY_IMPLEMENT )
+
+template< typename T, size_t Capacity >
+xyMPSCQueue< T, Capacity >::xyMPSCQueue( void )
+{
+	for( size_t i = 0; i < Capacity; ++i )
+		Cells[ i ].Sequence.store( i, std::memory_order_relaxed );
+
+} // xyMPSCQueue
+
+//////////////////////////////////////////////////////////////////////////
+
+template< typename T, size_t Capacity >
+template< typename Writer >
+bool xyMPSCQueue< T, Capacity >::TryPush( Writer&& rrWrite )
+{
+	size_t Position = Head.load( std::memory_order_relaxed );
+	Cell*  pCell;
+
+	while( true )
+	{
+		pCell = &Cells[ Position & ( Capacity - 1 ) ];
+
+		const size_t    Sequence   = pCell->Sequence.load( std::memory_order_acquire );
+		const ptrdiff_t Difference = static_cast< ptrdiff_t >( Sequence ) - static_cast< ptrdiff_t >( Position );
+
+		// The cell is free for this lap. Try to claim it.
+		if( Difference == 0 )
+		{
+			if( Head.compare_exchange_weak( Position, Position + 1, std::memory_order_relaxed ) )
+				break;
+		}
+		// The consumer has not gotten around to this cell yet, meaning that the queue is full
+		else if( Difference < 0 )
+		{
+			return false;
+		}
+		// Another producer claimed the cell first
+		else
+		{
+			Position = Head.load( std::memory_order_relaxed );
+		}
+	}
+
+	rrWrite( pCell->Value );
+	pCell->Sequence.store( Position + 1, std::memory_order_release );
+
+	return true;
+
+} // TryPush
+
+//////////////////////////////////////////////////////////////////////////
+
+template< typename T, size_t Capacity >
+template< typename Reader >
+bool xyMPSCQueue< T, Capacity >::TryPop( Reader&& rrRead )
+{
+	Cell& rCell = Cells[ Tail & ( Capacity - 1 ) ];
+
+	if( rCell.Sequence.load( std::memory_order_acquire ) != Tail + 1 )
+		return false;
+
+	rrRead( rCell.Value );
+
+	// Hand the cell back to the producers for the next lap
+	rCell.Sequence.store( Tail + Capacity, std::memory_order_release );
+	++Tail;
+
+	return true;
+
+} // TryPop
+
+//////////////////////////////////////////////////////////////////////////
+
+xyDispatchQueue::xyDispatchQueue( void )
+	: EventFD( eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) )
+{
+} // xyDispatchQueue
+
+//////////////////////////////////////////////////////////////////////////
+
+xyDispatchQueue::~xyDispatchQueue( void )
+{
+	if( EventFD >= 0 )
+		close( EventFD );
+
+} // ~xyDispatchQueue
+
+//////////////////////////////////////////////////////////////////////////
+
+template< typename Function >
+void xyDispatchQueue::Post( Function&& rrFunction )
+{
+
+#if defined( XY_ENABLE_TRACING )
+
+	// Connect the job to where it was posted from
+	if( xyTracer::Get().IsActive() )
+	{
+		XY_TRACE_SCOPE( "xyDispatchQueue::Post" );
+
+		const uint64_t FlowID = xyTracer::NextID();
+		XY_TRACE_FLOW_BEGIN( "Dispatch", FlowID );
+
+		PostUntraced( [ FlowID, Callback = std::forward< Function >( rrFunction ) ]( void ) mutable
+		{
+			XY_TRACE_SCOPE( "Dispatch" );
+			XY_TRACE_FLOW_END( "Dispatch", FlowID );
+			std::invoke( Callback );
+		} );
+
+		return;
+	}
+
+#endif // XY_ENABLE_TRACING
+
+	PostUntraced( std::forward< Function >( rrFunction ) );
+
+} // Post
+
+//////////////////////////////////////////////////////////////////////////
+
+template< typename Function >
+void xyDispatchQueue::PostUntraced( Function&& rrFunction )
+{
+	const size_t PreviouslyPending = Pending.fetch_add( 1, std::memory_order_acq_rel );
+
+	// Wait for the consumer to make room
+	while( !Jobs.TryPush( [ & ]( xyJob& rJob ) { rJob.Emplace( std::forward< Function >( rrFunction ) ); } ) )
+	{
+		// The consumer can't make room while it is the one waiting, so run the job right away instead
+		if( std::this_thread::get_id() == ConsumerThreadID.load( std::memory_order_relaxed ) )
+		{
+			Pending.fetch_sub( 1, std::memory_order_acq_rel );
+			std::invoke( std::forward< Function >( rrFunction ) );
+			return;
+		}
+
+		std::this_thread::yield();
+	}
+
+	// Only the job that makes the queue non-empty needs to wake up the consumer
+	if( PreviouslyPending == 0 )
+	{
+		const uint64_t One = 1;
+		( void )!write( EventFD, &One, sizeof( One ) );
+	}
+
+} // PostUntraced
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t xyDispatchQueue::Drain( void )
+{
+	XY_TRACE_SCOPE( "xyDispatchQueue::Drain" );
+
+	uint64_t Signals;
+	( void )!read( EventFD, &Signals, sizeof( Signals ) );
+
+	ConsumerThreadID.store( std::this_thread::get_id(), std::memory_order_relaxed );
+
+	size_t Total = 0;
+
+	while( true )
+	{
+		size_t Count = 0;
+
+		while( Jobs.TryPop( []( xyJob& rJob ) { rJob.Run(); } ) )
+			++Count;
+
+		Total += Count;
+
+		// If nothing was added while we were busy, the queue is empty and the next producer will signal us again
+		if( Pending.fetch_sub( Count, std::memory_order_acq_rel ) == Count )
+			break;
+
+		// A producer has claimed a cell but not filled it yet
+		if( Count == 0 )
+			std::this_thread::yield();
+	}
+
+	XY_TRACE_COUNTER( "Dispatched jobs", Total );
+
+	return Total;
+
+} // Drain
+
+//////////////////////////////////////////////////////////////////////////
+
+xyEventLoop::xyEventLoop( void )
+	: EpollFD( epoll_create1( EPOLL_CLOEXEC ) )
+{
+	sigemptyset( &SignalMask );
+
+} // xyEventLoop
+
+//////////////////////////////////////////////////////////////////////////
+
+xyEventLoop::~xyEventLoop( void )
+{
+	for( auto& [ FD, pSource ] : Sources )
+	{
+		if( pSource->OwnsFD )
+			close( FD );
+	}
+
+	if( SignalFD >= 0 )
+		close( SignalFD );
+
+	if( EpollFD >= 0 )
+		close( EpollFD );
+
+} // ~xyEventLoop
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyEventLoop::AddSource( int FD, uint32_t Events, FDCallback Callback, bool OwnsFD )
+{
+	if( FD < 0 || Sources.contains( FD ) )
+		return false;
+
+	auto pSource = std::make_unique< Source >( std::move( Callback ), NextGeneration++, OwnsFD );
+
+	// The generation lets us tell apart a stale event from a new source that happened to reuse the same fd within one batch
+	epoll_event Event = { .events=Events, .data={ .u64=( static_cast< uint64_t >( pSource->Generation ) << 32 ) | static_cast< uint32_t >( FD ) } };
+
+	if( epoll_ctl( EpollFD, EPOLL_CTL_ADD, FD, &Event ) != 0 )
+		return false;
+
+	Sources.emplace( FD, std::move( pSource ) );
+
+	return true;
+
+} // AddSource
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyEventLoop::AddFD( int FD, uint32_t Events, FDCallback Callback )
+{
+	return AddSource( FD, Events, std::move( Callback ), false );
+
+} // AddFD
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyEventLoop::ModifyFD( int FD, uint32_t Events )
+{
+	auto It = Sources.find( FD );
+	if( It == Sources.end() )
+		return false;
+
+	epoll_event Event = { .events=Events, .data={ .u64=( static_cast< uint64_t >( It->second->Generation ) << 32 ) | static_cast< uint32_t >( FD ) } };
+
+	return epoll_ctl( EpollFD, EPOLL_CTL_MOD, FD, &Event ) == 0;
+
+} // ModifyFD
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyEventLoop::RemoveFD( int FD )
+{
+	auto It = Sources.find( FD );
+	if( It == Sources.end() )
+		return;
+
+	epoll_ctl( EpollFD, EPOLL_CTL_DEL, FD, nullptr );
+
+	if( It->second->OwnsFD )
+		close( FD );
+
+	// The source may be the one whose callback is running right now
+	RemovedSources.push_back( std::move( It->second ) );
+	Sources.erase( It );
+
+} // RemoveFD
+
+//////////////////////////////////////////////////////////////////////////
+
+int xyEventLoop::AddTimer( std::chrono::nanoseconds Delay, std::chrono::nanoseconds Interval, TimerCallback Callback )
+{
+	const int TimerFD = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+	if( TimerFD < 0 )
+		return -1;
+
+	// A zero it_value would disarm the timer, so an immediate timer fires after one nanosecond instead
+	Delay = std::max( Delay, std::chrono::nanoseconds( 1 ) );
+
+	const itimerspec Spec =
+	{
+		.it_interval={ .tv_sec=static_cast< time_t >( Interval.count() / 1'000'000'000 ), .tv_nsec=static_cast< long >( Interval.count() % 1'000'000'000 ) },
+		.it_value   ={ .tv_sec=static_cast< time_t >( Delay.count()    / 1'000'000'000 ), .tv_nsec=static_cast< long >( Delay.count()    % 1'000'000'000 ) },
+	};
+
+	timerfd_settime( TimerFD, 0, &Spec, nullptr );
+
+	const bool Repeating = Interval.count() > 0;
+	const bool Added     = AddSource( TimerFD, EPOLLIN, [ this, TimerFD, Repeating, Callback = std::move( Callback ) ]( uint32_t )
+	{
+		uint64_t Expirations;
+		if( read( TimerFD, &Expirations, sizeof( Expirations ) ) != sizeof( Expirations ) )
+			return;
+
+		// One-shot timers are removed before the call so that the callback is free to add a new one
+		if( !Repeating )
+			RemoveFD( TimerFD );
+
+		Callback();
+
+	}, true );
+
+	if( !Added )
+	{
+		close( TimerFD );
+		return -1;
+	}
+
+	return TimerFD;
+
+} // AddTimer
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyEventLoop::RemoveTimer( int TimerID )
+{
+	RemoveFD( TimerID );
+
+} // RemoveTimer
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyEventLoop::BlockSignals( void )
+{
+	if( SignalFD >= 0 )
+		return;
+
+	// The whole set is blocked once and for all. Changing it later would only affect the calling thread.
+	for( const int Signal : CatchableSignals )
+		sigaddset( &SignalMask, Signal );
+
+	pthread_sigmask( SIG_BLOCK, &SignalMask, nullptr );
+
+	SignalFD = signalfd( -1, &SignalMask, SFD_NONBLOCK | SFD_CLOEXEC );
+	if( SignalFD >= 0 )
+		AddSource( SignalFD, EPOLLIN, [ this ]( uint32_t ) { OnSignal(); }, false );
+
+} // BlockSignals
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyEventLoop::AddSignal( int Signal, SignalCallback Callback )
+{
+	if( std::ranges::find( CatchableSignals, Signal ) == std::end( CatchableSignals ) )
+		return false;
+
+	// Only takes effect for this thread and the ones it starts from now on, see BlockSignals
+	BlockSignals();
+
+	if( SignalFD < 0 )
+		return false;
+
+	SignalCallbacks[ Signal ] = std::move( Callback );
+
+	return true;
+
+} // AddSignal
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyEventLoop::RemoveSignal( int Signal )
+{
+	// The signal stays blocked, and gets its default action from now on
+	SignalCallbacks.erase( Signal );
+
+} // RemoveSignal
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyEventLoop::OnSignal( void )
+{
+	signalfd_siginfo Infos[ 8 ];
+	ssize_t          Size;
+
+	while( ( Size = read( SignalFD, Infos, sizeof( Infos ) ) ) > 0 )
+	{
+		for( size_t i = 0; i < static_cast< size_t >( Size ) / sizeof( signalfd_siginfo ); ++i )
+		{
+			const int Signal = static_cast< int >( Infos[ i ].ssi_signo );
+
+			if( auto It = SignalCallbacks.find( Signal ); It != SignalCallbacks.end() )
+			{
+				It->second( Infos[ i ] );
+			}
+			else
+			{
+				// Nobody asked for it. Raise it again with this thread unblocked, which usually terminates the process.
+				sigset_t Unblock;
+				sigemptyset( &Unblock );
+				sigaddset( &Unblock, Signal );
+
+				pthread_sigmask( SIG_UNBLOCK, &Unblock, nullptr );
+				raise( Signal );
+				pthread_sigmask( SIG_BLOCK, &Unblock, nullptr );
+			}
+		}
+	}
+
+} // OnSignal
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyEventLoop::RunOnce( int TimeoutMilliseconds )
+{
+	epoll_event Events[ 32 ];
+	const int   Count = epoll_wait( EpollFD, Events, std::size( Events ), TimeoutMilliseconds );
+
+	XY_TRACE_SCOPE( "xyEventLoop::RunOnce" );
+
+	++Depth;
+
+	for( int i = 0; i < Count && !Quitting; ++i )
+	{
+		const int      FD         = static_cast< int >( Events[ i ].data.u64 & 0xFFFFFFFF );
+		const uint32_t Generation = static_cast< uint32_t >( Events[ i ].data.u64 >> 32 );
+		auto           It         = Sources.find( FD );
+
+		// Skip sources that were removed by an earlier callback in this batch
+		if( It == Sources.end() || It->second->Generation != Generation )
+			continue;
+
+		// Hold on to the source in case the callback removes it
+		Source* pSource = It->second.get();
+		pSource->Callback( Events[ i ].events );
+	}
+
+	// A callback may run a nested loop, in which case the outer call is still using its source
+	if( --Depth == 0 )
+		RemovedSources.clear();
+
+	return !Quitting;
+
+} // RunOnce
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyEventLoop::Run( void )
+{
+	Quitting = false;
+
+	while( RunOnce( -1 ) ) { }
+
+} // Run
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyEventLoop::Quit( void )
+{
+	Quitting = true;
+
+} // Quit
+
+//////////////////////////////////////////////////////////////////////////
+
+xyWorkerPool::xyWorkerPool( size_t ThreadCount )
+{
+	for( size_t i = 0; i < ThreadCount; ++i )
+		Threads.emplace_back( &xyWorkerPool::WorkerMain, this );
+
+} // xyWorkerPool
+
+//////////////////////////////////////////////////////////////////////////
+
+xyWorkerPool::~xyWorkerPool( void )
+{
+	{
+		std::scoped_lock Lock( Mutex );
+		Stopping = true;
+	}
+
+	Condition.notify_all();
+
+	for( std::thread& rThread : Threads )
+		rThread.join();
+
+} // ~xyWorkerPool
+
+//////////////////////////////////////////////////////////////////////////
+
+template< typename Function >
+void xyWorkerPool::Post( Function&& rrFunction )
+{
+	{
+		std::scoped_lock Lock( Mutex );
+		Jobs.emplace_back().Emplace( std::forward< Function >( rrFunction ) );
+	}
+
+	Condition.notify_one();
+
+} // Post
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyWorkerPool::WorkerMain( void )
+{
+	XY_TRACE_THREAD_NAME( "Worker" );
+
+	while( true )
+	{
+		xyJob Job;
+
+		{
+			std::unique_lock Lock( Mutex );
+			Condition.wait( Lock, [ this ]{ return Stopping || !Jobs.empty(); } );
+
+			if( Jobs.empty() )
+				return;
+
+			Job = std::move( Jobs.front() );
+			Jobs.pop_front();
+		}
+
+		Job.Run();
+	}
+
+} // WorkerMain
+
+//////////////////////////////////////////////////////////////////////////
+
+xyQueryPool::xyQueryPool( size_t MaxThreads )
+	: pShared   ( std::make_shared< Shared >() )
+	, MaxThreads( MaxThreads )
+{
+} // xyQueryPool
+
+//////////////////////////////////////////////////////////////////////////
+
+xyQueryPool::~xyQueryPool( void )
+{
+	std::deque< xyJob > Dropped;
+
+	{
+		std::scoped_lock Lock( pShared->Mutex );
+		pShared->Stopping = true;
+
+		// Jobs that never started are destroyed out here, since they may hold what destroyed us
+		Dropped = std::move( pShared->Jobs );
+	}
+
+	pShared->Condition.notify_all();
+
+} // ~xyQueryPool
+
+//////////////////////////////////////////////////////////////////////////
+
+template< typename Function >
+void xyQueryPool::Post( Function&& rrFunction )
+{
+	bool StartThread;
+
+	{
+		std::scoped_lock Lock( pShared->Mutex );
+		pShared->Jobs.emplace_back().Emplace( std::forward< Function >( rrFunction ) );
+
+		// A job never waits behind one that may be stuck, as long as there are threads left to start
+		StartThread = pShared->Jobs.size() > pShared->IdleThreads && Threads < MaxThreads;
+	}
+
+	if( StartThread )
+	{
+		++Threads;
+		std::thread( &xyQueryPool::WorkerMain, pShared ).detach();
+	}
+	else
+	{
+		pShared->Condition.notify_one();
+	}
+
+} // Post
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyQueryPool::WorkerMain( std::shared_ptr< Shared > pShared )
+{
+	XY_TRACE_THREAD_NAME( "Query" );
+
+	while( true )
+	{
+		xyJob Job;
+
+		{
+			std::unique_lock Lock( pShared->Mutex );
+
+			++pShared->IdleThreads;
+			pShared->Condition.wait( Lock, [ &rShared = *pShared ]{ return rShared.Stopping || !rShared.Jobs.empty(); } );
+			--pShared->IdleThreads;
+
+			if( pShared->Stopping )
+				return;
+
+			Job = std::move( pShared->Jobs.front() );
+			pShared->Jobs.pop_front();
+		}
+
+		Job.Run();
+	}
+
+} // WorkerMain
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyMainThreadAwaiter::await_ready( void ) const
+{
+	return std::this_thread::get_id() == xyGetContext().pPlatformImpl->MainThreadID;
+
+} // await_ready
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyMainThreadAwaiter::await_suspend( std::coroutine_handle<> Handle ) const
+{
+	xyPostToMainThread( [ Handle ]{ Handle.resume(); } );
+
+} // await_suspend
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyWorkerAwaiter::await_suspend( std::coroutine_handle<> Handle ) const
+{
+	xyGetContext().pPlatformImpl->GetWorkerPool().Post( [ Handle ]{ Handle.resume(); } );
+
+} // await_suspend
+
+//////////////////////////////////////////////////////////////////////////
+
+xyMainThreadAwaiter xyResumeOnMainThread( void )
+{
+	return { };
+
+} // xyResumeOnMainThread
+
+//////////////////////////////////////////////////////////////////////////
+
+xyWorkerAwaiter xyResumeOnWorker( void )
+{
+	return { };
+
+} // xyResumeOnWorker
+
+//////////////////////////////////////////////////////////////////////////
+
+xyPlatformImpl::xyPlatformImpl( void )
+{
+	// Jobs from other threads are run by whichever thread runs the event loop
+	EventLoop.AddFD( MainThreadQueue.GetFD(), EPOLLIN, [ this ]( uint32_t ) { MainThreadQueue.Drain(); } );
+
+} // xyPlatformImpl
+
+//////////////////////////////////////////////////////////////////////////
+
+void xySetXCBErrorCallback( xyXCBConnection::ErrorCallback Callback )
+{
+	xyPlatformImpl& rPlatformImpl = *xyGetContext().pPlatformImpl;
+
+	// Errors are reported from the main thread, so the callback is swapped there as well
+	xyRunOnMainThread( [ & ]
+	{
+		if( xyXCBConnection* pXCB = rPlatformImpl.GetXCB() )
+			pXCB->OnError = std::move( Callback );
+	} );
+
+} // xySetXCBErrorCallback
+
+//////////////////////////////////////////////////////////////////////////
+
+xyWorkerPool& xyPlatformImpl::GetWorkerPool( void )
+{
+	// Started on first use so that apps which never need it don't pay for the threads
+	std::call_once( WorkerPoolFlag, [ this ]
+	{
+		pWorkerPool = std::make_unique< xyWorkerPool >( std::clamp( std::thread::hardware_concurrency(), 2u, 4u ) );
+	} );
+
+	return *pWorkerPool;
+
+} // GetWorkerPool
+
+//////////////////////////////////////////////////////////////////////////
+
+xyPowerSupplyMonitor::xyPowerSupplyMonitor( std::string_view Root )
+	: Root( Root )
+{
+	Discover();
+
+} // xyPowerSupplyMonitor
+
+//////////////////////////////////////////////////////////////////////////
+
+xyPowerSupplyMonitor::~xyPowerSupplyMonitor( void )
+{
+	std::scoped_lock Lock( Mutex );
+
+	Close();
+
+} // ~xyPowerSupplyMonitor
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPowerSupplyMonitor::Close( void )
+{
+	for( Battery& rBattery : Batteries )
+	{
+		close( rBattery.CapacityFD );
+		close( rBattery.StatusFD );
+	}
+
+	Batteries.clear();
+
+} // Close
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPowerSupplyMonitor::Discover( void )
+{
+	std::scoped_lock Lock( Mutex );
+
+	Close();
+
+	DIR* pDirectory = opendir( Root.c_str() );
+	if( !pDirectory )
+		return;
+
+	// Reads the first line of a small attribute file
+	auto ReadAttribute = []( int DirectoryFD, const char* pName ) -> std::string
+	{
+		const int FD = openat( DirectoryFD, pName, O_RDONLY | O_CLOEXEC );
+		if( FD < 0 )
+			return { };
+
+		char          Buffer[ 64 ];
+		const ssize_t Size = read( FD, Buffer, sizeof( Buffer ) );
+		close( FD );
+
+		if( Size <= 0 )
+			return { };
+
+		return std::string( Buffer, std::find( Buffer, Buffer + Size, '\n' ) );
+	};
+
+	while( dirent* pEntry = readdir( pDirectory ) )
+	{
+		if( pEntry->d_name[ 0 ] == '.' )
+			continue;
+
+		const int DeviceFD = openat( dirfd( pDirectory ), pEntry->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+		if( DeviceFD < 0 )
+			continue;
+
+		// Batteries with a device scope belong to peripherals like mice and gamepads, not to the system
+		if( ReadAttribute( DeviceFD, "type" ) == "Battery" && ReadAttribute( DeviceFD, "scope" ) != "Device" )
+		{
+			Battery NewBattery;
+			NewBattery.CapacityFD = openat( DeviceFD, "capacity", O_RDONLY | O_CLOEXEC );
+			NewBattery.StatusFD   = openat( DeviceFD, "status",   O_RDONLY | O_CLOEXEC );
+
+			for( const char* pFullName : { "energy_full", "charge_full" } )
+			{
+				const std::string Full = ReadAttribute( DeviceFD, pFullName );
+
+				if( uint64_t Weight; std::from_chars( Full.data(), Full.data() + Full.size(), Weight ).ec == std::errc() && Weight > 0 )
+				{
+					NewBattery.Weight = Weight;
+					break;
+				}
+			}
+
+			if( NewBattery.CapacityFD >= 0 ) Batteries.push_back( NewBattery );
+			else                             close( NewBattery.StatusFD );
+		}
+
+		close( DeviceFD );
+	}
+
+	closedir( pDirectory );
+
+} // Discover
+
+//////////////////////////////////////////////////////////////////////////
+
+xyBatteryState xyPowerSupplyMonitor::Read( void ) const
+{
+	xyBatteryState BatteryState;
+	uint64_t       WeightedCapacity = 0;
+	uint64_t       TotalWeight      = 0;
+
+	std::scoped_lock Lock( Mutex );
+
+	for( const Battery& rBattery : Batteries )
+	{
+		char    Buffer[ 16 ];
+		ssize_t Size = pread( rBattery.CapacityFD, Buffer, sizeof( Buffer ), 0 );
+		int     Capacity;
+
+		// The battery has been unplugged or the value is garbage
+		if( Size <= 0 || std::from_chars( Buffer, Buffer + Size, Capacity ).ec != std::errc() )
+			continue;
+
+		WeightedCapacity += static_cast< uint64_t >( std::clamp( Capacity, 0, 100 ) ) * rBattery.Weight;
+		TotalWeight      += rBattery.Weight;
+
+		Size = pread( rBattery.StatusFD, Buffer, sizeof( Buffer ), 0 );
+		if( Size > 0 && std::string_view( Buffer, Size ).starts_with( "Charging" ) )
+			BatteryState.Charging = true;
+	}
+
+	if( TotalWeight > 0 )
+	{
+		BatteryState.CapacityPercentage = static_cast< uint8_t >( WeightedCapacity / TotalWeight );
+		BatteryState.Valid              = true;
+	}
+
+	return BatteryState;
+
+} // Read
+
+//////////////////////////////////////////////////////////////////////////
+
+xyPowerSupplyMonitor& xyPlatformImpl::GetPowerSupplyMonitor( void )
+{
+	// Discovered on first use so that apps which never ask don't pay for the directory walk
+	std::call_once( PowerSupplyMonitorFlag, [ this ]
+	{
+		pPowerSupplyMonitor = std::make_unique< xyPowerSupplyMonitor >();
+	} );
+
+	return *pPowerSupplyMonitor;
+
+} // GetPowerSupplyMonitor
+
+//////////////////////////////////////////////////////////////////////////
+
+xyChangeNotifier::xyChangeNotifier( xyPlatformImpl& rPlatformImpl )
+	: rPlatformImpl( rPlatformImpl )
+{
+} // xyChangeNotifier
+
+//////////////////////////////////////////////////////////////////////////
+
+xyChangeNotifier::~xyChangeNotifier( void )
+{
+	for( size_t i = 0; i < ChangeCount; ++i )
+		StopWatching( static_cast< xyChange >( i ) );
+
+} // ~xyChangeNotifier
+
+//////////////////////////////////////////////////////////////////////////
+
+uint64_t xyChangeNotifier::Subscribe( xyChange Change, std::function< void( void ) > Callback )
+{
+	++Watches[ static_cast< size_t >( Change ) ].Subscribers;
+
+	StartWatching( Change );
+
+	Subscriptions.push_back( { .ID=NextID, .Change=Change, .Callback=std::move( Callback ) } );
+
+	return NextID++;
+
+} // Subscribe
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyChangeNotifier::Unsubscribe( uint64_t SubscriptionID )
+{
+	auto It = std::find_if( Subscriptions.begin(), Subscriptions.end(), [ SubscriptionID ]( const Subscription& rSubscription ) { return rSubscription.ID == SubscriptionID; } );
+	if( It == Subscriptions.end() )
+		return;
+
+	const xyChange Change = It->Change;
+	Subscriptions.erase( It );
+
+	// Nobody is listening anymore, so stop polling and give the descriptors back
+	if( --Watches[ static_cast< size_t >( Change ) ].Subscribers == 0 )
+		StopWatching( Change );
+
+} // Unsubscribe
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyChangeNotifier::Notify( xyChange Change )
+{
+	Watch& rWatch = Watches[ static_cast< size_t >( Change ) ];
+
+	// A check has already been scheduled, which will see this change as well. Nobody would hear about it if the change isn't watched.
+	if( rWatch.NotifyTimerID >= 0 || !rWatch.Watching )
+		return;
+
+	rWatch.NotifyTimerID = rPlatformImpl.EventLoop.AddTimer( std::chrono::milliseconds( 50 ), { }, [ this, Change ]
+	{
+		// One-shot timers are already gone by the time they are called
+		Watches[ static_cast< size_t >( Change ) ].NotifyTimerID = -1;
+
+		if( !Refresh( Change ) )
+			return;
+
+		// Look each subscription up again, since a callback may unsubscribe others
+		std::vector< uint64_t > IDs;
+		for( const Subscription& rSubscription : Subscriptions )
+		{
+			if( rSubscription.Change == Change )
+				IDs.push_back( rSubscription.ID );
+		}
+
+		for( uint64_t ID : IDs )
+		{
+			auto It = std::find_if( Subscriptions.begin(), Subscriptions.end(), [ ID ]( const Subscription& rSubscription ) { return rSubscription.ID == ID; } );
+			// Called through a copy, since the callback may also unsubscribe itself
+			if( It != Subscriptions.end() )
+				std::function< void( void ) >( It->Callback )();
+		}
+	} );
+
+} // Notify
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyChangeNotifier::Refresh( xyChange Change )
+{
+	switch( Change )
+	{
+		case xyChange::Battery:
+		{
+			const xyBatteryState BatteryState = rPlatformImpl.GetPowerSupplyMonitor().Read();
+			const bool           Changed      = BatteryState.Valid != LastBattery.Valid || BatteryState.CapacityPercentage != LastBattery.CapacityPercentage || BatteryState.Charging != LastBattery.Charging;
+
+			LastBattery = BatteryState;
+			return Changed;
+		}
+
+		case xyChange::Theme:
+		{
+			const xyTheme Theme = xyGetPreferredTheme();
+
+			return std::exchange( LastTheme, Theme ) != Theme;
+		}
+
+		// The cached language is refreshed from here. Its snapshot is only replaced when it changes, and may have been by xyRefreshSystemInfo too.
+		case xyChange::Language:
+		{
+			xySystemInfoCache& rCache = xyGetContext().SystemInfo;
+			rCache.RefreshLanguage();
+
+			return std::exchange( pLastLanguage, rCache.Language.Get() ) != rCache.Language.Get();
+		}
+
+		// The server only tells us when something did change
+		case xyChange::Displays:
+		default:
+		{
+			return true;
+		}
+	}
+
+} // Refresh
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyChangeNotifier::StartWatching( xyChange Change )
+{
+	Watch& rWatch = Watches[ static_cast< size_t >( Change ) ];
+
+	if( std::exchange( rWatch.Watching, true ) )
+		return;
+
+	// Remember what the value was, so that we can tell whether a notification changed anything
+	Refresh( Change );
+
+	switch( Change )
+	{
+		case xyChange::Battery:
+		{
+			// The kernel sends a uevent whenever a power supply changes, is plugged in or is unplugged
+			rWatch.UEventFD = socket( AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT );
+
+			sockaddr_nl Address = { };
+			Address.nl_family   = AF_NETLINK;
+			Address.nl_groups   = 1; // Kernel events, as opposed to the ones that udev rebroadcasts
+			if( rWatch.UEventFD >= 0 && bind( rWatch.UEventFD, reinterpret_cast< sockaddr* >( &Address ), sizeof( Address ) ) == 0 )
+			{
+				rPlatformImpl.EventLoop.AddFD( rWatch.UEventFD, EPOLLIN, [ this ]( uint32_t ) { OnUEvent(); } );
+			}
+			else if( rWatch.UEventFD >= 0 )
+			{
+				close( rWatch.UEventFD );
+				rWatch.UEventFD = -1;
+			}
+
+			// Not every battery sends an event when its capacity drops, so check every once in a while as well
+			rWatch.PollTimerID = rPlatformImpl.EventLoop.AddTimer( std::chrono::seconds( 30 ), std::chrono::seconds( 30 ), [ this ] { Notify( xyChange::Battery ); } );
+		} break;
+
+		case xyChange::Theme:
+		{
+			ThemeSettingsPath = xyGetConfigDirectory() + "/gtk-3.0/settings.ini";
+
+			// Editors tend to replace files rather than write to them, so we watch the directories instead.
+			// The config directory is watched as well in case gtk-3.0 doesn't exist yet.
+			WatchDirectory( Change, xyGetConfigDirectory() );
+			WatchDirectory( Change, xyGetConfigDirectory() + "/gtk-3.0" );
+		} break;
+
+		case xyChange::Language:
+		{
+			WatchDirectory( Change, xyGetConfigDirectory() );
+			WatchDirectory( Change, "/etc" );
+			WatchDirectory( Change, "/etc/default" );
+		} break;
+
+		case xyChange::Displays:
+		{
+			// The connection listens for screen changes from the start, since it needs them to keep the display cache up to date
+			rPlatformImpl.GetXCB();
+		} break;
+	}
+
+} // StartWatching
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyChangeNotifier::StopWatching( xyChange Change )
+{
+	Watch& rWatch = Watches[ static_cast< size_t >( Change ) ];
+
+	if( !std::exchange( rWatch.Watching, false ) )
+		return;
+
+	if( rWatch.NotifyTimerID >= 0 ) rPlatformImpl.EventLoop.RemoveTimer( std::exchange( rWatch.NotifyTimerID, -1 ) );
+	if( rWatch.PollTimerID   >= 0 ) rPlatformImpl.EventLoop.RemoveTimer( std::exchange( rWatch.PollTimerID,   -1 ) );
+
+	if( rWatch.UEventFD >= 0 )
+	{
+		rPlatformImpl.EventLoop.RemoveFD( rWatch.UEventFD );
+		close( std::exchange( rWatch.UEventFD, -1 ) );
+	}
+
+	// The config directory is watched for both the theme and the language, and inotify hands out one descriptor per directory
+	for( int Directory : std::exchange( rWatch.Directories, { } ) )
+	{
+		const bool Shared = std::any_of( Watches.begin(), Watches.end(), [ Directory ]( const Watch& rOther ) { return std::ranges::find( rOther.Directories, Directory ) != rOther.Directories.end(); } );
+		if( Shared )
+			continue;
+
+		inotify_rm_watch( INotifyFD, Directory );
+		WatchedDirectories.erase( Directory );
+	}
+
+	if( INotifyFD >= 0 && WatchedDirectories.empty() )
+	{
+		rPlatformImpl.EventLoop.RemoveFD( INotifyFD );
+		close( std::exchange( INotifyFD, -1 ) );
+	}
+
+} // StopWatching
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyChangeNotifier::WatchDirectory( xyChange Change, const std::string& rPath )
+{
+	if( INotifyFD < 0 )
+	{
+		INotifyFD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+		if( INotifyFD < 0 )
+			return;
+
+		rPlatformImpl.EventLoop.AddFD( INotifyFD, EPOLLIN, [ this ]( uint32_t ) { OnINotify(); } );
+	}
+
+	// Adding the same directory twice gives back the same descriptor
+	const int Directory = inotify_add_watch( INotifyFD, rPath.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ONLYDIR );
+	if( Directory < 0 )
+		return;
+
+	WatchedDirectories[ Directory ] = rPath;
+
+	std::vector< int >& rDirectories = Watches[ static_cast< size_t >( Change ) ].Directories;
+	if( std::ranges::find( rDirectories, Directory ) == rDirectories.end() )
+		rDirectories.push_back( Directory );
+
+} // WatchDirectory
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyChangeNotifier::OnINotify( void )
+{
+	alignas( inotify_event ) char Buffer[ 4096 ];
+	ssize_t                       Size;
+
+	while( ( Size = read( INotifyFD, Buffer, sizeof( Buffer ) ) ) > 0 )
+	{
+		for( char* pCursor = Buffer; pCursor < Buffer + Size; )
+		{
+			const inotify_event* pEvent = reinterpret_cast< const inotify_event* >( pCursor );
+			pCursor += sizeof( inotify_event ) + pEvent->len;
+
+			auto It = WatchedDirectories.find( pEvent->wd );
+			if( It == WatchedDirectories.end() || pEvent->len == 0 )
+				continue;
+
+			const std::string Path = It->second + "/" + pEvent->name;
+
+			if( Watches[ static_cast< size_t >( xyChange::Theme ) ].Watching )
+			{
+				// gtk-3.0 was just created, so start watching the settings inside it
+				if( Path == xyGetConfigDirectory() + "/gtk-3.0" )
+					WatchDirectory( xyChange::Theme, Path );
+
+				if( Path == ThemeSettingsPath || Path == xyGetConfigDirectory() + "/gtk-3.0" )
+					Notify( xyChange::Theme );
+			}
+
+			if( Watches[ static_cast< size_t >( xyChange::Language ) ].Watching )
+			{
+				if( Path == xyGetConfigDirectory() + "/locale.conf" || Path == "/etc/locale.conf" || Path == "/etc/default/locale" )
+					Notify( xyChange::Language );
+			}
+		}
+	}
+
+} // OnINotify
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyChangeNotifier::OnUEvent( void )
+{
+	// Each message is a header line followed by null-separated KEY=VALUE pairs
+	char    Buffer[ 8192 ];
+	ssize_t Size;
+
+	while( ( Size = recv( Watches[ static_cast< size_t >( xyChange::Battery ) ].UEventFD, Buffer, sizeof( Buffer ), 0 ) ) > 0 )
+	{
+		std::string_view Action;
+		bool             PowerSupply = false;
+
+		for( std::string_view Message( Buffer, Size ); !Message.empty(); )
+		{
+			const std::string_view Field = Message.substr( 0, Message.find( '\0' ) );
+
+			if( Field == "SUBSYSTEM=power_supply" ) PowerSupply = true;
+			else if( Field.starts_with( "ACTION=" ) ) Action = Field.substr( 7 );
+
+			Message.remove_prefix( std::min( Field.size() + 1, Message.size() ) );
+		}
+
+		if( !PowerSupply )
+			continue;
+
+		// Batteries were plugged in or out, so the cached files are out of date
+		if( Action == "add" || Action == "remove" )
+			rPlatformImpl.GetPowerSupplyMonitor().Discover();
+
+		Notify( xyChange::Battery );
+	}
+
+} // OnUEvent
+
+//////////////////////////////////////////////////////////////////////////
+
+xyChangeNotifier& xyPlatformImpl::GetChangeNotifier( void )
+{
+	if( !pChangeNotifier )
+		pChangeNotifier = std::make_unique< xyChangeNotifier >( *this );
+
+	return *pChangeNotifier;
+
+} // GetChangeNotifier
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyHasDisplayServer( void )
+{
+	if( const char* pWaylandDisplay = getenv( "WAYLAND_DISPLAY" ); pWaylandDisplay && *pWaylandDisplay )
+	{
+		// The name is relative to the runtime directory unless it is a path of its own
+		const char* pRuntimeDir = getenv( "XDG_RUNTIME_DIR" );
+		std::string Path        = ( *pWaylandDisplay == '/' ) ? pWaylandDisplay : std::string( pRuntimeDir ? pRuntimeDir : "" ) + "/" + pWaylandDisplay;
+
+		if( access( Path.c_str(), F_OK ) == 0 )
+			return true;
+	}
+
+	const char* pDisplay = getenv( "DISPLAY" );
+	if( !pDisplay || !*pDisplay )
+		return false;
+
+	// The display is written as [host]:number[.screen]
+	const std::string_view Display = pDisplay;
+	const size_t           Colon   = Display.rfind( ':' );
+	if( Colon == std::string_view::npos )
+		return false;
+
+	const std::string_view Host = Display.substr( 0, Colon );
+	if( !Host.empty() && Host != "unix" )
+		return true;
+
+	const std::string_view Number = Display.substr( Colon + 1, Display.find( '.', Colon ) - Colon - 1 );
+	const std::string      Path   = "/tmp/.X11-unix/X" + std::string( Number );
+
+	if( access( Path.c_str(), F_OK ) == 0 )
+		return true;
+
+	// Sandboxes often leave out /tmp, but the server listens on an abstract socket of the same name as well
+	int Socket = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+	if( Socket < 0 )
+		return false;
+
+	sockaddr_un Address;
+	memset( &Address, 0, sizeof( Address ) );
+	Address.sun_family = AF_UNIX;
+
+	const size_t PathLength = std::min( Path.size(), sizeof( Address.sun_path ) - 1 );
+	memcpy( Address.sun_path + 1, Path.data(), PathLength );
+
+	const bool Connected = connect( Socket, reinterpret_cast< sockaddr* >( &Address ), static_cast< socklen_t >( offsetof( sockaddr_un, sun_path ) + 1 + PathLength ) ) == 0;
+	close( Socket );
+
+	return Connected;
+
+} // xyHasDisplayServer
+
+//////////////////////////////////////////////////////////////////////////
+
+std::string xyGetConfigDirectory( void )
+{
+	if( const char* pConfigHome = getenv( "XDG_CONFIG_HOME" ); pConfigHome && *pConfigHome )
+		return pConfigHome;
+
+	const char* pHome = getenv( "HOME" );
+
+	return std::string( pHome ? pHome : "" ) + "/.config";
+
+} // xyGetConfigDirectory
+
+//////////////////////////////////////////////////////////////////////////
+
+std::optional< std::string > xyReadConfigValue( const std::string& rPath, std::string_view Key )
+{
+	constexpr std::string_view Whitespace = " \t\r";
+
+	auto Trim = [ & ]( std::string_view Text )
+	{
+		Text.remove_prefix( std::min( Text.find_first_not_of( Whitespace ), Text.size() ) );
+		Text.remove_suffix( Text.size() - std::min( Text.find_last_not_of( Whitespace ) + 1, Text.size() ) );
+		return Text;
+	};
+
+	std::ifstream File( rPath );
+	std::string   Line;
+
+	while( std::getline( File, Line ) )
+	{
+		const size_t Equals = Line.find( '=' );
+		if( Equals == std::string::npos || Trim( std::string_view( Line ).substr( 0, Equals ) ) != Key )
+			continue;
+
+		std::string_view Value = Trim( std::string_view( Line ).substr( Equals + 1 ) );
+
+		if( Value.size() >= 2 && ( Value.front() == '"' || Value.front() == '\'' ) && Value.back() == Value.front() )
+			Value = Value.substr( 1, Value.size() - 2 );
+
+		return std::string( Value );
+	}
+
+	return std::nullopt;
+
+} // xyReadConfigValue
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t xyDrainMouseHistory( std::span< xyMouseSample > Samples )
+{
+	if( xyPointerSampler* pSampler = xyGetContext().pPlatformImpl->GetPointerSampler() )
+		return pSampler->DrainHistory( Samples );
+
+	return 0;
+
+} // xyDrainMouseHistory
+
+//////////////////////////////////////////////////////////////////////////
+
+std::vector< xyDisplayAdapter > xyXCBConnection::QueryDisplayAdapters( void )
+{
+	XY_TRACE_SCOPE( "xyXCBConnection::QueryDisplayAdapters" );
+
+	std::vector< xyDisplayAdapter > DisplayAdapters;
+
+	// Every request that has a reply is sent before we wait for any of them.
+	// The outputs and CRTCs depend on the screen resources, which makes this two waits in total no matter how many displays there are.
+	xcb_get_property_cookie_t WorkAreaCookie    = xyXCB.get_property( pConnection, 0, pScreen->root, NetWorkArea,    XCB_ATOM_CARDINAL, 0, 256 );
+	xcb_get_property_cookie_t CurrentDeskCookie = xyXCB.get_property( pConnection, 0, pScreen->root, NetCurrentDesk, XCB_ATOM_CARDINAL, 0, 1 );
+	xcb_get_property_cookie_t ResourcesDBCookie = xyXCB.get_property( pConnection, 0, pScreen->root, XCB_ATOM_RESOURCE_MANAGER, XCB_ATOM_STRING, 0, 16384 );
+
+#if defined( XY_HAS_XCB_RANDR )
+
+	xcb_randr_get_screen_resources_current_cookie_t ResourcesCookie;
+	xcb_randr_get_output_primary_cookie_t           PrimaryCookie;
+	xcb_randr_get_monitors_cookie_t                 MonitorsCookie = { };
+
+	if( RandREventBase )
+	{
+		ResourcesCookie = xyXCB.randr_get_screen_resources_current( pConnection, pScreen->root );
+		PrimaryCookie   = xyXCB.randr_get_output_primary( pConnection, pScreen->root );
+
+		// Monitors are what the desktop shows things on. Usually one per output, but a screen may be split up, or tiled outputs joined.
+		if( RandRMonitors )
+			MonitorsCookie = xyXCB.randr_get_monitors( pConnection, pScreen->root, 1 );
+	}
+
+#endif // XY_HAS_XCB_RANDR
+
+	// The work area is given per virtual desktop
+	xyRect WorkArea = { 0, 0, pScreen->width_in_pixels, pScreen->height_in_pixels };
+	{
+		uint32_t CurrentDesk = 0;
+
+		++RoundTrips;
+		XY_TRACE_COUNTER( "XCB round trips", RoundTrips.load( std::memory_order_relaxed ) );
+
+		if( xcb_get_property_reply_t* pReply = xyXCB.get_property_reply( pConnection, CurrentDeskCookie, nullptr ) )
+		{
+			if( xyXCB.get_property_value_length( pReply ) >= 4 )
+				CurrentDesk = *static_cast< const uint32_t* >( xyXCB.get_property_value( pReply ) );
+
+			free( pReply );
+		}
+
+		if( xcb_get_property_reply_t* pReply = xyXCB.get_property_reply( pConnection, WorkAreaCookie, nullptr ) )
+		{
+			const uint32_t* pValues = static_cast< const uint32_t* >( xyXCB.get_property_value( pReply ) );
+			const size_t    Count   = xyXCB.get_property_value_length( pReply ) / 4;
+
+			if( Count >= 4 )
+			{
+				const uint32_t* pDesk = &pValues[ ( CurrentDesk < Count / 4 ? CurrentDesk : 0 ) * 4 ];
+				WorkArea              = { static_cast< int32_t >( pDesk[ 0 ] ), static_cast< int32_t >( pDesk[ 1 ] ), static_cast< int32_t >( pDesk[ 0 ] + pDesk[ 2 ] ), static_cast< int32_t >( pDesk[ 1 ] + pDesk[ 3 ] ) };
+			}
+
+			free( pReply );
+		}
+	}
+
+	// X has no notion of scaling, but desktops tell toolkits what DPI to use through the Xft.dpi resource
+	float ScaleFactor = 1.0f;
+
+	if( xcb_get_property_reply_t* pReply = xyXCB.get_property_reply( pConnection, ResourcesDBCookie, nullptr ) )
+	{
+		const std::string_view Resources( static_cast< const char* >( xyXCB.get_property_value( pReply ) ), xyXCB.get_property_value_length( pReply ) );
+		constexpr std::string_view Key = "Xft.dpi:";
+
+		if( size_t Position = Resources.find( Key ); Position != std::string_view::npos && ( Position == 0 || Resources[ Position - 1 ] == '\n' ) )
+		{
+			std::string_view Value = Resources.substr( Position + Key.size() );
+			Value.remove_prefix( std::min( Value.find_first_not_of( " \t" ), Value.size() ) );
+
+			if( float DPI; std::from_chars( Value.data(), Value.data() + Value.size(), DPI ).ec == std::errc() && DPI > 0.0f )
+				ScaleFactor = DPI / 96.0f;
+		}
+
+		free( pReply );
+	}
+
+	// Core X and RandR don't say when a CRTC refreshes, so refreshes are counted from now. Only the rate is real, see xyGetNextRefresh.
+	const std::chrono::steady_clock::time_point RefreshAnchor = std::chrono::steady_clock::now();
+
+	// The work area covers the whole screen, so each display gets the part of it that overlaps
+	auto ClipToWorkArea = [ & ]( const xyRect& rFullRect ) -> xyRect
+	{
+		xyRect WorkRect = { std::max( rFullRect.Left, WorkArea.Left ), std::max( rFullRect.Top, WorkArea.Top ), std::min( rFullRect.Right, WorkArea.Right ), std::min( rFullRect.Bottom, WorkArea.Bottom ) };
+
+		// The display is entirely covered by panels, or the work area only covers some other display
+		if( WorkRect.Right <= WorkRect.Left || WorkRect.Bottom <= WorkRect.Top )
+			WorkRect = rFullRect;
+
+		return WorkRect;
+	};
+
+#if defined( XY_HAS_XCB_RANDR )
+
+	if( RandREventBase )
+	{
+		xcb_randr_get_screen_resources_current_reply_t* pResources = xyXCB.randr_get_screen_resources_current_reply( pConnection, ResourcesCookie, nullptr );
+		xcb_randr_get_output_primary_reply_t*           pPrimary   = xyXCB.randr_get_output_primary_reply( pConnection, PrimaryCookie, nullptr );
+		xcb_randr_get_monitors_reply_t*                 pMonitors  = MonitorsCookie.sequence ? xyXCB.randr_get_monitors_reply( pConnection, MonitorsCookie, nullptr ) : nullptr;
+
+		if( pResources )
+		{
+			const xcb_randr_output_t* pOutputs    = xyXCB.randr_get_screen_resources_current_outputs( pResources );
+			const int                 OutputCount = xyXCB.randr_get_screen_resources_current_outputs_length( pResources );
+			const xcb_randr_output_t  Primary     = pPrimary ? pPrimary->output : XCB_NONE;
+
+			std::vector< xcb_randr_get_output_info_cookie_t > OutputCookies( OutputCount );
+			for( int i = 0; i < OutputCount; ++i )
+				OutputCookies[ i ] = xyXCB.randr_get_output_info( pConnection, pOutputs[ i ], pResources->config_timestamp );
+
+			// We don't know which CRTCs are in use until we have the outputs, so ask for all of them up front
+			const xcb_randr_crtc_t* pCRTCs    = xyXCB.randr_get_screen_resources_current_crtcs( pResources );
+			const int               CRTCCount = xyXCB.randr_get_screen_resources_current_crtcs_length( pResources );
+
+			std::vector< xcb_randr_get_crtc_info_cookie_t > CRTCCookies( CRTCCount );
+			for( int i = 0; i < CRTCCount; ++i )
+				CRTCCookies[ i ] = xyXCB.randr_get_crtc_info( pConnection, pCRTCs[ i ], pResources->config_timestamp );
+
+			// Monitors are named by atoms, which are looked up along with the rest
+			std::vector< xcb_get_atom_name_cookie_t > MonitorNameCookies;
+			if( pMonitors )
+			{
+				for( xcb_randr_monitor_info_iterator_t It = xyXCB.randr_get_monitors_monitors_iterator( pMonitors ); It.rem; xyXCB.randr_monitor_info_next( &It ) )
+					MonitorNameCookies.push_back( xyXCB.get_atom_name( pConnection, It.data->name ) );
+			}
+
+			++RoundTrips;
+			XY_TRACE_COUNTER( "XCB round trips", RoundTrips.load( std::memory_order_relaxed ) );
+
+			// The refresh rate follows from the timings of the mode: the pixel clock divided by the size of a frame including blanking
+			std::unordered_map< xcb_randr_mode_t, double > RefreshRates;
+			for( xcb_randr_mode_info_iterator_t It = xyXCB.randr_get_screen_resources_current_modes_iterator( pResources ); It.rem; xyXCB.randr_mode_info_next( &It ) )
+			{
+				const xcb_randr_mode_info_t& rMode       = *It.data;
+				double                       FrameLength = static_cast< double >( rMode.htotal ) * rMode.vtotal;
+
+				if( rMode.mode_flags & XCB_RANDR_MODE_FLAG_DOUBLE_SCAN ) FrameLength *= 2.0;
+				if( rMode.mode_flags & XCB_RANDR_MODE_FLAG_INTERLACE )   FrameLength /= 2.0;
+
+				RefreshRates[ rMode.id ] = FrameLength > 0.0 ? rMode.dot_clock / FrameLength : 0.0;
+			}
+
+			struct CRTCInfo
+			{
+				xyRect Rect;
+				double RefreshRate;
+
+			}; // CRTCInfo
+
+			std::unordered_map< xcb_randr_crtc_t, CRTCInfo > CRTCs;
+			for( int i = 0; i < CRTCCount; ++i )
+			{
+				if( xcb_randr_get_crtc_info_reply_t* pReply = xyXCB.randr_get_crtc_info_reply( pConnection, CRTCCookies[ i ], nullptr ) )
+				{
+					// A CRTC without a mode is not showing anything
+					if( pReply->mode != XCB_NONE )
+						CRTCs[ pCRTCs[ i ] ] = { .Rect={ pReply->x, pReply->y, pReply->x + pReply->width, pReply->y + pReply->height }, .RefreshRate=RefreshRates[ pReply->mode ] };
+
+					free( pReply );
+				}
+			}
+
+			struct OutputInfo
+			{
+				std::string     Name;
+				const CRTCInfo* pCRTC;
+
+			}; // OutputInfo
+
+			// Only outputs that are connected and are showing something count as displays
+			std::vector< std::pair< xcb_randr_output_t, OutputInfo > > Outputs;
+			for( int i = 0; i < OutputCount; ++i )
+			{
+				xcb_randr_get_output_info_reply_t* pReply = xyXCB.randr_get_output_info_reply( pConnection, OutputCookies[ i ], nullptr );
+				if( !pReply )
+					continue;
+
+				if( auto It = CRTCs.find( pReply->crtc ); pReply->connection == XCB_RANDR_CONNECTION_CONNECTED && It != CRTCs.end() )
+					Outputs.push_back( { pOutputs[ i ], { .Name=std::string( reinterpret_cast< const char* >( xyXCB.randr_get_output_info_name( pReply ) ), xyXCB.randr_get_output_info_name_length( pReply ) ), .pCRTC=&It->second } } );
+
+				free( pReply );
+			}
+
+			auto AddDisplayAdapter = [ & ]( std::string Name, const xyRect& rRect, double RefreshRate, bool IsPrimary )
+			{
+				xyDisplayAdapter DisplayAdapter;
+				DisplayAdapter.Name          = std::move( Name );
+				DisplayAdapter.FullRect      = rRect;
+				DisplayAdapter.WorkRect      = ClipToWorkArea( rRect );
+				DisplayAdapter.RefreshRate   = RefreshRate;
+				DisplayAdapter.ScaleFactor   = ScaleFactor;
+				DisplayAdapter.RefreshAnchor = RefreshAnchor;
+
+				// The primary display goes first
+				if( IsPrimary ) DisplayAdapters.insert( DisplayAdapters.begin(), std::move( DisplayAdapter ) );
+				else            DisplayAdapters.emplace_back( std::move( DisplayAdapter ) );
+			};
+
+			if( pMonitors && pMonitors->nMonitors > 0 )
+			{
+				size_t MonitorIndex = 0;
+
+				for( xcb_randr_monitor_info_iterator_t It = xyXCB.randr_get_monitors_monitors_iterator( pMonitors ); It.rem; xyXCB.randr_monitor_info_next( &It ), ++MonitorIndex )
+				{
+					const xcb_randr_monitor_info_t& rMonitor        = *It.data;
+					const xcb_randr_output_t*       pMonitorOutputs = xyXCB.randr_monitor_info_outputs( It.data );
+					const int                       MonitorOutputs  = xyXCB.randr_monitor_info_outputs_length( It.data );
+					const xyRect                    Rect            = { rMonitor.x, rMonitor.y, rMonitor.x + rMonitor.width, rMonitor.y + rMonitor.height };
+					std::string                     Name;
+					double                          RefreshRate     = 0.0;
+
+					if( xcb_get_atom_name_reply_t* pReply = xyXCB.get_atom_name_reply( pConnection, MonitorNameCookies[ MonitorIndex ], nullptr ) )
+					{
+						Name.assign( xyXCB.get_atom_name_name( pReply ), xyXCB.get_atom_name_name_length( pReply ) );
+						free( pReply );
+					}
+
+					// The monitor refreshes along with its first output that is showing something
+					for( int i = 0; i < MonitorOutputs && RefreshRate == 0.0; ++i )
+					{
+						auto Output = std::ranges::find( Outputs, pMonitorOutputs[ i ], &std::pair< xcb_randr_output_t, OutputInfo >::first );
+						if( Output != Outputs.end() )
+							RefreshRate = Output->second.pCRTC->RefreshRate;
+					}
+
+					// Monitors that were made up by the user may have no outputs at all. Those take after the CRTC they overlap the most.
+					if( RefreshRate == 0.0 )
+					{
+						int64_t MostOverlap = 0;
+
+						for( const auto& [ CRTC, rInfo ] : CRTCs )
+						{
+							const int64_t Width   = std::min( Rect.Right, rInfo.Rect.Right ) - std::max( Rect.Left, rInfo.Rect.Left );
+							const int64_t Height  = std::min( Rect.Bottom, rInfo.Rect.Bottom ) - std::max( Rect.Top, rInfo.Rect.Top );
+							const int64_t Overlap = ( Width > 0 && Height > 0 ) ? Width * Height : 0;
+
+							if( Overlap > MostOverlap )
+							{
+								MostOverlap = Overlap;
+								RefreshRate = rInfo.RefreshRate;
+							}
+						}
+					}
+
+					AddDisplayAdapter( std::move( Name ), Rect, RefreshRate, rMonitor.primary );
+				}
+			}
+			else
+			{
+				for( auto& [ Output, rInfo ] : Outputs )
+					AddDisplayAdapter( std::move( rInfo.Name ), rInfo.pCRTC->Rect, rInfo.pCRTC->RefreshRate, Output == Primary );
+			}
+
+			free( pResources );
+		}
+
+		free( pMonitors );
+		free( pPrimary );
+	}
+
+#endif // XY_HAS_XCB_RANDR
+
+	// Without RandR, the screen is all we know about
+	if( DisplayAdapters.empty() )
+	{
+		xyDisplayAdapter DisplayAdapter;
+		DisplayAdapter.Name          = "Screen";
+		DisplayAdapter.FullRect      = { 0, 0, pScreen->width_in_pixels, pScreen->height_in_pixels };
+		DisplayAdapter.WorkRect      = ClipToWorkArea( DisplayAdapter.FullRect );
+		DisplayAdapter.ScaleFactor   = ScaleFactor;
+		DisplayAdapter.RefreshAnchor = RefreshAnchor;
+
+		DisplayAdapters.emplace_back( std::move( DisplayAdapter ) );
+	}
+
+	return DisplayAdapters;
+
+} // QueryDisplayAdapters
+
+//////////////////////////////////////////////////////////////////////////
+
+std::vector< xyDisplayAdapter > xyPlatformImpl::GetDisplayAdapters( void )
+{
+	uint64_t Generation;
+
+	{
+		std::scoped_lock Lock( DisplayAdaptersMutex );
+
+		if( CachedGeneration == DisplayAdaptersGeneration )
+			return DisplayAdapters;
+
+		Generation = DisplayAdaptersGeneration;
+	}
+
+	xyXCBConnection* pXCB = GetXCB();
+	if( !pXCB )
+		return { };
+
+	std::vector< xyDisplayAdapter > NewDisplayAdapters = pXCB->QueryDisplayAdapters();
+
+	// Waiting for the replies may have pulled events off the socket, and epoll won't tell the main thread about those
+	if( std::this_thread::get_id() != MainThreadID )
+		MainThreadQueue.Post( [ this ]{ OnXCBEvents(); } );
+
+	std::scoped_lock Lock( DisplayAdaptersMutex );
+
+	// Don't cache the result if the displays changed while we were asking
+	if( Generation == DisplayAdaptersGeneration )
+	{
+		DisplayAdapters  = NewDisplayAdapters;
+		CachedGeneration = Generation;
+	}
+
+	return NewDisplayAdapters;
+
+} // GetDisplayAdapters
+
+//////////////////////////////////////////////////////////////////////////
+
+std::optional< std::vector< xyDisplayAdapter > > xyPlatformImpl::PeekDisplayAdapters( void )
+{
+	// Without a display server there is nothing to ask
+	if( !( xyGetContext().UIMode & XY_UI_MODE_DESKTOP ) )
+		return std::vector< xyDisplayAdapter >();
+
+	std::scoped_lock Lock( DisplayAdaptersMutex );
+
+	if( CachedGeneration == DisplayAdaptersGeneration )
+		return DisplayAdapters;
+
+	// The server would have to be asked, which may block
+	return std::nullopt;
+
+} // PeekDisplayAdapters
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPlatformImpl::InvalidateDisplayAdapters( void )
+{
+	{
+		std::scoped_lock Lock( DisplayAdaptersMutex );
+		++DisplayAdaptersGeneration;
+	}
+
+	if( pChangeNotifier )
+		pChangeNotifier->Notify( xyChange::Displays );
+
+} // InvalidateDisplayAdapters
+
+//////////////////////////////////////////////////////////////////////////
+
+xyXCBConnection* xyPlatformImpl::GetXCB( void )
+{
+	// Opened on first use since connection setup costs several round trips
+	std::call_once( XCBFlag, [ this ]
+	{
+		// There is nothing to connect to, so don't even load the library
+		if( !( xyGetContext().UIMode & XY_UI_MODE_DESKTOP ) || !xyXCB.Load() )
+			return;
+
+		auto pNewXCB = std::make_unique< xyXCBConnection >();
+		if( !pNewXCB->Connect() )
+			return;
+
+		pXCB = std::move( pNewXCB );
+
+		// Events for every window arrive on this one connection, so they are served from the main loop
+		auto Register = [ this ]
+		{
+			EventLoop.AddFD( xyXCB.get_file_descriptor( pXCB->pConnection ), EPOLLIN, [ this ]( uint32_t ) { OnXCBEvents(); } );
+		};
+
+		if( std::this_thread::get_id() == MainThreadID ) Register();
+		else                                             MainThreadQueue.Post( Register );
+	} );
+
+	return pXCB.get();
+
+} // GetXCB
+
+//////////////////////////////////////////////////////////////////////////
+
+xyPointerSampler* xyPlatformImpl::GetPointerSampler( void )
+{
+	// Motion is only listened for once someone asks, since every movement of the mouse would otherwise wake the main thread for nothing
+	std::call_once( PointerSamplerFlag, [ this ]
+	{
+		xyXCBConnection* pConnection = GetXCB();
+		if( !pConnection )
+			return;
+
+		pPointerSampler = std::make_unique< xyPointerSampler >( *pConnection );
+
+		auto Start = [ this ]
+		{
+			pPointerSampler->Start();
+			pActivePointerSampler = pPointerSampler.get();
+		};
+
+		if( std::this_thread::get_id() == MainThreadID ) Start();
+		else                                             xyPostToMainThread( Start );
+	} );
+
+	return pPointerSampler.get();
+
+} // GetPointerSampler
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPlatformImpl::OnXCBEvents( void )
+{
+	XY_TRACE_SCOPE( "xyPlatformImpl::OnXCBEvents" );
+
+	xcb_connection_t*    pConnection = pXCB->pConnection;
+	xcb_generic_event_t* pEvent;
+
+	while( ( pEvent = xyXCB.poll_for_event( pConnection ) ) )
+	{
+		xcb_window_t Window = 0;
+
+		switch( pEvent->response_type & ~0x80 )
+		{
+			case 0:
+			{
+				if( pXCB->OnError )
+					pXCB->OnError( *reinterpret_cast< xcb_generic_error_t* >( pEvent ) );
+			} break;
+
+			case XCB_EXPOSE:         Window = reinterpret_cast< xcb_expose_event_t* >( pEvent )->window;         break;
+			case XCB_CLIENT_MESSAGE: Window = reinterpret_cast< xcb_client_message_event_t* >( pEvent )->window; break;
+			case XCB_BUTTON_PRESS:
+			case XCB_BUTTON_RELEASE: Window = reinterpret_cast< xcb_button_press_event_t* >( pEvent )->event;    break;
+
+			case XCB_CONFIGURE_NOTIFY:
+			{
+				Window = reinterpret_cast< xcb_configure_notify_event_t* >( pEvent )->window;
+
+				// The root window is resized along with the screen
+				if( Window == pXCB->pScreen->root )
+					InvalidateDisplayAdapters();
+			} break;
+
+			case XCB_PROPERTY_NOTIFY:
+			{
+				// Panels and docks were moved or resized, or the DPI setting changed
+				const xcb_atom_t Atom = reinterpret_cast< xcb_property_notify_event_t* >( pEvent )->atom;
+				if( Atom == pXCB->NetWorkArea || Atom == XCB_ATOM_RESOURCE_MANAGER )
+					InvalidateDisplayAdapters();
+			} break;
+
+			case XCB_GE_GENERIC:
+			{
+				if( pActivePointerSampler )
+					pActivePointerSampler->HandleEvent( pEvent );
+			} break;
+
+			default:
+			{
+
+#if defined( XY_HAS_XCB_RANDR )
+
+				if( pXCB->RandREventBase && ( pEvent->response_type & ~0x80 ) == pXCB->RandREventBase + XCB_RANDR_SCREEN_CHANGE_NOTIFY )
+					InvalidateDisplayAdapters();
+
+#endif // XY_HAS_XCB_RANDR
+#if defined( XY_HAS_XCB_SHM )
+
+				if( pXCB->ShmEventBase && ( pEvent->response_type & ~0x80 ) == pXCB->ShmEventBase + XCB_SHM_COMPLETION )
+					Window = reinterpret_cast< xcb_shm_completion_event_t* >( pEvent )->drawable;
+
+#endif // XY_HAS_XCB_SHM
+
+			} break;
+		}
+
+		if( auto It = MessageBoxes.find( Window ); It != MessageBoxes.end() )
+		{
+			if( std::optional< xyMessageResult > Result = It->second->HandleEvent( pEvent ) )
+			{
+				It->second->m_Result.set_value( *Result );
+				XY_TRACE_ASYNC_END( "Message box", It->first );
+				MessageBoxes.erase( It );
+			}
+		}
+		else if( auto It = Windows.find( Window ); It != Windows.end() )
+		{
+			It->second->HandleEvent( pEvent );
+		}
+
+		free( pEvent );
+	}
+
+	// The server went away, so every box is as good as closed
+	if( xyXCB.connection_has_error( pConnection ) )
+	{
+		EventLoop.RemoveFD( xyXCB.get_file_descriptor( pConnection ) );
+
+		for( auto& [ Window, pBox ] : MessageBoxes )
+		{
+			pBox->m_Result.set_value( pBox->GetCloseResult() );
+			XY_TRACE_ASYNC_END( "Message box", Window );
+		}
+
+		MessageBoxes.clear();
+
+		// The windows are left for their owners to destroy
+		for( auto& [ Window, pWindow ] : Windows )
+			pWindow->Close();
+
+		return;
+	}
+
+	// Everything that was damaged by the events above is repainted at once
+	for( auto& [ Window, pBox ] : MessageBoxes )
+		pBox->Repaint();
+
+	for( auto& [ Window, pWindow ] : Windows )
+		pWindow->Repaint();
+
+	// Reading the events above also read whatever replies came along with them
+	if( pActivePointerSampler )
+		pActivePointerSampler->PollReplies();
+
+	xyXCB.flush( pConnection );
+
+} // OnXCBEvents
+
+//////////////////////////////////////////////////////////////////////////
+
+xyWaylandConnection* xyPlatformImpl::GetWayland( void )
+{
+	// Windows are only put on Wayland in a session that has it. The library is left alone otherwise, and X is used.
+	std::call_once( WaylandFlag, [ this ]
+	{
+		const char* pWaylandDisplay = getenv( "WAYLAND_DISPLAY" );
+		if( !( xyGetContext().UIMode & XY_UI_MODE_DESKTOP ) || !pWaylandDisplay || !*pWaylandDisplay || !xyWL.Load() )
+			return;
+
+		auto pNewWayland = std::make_unique< xyWaylandConnection >();
+		if( !pNewWayland->Connect() )
+			return;
+
+		pWayland = std::move( pNewWayland );
+
+		auto Register = [ this ]
+		{
+			EventLoop.AddFD( xyWL.display_get_fd( pWayland->pDisplay ), EPOLLIN, [ this ]( uint32_t ) { OnWaylandEvents(); } );
+		};
+
+		if( std::this_thread::get_id() == MainThreadID ) Register();
+		else                                             MainThreadQueue.Post( Register );
+	} );
+
+	return pWayland.get();
+
+} // GetWayland
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPlatformImpl::OnWaylandEvents( void )
+{
+	XY_TRACE_SCOPE( "xyPlatformImpl::OnWaylandEvents" );
+
+	// The compositor went away, so every box is as good as closed
+	if( !pWayland->Dispatch() )
+	{
+		EventLoop.RemoveFD( xyWL.display_get_fd( pWayland->pDisplay ) );
+
+		for( auto& [ pSurface, pBox ] : WaylandMessageBoxes )
+		{
+			pBox->m_Result.set_value( pBox->GetCloseResult() );
+			XY_TRACE_ASYNC_END( "Message box", reinterpret_cast< uintptr_t >( pSurface ) );
+		}
+
+		WaylandMessageBoxes.clear();
+
+		// The windows are left for their owners to destroy
+		for( auto& [ pSurface, pWindow ] : WaylandWindows )
+			pWindow->Close();
+
+		return;
+	}
+
+	ResolveWaylandMessageBoxes();
+
+	xyWL.display_flush( pWayland->pDisplay );
+
+} // OnWaylandEvents
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPlatformImpl::ResolveWaylandMessageBoxes( void )
+{
+	// Boxes that were clicked or closed while events were dispatched are done with, and the rest may have been damaged
+	for( auto It = WaylandMessageBoxes.begin(); It != WaylandMessageBoxes.end(); )
+	{
+		xyMessageBoxData& rBox = *It->second;
+
+		if( !rBox.m_Dismissed && !rBox.m_pSurface->IsOpen() )
+			rBox.m_Dismissed = rBox.GetCloseResult();
+
+		if( rBox.m_Dismissed )
+		{
+			rBox.m_Result.set_value( *rBox.m_Dismissed );
+			XY_TRACE_ASYNC_END( "Message box", reinterpret_cast< uintptr_t >( It->first ) );
+			It = WaylandMessageBoxes.erase( It );
+			continue;
+		}
+
+		rBox.Repaint();
+		++It;
+	}
+
+} // ResolveWaylandMessageBoxes
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPlatformImpl::OnWaylandButton( wl_proxy* pSurface, int32_t X, int32_t Y, bool Pressed )
+{
+	if( auto It = WaylandMessageBoxes.find( pSurface ); It != WaylandMessageBoxes.end() && !It->second->m_Dismissed )
+		It->second->m_Dismissed = It->second->HandleButton( Pressed, static_cast< int16_t >( X ), static_cast< int16_t >( Y ) );
+
+} // OnWaylandButton
+
+//////////////////////////////////////////////////////////////////////////
+
+xyPointerSampler::xyPointerSampler( xyXCBConnection& rXCB )
+	: rXCB( rXCB )
+{
+} // xyPointerSampler
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPointerSampler::Start( void )
+{
+
+#if defined( XY_HAS_XCB_XINPUT )
+
+	if( !rXCB.XInputOpcode )
+		return;
+
+	// Raw events are only ever delivered to the root window, and unlike core motion they arrive no matter which window the pointer is over
+	struct
+	{
+		xcb_input_event_mask_t Header;
+		uint32_t               Mask;
+
+	} EventMask = { { XCB_INPUT_DEVICE_ALL_MASTER, 1 }, XCB_INPUT_XI_EVENT_MASK_RAW_MOTION };
+
+	xyXCB.input_xi_select_events( rXCB.pConnection, rXCB.pScreen->root, 1, &EventMask.Header );
+
+	// The pointer may have moved since it was last read, and before we were told about it
+	SendQuery( Clock::now() );
+	xyXCB.flush( rXCB.pConnection );
+
+	Streaming.store( true, std::memory_order_release );
+
+#endif // XY_HAS_XCB_XINPUT
+
+} // Start
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyPointerSampler::HandleEvent( [[ maybe_unused ]] const xcb_generic_event_t* pEvent )
+{
+
+#if defined( XY_HAS_XCB_XINPUT )
+
+	const xcb_ge_generic_event_t* pGenericEvent = reinterpret_cast< const xcb_ge_generic_event_t* >( pEvent );
+
+	if( pGenericEvent->extension != rXCB.XInputOpcode || pGenericEvent->event_type != XCB_INPUT_RAW_MOTION )
+		return false;
+
+	// Raw motion is in device units, so the position itself has to be asked for.
+	// A fast mouse sends a thousand of these every second, and the queries are capped so that a busy server can't make us pile them up.
+	if( Queries.size() < MaxQueriesInFlight ) SendQuery( Clock::now() );
+	else                                      MovedWhileBusy = Clock::now();
+
+	return true;
+
+#else // XY_HAS_XCB_XINPUT
+
+	return false;
+
+#endif // !XY_HAS_XCB_XINPUT
+
+} // HandleEvent
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPointerSampler::PollReplies( void )
+{
+	// Replies come back in the order the queries were sent
+	while( !Queries.empty() )
+	{
+		void*                pReply = nullptr;
+		xcb_generic_error_t* pError = nullptr;
+
+		if( !xyXCB.poll_for_reply( rXCB.pConnection, Queries.front().Cookie.sequence, &pReply, &pError ) )
+			break;
+
+		if( pReply )
+		{
+			Publish( *static_cast< xcb_query_pointer_reply_t* >( pReply ), Queries.front().Time );
+			free( pReply );
+		}
+
+		free( pError );
+		Queries.pop_front();
+	}
+
+	if( MovedWhileBusy && Queries.size() < MaxQueriesInFlight )
+	{
+		SendQuery( *MovedWhileBusy );
+		MovedWhileBusy.reset();
+	}
+
+} // PollReplies
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyPointerSampler::GetLatest( int32_t& rX, int32_t& rY )
+{
+	uint64_t Packed = Latest.load( std::memory_order_acquire );
+
+	// Without XInput2 nothing keeps the position current, and the first read may come before the first reply
+	if( !Packed || !Streaming.load( std::memory_order_acquire ) )
+	{
+		XY_TRACE_SCOPE( "xyPointerSampler::QueryPointer" );
+
+		++rXCB.RoundTrips;
+		XY_TRACE_COUNTER( "XCB round trips", rXCB.RoundTrips.load( std::memory_order_relaxed ) );
+
+		xcb_query_pointer_reply_t* pReply = xyXCB.query_pointer_reply( rXCB.pConnection, xyXCB.query_pointer( rXCB.pConnection, rXCB.pScreen->root ), nullptr );
+		if( !pReply )
+			return false;
+
+		Packed = Pack( *pReply );
+		free( pReply );
+
+		// Don't replace a newer position from the main thread
+		uint64_t Expected = 0;
+		Latest.compare_exchange_strong( Expected, Packed, std::memory_order_acq_rel );
+
+		// Waiting for the reply may have pulled events off the socket, and epoll won't tell the main thread about those
+		if( std::this_thread::get_id() != xyGetContext().pPlatformImpl->MainThreadID )
+			xyPostToMainThread( []{ xyGetContext().pPlatformImpl->OnXCBEvents(); } );
+	}
+
+	if( !( Packed >> 63 ) )
+		return false;
+
+	rX = static_cast< int16_t >( Packed >> 16 );
+	rY = static_cast< int16_t >( Packed );
+
+	return true;
+
+} // GetLatest
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t xyPointerSampler::DrainHistory( std::span< xyMouseSample > Samples )
+{
+	std::scoped_lock Lock( DrainMutex );
+
+	const uint64_t End   = Head.load( std::memory_order_acquire );
+	size_t         Count = 0;
+
+	// Samples that were overwritten before we got to them are gone
+	Tail = std::max( Tail, End > HistoryCapacity ? End - HistoryCapacity : 0 );
+
+	for( ; Tail < End && Count < Samples.size(); ++Tail )
+	{
+		const Slot&    rSlot    = History[ Tail % HistoryCapacity ];
+		const uint64_t Expected = Tail * 2 + 2;
+
+		// The writer may lap us while we are reading, in which case the sequence has moved on and the sample is skipped
+		if( rSlot.Sequence.load( std::memory_order_acquire ) != Expected )
+			continue;
+
+		const uint64_t Position = rSlot.Position.load( std::memory_order_relaxed );
+		const int64_t  Time     = rSlot.Time.load( std::memory_order_relaxed );
+
+		std::atomic_thread_fence( std::memory_order_acquire );
+
+		if( rSlot.Sequence.load( std::memory_order_relaxed ) != Expected )
+			continue;
+
+		Samples[ Count++ ] = { .X=static_cast< int16_t >( Position >> 16 ), .Y=static_cast< int16_t >( Position ), .Time=Clock::time_point( Clock::duration( Time ) ) };
+	}
+
+	return Count;
+
+} // DrainHistory
+
+//////////////////////////////////////////////////////////////////////////
+
+uint64_t xyPointerSampler::Pack( const xcb_query_pointer_reply_t& rReply )
+{
+	// The pointer may be on another screen, in which case its coordinates mean nothing to us.
+	// Bit 32 is always set so that a known position never packs to zero.
+	const uint64_t Valid = rReply.same_screen ? 1 : 0;
+	const uint64_t X     = static_cast< uint16_t >( rReply.root_x );
+	const uint64_t Y     = static_cast< uint16_t >( rReply.root_y );
+
+	return ( Valid << 63 ) | ( uint64_t( 1 ) << 32 ) | ( X << 16 ) | Y;
+
+} // Pack
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPointerSampler::SendQuery( Clock::time_point Time )
+{
+	Queries.push_back( { .Cookie=xyXCB.query_pointer( rXCB.pConnection, rXCB.pScreen->root ), .Time=Time } );
+
+} // SendQuery
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyPointerSampler::Publish( const xcb_query_pointer_reply_t& rReply, Clock::time_point Time )
+{
+	const uint64_t Packed = Pack( rReply );
+
+	Latest.store( Packed, std::memory_order_release );
+
+	if( !( Packed >> 63 ) )
+		return;
+
+	// Only the main thread writes, so the slot can be claimed without a compare and swap
+	const uint64_t Index = Head.load( std::memory_order_relaxed );
+	Slot&          rSlot = History[ Index % HistoryCapacity ];
+
+	rSlot.Sequence.store( Index * 2 + 1, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+	rSlot.Position.store( Packed, std::memory_order_relaxed );
+	rSlot.Time.store( Time.time_since_epoch().count(), std::memory_order_relaxed );
+	rSlot.Sequence.store( Index * 2 + 2, std::memory_order_release );
+
+	Head.store( Index + 1, std::memory_order_release );
+
+} // Publish
+
+//////////////////////////////////////////////////////////////////////////
+
+xyRect xyDamageRegion::Intersect( const xyRect& rA, const xyRect& rB )
+{
+	return { .Left=std::max( rA.Left, rB.Left ), .Top=std::max( rA.Top, rB.Top ), .Right=std::min( rA.Right, rB.Right ), .Bottom=std::min( rA.Bottom, rB.Bottom ) };
+
+} // Intersect
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyDamageRegion::Add( const xyRect& rRect )
+{
+	auto Area  = []( const xyRect& r ) { return int64_t( r.Right - r.Left ) * ( r.Bottom - r.Top ); };
+	auto Union = []( const xyRect& a, const xyRect& b ) { return xyRect{ .Left=std::min( a.Left, b.Left ), .Top=std::min( a.Top, b.Top ), .Right=std::max( a.Right, b.Right ), .Bottom=std::max( a.Bottom, b.Bottom ) }; };
+
+	if( rRect.Right <= rRect.Left || rRect.Bottom <= rRect.Top )
+		return;
+
+	xyRect New = rRect;
+
+	// Swallow every rectangle that is cheaper to repaint together with the new one than apart from it.
+	// A merge grows the new rectangle, which may make it worth merging with ones that were passed over, so this goes on until nothing changes.
+	for( bool Merged = true; Merged; )
+	{
+		Merged = false;
+
+		for( size_t i = 0; i < Count; ++i )
+		{
+			const xyRect Combined = Union( New, Rects[ i ] );
+
+			if( Area( Combined ) > Area( New ) + Area( Rects[ i ] ) )
+				continue;
+
+			New          = Combined;
+			Rects[ i-- ] = Rects[ --Count ];
+			Merged       = true;
+		}
+	}
+
+	Rects[ Count++ ] = New;
+
+	if( Count <= MaxRects )
+		return;
+
+	// Too many of them, so merge the two that waste the least area together
+	size_t  BestA     = 0;
+	size_t  BestB     = 1;
+	int64_t BestWaste = INT64_MAX;
+
+	for( size_t a = 0; a < Count; ++a )
+	{
+		for( size_t b = a + 1; b < Count; ++b )
+		{
+			const int64_t Waste = Area( Union( Rects[ a ], Rects[ b ] ) ) - Area( Rects[ a ] ) - Area( Rects[ b ] );
+
+			if( Waste < BestWaste )
+			{
+				BestA     = a;
+				BestB     = b;
+				BestWaste = Waste;
+			}
+		}
+	}
+
+	Rects[ BestA ] = Union( Rects[ BestA ], Rects[ BestB ] );
+	Rects[ BestB ] = Rects[ --Count ];
+
+} // Add
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyPutImage( xcb_connection_t* pConnection, xcb_drawable_t Drawable, xcb_gcontext_t GC, uint8_t Depth, const uint32_t* pPixels, uint32_t Stride, std::span< const xyRect > Rects )
+{
+	// Requests can't be larger than the server allows, so large rectangles are sent in bands of whole rows
+	const size_t MaxSize = size_t( xyXCB.get_maximum_request_length( pConnection ) ) * 4 - sizeof( xcb_put_image_request_t );
+	std::vector< uint32_t > Packed;
+
+	for( const xyRect& rRect : Rects )
+	{
+		const uint32_t RectWidth  = rRect.Right - rRect.Left;
+		const uint32_t BandHeight = static_cast< uint32_t >( std::max< size_t >( MaxSize / ( RectWidth * sizeof( uint32_t ) ), 1 ) );
+
+		for( uint32_t Y = rRect.Top; Y < static_cast< uint32_t >( rRect.Bottom ); Y += BandHeight )
+		{
+			const uint32_t  Rows    = std::min< uint32_t >( BandHeight, rRect.Bottom - Y );
+			const uint32_t* pSource = pPixels + size_t( Y ) * Stride + rRect.Left;
+
+			// Rows that are narrower than the pixels they are taken from are not back to back, and have to be packed together first
+			if( RectWidth != Stride )
+			{
+				Packed.resize( size_t( Rows ) * RectWidth );
+
+				for( uint32_t Row = 0; Row < Rows; ++Row )
+					std::memcpy( &Packed[ size_t( Row ) * RectWidth ], pSource + size_t( Row ) * Stride, RectWidth * sizeof( uint32_t ) );
+
+				pSource = Packed.data();
+			}
+
+			xyXCB.put_image( pConnection, XCB_IMAGE_FORMAT_Z_PIXMAP, Drawable, GC, RectWidth, Rows, rRect.Left, Y, 0, Depth, Rows * RectWidth * sizeof( uint32_t ), reinterpret_cast< const uint8_t* >( pSource ) );
+		}
+	}
+
+} // xyPutImage
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xySetFixedSize( xyXCBConnection& rXCB, xcb_window_t Window, uint32_t Width, uint32_t Height )
+{
+	// Great hack... The window can't be resized when its minimum and maximum size are the same.
+	// This is the WM_SIZE_HINTS layout from the ICCCM, which saves us from linking with xcb-icccm for a single property.
+	std::array< uint32_t, 18 > SizeHints = { };
+	SizeHints[ 0 ] = ( 1 << 4 ) | ( 1 << 5 ); // PMinSize | PMaxSize
+	SizeHints[ 5 ] = SizeHints[ 7 ] = Width;
+	SizeHints[ 6 ] = SizeHints[ 8 ] = Height;
+
+	xyXCB.change_property( rXCB.pConnection, XCB_PROP_MODE_REPLACE, Window, XCB_ATOM_WM_NORMAL_HINTS, XCB_ATOM_WM_SIZE_HINTS, 32, SizeHints.size(), SizeHints.data() );
+
+} // xySetFixedSize
+
+//////////////////////////////////////////////////////////////////////////
+
+xyWindow::~xyWindow( void )
+{
+	xyPlatformImpl& rPlatformImpl = *xyGetContext().pPlatformImpl;
+
+	if( pSurface )
+	{
+		xyRunOnMainThread( [ & ]{ DestroySurface(); } );
+		return;
+	}
+
+	if( !Window )
+		return;
+
+	xyRunOnMainThread( [ & ]{ rPlatformImpl.Windows.erase( Window ); } );
+
+	std::scoped_lock Lock( Mutex );
+
+	Release();
+
+	if( xyXCB.connection_has_error( pXCB->pConnection ) )
+		return;
+
+	xyXCB.free_gc( pXCB->pConnection, GC );
+	xyXCB.destroy_window( pXCB->pConnection, Window );
+	xyXCB.flush( pXCB->pConnection );
+
+} // ~xyWindow
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyWindow::Create( std::string_view Title, uint32_t NewWidth, uint32_t NewHeight, bool Resizable )
+{
+	XY_TRACE_SCOPE( "xyWindow::Create" );
+
+	xyPlatformImpl& rPlatformImpl = *xyGetContext().pPlatformImpl;
+
+	if( Window || pSurface )
+		return false;
+
+	if( ( pWayland = rPlatformImpl.GetWayland() ) )
+		return CreateSurface( std::string( Title ), std::clamp< uint32_t >( NewWidth, 1, INT16_MAX ), std::clamp< uint32_t >( NewHeight, 1, INT16_MAX ), Resizable );
+
+	if( !( pXCB = rPlatformImpl.GetXCB() ) )
+		return false;
+
+	// Pixels are written as whole words, which is how every server stores the usual depths of 24 and 32
+	if( pXCB->BitsPerPixel != 32 || pXCB->pScreen->root_depth < 24 )
+		return false;
+
+	xcb_connection_t* pConnection = pXCB->pConnection;
+	xcb_screen_t*     pScreen     = pXCB->pScreen;
+	std::string       TitleString( Title );
+
+	NewWidth  = std::clamp< uint32_t >( NewWidth,  1, INT16_MAX );
+	NewHeight = std::clamp< uint32_t >( NewHeight, 1, INT16_MAX );
+
+	Window = xyXCB.generate_id( pConnection );
+	GC     = xyXCB.generate_id( pConnection );
+
+	// Without a background the server leaves the window alone until we present, instead of clearing it every time it is resized or uncovered
+	{
+		const uint32_t Values[] = { XCB_BACK_PIXMAP_NONE, XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY };
+		xyXCB.create_window( pConnection, XCB_COPY_FROM_PARENT, Window, pScreen->root, 0, 0, NewWidth, NewHeight, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT, pXCB->VisualID, XCB_CW_BACK_PIXMAP | XCB_CW_EVENT_MASK, Values );
+	}
+
+	xyXCB.change_property( pConnection, XCB_PROP_MODE_REPLACE, Window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, TitleString.size(), TitleString.data() );
+	xyXCB.change_property( pConnection, XCB_PROP_MODE_REPLACE, Window, XCB_ATOM_WM_ICON_NAME, XCB_ATOM_STRING, 8, TitleString.size(), TitleString.data() );
+	xyXCB.change_property( pConnection, XCB_PROP_MODE_REPLACE, Window, pXCB->WMProtocols, XCB_ATOM_ATOM, 32, 1, &pXCB->WMDeleteWindow );
+
+	if( !Resizable )
+		xySetFixedSize( *pXCB, Window, NewWidth, NewHeight );
+
+	// Presenting every frame would otherwise send back an event saying that nothing needed to be copied
+	{
+		const uint32_t Values[] = { 0 };
+		xyXCB.create_gc( pConnection, GC, Window, XCB_GC_GRAPHICS_EXPOSURES, Values );
+	}
+
+	{
+		std::scoped_lock Lock( Mutex );
+
+		SharedMemory = pXCB->ShmEventBase != 0;
+		WindowWidth  = NewWidth;
+		WindowHeight = NewHeight;
+
+		if( !Allocate( NewWidth, NewHeight, true ) )
+		{
+			xyXCB.free_gc( pConnection, GC );
+			xyXCB.destroy_window( pConnection, Window );
+			xyXCB.flush( pConnection );
+			Window = 0;
+			return false;
+		}
+	}
+
+	// Events about the window are handled on the main thread, so it has to know about it before the window is shown
+	xyRunOnMainThread( [ & ]{ rPlatformImpl.Windows.emplace( Window, this ); } );
+
+	Open.store( true, std::memory_order_release );
+
+	xyXCB.map_window( pConnection, Window );
+	xyXCB.flush( pConnection );
+
+	return true;
+
+} // Create
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyWindow::CreateSurface( const std::string& rTitle, uint32_t NewWidth, uint32_t NewHeight, bool Resizable )
+{
+	struct XdgSurfaceListener
+	{
+		void( *Configure )( void*, wl_proxy*, uint32_t );
+
+	}; // XdgSurfaceListener
+
+	struct ToplevelListener
+	{
+		void( *Configure )( void*, wl_proxy*, int32_t, int32_t, wl_array* );
+		void( *Close     )( void*, wl_proxy* );
+
+	}; // ToplevelListener
+
+	// The size that the toplevel was configured with comes first, and is then applied by the next frame
+	static constexpr XdgSurfaceListener XdgSurface =
+	{
+		.Configure=[]( void* pData, wl_proxy* pXdgSurface, uint32_t Serial )
+		{
+			xyWindow* pThis = static_cast< xyWindow* >( pData );
+			xyWaylandConnection::Send( pXdgSurface, 4 /* xdg_surface.ack_configure */, nullptr, false, Serial );
+
+			std::scoped_lock Lock( pThis->Mutex );
+			pThis->Configured = true;
+		},
+	};
+
+	static constexpr ToplevelListener Toplevel =
+	{
+		.Configure=[]( void* pData, wl_proxy*, int32_t ConfiguredWidth, int32_t ConfiguredHeight, wl_array* )
+		{
+			// A size of zero leaves it up to us
+			if( ConfiguredWidth <= 0 || ConfiguredHeight <= 0 )
+				return;
+
+			xyWindow* pThis = static_cast< xyWindow* >( pData );
+
+			std::scoped_lock Lock( pThis->Mutex );
+			pThis->WindowWidth  = std::min< uint32_t >( ConfiguredWidth,  INT16_MAX );
+			pThis->WindowHeight = std::min< uint32_t >( ConfiguredHeight, INT16_MAX );
+		},
+		.Close=[]( void* pData, wl_proxy* ) { static_cast< xyWindow* >( pData )->Close(); },
+	};
+
+	xyPlatformImpl& rPlatformImpl = *xyGetContext().pPlatformImpl;
+	bool            Created       = false;
+
+	// Events about the window are dispatched on the main thread, so that is where it is set up and waits to be configured
+	xyRunOnMainThread( [ & ]
+	{
+		pSurface    = xyWaylandConnection::Send( pWayland->pCompositor, 0 /* wl_compositor.create_surface */, xyWL.surface_interface,  false, nullptr );
+		pXdgSurface = xyWaylandConnection::Send( pWayland->pWmBase,     2 /* xdg_wm_base.get_xdg_surface */,  &xyXdgSurfaceInterface,  false, nullptr, pSurface );
+		pToplevel   = xyWaylandConnection::Send( pXdgSurface,           1 /* xdg_surface.get_toplevel */,     &xyXdgToplevelInterface, false, nullptr );
+
+		xyWaylandConnection::AddListener( pXdgSurface, XdgSurface, this );
+		xyWaylandConnection::AddListener( pToplevel,   Toplevel,   this );
+
+		xyWaylandConnection::Send( pToplevel, 2 /* xdg_toplevel.set_title */, nullptr, false, rTitle.c_str() );
+
+		if( !Resizable )
+		{
+			xyWaylandConnection::Send( pToplevel, 7 /* xdg_toplevel.set_max_size */, nullptr, false, static_cast< int32_t >( NewWidth ), static_cast< int32_t >( NewHeight ) );
+			xyWaylandConnection::Send( pToplevel, 8 /* xdg_toplevel.set_min_size */, nullptr, false, static_cast< int32_t >( NewWidth ), static_cast< int32_t >( NewHeight ) );
+		}
+
+		// Committing without a buffer asks for the first configure, which is sent before the round trip ends
+		xyWaylandConnection::Send( pSurface, 6 /* wl_surface.commit */, nullptr, false );
+
+		{
+			std::scoped_lock Lock( pWayland->DispatchMutex );
+			xyWL.display_roundtrip( pWayland->pDisplay );
+		}
+
+		std::scoped_lock Lock( Mutex );
+
+		// Nothing may be attached to the surface before it has been configured
+		if( !Configured )
+			return;
+
+		SharedMemory = true;
+
+		if( !WindowWidth )
+		{
+			WindowWidth  = NewWidth;
+			WindowHeight = NewHeight;
+		}
+
+		if( !Allocate( WindowWidth, WindowHeight, false ) )
+			return;
+
+		rPlatformImpl.WaylandWindows.emplace( pSurface, this );
+		Created = true;
+	} );
+
+	if( !Created )
+	{
+		xyRunOnMainThread( [ & ]{ DestroySurface(); } );
+		return false;
+	}
+
+	Open.store( true, std::memory_order_release );
+
+	return true;
+
+} // CreateSurface
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyWindow::DestroySurface( void )
+{
+	xyGetContext().pPlatformImpl->WaylandWindows.erase( pSurface );
+
+	std::scoped_lock Lock( Mutex );
+
+	Release();
+
+	if( pFrameCallback )
+		xyWL.proxy_destroy( std::exchange( pFrameCallback, nullptr ) );
+
+	xyWaylandConnection::Send( std::exchange( pToplevel,   nullptr ), 0 /* xdg_toplevel.destroy */, nullptr, true );
+	xyWaylandConnection::Send( std::exchange( pXdgSurface, nullptr ), 0 /* xdg_surface.destroy */,  nullptr, true );
+	xyWaylandConnection::Send( std::exchange( pSurface,    nullptr ), 0 /* wl_surface.destroy */,   nullptr, true );
+
+	xyWL.display_flush( pWayland->pDisplay );
+
+} // DestroySurface
+
+//////////////////////////////////////////////////////////////////////////
+
+xyWindow::Framebuffer xyWindow::BeginFrame( void )
+{
+	XY_TRACE_SCOPE( "xyWindow::BeginFrame" );
+
+	std::unique_lock Lock( Mutex );
+
+	// The window was resized since the last frame
+	if( ( WindowWidth != Width || WindowHeight != Height ) && !Allocate( WindowWidth, WindowHeight, false ) )
+		return { };
+
+	Buffer& rBuffer = Buffers[ Current ];
+	auto    Ready   = [ & ]{ return ( !rBuffer.InFlight && !pFrameCallback ) || !IsOpen(); };
+
+	// The server tells the main thread when it is done reading, so the main thread has to keep serving events while it waits
+	if( std::this_thread::get_id() == xyGetContext().pPlatformImpl->MainThreadID )
+	{
+		while( !Ready() )
+		{
+			Lock.unlock();
+			xyGetContext().pPlatformImpl->EventLoop.RunOnce( -1 );
+			Lock.lock();
+		}
+	}
+	else
+	{
+		Released.wait( Lock, Ready );
+	}
+
+	return { .pPixels=rBuffer.pPixels, .Width=Width, .Height=Height, .Stride=Stride, .Stale=rBuffer.Stale.GetRects() };
+
+} // BeginFrame
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyWindow::IsFrameReady( void )
+{
+	std::scoped_lock Lock( Mutex );
+
+	return !Buffers[ Current ].InFlight && !pFrameCallback;
+
+} // IsFrameReady
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyWindow::Present( void )
+{
+	const xyRect Whole = { .Left=0, .Top=0, .Right=static_cast< int32_t >( Width ), .Bottom=static_cast< int32_t >( Height ) };
+
+	Present( std::span< const xyRect >( &Whole, 1 ) );
+
+} // Present
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyWindow::Present( std::span< const xyRect > Damage )
+{
+	XY_TRACE_SCOPE( "xyWindow::Present" );
+
+	// The frame callback has to have its listener before the main thread can dispatch anything to it
+	std::unique_lock< std::mutex > DispatchLock;
+	if( pWayland )
+		DispatchLock = std::unique_lock( pWayland->DispatchMutex );
+
+	std::scoped_lock Lock( Mutex );
+
+	if( !pMemory || !IsOpen() )
+		return;
+
+	const xyRect   Bounds  = { .Left=0, .Top=0, .Right=static_cast< int32_t >( Width ), .Bottom=static_cast< int32_t >( Height ) };
+	Buffer&        rBuffer = Buffers[ Current ];
+	Buffer&        rOther  = Buffers[ ( Current + 1 ) % Buffers.size() ];
+	xyDamageRegion Region;
+
+	for( const xyRect& rRect : Damage )
+		Region.Add( xyDamageRegion::Intersect( rRect, Bounds ) );
+
+	// The stale parts were redrawn along with the damage, and what was drawn now is what the other buffer is missing
+	rBuffer.Stale.Clear();
+
+	for( const xyRect& rRect : Region.GetRects() )
+		rOther.Stale.Add( rRect );
+
+	Put( rBuffer, Region.GetRects() );
+
+	Current   = ( Current + 1 ) % Buffers.size();
+	Presented = true;
+
+	if( pWayland ) xyWL.display_flush( pWayland->pDisplay );
+	else           xyXCB.flush( pXCB->pConnection );
+
+} // Present
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyWindow::HandleEvent( const xcb_generic_event_t* pEvent )
+{
+	switch( pEvent->response_type & ~0x80 )
+	{
+		case XCB_CLIENT_MESSAGE:
+		{
+			if( reinterpret_cast< const xcb_client_message_event_t* >( pEvent )->data.data32[ 0 ] == pXCB->WMDeleteWindow )
+				Close();
+		} break;
+
+		case XCB_EXPOSE:
+		{
+			// The server sends one event for every rectangle that was lost. They are merged here and repainted once they have all been read.
+			const xcb_expose_event_t* pExpose = reinterpret_cast< const xcb_expose_event_t* >( pEvent );
+
+			std::scoped_lock Lock( Mutex );
+			Exposed.Add( { .Left=pExpose->x, .Top=pExpose->y, .Right=pExpose->x + pExpose->width, .Bottom=pExpose->y + pExpose->height } );
+		} break;
+
+		case XCB_CONFIGURE_NOTIFY:
+		{
+			// The framebuffer is resized by the next frame, on the thread that draws
+			const xcb_configure_notify_event_t* pConfigure = reinterpret_cast< const xcb_configure_notify_event_t* >( pEvent );
+
+			std::scoped_lock Lock( Mutex );
+			WindowWidth  = std::max< uint32_t >( pConfigure->width,  1 );
+			WindowHeight = std::max< uint32_t >( pConfigure->height, 1 );
+		} break;
+
+		default:
+		{
+
+#if defined( XY_HAS_XCB_SHM )
+
+			if( pXCB->ShmEventBase && ( pEvent->response_type & ~0x80 ) == pXCB->ShmEventBase + XCB_SHM_COMPLETION )
+			{
+				const xcb_shm_completion_event_t* pCompletion = reinterpret_cast< const xcb_shm_completion_event_t* >( pEvent );
+
+				std::scoped_lock Lock( Mutex );
+
+				// Completions for memory that was replaced by a resize are of no interest
+				for( Buffer& rBuffer : Buffers )
+				{
+					if( pCompletion->shmseg == Segment && pCompletion->offset == rBuffer.Offset && rBuffer.InFlight )
+						--rBuffer.InFlight;
+				}
+
+				Released.notify_all();
+			}
+
+#endif // XY_HAS_XCB_SHM
+
+		} break;
+	}
+
+} // HandleEvent
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyWindow::Repaint( void )
+{
+	std::scoped_lock Lock( Mutex );
+
+	if( Exposed.IsEmpty() )
+		return;
+
+	// Exposed parts are restored from the frame that was presented last, which the app is not drawing into.
+	// Until the first frame has been presented there is nothing to restore them from, and the first frame covers them anyway.
+	if( Presented && pMemory && IsOpen() )
+	{
+		const xyRect   Bounds = { .Left=0, .Top=0, .Right=static_cast< int32_t >( Width ), .Bottom=static_cast< int32_t >( Height ) };
+		xyDamageRegion Region;
+
+		for( const xyRect& rRect : Exposed.GetRects() )
+			Region.Add( xyDamageRegion::Intersect( rRect, Bounds ) );
+
+		Put( Buffers[ ( Current + 1 ) % Buffers.size() ], Region.GetRects() );
+	}
+
+	Exposed.Clear();
+
+} // Repaint
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyWindow::Close( void )
+{
+	std::scoped_lock Lock( Mutex );
+
+	Open.store( false, std::memory_order_release );
+	Released.notify_all();
+
+} // Close
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyWindow::Allocate( uint32_t NewWidth, uint32_t NewHeight, [[ maybe_unused ]] bool Verify )
+{
+	Release();
+
+	// Rows start on a cache line, and buffers on a page of their own
+	const size_t PageSize   = static_cast< size_t >( sysconf( _SC_PAGESIZE ) );
+	const size_t NewStride  = ( NewWidth + 15 ) & ~size_t( 15 );
+	const size_t BufferSize = ( NewStride * NewHeight * sizeof( uint32_t ) + PageSize - 1 ) / PageSize * PageSize;
+	const size_t NewSize    = BufferSize * Buffers.size();
+
+	// The memory is a file so that it can be handed to the server. Without the extension it is just memory.
+	const int FD = memfd_create( "xy-framebuffer", MFD_CLOEXEC );
+	if( FD < 0 )
+		return false;
+
+	void* pNewMemory = MAP_FAILED;
+	if( ftruncate( FD, NewSize ) != 0 || ( pNewMemory = mmap( nullptr, NewSize, PROT_READ | PROT_WRITE, MAP_SHARED, FD, 0 ) ) == MAP_FAILED )
+	{
+		close( FD );
+		return false;
+	}
+
+	pMemory    = pNewMemory;
+	MemorySize = NewSize;
+	Width      = NewWidth;
+	Height     = NewHeight;
+	Stride     = static_cast< uint32_t >( NewStride );
+	Current    = 0;
+	Presented  = false;
+
+	for( size_t i = 0; i < Buffers.size(); ++i )
+	{
+		Buffers[ i ].pPixels  = reinterpret_cast< uint32_t* >( static_cast< uint8_t* >( pMemory ) + i * BufferSize );
+		Buffers[ i ].Offset   = static_cast< uint32_t >( i * BufferSize );
+		Buffers[ i ].InFlight = 0;
+		Buffers[ i ].Stale.Clear();
+		Buffers[ i ].Stale.Add( { .Left=0, .Top=0, .Right=static_cast< int32_t >( Width ), .Bottom=static_cast< int32_t >( Height ) } );
+	}
+
+	if( pWayland )
+	{
+		struct BufferListener
+		{
+			void( *Release )( void*, wl_proxy* );
+
+		}; // BufferListener
+
+		static constexpr BufferListener Listener =
+		{
+			.Release=[]( void* pData, wl_proxy* pReleased )
+			{
+				xyWindow* pThis = static_cast< xyWindow* >( pData );
+
+				std::scoped_lock Lock( pThis->Mutex );
+
+				for( Buffer& rBuffer : pThis->Buffers )
+				{
+					if( rBuffer.pBuffer == pReleased )
+						rBuffer.InFlight = 0;
+				}
+
+				pThis->Released.notify_all();
+			},
+		};
+
+		// The pool is the whole of the memory, and the buffers are parts of it. The descriptor is duplicated by libwayland.
+		pPool = xyWaylandConnection::Send( pWayland->pShm, 0 /* wl_shm.create_pool */, xyWL.shm_pool_interface, false, nullptr, FD, static_cast< int32_t >( NewSize ) );
+
+		for( Buffer& rBuffer : Buffers )
+		{
+			rBuffer.pBuffer = xyWaylandConnection::Send( pPool, 0 /* wl_shm_pool.create_buffer */, xyWL.buffer_interface, false, nullptr, static_cast< int32_t >( rBuffer.Offset ), static_cast< int32_t >( Width ), static_cast< int32_t >( Height ), static_cast< int32_t >( Stride * sizeof( uint32_t ) ), 1 /* WL_SHM_FORMAT_XRGB8888 */ );
+			xyWaylandConnection::AddListener( rBuffer.pBuffer, Listener, this );
+		}
+
+		close( FD );
+
+		return true;
+	}
+
+#if defined( XY_HAS_XCB_SHM )
+
+	if( SharedMemory )
+	{
+		xcb_connection_t* pConnection = pXCB->pConnection;
+
+		// The descriptor is closed by xcb once it has been sent
+		Segment = xyXCB.generate_id( pConnection );
+
+		if( !Verify )
+		{
+			xyXCB.shm_attach_fd( pConnection, Segment, FD, 0 );
+			return true;
+		}
+
+		// A server on another host has the extension too, but can't open our memory.
+		// Finding that out costs a round trip, but only when the window is created.
+		++pXCB->RoundTrips;
+		XY_TRACE_COUNTER( "XCB round trips", pXCB->RoundTrips.load( std::memory_order_relaxed ) );
+
+		if( xcb_generic_error_t* pError = xyXCB.request_check( pConnection, xyXCB.shm_attach_fd_checked( pConnection, Segment, FD, 0 ) ) )
+		{
+			free( pError );
+			SharedMemory = false;
+		}
+
+		// Waiting for the reply may have pulled events off the socket, and epoll won't tell the main thread about those
+		if( std::this_thread::get_id() != xyGetContext().pPlatformImpl->MainThreadID )
+			xyPostToMainThread( []{ xyGetContext().pPlatformImpl->OnXCBEvents(); } );
+
+		return true;
+	}
+
+#endif // XY_HAS_XCB_SHM
+
+	close( FD );
+
+	return true;
+
+} // Allocate
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyWindow::Release( void )
+{
+	if( !pMemory )
+		return;
+
+	// The compositor keeps showing the last buffer that was attached, even after it has been destroyed
+	if( pWayland )
+	{
+		for( Buffer& rBuffer : Buffers )
+			xyWaylandConnection::Send( rBuffer.pBuffer, 0 /* wl_buffer.destroy */, nullptr, true );
+
+		xyWaylandConnection::Send( std::exchange( pPool, nullptr ), 1 /* wl_shm_pool.destroy */, nullptr, true );
+	}
+
+#if defined( XY_HAS_XCB_SHM )
+
+	if( pXCB && SharedMemory && !xyXCB.connection_has_error( pXCB->pConnection ) )
+		xyXCB.shm_detach( pXCB->pConnection, Segment );
+
+#endif // XY_HAS_XCB_SHM
+
+	// The server maps the memory on its own, so it can keep reading from it after we let go of ours
+	munmap( pMemory, MemorySize );
+
+	pMemory    = nullptr;
+	MemorySize = 0;
+
+	for( Buffer& rBuffer : Buffers )
+		rBuffer = { };
+
+} // Release
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyWindow::Put( Buffer& rBuffer, std::span< const xyRect > Rects )
+{
+	if( pWayland )
+	{
+		struct CallbackListener
+		{
+			void( *Done )( void*, wl_proxy*, uint32_t );
+
+		}; // CallbackListener
+
+		static constexpr CallbackListener Listener =
+		{
+			.Done=[]( void* pData, wl_proxy* pCallback, uint32_t )
+			{
+				xyWindow* pThis = static_cast< xyWindow* >( pData );
+
+				std::scoped_lock Lock( pThis->Mutex );
+
+				if( pThis->pFrameCallback == pCallback )
+					pThis->pFrameCallback = nullptr;
+
+				xyWL.proxy_destroy( pCallback );
+				pThis->Released.notify_all();
+			},
+		};
+
+		if( Rects.empty() )
+			return;
+
+		// Damage is in buffer coordinates from version 4 of the surface. Before that it is in surface coordinates, which are the same at a scale of 1.
+		const uint32_t DamageOpcode = ( xyWL.proxy_get_version( pSurface ) >= 4 ) ? 9 /* wl_surface.damage_buffer */ : 2 /* wl_surface.damage */;
+
+		xyWaylandConnection::Send( pSurface, 1 /* wl_surface.attach */, nullptr, false, rBuffer.pBuffer, int32_t( 0 ), int32_t( 0 ) );
+
+		for( const xyRect& rRect : Rects )
+			xyWaylandConnection::Send( pSurface, DamageOpcode, nullptr, false, rRect.Left, rRect.Top, rRect.Right - rRect.Left, rRect.Bottom - rRect.Top );
+
+		// The compositor calls back when it is a good time to draw the next frame, which is what BeginFrame waits for
+		if( !pFrameCallback )
+		{
+			pFrameCallback = xyWaylandConnection::Send( pSurface, 3 /* wl_surface.frame */, xyWL.callback_interface, false, nullptr );
+			xyWaylandConnection::AddListener( pFrameCallback, Listener, this );
+		}
+
+		xyWaylandConnection::Send( pSurface, 6 /* wl_surface.commit */, nullptr, false );
+
+		// A buffer is released once when the compositor is done with it, no matter how many times it was attached
+		rBuffer.InFlight = 1;
+
+		return;
+	}
+
+	xcb_connection_t* pConnection = pXCB->pConnection;
+	const uint8_t     Depth       = pXCB->pScreen->root_depth;
+
+#if defined( XY_HAS_XCB_SHM )
+
+	if( SharedMemory )
+	{
+		// Requests are handled in order, so only the last one has to send a completion event for us to know when the buffer can be drawn into again
+		for( size_t i = 0; i < Rects.size(); ++i )
+		{
+			const xyRect& rRect = Rects[ i ];
+			const bool    Last  = ( i + 1 == Rects.size() );
+
+			xyXCB.shm_put_image( pConnection, Window, GC, Stride, Height, rRect.Left, rRect.Top, rRect.Right - rRect.Left, rRect.Bottom - rRect.Top, rRect.Left, rRect.Top, Depth, XCB_IMAGE_FORMAT_Z_PIXMAP, Last, Segment, rBuffer.Offset );
+		}
+
+		if( !Rects.empty() )
+			++rBuffer.InFlight;
+
+		return;
+	}
+
+#endif // XY_HAS_XCB_SHM
+
+	// The pixels are copied into the socket by the time this returns, so there is no completion to wait for
+	xyPutImage( pConnection, Window, GC, Depth, rBuffer.pPixels, Stride, Rects );
+
+} // Put
+
+//////////////////////////////////////////////////////////////////////////
+
+xyGlyphAtlas::xyGlyphAtlas( uint32_t NewRowHeight )
+	: RowHeight( std::clamp< uint32_t >( NewRowHeight, 1, MaxHeight ) )
+{
+	// Starts out with room for a handful of rows, which is enough for a few short strings
+	Pixels.resize( size_t( Width ) * std::min( MaxHeight, RowHeight * 4 ) );
+
+} // xyGlyphAtlas
+
+//////////////////////////////////////////////////////////////////////////
+
+const xyGlyphAtlas::Entry* xyGlyphAtlas::Find( uint32_t GlyphIndex, uint64_t Stamp )
+{
+	auto It = Entries.find( GlyphIndex );
+	if( It == Entries.end() )
+		return nullptr;
+
+	if( It->second.Row < Rows.size() )
+		Rows[ It->second.Row ].LastUsed = Stamp;
+
+	return &It->second;
+
+} // Find
+
+//////////////////////////////////////////////////////////////////////////
+
+const xyGlyphAtlas::Entry& xyGlyphAtlas::Insert( uint32_t GlyphIndex, const uint8_t* pBitmap, int32_t Pitch, uint32_t BitmapWidth, uint32_t BitmapHeight, int32_t Left, int32_t Top, int32_t Advance, uint64_t Stamp )
+{
+	Entry NewEntry = { .Left=static_cast< int16_t >( Left ), .Top=static_cast< int16_t >( Top ), .Advance=Advance };
+
+	// Glyphs that reach outside of the bounding box of their font are cut off at the height of a row
+	const uint32_t GlyphWidth  = std::min( BitmapWidth, Width );
+	const uint32_t GlyphHeight = std::min( BitmapHeight, RowHeight );
+
+	if( GlyphWidth && GlyphHeight )
+	{
+		const uint32_t RowIndex = FindRow( GlyphWidth, Stamp );
+		Row&           rRow     = Rows[ RowIndex ];
+
+		NewEntry.X      = static_cast< uint16_t >( rRow.Used );
+		NewEntry.Y      = static_cast< uint16_t >( RowIndex * RowHeight );
+		NewEntry.Width  = static_cast< uint16_t >( GlyphWidth );
+		NewEntry.Height = static_cast< uint16_t >( GlyphHeight );
+		NewEntry.Row    = RowIndex;
+
+		for( uint32_t Y = 0; Y < GlyphHeight; ++Y )
+			std::memcpy( &Pixels[ size_t( NewEntry.Y + Y ) * Width + NewEntry.X ], pBitmap + ptrdiff_t( Y ) * Pitch, GlyphWidth );
+
+		rRow.Used    += GlyphWidth;
+		rRow.LastUsed = Stamp;
+		rRow.Glyphs.push_back( GlyphIndex );
+	}
+
+	return Entries.insert_or_assign( GlyphIndex, NewEntry ).first->second;
+
+} // Insert
+
+//////////////////////////////////////////////////////////////////////////
+
+uint32_t xyGlyphAtlas::FindRow( uint32_t GlyphWidth, uint64_t Stamp )
+{
+	for( uint32_t i = 0; i < Rows.size(); ++i )
+	{
+		if( Width - Rows[ i ].Used >= GlyphWidth )
+			return i;
+	}
+
+	const uint32_t Height = static_cast< uint32_t >( Pixels.size() / Width );
+
+	if( ( Rows.size() + 1 ) * RowHeight > Height )
+	{
+		// Rows that the run being shaped has used can't be emptied, since its glyphs point into them. If the oldest row is one of those,
+		// every row is, and the atlas has to grow past its full size to fit the run.
+		auto LRU = std::min_element( Rows.begin(), Rows.end(), []( const Row& rA, const Row& rB ) { return rA.LastUsed < rB.LastUsed; } );
+
+		if( Height >= MaxHeight && LRU != Rows.end() && LRU->LastUsed != Stamp )
+		{
+			for( uint32_t Glyph : LRU->Glyphs )
+				Entries.erase( Glyph );
+
+			LRU->Glyphs.clear();
+			LRU->Used = 0;
+
+			return static_cast< uint32_t >( LRU - Rows.begin() );
+		}
+
+		Pixels.resize( size_t( Width ) * std::max< size_t >( size_t( Height ) * 2, ( Rows.size() + 1 ) * RowHeight ) );
+	}
+
+	Rows.emplace_back();
+
+	return static_cast< uint32_t >( Rows.size() - 1 );
+
+} // FindRow
+
+#if defined( XY_HAS_FREETYPE )
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyFreeTypeLibrary::Load( void )
+{
+	// Never closed, for the same reason as libxcb
+	void* pHandle = dlopen( "libfreetype.so.6", RTLD_NOW | RTLD_LOCAL );
+	if( !pHandle )
+		return false;
+
+	bool Resolved = true;
+
+#define XY_FREETYPE_RESOLVE_FUNCTION( Name ) Resolved &= ( ( Name = reinterpret_cast< decltype( Name ) >( dlsym( pHandle, "FT_" #Name ) ) ) != nullptr );
+
+	XY_FREETYPE_FUNCTIONS( XY_FREETYPE_RESOLVE_FUNCTION )
+
+#undef XY_FREETYPE_RESOLVE_FUNCTION
+
+	return Resolved;
+
+} // Load
+
+//////////////////////////////////////////////////////////////////////////
+
+xyTextEngine::~xyTextEngine( void )
+{
+	if( Face )    xyFT.Done_Face( Face );
+	if( Library ) xyFT.Done_FreeType( Library );
+
+} // ~xyTextEngine
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyTextEngine::Load( void )
+{
+	if( !xyFT.Load() || xyFT.Init_FreeType( &Library ) != 0 )
+		return false;
+
+	// Fontconfig would know which font the user prefers, but it is a large library to load for one answer
+	std::vector< const char* > Paths;
+	if( const char* pFont = getenv( "XY_FONT" ) )
+		Paths.push_back( pFont );
+
+	for( const char* pPath : { "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+	                           "/usr/share/fonts/TTF/DejaVuSans.ttf",
+	                           "/usr/share/fonts/dejavu-sans-fonts/DejaVuSans.ttf",
+	                           "/usr/share/fonts/truetype/noto/NotoSans-Regular.ttf",
+	                           "/usr/share/fonts/noto/NotoSans-Regular.ttf",
+	                           "/usr/share/fonts/google-noto/NotoSans-Regular.ttf",
+	                           "/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+	                           "/usr/share/fonts/liberation-sans/LiberationSans-Regular.ttf" } )
+	{
+		Paths.push_back( pPath );
+	}
+
+	for( const char* pPath : Paths )
+	{
+		if( xyFT.New_Face( Library, pPath, 0, &Face ) == 0 )
+			return true;
+	}
+
+	return false;
+
+} // Load
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyTextEngine::GetMetrics( uint32_t NewPixelSize, int32_t& rAscent, int32_t& rDescent )
+{
+	SelectSize( NewPixelSize );
+
+	// In 1/64 pixels, and the descender is negative
+	rAscent  = static_cast< int32_t >( (  Face->size->metrics.ascender  + 63 ) >> 6 );
+	rDescent = static_cast< int32_t >( ( -Face->size->metrics.descender + 63 ) >> 6 );
+
+	return true;
+
+} // GetMetrics
+
+//////////////////////////////////////////////////////////////////////////
+
+xyGlyphAtlas& xyTextEngine::SelectSize( uint32_t NewPixelSize )
+{
+	NewPixelSize = std::max( NewPixelSize, 1u );
+
+	if( NewPixelSize != PixelSize )
+	{
+		xyFT.Set_Pixel_Sizes( Face, 0, NewPixelSize );
+		PixelSize = NewPixelSize;
+	}
+
+	std::unique_ptr< xyGlyphAtlas >& rpAtlas = Atlases[ NewPixelSize ];
+
+	if( !rpAtlas )
+	{
+		// Every glyph fits in the bounding box of the face, give or take a pixel of rounding on each side
+		uint32_t RowHeight = static_cast< uint32_t >( Face->size->metrics.height >> 6 ) + 2;
+
+		if( FT_IS_SCALABLE( Face ) )
+			RowHeight = static_cast< uint32_t >( ( int64_t( Face->bbox.yMax - Face->bbox.yMin ) * NewPixelSize + Face->units_per_EM - 1 ) / Face->units_per_EM ) + 2;
+
+		rpAtlas = std::make_unique< xyGlyphAtlas >( RowHeight );
+	}
+
+	return *rpAtlas;
+
+} // SelectSize
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyTextEngine::Shape( std::string_view Text, uint32_t NewPixelSize, xyGlyphRun& rRun )
+{
+	xyGlyphAtlas&  rAtlas   = SelectSize( NewPixelSize );
+	const uint64_t RunStamp = ++Stamp;
+	const bool     Kerning  = FT_HAS_KERNING( Face );
+	int64_t        PenX     = 0; // In 1/64 pixels, so that advances don't add up rounding errors
+	FT_UInt        Previous = 0;
+
+	xyUnicode( Text, rRun.Codepoints );
+	rRun.Glyphs.clear();
+	rRun.pAtlas = &rAtlas;
+
+	for( wchar_t Codepoint : rRun.Codepoints )
+	{
+		auto [ IndexIt, NewIndex ] = GlyphIndices.try_emplace( Codepoint, 0 );
+		if( NewIndex )
+			IndexIt->second = xyFT.Get_Char_Index( Face, static_cast< FT_ULong >( Codepoint ) );
+
+		const FT_UInt GlyphIndex = IndexIt->second;
+
+		if( Kerning && Previous && GlyphIndex )
+		{
+			if( rAtlas.Kerning.size() >= 64 * 1024 )
+				rAtlas.Kerning.clear();
+
+			auto [ It, New ] = rAtlas.Kerning.try_emplace( ( uint64_t( Previous ) << 32 ) | GlyphIndex, 0 );
+			if( New )
+			{
+				FT_Vector Delta;
+				if( xyFT.Get_Kerning( Face, Previous, GlyphIndex, FT_KERNING_DEFAULT, &Delta ) == 0 )
+					It->second = static_cast< int32_t >( Delta.x );
+			}
+
+			PenX += It->second;
+		}
+
+		Previous = GlyphIndex;
+
+		const xyGlyphAtlas::Entry* pEntry = rAtlas.Find( GlyphIndex, RunStamp );
+
+		if( !pEntry )
+		{
+			if( xyFT.Load_Glyph( Face, GlyphIndex, FT_LOAD_RENDER ) != 0 )
+				continue;
+
+			// Fonts that only have monochrome bitmaps at this size still get their advances, but not their pixels
+			const FT_GlyphSlot pSlot   = Face->glyph;
+			const FT_Bitmap&   rBitmap = pSlot->bitmap;
+			const bool         Gray    = ( rBitmap.pixel_mode == FT_PIXEL_MODE_GRAY );
+
+			pEntry = &rAtlas.Insert( GlyphIndex, rBitmap.buffer, rBitmap.pitch, Gray ? rBitmap.width : 0, Gray ? rBitmap.rows : 0, pSlot->bitmap_left, pSlot->bitmap_top, static_cast< int32_t >( pSlot->advance.x ), RunStamp );
+		}
+
+		if( pEntry->Width )
+			rRun.Glyphs.push_back( { .X=static_cast< int32_t >( ( PenX + 32 ) >> 6 ) + pEntry->Left, .Y=-pEntry->Top, .AtlasX=pEntry->X, .AtlasY=pEntry->Y, .Width=pEntry->Width, .Height=pEntry->Height } );
+
+		PenX += pEntry->Advance;
+	}
+
+	rRun.Width = static_cast< int32_t >( ( PenX + 32 ) >> 6 );
+
+} // Shape
+
+//////////////////////////////////////////////////////////////////////////
+
+xyRect xyTextEngine::Composite( const xyGlyphRun& rRun, const xyWindow::Framebuffer& rFrame, int32_t X, int32_t Baseline, uint32_t Color ) const
+{
+	const xyRect   Bounds  = { .Right=static_cast< int32_t >( rFrame.Width ), .Bottom=static_cast< int32_t >( rFrame.Height ) };
+	const uint8_t* pAtlas  = rRun.pAtlas ? rRun.pAtlas->GetPixels() : nullptr;
+	const uint32_t ColorRB = Color & 0x00FF00FF;
+	const uint32_t ColorG  = Color & 0x0000FF00;
+	xyRect         Drawn   = { INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+
+	for( const xyGlyphRun::Glyph& rGlyph : rRun.Glyphs )
+	{
+		const xyRect GlyphRect = { X + rGlyph.X, Baseline + rGlyph.Y, X + rGlyph.X + rGlyph.Width, Baseline + rGlyph.Y + rGlyph.Height };
+		const xyRect Rect      = xyDamageRegion::Intersect( GlyphRect, Bounds );
+		if( Rect.Left >= Rect.Right || Rect.Top >= Rect.Bottom )
+			continue;
+
+		for( int32_t Y = Rect.Top; Y < Rect.Bottom; ++Y )
+		{
+			const uint8_t* pCoverage    = pAtlas + size_t( rGlyph.AtlasY + Y - GlyphRect.Top ) * xyGlyphAtlas::Width + rGlyph.AtlasX + ( Rect.Left - GlyphRect.Left );
+			uint32_t*      pDestination = rFrame.pPixels + size_t( Y ) * rFrame.Stride + Rect.Left;
+
+			for( int32_t i = 0; i < Rect.Right - Rect.Left; ++i )
+			{
+				// Coverage is scaled from 0-255 to 0-256 so that full coverage is an exact copy. Red and blue are then blended together,
+				// with enough room between them that neither spills into the other, and green on its own.
+				const uint32_t Alpha = pCoverage[ i ] + ( pCoverage[ i ] >> 7 );
+				if( !Alpha )
+					continue;
+
+				const uint32_t Old = pDestination[ i ];
+				const uint32_t RB  = ( ( ColorRB * Alpha + ( Old & 0x00FF00FF ) * ( 256 - Alpha ) ) >> 8 ) & 0x00FF00FF;
+				const uint32_t G   = ( ( ColorG  * Alpha + ( Old & 0x0000FF00 ) * ( 256 - Alpha ) ) >> 8 ) & 0x0000FF00;
+
+				pDestination[ i ] = RB | G;
+			}
+		}
+
+		Drawn.Left   = std::min( Drawn.Left,   Rect.Left );
+		Drawn.Top    = std::min( Drawn.Top,    Rect.Top );
+		Drawn.Right  = std::max( Drawn.Right,  Rect.Right );
+		Drawn.Bottom = std::max( Drawn.Bottom, Rect.Bottom );
+	}
+
+	if( Drawn.Left > Drawn.Right )
+		return { };
+
+	return Drawn;
+
+} // Composite
+
+//////////////////////////////////////////////////////////////////////////
+
+xyTextEngine* xyPlatformImpl::GetTextEngine( void )
+{
+	std::call_once( TextEngineFlag, [ this ]
+	{
+		auto pEngine = std::make_unique< xyTextEngine >();
+		if( pEngine->Load() )
+			pTextEngine = std::move( pEngine );
+	} );
+
+	return pTextEngine.get();
+
+} // GetTextEngine
+
+#endif // XY_HAS_FREETYPE
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyGetFontMetrics( [[ maybe_unused ]] uint32_t PixelSize, int32_t& rAscent, int32_t& rDescent )
+{
+	rAscent  = 0;
+	rDescent = 0;
+
+#if defined( XY_HAS_FREETYPE )
+
+	if( xyTextEngine* pEngine = xyGetContext().pPlatformImpl->GetTextEngine() )
+	{
+		std::scoped_lock Lock( pEngine->Mutex );
+		return pEngine->GetMetrics( PixelSize, rAscent, rDescent );
+	}
+
+#endif // XY_HAS_FREETYPE
+
+	return false;
+
+} // xyGetFontMetrics
+
+//////////////////////////////////////////////////////////////////////////
+
+int32_t xyMeasureText( [[ maybe_unused ]] std::string_view Text, [[ maybe_unused ]] uint32_t PixelSize )
+{
+#if defined( XY_HAS_FREETYPE )
+
+	if( xyTextEngine* pEngine = xyGetContext().pPlatformImpl->GetTextEngine() )
+	{
+		thread_local xyGlyphRun Run;
+
+		std::scoped_lock Lock( pEngine->Mutex );
+		pEngine->Shape( Text, PixelSize, Run );
+
+		return Run.Width;
+	}
+
+#endif // XY_HAS_FREETYPE
+
+	return 0;
+
+} // xyMeasureText
+
+//////////////////////////////////////////////////////////////////////////
+
+xyRect xyDrawText( [[ maybe_unused ]] const xyWindow::Framebuffer& rFrame, [[ maybe_unused ]] std::string_view Text, [[ maybe_unused ]] int32_t X, [[ maybe_unused ]] int32_t Baseline, [[ maybe_unused ]] uint32_t PixelSize, [[ maybe_unused ]] uint32_t Color, [[ maybe_unused ]] xyGlyphRun& rRun )
+{
+#if defined( XY_HAS_FREETYPE )
+
+	if( xyTextEngine* pEngine = xyGetContext().pPlatformImpl->GetTextEngine() )
+	{
+		// The lock is held while compositing too, since the atlas that the run points into may otherwise be changed under us
+		std::scoped_lock Lock( pEngine->Mutex );
+		pEngine->Shape( Text, PixelSize, rRun );
+
+		return pEngine->Composite( rRun, rFrame, X, Baseline, Color );
+	}
+
+#endif // XY_HAS_FREETYPE
+
+	return { };
+
+} // xyDrawText
+
+//////////////////////////////////////////////////////////////////////////
+
+xyRect xyDrawText( const xyWindow::Framebuffer& rFrame, std::string_view Text, int32_t X, int32_t Baseline, uint32_t PixelSize, uint32_t Color )
+{
+	thread_local xyGlyphRun Run;
+
+	return xyDrawText( rFrame, Text, X, Baseline, PixelSize, Color, Run );
+
+} // xyDrawText
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyXCBLibrary::Load( void )
+{
+	// The libraries are never closed, since the connection may be used until the very end of the process.
+	// Their versioned names are used because the unversioned ones only come with the development packages.
+	auto Open = []( const char* pFileName ) { return dlopen( pFileName, RTLD_NOW | RTLD_LOCAL ); };
+
+	bool  Resolved = true;
+	void* pHandle  = Open( "libxcb.so.1" );
+	if( !pHandle )
+		return false;
+
+#define XY_XCB_RESOLVE_FUNCTION( Name ) Resolved &= ( ( Name = reinterpret_cast< decltype( Name ) >( dlsym( pHandle, "xcb_" #Name ) ) ) != nullptr );
+
+	XY_XCB_FUNCTIONS( XY_XCB_RESOLVE_FUNCTION )
+
+	if( !Resolved )
+		return false;
+
+#if defined( XY_HAS_XCB_RANDR )
+
+	if( ( pHandle = Open( "libxcb-randr.so.0" ) ) )
+	{
+		XY_XCB_RANDR_FUNCTIONS( XY_XCB_RESOLVE_FUNCTION )
+
+		// The extension is only used if the whole library is there
+		if( Resolved )
+			randr_id = static_cast< xcb_extension_t* >( dlsym( pHandle, "xcb_randr_id" ) );
+
+		Resolved = true;
+
+		XY_XCB_RANDR_MONITOR_FUNCTIONS( XY_XCB_RESOLVE_FUNCTION )
+
+		randr_monitors = Resolved;
+		Resolved       = true;
+	}
+
+#endif // XY_HAS_XCB_RANDR
+#if defined( XY_HAS_XCB_XINPUT )
+
+	if( ( pHandle = Open( "libxcb-xinput.so.0" ) ) )
+	{
+		XY_XCB_XINPUT_FUNCTIONS( XY_XCB_RESOLVE_FUNCTION )
+
+		if( Resolved )
+			input_id = static_cast< xcb_extension_t* >( dlsym( pHandle, "xcb_input_id" ) );
+
+		Resolved = true;
+	}
+
+#endif // XY_HAS_XCB_XINPUT
+#if defined( XY_HAS_XCB_SHM )
+
+	if( ( pHandle = Open( "libxcb-shm.so.0" ) ) )
+	{
+		XY_XCB_SHM_FUNCTIONS( XY_XCB_RESOLVE_FUNCTION )
+
+		if( Resolved )
+			shm_id = static_cast< xcb_extension_t* >( dlsym( pHandle, "xcb_shm_id" ) );
+
+		Resolved = true;
+	}
+
+#endif // XY_HAS_XCB_SHM
+
+#undef XY_XCB_RESOLVE_FUNCTION
+
+	return true;
+
+} // Load
+
+//////////////////////////////////////////////////////////////////////////
+
+xyXCBConnection::~xyXCBConnection( void )
+{
+	if( !pConnection )
+		return;
+
+	if( !xyXCB.connection_has_error( pConnection ) )
+	{
+		xyXCB.free_gc( pConnection, FontGC );
+		xyXCB.free_gc( pConnection, FillGC );
+		xyXCB.free_gc( pConnection, ForegroundGC );
+	}
+
+	xyXCB.disconnect( pConnection );
+
+} // ~xyXCBConnection
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyXCBConnection::Connect( void )
+{
+	XY_TRACE_SCOPE( "xyXCBConnection::Connect" );
+
+	int ScreenNumber = 0;
+
+	pConnection = xyXCB.connect( nullptr, &ScreenNumber );
+
+	if( xyXCB.connection_has_error( pConnection ) )
+	{
+		xyXCB.disconnect( pConnection );
+		pConnection = nullptr;
+		return false;
+	}
+
+	// Find the screen that DISPLAY asked for.
+	xcb_screen_iterator_t ScreenIterator = xyXCB.setup_roots_iterator( xyXCB.get_setup( pConnection ) );
+	for( ; ScreenIterator.rem && ScreenNumber > 0; --ScreenNumber )
+		xyXCB.screen_next( &ScreenIterator );
+
+	pScreen  = ScreenIterator.data;
+	VisualID = pScreen->root_visual;
+
+	// Images are laid out in memory according to their depth, which is described up front along with the screens
+	{
+		const xcb_setup_t*  pSetup   = xyXCB.get_setup( pConnection );
+		const xcb_format_t* pFormats = xyXCB.setup_pixmap_formats( pSetup );
+
+		for( int i = 0; i < xyXCB.setup_pixmap_formats_length( pSetup ); ++i )
+		{
+			if( pFormats[ i ].depth == pScreen->root_depth )
+				BitsPerPixel = pFormats[ i ].bits_per_pixel;
+		}
+	}
+
+	// Send every request that has a reply before waiting for any of them.
+	xcb_intern_atom_cookie_t ProtocolsCookie   = xyXCB.intern_atom( pConnection, 1, 12, "WM_PROTOCOLS" );
+	xcb_intern_atom_cookie_t CloseWindowCookie = xyXCB.intern_atom( pConnection, 0, 16, "WM_DELETE_WINDOW" );
+	xcb_intern_atom_cookie_t WorkAreaCookie    = xyXCB.intern_atom( pConnection, 0, 12, "_NET_WORKAREA" );
+	xcb_intern_atom_cookie_t CurrentDeskCookie = xyXCB.intern_atom( pConnection, 0, 20, "_NET_CURRENT_DESKTOP" );
+	xcb_query_font_cookie_t  FontCookie;
+
+	// Sending a request to an extension that the server doesn't have closes the connection, so we have to know which ones are there first.
+	// Extensions whose library couldn't be loaded are treated as missing.
+#if defined( XY_HAS_XCB_RANDR )
+	if( xyXCB.randr_id )
+		xyXCB.prefetch_extension_data( pConnection, xyXCB.randr_id );
+#endif // XY_HAS_XCB_RANDR
+#if defined( XY_HAS_XCB_XINPUT )
+	if( xyXCB.input_id )
+		xyXCB.prefetch_extension_data( pConnection, xyXCB.input_id );
+#endif // XY_HAS_XCB_XINPUT
+#if defined( XY_HAS_XCB_SHM )
+	if( xyXCB.shm_id )
+		xyXCB.prefetch_extension_data( pConnection, xyXCB.shm_id );
+#endif // XY_HAS_XCB_SHM
+
+	// Listen for changes to the screen and to the work area, which both invalidate the display adapters
+	{
+		const uint32_t EventMask = XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE;
+		xyXCB.change_window_attributes( pConnection, pScreen->root, XCB_CW_EVENT_MASK, &EventMask );
+	}
+
+	// The graphic contexts are created on the root window, which makes them usable with any drawable of the root depth.
+	ForegroundGC = xyXCB.generate_id( pConnection );
+	FillGC       = xyXCB.generate_id( pConnection );
+	FontGC       = xyXCB.generate_id( pConnection );
+
+	// Create foreground gc.
+	{
+		uint32_t Values[] = { 0x2c2c2c, 0 };
+		xyXCB.create_gc( pConnection, ForegroundGC, pScreen->root, XCB_GC_FOREGROUND | XCB_GC_GRAPHICS_EXPOSURES, Values );
+	}
+
+	// Create fill gc.
+	{
+		uint32_t Values[] = { 0x343434, 0x343434 };
+		xyXCB.create_gc( pConnection, FillGC, pScreen->root, XCB_GC_FOREGROUND | XCB_GC_BACKGROUND, Values );
+	}
+
+	// Create font gc. Here we want the text to be rendered on the same color as the fill gc, with white as the text color.
+	{
+		const char* pFontName = "fixed";
+		xcb_font_t  Font      = xyXCB.generate_id( pConnection );
+
+		xyXCB.open_font( pConnection, Font, strlen( pFontName ), pFontName );
+
+		uint32_t Values[] = { pScreen->white_pixel, 0x343434, Font };
+		xyXCB.create_gc( pConnection, FontGC, pScreen->root, XCB_GC_FOREGROUND | XCB_GC_BACKGROUND | XCB_GC_FONT, Values );
+
+		FontCookie = xyXCB.query_font( pConnection, Font );
+
+		xyXCB.close_font( pConnection, Font );
+	}
+
+	// All replies come back from the same trip
+	++RoundTrips;
+	XY_TRACE_COUNTER( "XCB round trips", RoundTrips.load( std::memory_order_relaxed ) );
+
+	if( xcb_query_font_reply_t* pReply = xyXCB.query_font_reply( pConnection, FontCookie, nullptr ) )
+	{
+		FontAscent  = pReply->font_ascent;
+		FontDescent = pReply->font_descent;
+		CharWidth   = pReply->max_bounds.character_width;
+		free( pReply );
+	}
+
+	if( xcb_intern_atom_reply_t* pReply = xyXCB.intern_atom_reply( pConnection, ProtocolsCookie, nullptr ) )
+	{
+		WMProtocols = pReply->atom;
+		free( pReply );
+	}
+
+	if( xcb_intern_atom_reply_t* pReply = xyXCB.intern_atom_reply( pConnection, CloseWindowCookie, nullptr ) )
+	{
+		WMDeleteWindow = pReply->atom;
+		free( pReply );
+	}
+
+	if( xcb_intern_atom_reply_t* pReply = xyXCB.intern_atom_reply( pConnection, WorkAreaCookie, nullptr ) )
+	{
+		NetWorkArea = pReply->atom;
+		free( pReply );
+	}
+
+	if( xcb_intern_atom_reply_t* pReply = xyXCB.intern_atom_reply( pConnection, CurrentDeskCookie, nullptr ) )
+	{
+		NetCurrentDesk = pReply->atom;
+		free( pReply );
+	}
+
+	// The extensions want to know which version we speak before we use anything newer than their first one.
+	// This costs a second trip, but only if one of them is there.
+	[[ maybe_unused ]] bool QueriedVersions = false;
+
+#if defined( XY_HAS_XCB_RANDR )
+
+	const xcb_query_extension_reply_t* pRandRExtension    = xyXCB.randr_id ? xyXCB.get_extension_data( pConnection, xyXCB.randr_id ) : nullptr;
+	xcb_randr_query_version_cookie_t   RandRVersionCookie = { };
+
+	if( pRandRExtension && pRandRExtension->present )
+	{
+		RandRVersionCookie = xyXCB.randr_query_version( pConnection, 1, 5 );
+		QueriedVersions    = true;
+	}
+
+#endif // XY_HAS_XCB_RANDR
+#if defined( XY_HAS_XCB_XINPUT )
+
+	const xcb_query_extension_reply_t*  pXInputExtension    = xyXCB.input_id ? xyXCB.get_extension_data( pConnection, xyXCB.input_id ) : nullptr;
+	xcb_input_xi_query_version_cookie_t XInputVersionCookie = { };
+
+	if( pXInputExtension && pXInputExtension->present )
+	{
+		XInputVersionCookie = xyXCB.input_xi_query_version( pConnection, 2, 0 );
+		QueriedVersions     = true;
+	}
+
+#endif // XY_HAS_XCB_XINPUT
+#if defined( XY_HAS_XCB_SHM )
+
+	const xcb_query_extension_reply_t* pShmExtension    = xyXCB.shm_id ? xyXCB.get_extension_data( pConnection, xyXCB.shm_id ) : nullptr;
+	xcb_shm_query_version_cookie_t     ShmVersionCookie = { };
+
+	if( pShmExtension && pShmExtension->present )
+	{
+		ShmVersionCookie = xyXCB.shm_query_version( pConnection );
+		QueriedVersions  = true;
+	}
+
+#endif // XY_HAS_XCB_SHM
+
+	if( QueriedVersions )
+	{
+		++RoundTrips;
+		XY_TRACE_COUNTER( "XCB round trips", RoundTrips.load( std::memory_order_relaxed ) );
+	}
+
+#if defined( XY_HAS_XCB_RANDR )
+
+	if( RandRVersionCookie.sequence )
+	{
+		if( xcb_randr_query_version_reply_t* pReply = xyXCB.randr_query_version_reply( pConnection, RandRVersionCookie, nullptr ) )
+		{
+			// GetScreenResourcesCurrent is what we are after, and it needs 1.3. GetMonitors needs 1.5.
+			if( pReply->major_version > 1 || pReply->minor_version >= 3 )
+			{
+				RandREventBase = pRandRExtension->first_event;
+				RandRMonitors  = xyXCB.randr_monitors && ( pReply->major_version > 1 || pReply->minor_version >= 5 );
+				xyXCB.randr_select_input( pConnection, pScreen->root, XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE );
+			}
+
+			free( pReply );
+		}
+	}
 
-	// #TODO:
-	~xyMessageBoxData();
+#endif // XY_HAS_XCB_RANDR
+#if defined( XY_HAS_XCB_XINPUT )
 
-	// Main Event loop
-	bool WaitClose();
+	if( XInputVersionCookie.sequence )
+	{
+		if( xcb_input_xi_query_version_reply_t* pReply = xyXCB.input_xi_query_version_reply( pConnection, XInputVersionCookie, nullptr ) )
+		{
+			// Raw events are new in 2.0
+			if( pReply->major_version >= 2 )
+				XInputOpcode = pXInputExtension->major_opcode;
 
-	void CreateFontGC();
-public:
+			free( pReply );
+		}
+	}
+
+#endif // XY_HAS_XCB_XINPUT
+#if defined( XY_HAS_XCB_SHM )
+
+	if( ShmVersionCookie.sequence )
+	{
+		if( xcb_shm_query_version_reply_t* pReply = xyXCB.shm_query_version_reply( pConnection, ShmVersionCookie, nullptr ) )
+		{
+			// Memory is shared through a file descriptor, which is new in 1.2. The older System V segments outlive a crashed process.
+			if( pReply->major_version > 1 || pReply->minor_version >= 2 )
+				ShmEventBase = pShmExtension->first_event;
+
+			free( pReply );
+		}
+	}
 
-	const char* m_pTitle = "";
-	const char* m_pMessageContent = "";
+#endif // XY_HAS_XCB_SHM
 
-	float m_Width = 463;
-	float m_Height = 310;
+	xyXCB.flush( pConnection );
 
-	xyMessageButtons m_MessageButtons = xyMessageButtons::Ok;
+	return true;
 
-	// XCB Data
+} // Connect
 
-	xcb_window_t m_Window = NULL;
-	xcb_screen_t* m_pScreen = nullptr;
-	xcb_connection_t* m_pConnection = nullptr;
-	xcb_drawable_t m_PixelMap;
+//////////////////////////////////////////////////////////////////////////
 
-	xcb_gcontext_t m_ForegroundGC;
-	xcb_gcontext_t m_FillGC;
-	xcb_gcontext_t m_FontGC;
+bool xyWaylandLibrary::Load( void )
+{
+	// Never closed, for the same reason as libxcb
+	void* pHandle = dlopen( "libwayland-client.so.0", RTLD_NOW | RTLD_LOCAL );
+	if( !pHandle )
+		return false;
 
-	xcb_intern_atom_reply_t* m_pDeleteWindReply = nullptr;
+	bool Resolved = true;
 
-	int m_VisualID = 0;
+#define XY_WAYLAND_RESOLVE_FUNCTION( Name, Return, Parameters ) Resolved &= ( ( Name = reinterpret_cast< decltype( Name ) >( dlsym( pHandle, "wl_" #Name ) ) ) != nullptr );
+#define XY_WAYLAND_RESOLVE_INTERFACE( Name ) Resolved &= ( ( Name##_interface = static_cast< const wl_interface* >( dlsym( pHandle, "wl_" #Name "_interface" ) ) ) != nullptr );
 
-	// X11 Data
+	XY_WAYLAND_FUNCTIONS( XY_WAYLAND_RESOLVE_FUNCTION )
+	XY_WAYLAND_INTERFACES( XY_WAYLAND_RESOLVE_INTERFACE )
 
-	Display* m_pDisplay = nullptr;
+#undef XY_WAYLAND_RESOLVE_INTERFACE
+#undef XY_WAYLAND_RESOLVE_FUNCTION
 
-private:
+	return Resolved;
 
-	void DrawMessageBox();
+} // Load
 
-	void TestCookie( xcb_void_cookie_t Cookie );
+//////////////////////////////////////////////////////////////////////////
 
+// The interfaces of the arguments of every message, one after the other. Interfaces that libwayland-client describes aren't known
+// until it has been loaded, and are left out. They are only used to check the objects in events, and none of these events have any.
+static const wl_interface* xyXdgTypes[] =
+{
+	nullptr, nullptr, nullptr, nullptr,
+	&xyXdgSurfaceInterface,   nullptr, // xdg_wm_base.get_xdg_surface
+	&xyXdgToplevelInterface,           // xdg_surface.get_toplevel
+	&xyXdgToplevelInterface,           // xdg_toplevel.set_parent
 };
 
-struct xyPlatformImpl
+static const wl_message xyXdgWmBaseRequests[] =
+{
+	{ "destroy",           "",   xyXdgTypes },
+	{ "create_positioner", "n",  xyXdgTypes },
+	{ "get_xdg_surface",   "no", xyXdgTypes + 4 },
+	{ "pong",              "u",  xyXdgTypes },
+};
+
+static const wl_message xyXdgWmBaseEvents[] =
+{
+	{ "ping", "u", xyXdgTypes },
+};
+
+static const wl_message xyXdgSurfaceRequests[] =
 {
-	void xyCreateXCBMsgBox( std::string_view Title, std::string_view Message, xyMessageButtons = xyMessageButtons::Ok );
+	{ "destroy",             "",     xyXdgTypes },
+	{ "get_toplevel",        "n",    xyXdgTypes + 6 },
+	{ "get_popup",           "n?oo", xyXdgTypes },
+	{ "set_window_geometry", "iiii", xyXdgTypes },
+	{ "ack_configure",       "u",    xyXdgTypes },
+};
 
-	std::vector< xyMessageBoxData > m_MessageBoxes;
+static const wl_message xyXdgSurfaceEvents[] =
+{
+	{ "configure", "u", xyXdgTypes },
+};
 
-}; // xyPlatformImpl
+static const wl_message xyXdgToplevelRequests[] =
+{
+	{ "destroy",          "",     xyXdgTypes },
+	{ "set_parent",       "?o",   xyXdgTypes + 7 },
+	{ "set_title",        "s",    xyXdgTypes },
+	{ "set_app_id",       "s",    xyXdgTypes },
+	{ "show_window_menu", "ouii", xyXdgTypes },
+	{ "move",             "ou",   xyXdgTypes },
+	{ "resize",           "ouu",  xyXdgTypes },
+	{ "set_max_size",     "ii",   xyXdgTypes },
+	{ "set_min_size",     "ii",   xyXdgTypes },
+	{ "set_maximized",    "",     xyXdgTypes },
+	{ "unset_maximized",  "",     xyXdgTypes },
+	{ "set_fullscreen",   "?o",   xyXdgTypes },
+	{ "unset_fullscreen", "",     xyXdgTypes },
+	{ "set_minimized",    "",     xyXdgTypes },
+};
+
+static const wl_message xyXdgToplevelEvents[] =
+{
+	{ "configure", "iia", xyXdgTypes },
+	{ "close",     "",    xyXdgTypes },
+};
+
+const wl_interface xyXdgWmBaseInterface   = { "xdg_wm_base",  1, static_cast< int >( std::size( xyXdgWmBaseRequests ) ),   xyXdgWmBaseRequests,   static_cast< int >( std::size( xyXdgWmBaseEvents ) ),   xyXdgWmBaseEvents };
+const wl_interface xyXdgSurfaceInterface  = { "xdg_surface",  1, static_cast< int >( std::size( xyXdgSurfaceRequests ) ),  xyXdgSurfaceRequests,  static_cast< int >( std::size( xyXdgSurfaceEvents ) ),  xyXdgSurfaceEvents };
+const wl_interface xyXdgToplevelInterface = { "xdg_toplevel", 1, static_cast< int >( std::size( xyXdgToplevelRequests ) ), xyXdgToplevelRequests, static_cast< int >( std::size( xyXdgToplevelEvents ) ), xyXdgToplevelEvents };
 
 //////////////////////////////////////////////////////////////////////////
-/*
 
-██╗███╗   ███╗██████╗ ██╗     ███████╗███╗   ███╗███████╗███╗   ██╗████████╗ █████╗ ████████╗██╗ ██████╗ ███╗   ██╗
-██║████╗ ████║██╔══██╗██║     ██╔════╝████╗ ████║██╔════╝████╗  ██║╚══██╔══╝██╔══██╗╚══██╔══╝██║██╔═══██╗████╗  ██║
-██║██╔████╔██║██████╔╝██║     █████╗  ██╔████╔██║█████╗  ██╔██╗ ██║   ██║   ███████║   ██║   ██║██║   ██║██╔██╗ ██║
-██║██║╚██╔╝██║██╔═══╝ ██║     ██╔══╝  ██║╚██╔╝██║██╔══╝  ██║╚██╗██║   ██║   ██╔══██║   ██║   ██║██║   ██║██║╚██╗██║
-██║██║ ╚═╝ ██║██║     ███████╗███████╗██║ ╚═╝ ██║███████╗██║ ╚████║   ██║   ██║  ██║   ██║   ██║╚██████╔╝██║ ╚████║
-╚═╝╚═╝     ╚═╝╚═╝     ╚══════╝╚══════╝╚═╝     ╚═╝╚══════╝╚═╝  ╚═══╝   ╚═╝   ╚═╝  ╚═╝   ╚═╝   ╚═╝ ╚═════╝ ╚═╝  ╚═══╝
-*/
-#if defined( XY_IMPLEMENT )
+xyWaylandConnection::~xyWaylandConnection( void )
+{
+	if( !pDisplay )
+		return;
+
+	if( pPointer )    xyWL.proxy_destroy( pPointer );
+	if( pSeat )       xyWL.proxy_destroy( pSeat );
+	if( pWmBase )     Send( pWmBase, 0 /* xdg_wm_base.destroy */, nullptr, true );
+	if( pShm )        xyWL.proxy_destroy( pShm );
+	if( pCompositor ) xyWL.proxy_destroy( pCompositor );
+	if( pRegistry )   xyWL.proxy_destroy( pRegistry );
+
+	xyWL.display_disconnect( pDisplay );
+
+} // ~xyWaylandConnection
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyWaylandConnection::Connect( void )
+{
+	// The display is found through $WAYLAND_DISPLAY
+	if( !( pDisplay = xyWL.display_connect( nullptr ) ) )
+		return false;
+
+	struct PointerListener
+	{
+		void( *Enter  )( void*, wl_proxy*, uint32_t, wl_proxy*, wl_fixed_t, wl_fixed_t );
+		void( *Leave  )( void*, wl_proxy*, uint32_t, wl_proxy* );
+		void( *Motion )( void*, wl_proxy*, uint32_t, wl_fixed_t, wl_fixed_t );
+		void( *Button )( void*, wl_proxy*, uint32_t, uint32_t, uint32_t, uint32_t );
+		void( *Axis   )( void*, wl_proxy*, uint32_t, uint32_t, wl_fixed_t );
+
+	}; // PointerListener
+
+	// Positions are fixed-point with 8 bits of fraction
+	static constexpr PointerListener Pointer =
+	{
+		.Enter=[]( void* pData, wl_proxy*, uint32_t, wl_proxy* pSurface, wl_fixed_t X, wl_fixed_t Y )
+		{
+			xyWaylandConnection* pThis = static_cast< xyWaylandConnection* >( pData );
+			pThis->pPointerFocus = pSurface;
+			pThis->PointerX      = X / 256;
+			pThis->PointerY      = Y / 256;
+		},
+		.Leave=[]( void* pData, wl_proxy*, uint32_t, wl_proxy* )
+		{
+			static_cast< xyWaylandConnection* >( pData )->pPointerFocus = nullptr;
+		},
+		.Motion=[]( void* pData, wl_proxy*, uint32_t, wl_fixed_t X, wl_fixed_t Y )
+		{
+			xyWaylandConnection* pThis = static_cast< xyWaylandConnection* >( pData );
+			pThis->PointerX = X / 256;
+			pThis->PointerY = Y / 256;
+		},
+		.Button=[]( void* pData, wl_proxy*, uint32_t, uint32_t, uint32_t Button, uint32_t State )
+		{
+			// Buttons are evdev codes, and BTN_LEFT is the only one that anything listens to
+			xyWaylandConnection* pThis = static_cast< xyWaylandConnection* >( pData );
+			if( Button == 0x110 && pThis->pPointerFocus )
+				xyGetContext().pPlatformImpl->OnWaylandButton( pThis->pPointerFocus, pThis->PointerX, pThis->PointerY, State == 1 );
+		},
+		.Axis=[]( void*, wl_proxy*, uint32_t, uint32_t, wl_fixed_t ) { },
+	};
+
+	struct SeatListener
+	{
+		void( *Capabilities )( void*, wl_proxy*, uint32_t );
+
+	}; // SeatListener
+
+	static constexpr SeatListener Seat =
+	{
+		.Capabilities=[]( void* pData, wl_proxy* pSeat, uint32_t Capabilities )
+		{
+			xyWaylandConnection* pThis      = static_cast< xyWaylandConnection* >( pData );
+			const bool           HasPointer = ( Capabilities & 1 ) != 0;
+
+			if( HasPointer && !pThis->pPointer )
+			{
+				pThis->pPointer = Send( pSeat, 0 /* wl_seat.get_pointer */, xyWL.pointer_interface, false, nullptr );
+				AddListener( pThis->pPointer, Pointer, pThis );
+			}
+			else if( !HasPointer && pThis->pPointer )
+			{
+				xyWL.proxy_destroy( std::exchange( pThis->pPointer, nullptr ) );
+				pThis->pPointerFocus = nullptr;
+			}
+		},
+	};
+
+	struct WmBaseListener
+	{
+		void( *Ping )( void*, wl_proxy*, uint32_t );
+
+	}; // WmBaseListener
+
+	// Windows of clients that don't answer are shown as frozen
+	static constexpr WmBaseListener WmBase =
+	{
+		.Ping=[]( void*, wl_proxy* pWmBase, uint32_t Serial ) { Send( pWmBase, 3 /* xdg_wm_base.pong */, nullptr, false, Serial ); },
+	};
+
+	struct RegistryListener
+	{
+		void( *Global       )( void*, wl_proxy*, uint32_t, const char*, uint32_t );
+		void( *GlobalRemove )( void*, wl_proxy*, uint32_t );
+
+	}; // RegistryListener
+
+	static constexpr RegistryListener Registry =
+	{
+		.Global=[]( void* pData, wl_proxy* pRegistry, uint32_t Name, const char* pInterface, uint32_t Version )
+		{
+			xyWaylandConnection* pThis = static_cast< xyWaylandConnection* >( pData );
+
+			// Objects are bound at the highest version that both sides know of, since listeners only cover the events of that version
+			auto Bind = [ & ]( const wl_interface* pBound, uint32_t MaxVersion )
+			{
+				const uint32_t BoundVersion = std::min( Version, MaxVersion );
+				return xyWL.proxy_marshal_flags( pRegistry, 0 /* wl_registry.bind */, pBound, BoundVersion, 0, Name, pBound->name, BoundVersion, nullptr );
+			};
+
+			if( !pThis->pCompositor && strcmp( pInterface, xyWL.compositor_interface->name ) == 0 )
+			{
+				pThis->pCompositor = Bind( xyWL.compositor_interface, 4 );
+			}
+			else if( !pThis->pShm && strcmp( pInterface, xyWL.shm_interface->name ) == 0 )
+			{
+				pThis->pShm = Bind( xyWL.shm_interface, 1 );
+			}
+			else if( !pThis->pWmBase && strcmp( pInterface, xyXdgWmBaseInterface.name ) == 0 )
+			{
+				pThis->pWmBase = Bind( &xyXdgWmBaseInterface, 1 );
+				AddListener( pThis->pWmBase, WmBase, pThis );
+			}
+			else if( !pThis->pSeat && strcmp( pInterface, xyWL.seat_interface->name ) == 0 )
+			{
+				pThis->pSeat = Bind( xyWL.seat_interface, 1 );
+				AddListener( pThis->pSeat, Seat, pThis );
+			}
+		},
+		.GlobalRemove=[]( void*, wl_proxy*, uint32_t ) { },
+	};
+
+	pRegistry = Send( reinterpret_cast< wl_proxy* >( pDisplay ), 1 /* wl_display.get_registry */, xyWL.registry_interface, false, nullptr );
+	AddListener( pRegistry, Registry, this );
+
+	// One round trip to be told about the globals, which are bound as they are announced.
+	// Every compositor has the shared memory buffers and xdg-shell that a window needs, but only a desktop one has a seat.
+	if( xyWL.display_roundtrip( pDisplay ) < 0 )
+		return false;
+
+	return pCompositor && pShm && pWmBase;
+
+} // Connect
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyWaylandConnection::Dispatch( void )
+{
+	std::scoped_lock Lock( DispatchMutex );
+
+	// Reading is refused while there are events that were read earlier and are still waiting to be dispatched
+	while( xyWL.display_prepare_read( pDisplay ) != 0 )
+	{
+		if( xyWL.display_dispatch_pending( pDisplay ) < 0 )
+			return false;
+	}
+
+	// The socket is readable, so this doesn't block
+	if( xyWL.display_read_events( pDisplay ) < 0 || xyWL.display_dispatch_pending( pDisplay ) < 0 )
+		return false;
+
+	return xyWL.display_get_error( pDisplay ) == 0;
+
+} // Dispatch
+
+//////////////////////////////////////////////////////////////////////////
 
 xyMessageBoxData::~xyMessageBoxData()
 {
-	xcb_free_gc( m_pConnection, m_FontGC );
-	xcb_free_gc( m_pConnection, m_ForegroundGC );
-	xcb_free_gc( m_pConnection, m_FillGC );
+	// A surface cleans up after itself
+	if( !m_pXCB || xyXCB.connection_has_error( m_pXCB->pConnection ) )
+		return;
 
-	xcb_free_pixmap( m_pConnection, m_PixelMap );
+	xyXCB.free_pixmap( m_pXCB->pConnection, m_PixelMap );
 
-	xcb_destroy_window( m_pConnection, m_Window );
+	xyXCB.destroy_window( m_pXCB->pConnection, m_Window );
+
+	xyXCB.flush( m_pXCB->pConnection );
+}
+
+std::span< const xyMessageBoxData::Button > xyMessageBoxData::GetButtons() const
+{
+	// Listed left to right
+	static constexpr Button Ok[]                     = { { "Ok",     xyMessageResult::Ok } };
+	static constexpr Button OkCancel[]               = { { "Ok",     xyMessageResult::Ok },    { "Cancel",    xyMessageResult::Cancel } };
+	static constexpr Button YesNo[]                  = { { "Yes",    xyMessageResult::Yes },   { "No",        xyMessageResult::No } };
+	static constexpr Button YesNoCancel[]            = { { "Yes",    xyMessageResult::Yes },   { "No",        xyMessageResult::No },       { "Cancel",   xyMessageResult::Cancel } };
+	static constexpr Button AbortRetryIgnore[]       = { { "Abort",  xyMessageResult::Abort }, { "Retry",     xyMessageResult::Retry },    { "Ignore",   xyMessageResult::Ignore } };
+	static constexpr Button CancelTryagainContinue[] = { { "Cancel", xyMessageResult::Cancel }, { "Try Again", xyMessageResult::Tryagain }, { "Continue", xyMessageResult::Continue } };
+	static constexpr Button RetryCancel[]            = { { "Retry",  xyMessageResult::Retry },  { "Cancel",    xyMessageResult::Cancel } };
 
-	xcb_disconnect( m_pConnection );
+	switch( m_MessageButtons )
+	{
+		default:
+		case xyMessageButtons::Ok:                     return Ok;
+		case xyMessageButtons::OkCancel:               return OkCancel;
+		case xyMessageButtons::YesNo:                  return YesNo;
+		case xyMessageButtons::YesNoCancel:            return YesNoCancel;
+		case xyMessageButtons::AbortRetryIgnore:       return AbortRetryIgnore;
+		case xyMessageButtons::CancelTryagainContinue: return CancelTryagainContinue;
+		case xyMessageButtons::RetryCancel:            return RetryCancel;
+	}
+}
 
-	m_pDisplay = nullptr;
-	m_pScreen = nullptr;
+xyMessageResult xyMessageBoxData::GetCloseResult() const
+{
+	// Same as what closing a native box gives on Windows: Cancel if there is one, otherwise the most passive choice
+	switch( m_MessageButtons )
+	{
+		default:
+		case xyMessageButtons::Ok:               return xyMessageResult::Ok;
+		case xyMessageButtons::YesNo:            return xyMessageResult::No;
+		case xyMessageButtons::AbortRetryIgnore: return xyMessageResult::Abort;
+		case xyMessageButtons::OkCancel:
+		case xyMessageButtons::YesNoCancel:
+		case xyMessageButtons::CancelTryagainContinue:
+		case xyMessageButtons::RetryCancel:      return xyMessageResult::Cancel;
+	}
 }
 
-void xyMessageBoxData::TestCookie( xcb_void_cookie_t Cookie )
+// Button layout
+constexpr uint32_t xyMessageBoxFontSize      = 13;
+constexpr uint16_t xyMessageBoxMargin        = 16;
+constexpr uint16_t xyMessageBoxButtonWidth   = 80;
+constexpr uint16_t xyMessageBoxButtonHeight  = 28;
+constexpr uint16_t xyMessageBoxButtonSpacing = 8;
+
+xcb_rectangle_t xyMessageBoxData::GetButtonRectangle( size_t Index ) const
 {
-	xcb_generic_error_t* pError = xcb_request_check( m_pConnection, Cookie );
+	// Buttons are right-aligned along the bottom edge
+	const size_t  Count = GetButtons().size();
+	const int16_t Left  = m_Width - xyMessageBoxMargin - Count * xyMessageBoxButtonWidth - ( Count - 1 ) * xyMessageBoxButtonSpacing;
 
-	// #TODO: Print and maybe not raise.
-	if( pError )
-		raise( SIGTRAP );
+	return { static_cast< int16_t >( Left + Index * ( xyMessageBoxButtonWidth + xyMessageBoxButtonSpacing ) ), static_cast< int16_t >( m_Height - xyMessageBoxMargin - xyMessageBoxButtonHeight ), xyMessageBoxButtonWidth, xyMessageBoxButtonHeight };
 }
 
-void xyMessageBoxData::CreateFontGC()
+int xyMessageBoxData::HitTest( int16_t X, int16_t Y ) const
 {
-	const char* pFontName = "fixed";
-	xcb_void_cookie_t Cookie;
+	for( size_t i = 0; i < GetButtons().size(); ++i )
+	{
+		const xcb_rectangle_t Rectangle = GetButtonRectangle( i );
+
+		if( X >= Rectangle.x && X < Rectangle.x + Rectangle.width && Y >= Rectangle.y && Y < Rectangle.y + Rectangle.height )
+			return static_cast< int >( i );
+	}
+
+	return -1;
+}
 
-	xcb_font_t Font = xcb_generate_id( m_pConnection );
-	Cookie = xcb_open_font_checked( m_pConnection, Font, strlen( pFontName ), pFontName );
+void xyMessageBoxData::DrawText( int16_t X, int16_t Y, std::string_view Text )
+{
+	// PolyText8 only draws the glyphs, so the text blends with whatever is underneath.
+	// It takes a list of items that are each a length, a horizontal delta and up to 254 characters.
+	uint8_t Items[ 512 ];
+	size_t  Size = 0;
 
-	TestCookie( Cookie );
+	while( !Text.empty() && Size + 2 + 254 <= sizeof( Items ) )
+	{
+		const size_t Length = std::min< size_t >( Text.size(), 254 );
 
-	uint32_t Mask = XCB_GC_FOREGROUND | XCB_GC_BACKGROUND | XCB_GC_FONT;
-	// Here we want the text to be rendered on the same color as the fill gc, with white as the text color.
-	uint32_t Values[] ={ m_pScreen->white_pixel, 0x343434, Font };
+		Items[ Size++ ] = static_cast< uint8_t >( Length );
+		Items[ Size++ ] = 0;
+		std::memcpy( &Items[ Size ], Text.data(), Length );
 
-	Cookie = xcb_create_gc_checked( m_pConnection, m_FontGC, m_PixelMap, Mask, Values );
+		Size += Length;
+		Text.remove_prefix( Length );
+	}
 
-	TestCookie( Cookie );
+	xyXCB.poly_text_8( m_pXCB->pConnection, m_PixelMap, m_pXCB->FontGC, X, Y, Size, Items );
+}
 
-	Cookie = xcb_close_font_checked( m_pConnection, Font );
+int32_t xyMessageBoxData::MeasureText( std::string_view Text ) const
+{
+	if( m_ClientText )
+		return xyMeasureText( Text, xyMessageBoxFontSize );
 
-	TestCookie( Cookie );
+	return static_cast< int32_t >( Text.size() ) * m_pXCB->CharWidth;
 }
 
-void xyMessageBoxData::DrawMessageBox()
+void xyMessageBoxData::DrawMessageBox( const xyRect& rArea )
 {
-	xcb_void_cookie_t Cookie;
+	// Nothing in here waits for the server. Errors show up in the event queue and the caller flushes once at the end.
+	// Only what overlaps the area is drawn. Text and buttons are drawn whole, which is harmless since it is the same as what is there.
+	// Our own pixels are drawn through a view of the area, which clips the text to it
+	const xyWindow::Framebuffer View = { .pPixels=m_ClientText ? &m_Pixels[ size_t( rArea.Top ) * m_Width + rArea.Left ] : nullptr, .Width=static_cast< uint32_t >( rArea.Right - rArea.Left ), .Height=static_cast< uint32_t >( rArea.Bottom - rArea.Top ), .Stride=m_Width, .Stale={ } };
 
-	switch( m_MessageButtons )
+	auto Overlaps = [ & ]( int32_t Left, int32_t Top, int32_t Right, int32_t Bottom )
+	{
+		return Left < rArea.Right && Right > rArea.Left && Top < rArea.Bottom && Bottom > rArea.Top;
+	};
+
+	// The colors are the same as those of the graphic contexts, which only exist under X
+	auto Fill = [ & ]( const xcb_rectangle_t& rRectangle, xcb_gcontext_t xyXCBConnection::* pGC, uint32_t Color )
 	{
-		case xyMessageButtons::Ok:
+		if( !m_ClientText )
 		{
-			xcb_rectangle_t Rectangles[] ={ { m_Width / 2, m_Height / 2 - 50, 73, 30 } };
-			Cookie                       = xcb_poly_fill_rectangle_checked( m_pConnection, m_PixelMap, m_ForegroundGC, 1, Rectangles );
+			xyXCB.poly_fill_rectangle( m_pXCB->pConnection, m_PixelMap, m_pXCB->*pGC, 1, &rRectangle );
+			return;
+		}
 
-			TestCookie( Cookie );
+		const xyRect Rect = xyDamageRegion::Intersect( { .Left=rRectangle.x, .Top=rRectangle.y, .Right=rRectangle.x + rRectangle.width, .Bottom=rRectangle.y + rRectangle.height }, rArea );
 
-			Cookie = xcb_image_text_8_checked( m_pConnection, strlen( "Ok" ), m_PixelMap, m_FontGC, m_Width / 2, m_Height / 2 - 50, "Ok" );
+		for( int32_t Y = Rect.Top; Y < Rect.Bottom; ++Y )
+			std::fill_n( &m_Pixels[ size_t( Y ) * m_Width + Rect.Left ], std::max( Rect.Right - Rect.Left, 0 ), Color );
+	};
 
-			TestCookie( Cookie );
-		} break;
+	auto Text = [ & ]( int32_t X, int32_t Baseline, std::string_view String )
+	{
+		if( m_ClientText ) xyDrawText( View, String, X - rArea.Left, Baseline - rArea.Top, xyMessageBoxFontSize, 0xFFFFFF );
+		else               DrawText( static_cast< int16_t >( X ), static_cast< int16_t >( Baseline ), String );
+	};
 
-		case xyMessageButtons::OkCancel:
-		{
-			// Ive got no idea what the hell this is.
-			xcb_rectangle_t Rectangles[] ={ { m_Width / 2 - 50, m_Height / 2, 73, 30 }, { m_Width / 2 - 40, m_Height / 2 - 50, 73, 30 } };
-			Cookie                       = xcb_poly_fill_rectangle_checked( m_pConnection, m_PixelMap, m_ForegroundGC, 2, Rectangles );
+	// Fill rect with black. #TODO: Fill color corresponding to theme. Or even see if the theme color is a warm/cool color and set fill accordingly.
+	Fill( { static_cast< int16_t >( rArea.Left ), static_cast< int16_t >( rArea.Top ), static_cast< uint16_t >( rArea.Right - rArea.Left ), static_cast< uint16_t >( rArea.Bottom - rArea.Top ) }, &xyXCBConnection::FillGC, 0x343434 );
 
-			TestCookie( Cookie );
-		} break;
+	// Draw message content, one line at a time.
+	const int16_t    LineHeight = m_FontAscent + m_FontDescent;
+	int16_t          Baseline   = xyMessageBoxMargin + m_FontAscent;
+	std::string_view Remaining  = m_MessageContent;
 
-		default:
-			break;
+	while( !Remaining.empty() && Baseline - m_FontAscent < rArea.Bottom )
+	{
+		const size_t           LineEnd = std::min( Remaining.find( '\n' ), Remaining.size() );
+		const std::string_view Line    = Remaining.substr( 0, LineEnd );
+
+		if( Overlaps( xyMessageBoxMargin, Baseline - m_FontAscent, xyMessageBoxMargin + MeasureText( Line ), Baseline + m_FontDescent ) )
+			Text( xyMessageBoxMargin, Baseline, Line );
+
+		Baseline += LineHeight;
+		Remaining.remove_prefix( std::min( LineEnd + 1, Remaining.size() ) );
 	}
 
-	// Draw message content.
-	Cookie = xcb_image_text_8_checked( m_pConnection, strlen( m_pMessageContent ), m_PixelMap, m_FontGC, m_Width / 2, m_Height / 2, m_pMessageContent );
+	// Draw the buttons with their labels centered.
+	std::span< const Button > Buttons = GetButtons();
+
+	for( size_t i = 0; i < Buttons.size(); ++i )
+	{
+		const xcb_rectangle_t Rectangle = GetButtonRectangle( i );
+
+		if( !Overlaps( Rectangle.x, Rectangle.y, Rectangle.x + Rectangle.width, Rectangle.y + Rectangle.height ) )
+			continue;
 
-	TestCookie( Cookie );
+		Fill( Rectangle, &xyXCBConnection::ForegroundGC, 0x2c2c2c );
+
+		// Outline the button that is held down, one edge at a time
+		if( static_cast< int >( i ) == m_PressedButton )
+		{
+			Fill( { Rectangle.x, Rectangle.y, Rectangle.width, 1 }, &xyXCBConnection::FontGC, 0xFFFFFF );
+			Fill( { Rectangle.x, static_cast< int16_t >( Rectangle.y + Rectangle.height - 1 ), Rectangle.width, 1 }, &xyXCBConnection::FontGC, 0xFFFFFF );
+			Fill( { Rectangle.x, Rectangle.y, 1, Rectangle.height }, &xyXCBConnection::FontGC, 0xFFFFFF );
+			Fill( { static_cast< int16_t >( Rectangle.x + Rectangle.width - 1 ), Rectangle.y, 1, Rectangle.height }, &xyXCBConnection::FontGC, 0xFFFFFF );
+		}
+
+		Text( Rectangle.x + ( Rectangle.width - MeasureText( Buttons[ i ].Label ) ) / 2, Rectangle.y + ( Rectangle.height + m_FontAscent - m_FontDescent ) / 2, Buttons[ i ].Label );
+	}
+
+	// Our own pixels go to the pixmap in one upload. A surface takes them from Repaint instead.
+	if( m_ClientText && m_pXCB )
+		xyPutImage( m_pXCB->pConnection, m_PixelMap, m_pXCB->ForegroundGC, m_pXCB->pScreen->root_depth, m_Pixels.data(), m_Width, std::span( &rArea, 1 ) );
 }
 
-bool xyMessageBoxData::WaitClose()
+void xyMessageBoxData::InvalidateButton( int Index )
 {
-	xcb_generic_event_t* pEvent;
+	if( Index < 0 )
+		return;
+
+	const xcb_rectangle_t Rectangle = GetButtonRectangle( Index );
 
-	while( pEvent = xcb_wait_for_event( m_pConnection ) )
+	m_Damage.Add( { .Left=Rectangle.x, .Top=Rectangle.y, .Right=Rectangle.x + Rectangle.width, .Bottom=Rectangle.y + Rectangle.height } );
+}
+
+void xyMessageBoxData::Repaint()
+{
+	if( m_pSurface )
 	{
-		switch( pEvent->response_type & ~0x80 )
-		{
-			case XCB_CLIENT_MESSAGE:
-			{
-				if( ( *( xcb_client_message_event_t* )pEvent ).data.data32[ 0 ] == ( *m_pDeleteWindReply ).atom )
-				{
-					return true;
-				}
-			}
-			case XCB_EXPOSE:
-			{
-				xcb_clear_area( m_pConnection, 1, m_Window, 0, 0, m_Width, m_Height );
+		// The damage waits for the compositor to ask for the next frame, and piles up in the meantime
+		if( m_Damage.IsEmpty() || !m_pSurface->IsFrameReady() )
+			return;
 
-				DrawMessageBox();
+		xyWindow::Framebuffer Frame = m_pSurface->BeginFrame();
+		if( !Frame.pPixels )
+			return;
 
-				xcb_flush( m_pConnection );
-				return false;
-			}
+		// The frame is missing what was drawn into the other buffer too
+		xyDamageRegion Region = m_Damage;
+
+		for( const xyRect& rRect : Frame.Stale )
+			Region.Add( rRect );
+
+		for( const xyRect& rRect : m_Damage.GetRects() )
+			DrawMessageBox( rRect );
+
+		for( const xyRect& rRect : Region.GetRects() )
+		{
+			for( int32_t Y = rRect.Top; Y < rRect.Bottom; ++Y )
+				std::copy_n( &m_Pixels[ size_t( Y ) * m_Width + rRect.Left ], rRect.Right - rRect.Left, &Frame.pPixels[ size_t( Y ) * Frame.Stride + rRect.Left ] );
 		}
 
-		return false;
+		m_pSurface->Present( Region.GetRects() );
+		m_Damage.Clear();
+
+		return;
+	}
+
+	for( const xyRect& rRect : m_Damage.GetRects() )
+	{
+		DrawMessageBox( rRect );
+
+		// Copy the pixmap to the window. Asking for exposures here would send us right back in here.
+		xyXCB.clear_area( m_pXCB->pConnection, 0, m_Window, rRect.Left, rRect.Top, rRect.Right - rRect.Left, rRect.Bottom - rRect.Top );
+	}
+
+	m_Damage.Clear();
+}
+
+std::optional< xyMessageResult > xyMessageBoxData::HandleEvent( xcb_generic_event_t* pEvent )
+{
+	switch( pEvent->response_type & ~0x80 )
+	{
+		case XCB_CLIENT_MESSAGE:
+		{
+			if( ( *( xcb_client_message_event_t* )pEvent ).data.data32[ 0 ] == m_pXCB->WMDeleteWindow )
+				return GetCloseResult();
+		} break;
+
+		case XCB_BUTTON_PRESS:
+		case XCB_BUTTON_RELEASE:
+		{
+			// Presses and releases have the same layout
+			xcb_button_press_event_t* pButton = reinterpret_cast< xcb_button_press_event_t* >( pEvent );
+
+			if( pButton->detail == XCB_BUTTON_INDEX_1 )
+				return HandleButton( ( pEvent->response_type & ~0x80 ) == XCB_BUTTON_PRESS, pButton->event_x, pButton->event_y );
+		} break;
 	}
+
+	return std::nullopt;
 }
 
-void xyPlatformImpl::xyCreateXCBMsgBox( std::string_view Title, std::string_view Message, xyMessageButtons MessageButtons )
+std::optional< xyMessageResult > xyMessageBoxData::HandleButton( bool Pressed, int16_t X, int16_t Y )
 {
-	xyMessageBoxData MessageBox ={ Title.data(), Message.data(), MessageButtons };
+	if( Pressed )
+	{
+		InvalidateButton( m_PressedButton );
+		m_PressedButton = HitTest( X, Y );
+		InvalidateButton( m_PressedButton );
+
+		return std::nullopt;
+	}
 
-	// Open Xlib display.
-	MessageBox.m_pDisplay = XOpenDisplay( 0 );
+	// Like any other button, it only counts if the pointer is released over the same button it was pressed on
+	const int PressedButton = std::exchange( m_PressedButton, -1 );
 
-	// Get connection from xlib.
-	MessageBox.m_pConnection = XGetXCBConnection( MessageBox.m_pDisplay );
+	if( PressedButton >= 0 && HitTest( X, Y ) == PressedButton )
+		return GetButtons()[ PressedButton ].Result;
 
-	// Find first screen.
-	MessageBox.m_pScreen = xcb_setup_roots_iterator( xcb_get_setup( MessageBox.m_pConnection ) ).data;
+	InvalidateButton( PressedButton );
 
-	uint32_t GCMask = 0;
-	uint32_t GCValues[ 2 ];
+	return std::nullopt;
+}
 
-	// Create black graphic context.
-	MessageBox.m_ForegroundGC = xcb_generate_id( MessageBox.m_pConnection );
-	MessageBox.m_FillGC       = xcb_generate_id( MessageBox.m_pConnection ); // #TODO: We might not need this.
-	MessageBox.m_FontGC       = xcb_generate_id( MessageBox.m_pConnection ); // Will be used when rendering
+void xyMessageBoxData::Layout( size_t MaxWidth, size_t MaxHeight )
+{
+	// Size the box to fit the message and the row of buttons
+	size_t LineCount = 0;
+	size_t TextWidth = 0;
 
-	// Create foreground gc.
-	GCMask = XCB_GC_FOREGROUND | XCB_GC_GRAPHICS_EXPOSURES;
-	GCValues[ 0 ] = 0x2c2c2c;
-	GCValues[ 1 ] = 0;
+	for( std::string_view Remaining = m_MessageContent; !Remaining.empty() || LineCount == 0; ++LineCount )
+	{
+		const size_t LineEnd = std::min( Remaining.find( '\n' ), Remaining.size() );
+
+		TextWidth = std::max< size_t >( TextWidth, MeasureText( Remaining.substr( 0, LineEnd ) ) );
+		Remaining.remove_prefix( std::min( LineEnd + 1, Remaining.size() ) );
+	}
 
-	xcb_create_gc( MessageBox.m_pConnection, MessageBox.m_ForegroundGC, MessageBox.m_pScreen->root, GCMask, GCValues );
+	const size_t ButtonCount = GetButtons().size();
+	const size_t RowWidth    = ButtonCount * xyMessageBoxButtonWidth + ( ButtonCount - 1 ) * xyMessageBoxButtonSpacing;
+	const size_t TextHeight  = LineCount * ( m_FontAscent + m_FontDescent );
 
-	// Create pixel/pixmap map.
+	m_Width  = static_cast< uint16_t >( std::clamp< size_t >( std::max( TextWidth, RowWidth ) + 2 * xyMessageBoxMargin, 300, MaxWidth ) );
+	m_Height = static_cast< uint16_t >( std::clamp< size_t >( TextHeight + xyMessageBoxButtonHeight + 3 * xyMessageBoxMargin, 120, MaxHeight ) );
+}
+
+void xyMessageBoxData::Create( xyXCBConnection& rXCB )
+{
+	xcb_connection_t* pConnection = rXCB.pConnection;
+	xcb_screen_t*     pScreen     = rXCB.pScreen;
 
-	MessageBox.m_PixelMap = xcb_generate_id( MessageBox.m_pConnection );
-	xcb_create_pixmap( MessageBox.m_pConnection, MessageBox.m_pScreen->root_depth, MessageBox.m_PixelMap, MessageBox.m_pScreen->root, 500, 500 );
+	m_pXCB = &rXCB;
 
-	MessageBox.CreateFontGC();
+	// The pixels are sent to the server as they are, so drawing our own text takes a screen with 32 bits per pixel. That is what every
+	// TrueColor screen has these days.
+	int32_t Ascent  = rXCB.FontAscent;
+	int32_t Descent = rXCB.FontDescent;
 
-	// Create fill gc.
-	GCMask = XCB_GC_FOREGROUND | XCB_GC_BACKGROUND;
-	GCValues[ 0 ] = 0x343434;
-	GCValues[ 1 ] = 0x343434;
+	m_ClientText  = rXCB.BitsPerPixel == 32 && pScreen->root_depth == 24 && xyGetFontMetrics( xyMessageBoxFontSize, Ascent, Descent );
+	m_FontAscent  = static_cast< int16_t >( m_ClientText ? Ascent  : rXCB.FontAscent );
+	m_FontDescent = static_cast< int16_t >( m_ClientText ? Descent : rXCB.FontDescent );
 
-	xcb_create_gc( MessageBox.m_pConnection, MessageBox.m_FillGC, MessageBox.m_pScreen->root, GCMask, GCValues );
+	Layout( pScreen->width_in_pixels, pScreen->height_in_pixels );
+
+	// Create pixel/pixmap map.
+
+	m_PixelMap = xyXCB.generate_id( pConnection );
+	xyXCB.create_pixmap( pConnection, pScreen->root_depth, m_PixelMap, pScreen->root, m_Width, m_Height );
+
+	if( m_ClientText )
+		m_Pixels.resize( size_t( m_Width ) * m_Height );
+
+	DrawMessageBox( { .Left=0, .Top=0, .Right=m_Width, .Bottom=m_Height } );
 
 	// Generate window ID
-	MessageBox.m_Window = xcb_generate_id( MessageBox.m_pConnection );
+	m_Window = xyXCB.generate_id( pConnection );
 
 	// xcb events -> https://xcb.freedesktop.org/tutorial/events/
+	// The pixmap is the background of the window, so the server repaints exposed parts from it without asking us.
+	// Exposures are not even listened for, and only our own changes to the pixmap need to be copied over.
 	uint32_t Mask = XCB_CW_BACK_PIXMAP | XCB_CW_EVENT_MASK;
-	uint32_t EventMask = XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_KEY_PRESS;
-	uint32_t ValueList[] ={ MessageBox.m_PixelMap, EventMask };
-
-	xcb_create_window( MessageBox.m_pConnection, XCB_COPY_FROM_PARENT, MessageBox.m_Window, MessageBox.m_pScreen->root, 0, 0, MessageBox.m_Width, MessageBox.m_Height, 8, XCB_WINDOW_CLASS_INPUT_OUTPUT, MessageBox.m_VisualID, Mask, ValueList );
+	uint32_t EventMask = XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE;
+	uint32_t ValueList[] ={ m_PixelMap, EventMask };
 
 	// Move window to center
-	int WindowPos[] ={ MessageBox.m_pScreen->width_in_pixels - MessageBox.m_Width, MessageBox.m_pScreen->height_in_pixels - MessageBox.m_Height };
-	xcb_configure_window( MessageBox.m_pConnection, MessageBox.m_Window, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y, WindowPos );
+	const int16_t X = ( pScreen->width_in_pixels  - m_Width  ) / 2;
+	const int16_t Y = ( pScreen->height_in_pixels - m_Height ) / 2;
+
+	xyXCB.create_window( pConnection, XCB_COPY_FROM_PARENT, m_Window, pScreen->root, X, Y, m_Width, m_Height, 8, XCB_WINDOW_CLASS_INPUT_OUTPUT, rXCB.VisualID, Mask, ValueList );
 
 	// Set title.
-	xcb_change_property( MessageBox.m_pConnection, XCB_PROP_MODE_REPLACE, MessageBox.m_Window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, strlen( MessageBox.m_pTitle ), MessageBox.m_pTitle );
+	xyXCB.change_property( pConnection, XCB_PROP_MODE_REPLACE, m_Window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, m_Title.size(), m_Title.data() );
 	// Icon title.
-	xcb_change_property( MessageBox.m_pConnection, XCB_PROP_MODE_REPLACE, MessageBox.m_Window, XCB_ATOM_WM_ICON_NAME, XCB_ATOM_STRING, 8, strlen( MessageBox.m_pTitle ), MessageBox.m_pTitle );
+	xyXCB.change_property( pConnection, XCB_PROP_MODE_REPLACE, m_Window, XCB_ATOM_WM_ICON_NAME, XCB_ATOM_STRING, 8, m_Title.size(), m_Title.data() );
+
+	// Gain access to WM_PROTOCOLS.
+	xyXCB.change_property( pConnection, XCB_PROP_MODE_REPLACE, m_Window, rXCB.WMProtocols, XCB_ATOM_ATOM, 32, 1, &rXCB.WMDeleteWindow );
 
-	xcb_intern_atom_cookie_t ProtocolsCookie = xcb_intern_atom( MessageBox.m_pConnection, 1, 12, "WM_PROTOCOLS" );
-	xcb_intern_atom_reply_t* pProtcolsReply  = xcb_intern_atom_reply( MessageBox.m_pConnection, ProtocolsCookie, 0 );
+	xySetFixedSize( rXCB, m_Window, m_Width, m_Height );
 
-	xcb_intern_atom_cookie_t CloseWindowCookie = xcb_intern_atom( MessageBox.m_pConnection, 0, 16, "WM_DELETE_WINDOW" );
-	MessageBox.m_pDeleteWindReply              = xcb_intern_atom_reply( MessageBox.m_pConnection, CloseWindowCookie, 0 );
+	xyXCB.map_window( pConnection, m_Window );
 
-	// Gain access to WM_PROTOCOLS.
-	xcb_change_property( MessageBox.m_pConnection, XCB_PROP_MODE_REPLACE, MessageBox.m_Window, ( *pProtcolsReply ).atom, 4, 32, 1, &( *MessageBox.m_pDeleteWindReply ).atom );
+	xyXCB.flush( pConnection );
+}
+
+bool xyMessageBoxData::CreateSurface( void )
+{
+	int32_t Ascent  = 0;
+	int32_t Descent = 0;
 
-	xcb_map_window( MessageBox.m_pConnection, MessageBox.m_Window );
+	if( !xyGetFontMetrics( xyMessageBoxFontSize, Ascent, Descent ) )
+		return false;
 
-	// Great hack...
-	xcb_size_hints_t SizeHints;
-	SizeHints.flags      = XCB_ICCCM_SIZE_HINT_P_MIN_SIZE | XCB_ICCCM_SIZE_HINT_P_MAX_SIZE;
-	SizeHints.min_width  = SizeHints.max_width  = MessageBox.m_Width;
-	SizeHints.min_height = SizeHints.max_height = MessageBox.m_Height;
+	m_ClientText  = true;
+	m_FontAscent  = static_cast< int16_t >( Ascent );
+	m_FontDescent = static_cast< int16_t >( Descent );
 
-	xcb_icccm_set_wm_normal_hints( MessageBox.m_pConnection, MessageBox.m_Window, &SizeHints );
+	// Wayland doesn't tell clients how large the outputs are, and the box is small enough for any of them anyway
+	Layout( INT16_MAX, INT16_MAX );
 
-	xcb_flush( MessageBox.m_pConnection );
+	m_pSurface = std::make_unique< xyWindow >();
+	if( !m_pSurface->Create( m_Title, m_Width, m_Height, false ) )
+		return false;
 
-	// Fill rect with black. #TODO: Fill color corresponding to theme. Or even see if the theme color is a warm/cool color and set fill accordingly.
+	m_Pixels.resize( size_t( m_Width ) * m_Height );
+	m_Damage.Add( { .Left=0, .Top=0, .Right=m_Width, .Bottom=m_Height } );
 
-	xcb_rectangle_t Rectangles[] ={ { 0, 0, MessageBox.m_Width, MessageBox.m_Height } };
+	Repaint();
+
+	return true;
+}
+
+std::future< xyMessageResult > xyPlatformImpl::xyCreateMsgBox( std::string_view Title, std::string_view Message, xyMessageButtons MessageButtons )
+{
+	auto                           pBox   = std::make_unique< xyMessageBoxData >( Title, Message, MessageButtons );
+	std::future< xyMessageResult > Result = pBox->m_Result.get_future();
+
+	if( !GetWayland() && !GetXCB() )
+	{
+		pBox->m_Result.set_value( pBox->GetCloseResult() );
+		return Result;
+	}
+
+	// The box lives on the main thread, where the event loop serves the connection
+	auto Open = [ this, pBox = std::move( pBox ) ]( void ) mutable
+	{
+		// Under Wayland the box is a surface of our own, which takes a font to draw its text with. Without one it goes through XWayland.
+		if( GetWayland() && pBox->CreateSurface() )
+		{
+			wl_proxy* pSurface = pBox->m_pSurface->GetWaylandSurface();
+
+			XY_TRACE_ASYNC_BEGIN( "Message box", reinterpret_cast< uintptr_t >( pSurface ) );
+			WaylandMessageBoxes.emplace( pSurface, std::move( pBox ) );
+			return;
+		}
+
+		pBox->m_pSurface.reset();
+
+		xyXCBConnection* pConnection = GetXCB();
+		if( !pConnection )
+		{
+			pBox->m_Result.set_value( pBox->GetCloseResult() );
+			return;
+		}
 
-	xcb_poly_fill_rectangle( MessageBox.m_pConnection, MessageBox.m_PixelMap, MessageBox.m_FillGC, 1, Rectangles );
+		pBox->Create( *pConnection );
+		XY_TRACE_ASYNC_BEGIN( "Message box", pBox->m_Window );
+		MessageBoxes.emplace( pBox->m_Window, std::move( pBox ) );
+	};
 
-	while( !MessageBox.WaitClose() )
-		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	if( std::this_thread::get_id() == MainThreadID ) Open();
+	else                                             xyPostToMainThread( std::move( Open ) );
 
-	//MessageBox = { };
+	return Result;
 }
 #endif
 
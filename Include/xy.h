@@ -20,11 +20,23 @@
 //////////////////////////////////////////////////////////////////////////
 /// Includes
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdio>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <span>
 #include <string>
 #include <string_view>
 #include <thread>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 
@@ -39,6 +51,13 @@
 #define XY_UI_MODE_CAR      0x20
 #define XY_UI_MODE_HEADLESS 0x40
 
+#define XY_SNAPSHOT_DEVICE   0x01
+#define XY_SNAPSHOT_LANGUAGE 0x02
+#define XY_SNAPSHOT_THEME    0x04
+#define XY_SNAPSHOT_BATTERY  0x08
+#define XY_SNAPSHOT_DISPLAYS 0x10
+#define XY_SNAPSHOT_ALL      0x1F
+
 #if defined( _WIN32 )
 /// Windows
 
@@ -81,6 +100,48 @@
 
 #endif // __linux__
 
+/// Statistics
+
+// Define XY_ENABLE_STATS to have the system queries record their call counts and latencies. See xyGetStats.
+// Without it the recording compiles away to nothing.
+#if defined( XY_ENABLE_STATS )
+#define XY_STAT_CONCAT_( A, B ) A##B
+#define XY_STAT_CONCAT( A, B )  XY_STAT_CONCAT_( A, B )
+#define XY_STAT_SCOPE( Api )    xyStatScope XY_STAT_CONCAT( StatScope, __LINE__ )( xyApi::Api )
+#else // XY_ENABLE_STATS
+#define XY_STAT_SCOPE( Api )
+#endif // !XY_ENABLE_STATS
+
+/// Tracing
+
+// Define XY_ENABLE_TRACING to compile in the trace points of the framework and of the app. See xyStartTracing.
+// Names must be string literals, or otherwise outlive the tracer, since only the pointer is recorded.
+#if defined( XY_ENABLE_TRACING )
+#define XY_TRACE_CONCAT_( A, B )               A##B
+#define XY_TRACE_CONCAT( A, B )                XY_TRACE_CONCAT_( A, B )
+#define XY_TRACE_SCOPE( Name )                 xyTraceScope XY_TRACE_CONCAT( TraceScope, __LINE__ )( Name )
+#define XY_TRACE_BEGIN( Name )                 xyTracer::Get().Record( 'B', Name, 0 )
+#define XY_TRACE_END( Name )                   xyTracer::Get().Record( 'E', Name, 0 )
+#define XY_TRACE_ASYNC_BEGIN( Name, ID )       xyTracer::Get().Record( 'b', Name, static_cast< int64_t >( ID ) )
+#define XY_TRACE_ASYNC_END( Name, ID )         xyTracer::Get().Record( 'e', Name, static_cast< int64_t >( ID ) )
+#define XY_TRACE_FLOW_BEGIN( Name, ID )        xyTracer::Get().Record( 's', Name, static_cast< int64_t >( ID ) )
+#define XY_TRACE_FLOW_END( Name, ID )          xyTracer::Get().Record( 'f', Name, static_cast< int64_t >( ID ) )
+#define XY_TRACE_COUNTER( Name, Value )        xyTracer::Get().Record( 'C', Name, static_cast< int64_t >( Value ) )
+#define XY_TRACE_INSTANT( Name )               xyTracer::Get().Record( 'i', Name, 0 )
+#define XY_TRACE_THREAD_NAME( Name )           xyTracer::Get().Record( 'M', Name, 0 )
+#else // XY_ENABLE_TRACING
+#define XY_TRACE_SCOPE( Name )
+#define XY_TRACE_BEGIN( Name )
+#define XY_TRACE_END( Name )
+#define XY_TRACE_ASYNC_BEGIN( Name, ID )
+#define XY_TRACE_ASYNC_END( Name, ID )
+#define XY_TRACE_FLOW_BEGIN( Name, ID )
+#define XY_TRACE_FLOW_END( Name, ID )
+#define XY_TRACE_COUNTER( Name, Value )
+#define XY_TRACE_INSTANT( Name )
+#define XY_TRACE_THREAD_NAME( Name )
+#endif // !XY_ENABLE_TRACING
+
 
 //////////////////////////////////////////////////////////////////////////
 /// Enumerators
@@ -118,19 +179,79 @@ enum class xyMessageResult
 
 }; // xyMessageResult
 
+enum class xyChange
+{
+	Battery,
+	Theme,
+	Language,
+	Displays,
+
+}; // xyChange
+
+enum class xyApi
+{
+	GetDevice,
+	GetLanguage,
+	GetPreferredTheme,
+	GetBatteryState,
+	GetDisplayAdapters,
+	GetSystemSnapshot,
+	MessageBox,
+
+	Count,
+
+}; // xyApi
+
 
 //////////////////////////////////////////////////////////////////////////
 /// Data structures
 
 struct xyPlatformImpl;
 
-struct xyContext
+/*
+ * Monotonic timestamps of the phases that the framework goes through before xyMain is called, and of marks that the app makes after that.
+ * Set XY_STARTUP_TRACE to a file path to have the timeline written there as Chrome trace JSON when the process exits.
+ * It can be opened in chrome://tracing or in Perfetto.
+ *
+ * Example: xyGetContext().Startup.Mark( "AssetsLoaded" );
+ */
+class xyStartupTimeline
 {
-	std::span< char* >                CommandLineArgs;
-	std::unique_ptr< xyPlatformImpl > pPlatformImpl;
-	uint32_t                          UIMode = 0x0;
+public:
 
-}; // xyContext
+	using Clock = std::chrono::steady_clock;
+
+	struct Event
+	{
+		std::string       Name;
+		Clock::time_point Begin;
+		Clock::time_point End;             // Same as Begin for marks
+		uint32_t          ThreadIndex = 0; // Threads are numbered in the order they first record something
+		bool              IsPhase     = false;
+
+	}; // Event
+
+	 xyStartupTimeline( void );
+	~xyStartupTimeline( void );
+
+	void                 BeginPhase      ( std::string_view Name );
+	void                 EndPhase        ( void );
+	void                 Mark            ( std::string_view Name );
+	std::vector< Event > GetEvents       ( void ) const;
+	Clock::time_point    GetOrigin       ( void ) const { return Origin; }
+	std::string          ToChromeTrace   ( void ) const;
+	bool                 WriteChromeTrace( const std::string& rPath ) const;
+
+private:
+
+	static uint32_t GetThreadIndex( void );
+
+	mutable std::mutex   Mutex;
+	std::vector< Event > Events;
+	Clock::time_point    Origin;
+	bool                 PhaseOpen = false; // Phases follow each other, so only the last one can be open
+
+}; // xyStartupTimeline
 
 struct xyRect
 {
@@ -143,24 +264,91 @@ struct xyRect
 
 struct xyDevice
 {
+	bool operator==( const xyDevice& ) const = default;
+
 	std::string Name;
 
 }; // xyDevice
 
 struct xyDisplayAdapter
 {
-	std::string Name;
-	xyRect      FullRect;
-	xyRect      WorkRect;
+	std::string                           Name;
+	xyRect                                FullRect;
+	xyRect                                WorkRect;
+	double                                RefreshRate = 0.0;  // In hertz, or zero if it is unknown
+	float                                 ScaleFactor = 1.0f; // How many pixels make up one point
+	std::chrono::steady_clock::time_point RefreshAnchor;      // Where refreshes are counted from. The rate is right, the phase is not known to be. See xyGetNextRefresh.
 
 }; // xyDisplayAdapter
 
 struct xyLanguage
 {
+	bool operator==( const xyLanguage& ) const = default;
+
 	std::string LocaleName;
 
 }; // xyLanguage
 
+/*
+ * A value that is read far more often than it changes.
+ * Readers load the current snapshot through an atomic pointer, which takes no lock and allocates nothing. A change is published as a new
+ * snapshot rather than written over the old one. Readers may hold on to a snapshot for as long as they like, so old ones are only freed
+ * along with the whole thing, which is fine for values that change a handful of times in the life of a process.
+ */
+template< typename T >
+class xySnapshot
+{
+public:
+
+	// Null until the first value is published
+	const T* Get( void ) const { return pCurrent.load( std::memory_order_acquire ); }
+
+	// Returns false if the value is the same as the current one, which is then left alone
+	bool Publish( T Value )
+	{
+		std::scoped_lock Lock( Mutex );
+
+		if( const T* pOld = pCurrent.load( std::memory_order_relaxed ); pOld && *pOld == Value )
+			return false;
+
+		pCurrent.store( Snapshots.emplace_back( std::make_unique< const T >( std::move( Value ) ) ).get(), std::memory_order_release );
+
+		return true;
+	}
+
+private:
+
+	std::atomic< const T* >                    pCurrent = nullptr;
+	std::mutex                                 Mutex;     // Serializes publishers
+	std::vector< std::unique_ptr< const T > > Snapshots; // Every value that was ever published
+
+}; // xySnapshot
+
+/*
+ * Information about the system that is read once and then served from snapshots.
+ * Snapshots are only replaced when the platform reports a change, or when xyRefreshSystemInfo is called.
+ */
+struct xySystemInfoCache
+{
+	// Read the value again and publish it if it changed. Returns whether it did.
+	bool RefreshDevice  ( void );
+	bool RefreshLanguage( void );
+
+	xySnapshot< xyDevice >   Device;
+	xySnapshot< xyLanguage > Language;
+
+}; // xySystemInfoCache
+
+struct xyContext
+{
+	xyStartupTimeline                 Startup; // First, so that it begins before and ends after everything else
+	std::span< char* >                CommandLineArgs;
+	xySystemInfoCache                 SystemInfo;
+	std::shared_ptr< xyPlatformImpl > pPlatformImpl; // Shared with the queries of xyGetSystemSnapshot, which may outlive the app
+	uint32_t                          UIMode = 0x0;
+
+}; // xyContext
+
 struct xyBatteryState
 {
 	operator bool( void ) const { return Valid; }
@@ -171,6 +359,401 @@ struct xyBatteryState
 
 }; // xyPowerStatus
 
+struct xySystemSnapshot
+{
+	// Whether the field was filled in, rather than left at its default because its query ran out of time
+	bool Has( uint8_t Field ) const { return ( Missing & Field ) == 0; }
+
+	xyDevice                        Device;
+	xyLanguage                      Language;
+	std::vector< xyDisplayAdapter > DisplayAdapters;
+	xyBatteryState                  BatteryState;
+	xyTheme                         Theme   = xyTheme::Light;
+	uint8_t                         Missing = 0; // XY_SNAPSHOT_* bits
+
+}; // xySystemSnapshot
+
+struct xyRunnable
+{
+	virtual ~xyRunnable( void ) = default;
+
+	virtual void Execute( void ) = 0;
+
+}; // xyRunnable
+
+/*
+ * A one-shot event that one thread signals and another thread waits for.
+ * Waiting threads are parked in the kernel (on a futex where available) and wake up as soon as the event is signaled.
+ */
+class xyCompletion
+{
+public:
+
+	void Signal     ( void );
+	void Wait       ( void );
+	bool IsSignaled ( void ) const { return State.load( std::memory_order_acquire ) != 0; }
+
+private:
+
+	std::atomic< uint32_t > State = 0;
+
+}; // xyCompletion
+
+/*
+ * Type-erased, one-shot callable without any virtual functions.
+ * Callables that fit in the inline storage are constructed in place. Only oversized ones fall back to the heap.
+ */
+class xyJob
+{
+public:
+
+	// Keeps the whole job within a single cache line
+	static constexpr size_t InlineSize = 40;
+
+	 xyJob( void ) = default;
+	 xyJob( const xyJob& ) = delete;
+	 xyJob( xyJob&& rrOther ) noexcept { *this = std::move( rrOther ); }
+	~xyJob( void ) { Reset(); }
+
+	xyJob& operator=( const xyJob& ) = delete;
+	xyJob& operator=( xyJob&& rrOther ) noexcept
+	{
+		Reset();
+
+		if( rrOther.pInvoke )
+		{
+			rrOther.pRelocate( Storage, rrOther.Storage );
+
+			pInvoke   = std::exchange( rrOther.pInvoke,   nullptr );
+			pDestroy  = std::exchange( rrOther.pDestroy,  nullptr );
+			pRelocate = std::exchange( rrOther.pRelocate, nullptr );
+		}
+
+		return *this;
+
+	} // operator=
+
+	explicit operator bool( void ) const { return pInvoke != nullptr; }
+
+	template< typename Function >
+	void Emplace( Function&& rrFunction );
+
+	// Calls and then destroys the callable
+	void Run( void )
+	{
+		auto* pFunction = std::exchange( pInvoke, nullptr );
+		pDestroy        = nullptr;
+		pRelocate       = nullptr;
+		pFunction( Storage );
+
+	} // Run
+
+	// Destroys the callable without calling it
+	void Reset( void )
+	{
+		if( pDestroy )
+			std::exchange( pDestroy, nullptr )( Storage );
+
+		pInvoke   = nullptr;
+		pRelocate = nullptr;
+
+	} // Reset
+
+	// Number of callables that did not fit inline since the program started
+	static inline std::atomic< uint64_t > HeapAllocations = 0;
+
+private:
+
+	alignas( std::max_align_t ) std::byte Storage[ InlineSize ];
+	void                                  ( *pInvoke   )( void* pStorage )             = nullptr;
+	void                                  ( *pDestroy  )( void* pStorage )             = nullptr;
+	void                                  ( *pRelocate )( void* pDst, void* pStorage ) = nullptr;
+
+}; // xyJob
+
+/*
+ * Return type for coroutines that run detached from their caller.
+ * The coroutine starts immediately and its frame is released as soon as it finishes.
+ */
+struct xyTask
+{
+	struct promise_type
+	{
+		xyTask              get_return_object  ( void )          { return { }; }
+		std::suspend_never  initial_suspend    ( void ) noexcept { return { }; }
+		std::suspend_never  final_suspend      ( void ) noexcept { return { }; }
+		void                return_void        ( void )          { }
+		void                unhandled_exception( void )          { std::terminate(); }
+
+	}; // promise_type
+
+}; // xyTask
+
+struct xyTranscodeResult
+{
+	size_t Read    = 0; // Number of source code units that were consumed
+	size_t Written = 0; // Number of code units that were written to the destination
+
+}; // xyTranscodeResult
+
+/*
+ * Converts UTF-8 into Unicode one chunk at a time.
+ * Chunks may be split in the middle of a multi-byte sequence, the incomplete part is kept until the next chunk arrives.
+ */
+class xyUTF8Decoder
+{
+public:
+
+	xyTranscodeResult Convert( std::string_view Chunk, std::span< wchar_t > Buffer );
+	size_t            Convert( std::string_view Chunk, std::wstring& rOutput );
+	size_t            Finish ( std::wstring& rOutput );
+	void              Reset  ( void ) { PendingSize = 0; }
+
+private:
+
+	char   Pending[ 4 ] = { };
+	size_t PendingSize  = 0;
+
+}; // xyUTF8Decoder
+
+/*
+ * Converts Unicode into UTF-8 one chunk at a time.
+ * Chunks may be split between the two halves of a UTF-16 surrogate pair, the first half is kept until the next chunk arrives.
+ */
+class xyUTF8Encoder
+{
+public:
+
+	xyTranscodeResult Convert( std::wstring_view Chunk, std::span< char > Buffer );
+	size_t            Convert( std::wstring_view Chunk, std::string& rOutput );
+	size_t            Finish ( std::string& rOutput );
+	void              Reset  ( void ) { PendingSize = 0; }
+
+private:
+
+	wchar_t Pending     = 0;
+	size_t  PendingSize = 0;
+
+}; // xyUTF8Encoder
+
+/*
+ * Latency histogram with a bounded relative error, in the style of HdrHistogram.
+ * Every power of two is split into 16 linear buckets, so a recorded value is never off by more than about 6%, from nanoseconds up to a minute.
+ * Longer values all land in the last bucket. The exact count, sum, minimum and maximum are kept on the side.
+ */
+class xyLatencyHistogram
+{
+public:
+
+	static constexpr uint32_t SubBucketBits  = 4;
+	static constexpr uint32_t SubBucketCount = 1 << SubBucketBits;
+	static constexpr uint32_t MaxExponent    = 36; // 2^36 ns is about 69 seconds
+	static constexpr size_t   BucketCount    = SubBucketCount + ( MaxExponent - SubBucketBits ) * SubBucketCount;
+
+	static size_t   GetBucketIndex     ( uint64_t Nanoseconds );
+	static uint64_t GetBucketUpperBound( size_t BucketIndex );
+
+	void                     Record       ( std::chrono::nanoseconds Latency );
+	void                     Merge        ( const xyLatencyHistogram& rOther );
+	uint64_t                 GetCount     ( void ) const { return Count; }
+	std::chrono::nanoseconds GetMin       ( void ) const { return std::chrono::nanoseconds( Count ? Min : 0 ); }
+	std::chrono::nanoseconds GetMax       ( void ) const { return std::chrono::nanoseconds( Max ); }
+	std::chrono::nanoseconds GetMean      ( void ) const { return std::chrono::nanoseconds( Count ? Sum / Count : 0 ); }
+	std::chrono::nanoseconds GetPercentile( double Percentile ) const;
+
+public:
+
+	std::array< uint64_t, BucketCount > Buckets = { };
+	uint64_t                            Count   = 0;
+	uint64_t                            Sum     = 0;
+	uint64_t                            Min     = UINT64_MAX;
+	uint64_t                            Max     = 0;
+
+}; // xyLatencyHistogram
+
+struct xyApiStats
+{
+	std::string_view   Name;
+	xyLatencyHistogram Latency; // Its count is the number of calls
+
+}; // xyApiStats
+
+struct xyStats
+{
+	std::array< xyApiStats, static_cast< size_t >( xyApi::Count ) > Apis;
+
+	const xyApiStats& operator[]( xyApi Api ) const { return Apis[ static_cast< size_t >( Api ) ]; }
+
+}; // xyStats
+
+#if defined( XY_ENABLE_STATS )
+
+/*
+ * Times the scope it lives in and records it for one of the APIs.
+ * Each thread records into its own histograms, so nothing is shared until xyGetStats merges them.
+ */
+class xyStatScope
+{
+public:
+
+	explicit xyStatScope( xyApi Api ) : Api( Api ), Begin( std::chrono::steady_clock::now() ) { }
+	        ~xyStatScope( void );
+
+	xyStatScope( const xyStatScope& ) = delete;
+	xyStatScope& operator=( const xyStatScope& ) = delete;
+
+private:
+
+	xyApi                                 Api;
+	std::chrono::steady_clock::time_point Begin;
+
+}; // xyStatScope
+
+#endif // XY_ENABLE_STATS
+
+/*
+ * One entry in a trace. Phases follow the Chrome trace event format.
+ */
+struct xyTraceEvent
+{
+	const char* pName     = nullptr;
+	int64_t     Timestamp = 0; // Nanoseconds on the steady clock
+	int64_t     Value     = 0; // Duration of complete events, value of counters, or ID of flows and async spans
+	char        Phase     = 0;
+
+}; // xyTraceEvent
+
+/*
+ * Low-overhead tracer that writes Chrome trace JSON, which can be opened in chrome://tracing or in Perfetto.
+ * Every thread records into a ring buffer of its own without taking any locks, and a background thread moves the events to the file.
+ * A thread that records faster than the background thread can keep up with loses events instead of waiting. Those are counted.
+ * Set XY_TRACE to a file path to start tracing as soon as the first trace point is hit.
+ */
+class xyTracer
+{
+public:
+
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr size_t RingCapacity = 8192; // Events per thread
+
+	static xyTracer& Get   ( void );
+	static uint64_t  NextID( void ) { static std::atomic< uint64_t > ID = 1; return ID.fetch_add( 1, std::memory_order_relaxed ); }
+
+	bool     Start           ( const std::string& rPath );
+	void     Stop            ( void );
+	bool     IsActive        ( void ) const { return Active.load( std::memory_order_relaxed ); }
+	void     Record          ( char Phase, const char* pName, int64_t Value );
+	void     Record          ( char Phase, const char* pName, int64_t Value, Clock::time_point Time );
+	uint64_t GetDroppedEvents( void ) const { return DroppedEvents.load( std::memory_order_relaxed ); }
+
+private:
+
+	struct Ring
+	{
+		std::array< xyTraceEvent, RingCapacity > Events;
+		alignas( 64 ) std::atomic< uint64_t >    Head        = 0; // Written by the owning thread
+		alignas( 64 ) std::atomic< uint64_t >    Tail        = 0; // Written by the flush thread
+		std::atomic< bool >                      Orphaned    = false; // The owning thread has exited
+		uint32_t                                 ThreadIndex = 0;
+
+	}; // Ring
+
+	 xyTracer( void );
+
+	Ring& GetThreadRing  ( void );
+	void  FlushThreadMain( void );
+	void  Flush          ( void );
+	void  Append         ( const xyTraceEvent& rEvent, uint32_t ThreadIndex );
+
+	std::atomic< bool >                    Active          = false;
+	std::atomic< uint64_t >                DroppedEvents   = 0;
+	std::mutex                             ControlMutex;    // Serializes Start and Stop
+	std::mutex                             Mutex;           // Guards everything below
+	std::condition_variable                Condition;
+	std::vector< std::shared_ptr< Ring > > Rings;
+	std::thread                            FlushThread;
+	std::string                            Buffer;
+	FILE*                                  pFile           = nullptr;
+	int64_t                                Origin          = 0; // Steady clock nanoseconds when tracing started
+	uint32_t                               NextThreadIndex = 0;
+	bool                                   Stopping        = false;
+	bool                                   FirstEvent      = true;
+
+}; // xyTracer
+
+#if defined( XY_ENABLE_TRACING )
+
+/*
+ * Records a complete event that spans the scope it lives in.
+ */
+class xyTraceScope
+{
+public:
+
+	explicit xyTraceScope( const char* pName ) : pName( xyTracer::Get().IsActive() ? pName : nullptr ) { if( this->pName ) Begin = xyTracer::Clock::now(); }
+	        ~xyTraceScope( void );
+
+	xyTraceScope( const xyTraceScope& ) = delete;
+	xyTraceScope& operator=( const xyTraceScope& ) = delete;
+
+private:
+
+	const char*                 pName;
+	xyTracer::Clock::time_point Begin;
+
+}; // xyTraceScope
+
+#endif // XY_ENABLE_TRACING
+
+/*
+ * Sleeps until the next frame of a fixed-rate loop, such as a render loop that follows the refresh rate of a display.
+ * The thread sleeps in the kernel until shortly before the deadline and spins the rest of the way, which avoids both busy-waiting and oversleeping.
+ * Frames that were missed are skipped rather than caught up on.
+ * A pacer made for a display has its rate but not its vblank, see xyGetNextRefresh. Call Reanchor with measured presentation times to line up with it.
+ */
+class xyFramePacer
+{
+public:
+
+	using Clock = std::chrono::steady_clock;
+
+	struct Statistics
+	{
+		uint64_t Frames                = 0;
+		uint64_t MissedFrames          = 0;
+		double   MeanJitterMicroseconds = 0.0; // How late we woke up compared to the deadline
+		double   JitterDeviation        = 0.0; // Standard deviation of the above
+		double   MaxJitterMicroseconds  = 0.0;
+
+	}; // Statistics
+
+	explicit xyFramePacer( std::chrono::nanoseconds Period, Clock::time_point Anchor = Clock::now() );
+	explicit xyFramePacer( const xyDisplayAdapter& rDisplayAdapter );
+	        ~xyFramePacer( void );
+
+	xyFramePacer( const xyFramePacer& ) = delete;
+	xyFramePacer& operator=( const xyFramePacer& ) = delete;
+
+	Clock::time_point WaitForNextFrame( void );
+	void              Reanchor        ( Clock::time_point VBlank );
+	void              SetSpinThreshold( std::chrono::nanoseconds Threshold ) { SpinThreshold = Threshold; }
+	Statistics        GetStatistics   ( void ) const;
+	void              ResetStatistics ( void );
+
+private:
+
+	void SleepUntil( Clock::time_point Deadline );
+
+	std::chrono::nanoseconds Period;
+	std::chrono::nanoseconds SpinThreshold = std::chrono::microseconds( 250 );
+	Clock::time_point        NextDeadline;
+	Statistics               Stats;
+	double                   JitterM2      = 0.0; // Running sum of squared differences from the mean
+	int                      TimerFD       = -1;
+
+}; // xyFramePacer
+
 
 //////////////////////////////////////////////////////////////////////////
 /// Functions
@@ -184,6 +767,8 @@ extern xyContext& xyGetContext( void );
 
 /**
  * Convert a unicode string to UTF-8.
+ * Unpaired surrogates and values outside of the Unicode range are replaced with U+FFFD.
+ * The conversion does not depend on the current C locale.
  *
  * @return A UTF-8 string.
  */
@@ -191,11 +776,53 @@ extern std::string xyUTF( std::wstring_view String );
 
 /**
  * Convert a UTF-8 to Unicode.
+ * Each maximal subpart of an invalid or truncated UTF-8 sequence is replaced with U+FFFD.
+ * The conversion does not depend on the current C locale.
  *
  * @return A Unicode string.
  */
 extern std::wstring xyUnicode( std::string_view String );
 
+/**
+ * Convert a unicode string to UTF-8 into a caller-provided buffer.
+ * The conversion stops early if the buffer is too small. It never writes half of a multi-byte sequence.
+ *
+ * @param String The string to convert.
+ * @param Buffer The buffer that receives the UTF-8 string. It is not null-terminated.
+ * @return The number of characters that were read from the string and written to the buffer.
+ */
+extern xyTranscodeResult xyUTF( std::wstring_view String, std::span< char > Buffer );
+
+/**
+ * Convert a UTF-8 string to Unicode into a caller-provided buffer.
+ * The conversion stops early if the buffer is too small. It never writes half of a surrogate pair.
+ *
+ * @param String The string to convert.
+ * @param Buffer The buffer that receives the Unicode string. It is not null-terminated.
+ * @return The number of bytes that were read from the string and characters written to the buffer.
+ */
+extern xyTranscodeResult xyUnicode( std::string_view String, std::span< wchar_t > Buffer );
+
+/**
+ * Convert a unicode string to UTF-8, replacing the contents of an existing string.
+ * Reusing the same output string avoids a heap allocation once its capacity is large enough.
+ *
+ * @param String The string to convert.
+ * @param rOutput The string that receives the result.
+ * @return The size of the UTF-8 string.
+ */
+extern size_t xyUTF( std::wstring_view String, std::string& rOutput );
+
+/**
+ * Convert a UTF-8 string to Unicode, replacing the contents of an existing string.
+ * Reusing the same output string avoids a heap allocation once its capacity is large enough.
+ *
+ * @param String The string to convert.
+ * @param rOutput The string that receives the result.
+ * @return The size of the Unicode string.
+ */
+extern size_t xyUnicode( std::string_view String, std::wstring& rOutput );
+
 /**
  * Prompts a system message box containing a user-defined message and a set of options in the form of buttons.
  * The current thread is blocked until a selection has been made.
@@ -219,12 +846,24 @@ extern xyMessageResult xyMessageBox( std::string_view Title, std::string_view Me
  */
 extern void xyMessageBox( std::string_view Title, std::string_view Message );
 
+/**
+ * Prompts a system message box like xyMessageBox, but returns right away instead of waiting for a selection.
+ * Any number of message boxes may be shown at once.
+ *
+ * @param Title The title of the message box window.
+ * @param Message The content of the message text box.
+ * @param Buttons The range of button options to present.
+ * @return A future that receives the result that was selected.
+ */
+extern std::future< xyMessageResult > xyMessageBoxAsync( std::string_view Title, std::string_view Message, xyMessageButtons Buttons );
+
 /**
  * Obtains information about the current device.
+ * It is read on the first call and cached from then on, since nothing tells us when it changes. See xyRefreshSystemInfo.
  *
- * @return The device data.
+ * @return The device data, which stays valid for the life of the process.
  */
-extern xyDevice xyGetDevice( void );
+extern const xyDevice& xyGetDevice( void );
 
 /**
  * Obtains the preferred theme of this device.
@@ -235,10 +874,20 @@ extern xyTheme xyGetPreferredTheme( void );
 
 /**
  * Obtains the system language.
+ * On Linux, LC_ALL, LC_MESSAGES and LANG come first, in that order. The configured locale in locale.conf is only used when none of them is set.
+ * It is read on the first call and cached from then on. The cache follows changes of language while something is subscribed to
+ * xyChange::Language, and otherwise only when xyRefreshSystemInfo is called. Watching for changes isn't free: on Linux, merely having
+ * an inotify instance adds about 10 ms to the exit of the process.
  *
- * @return The language code.
+ * @return The language code, which stays valid for the life of the process.
+ */
+extern const xyLanguage& xyGetLanguage( void );
+
+/**
+ * Reads the cached information about the system again, for changes that the platform doesn't report.
+ * References that were returned before stay valid, but keep the old values.
  */
-extern xyLanguage xyGetLanguage( void );
+extern void xyRefreshSystemInfo( void );
 
 /**
  * Obtains the state of the battery power source on this device.
@@ -263,33 +912,157 @@ extern xyBatteryState xyGetBatteryState( void );
  */
 extern std::vector< xyDisplayAdapter > xyGetDisplayAdapters( void );
 
-//////////////////////////////////////////////////////////////////////////
-/*
+/**
+ * Obtains the device, language, theme, battery state and display adapters in one go.
+ * Where there are threads, each field is read by a query of its own on a small pool of threads, and the calling thread only waits for
+ * them. Values that are already cached are taken from the cache.
+ * Each query has until the timeout, counted from the call. Those that don't finish in time are flagged in the Missing field and left at
+ * their defaults, so that a slow display server or file system doesn't hold up the caller. A field whose query from an earlier call still
+ * hasn't returned is not queried again, and is flagged as missing right away. Queries that never return don't hold up the exit either.
+ *
+ * Example: if( xySystemSnapshot Snapshot = xyGetSystemSnapshot(); Snapshot.Has( XY_SNAPSHOT_THEME ) ) { ... }
+ *
+ * @param Timeout How long to wait for each query.
+ * @return The snapshot.
+ */
+extern xySystemSnapshot xyGetSystemSnapshot( std::chrono::milliseconds Timeout = std::chrono::milliseconds( 250 ) );
 
-██╗███╗   ███╗██████╗ ██╗     ███████╗███╗   ███╗███████╗███╗   ██╗████████╗ █████╗ ████████╗██╗ ██████╗ ███╗   ██╗
-██║████╗ ████║██╔══██╗██║     ██╔════╝████╗ ████║██╔════╝████╗  ██║╚══██╔══╝██╔══██╗╚══██╔══╝██║██╔═══██╗████╗  ██║
-██║██╔████╔██║██████╔╝██║     █████╗  ██╔████╔██║█████╗  ██╔██╗ ██║   ██║   ███████║   ██║   ██║██║   ██║██╔██╗ ██║
-██║██║╚██╔╝██║██╔═══╝ ██║     ██╔══╝  ██║╚██╔╝██║██╔══╝  ██║╚██╗██║   ██║   ██╔══██║   ██║   ██║██║   ██║██║╚██╗██║
-██║██║ ╚═╝ ██║██║     ███████╗███████╗██║ ╚═╝ ██║███████╗██║ ╚████║   ██║   ██║  ██║   ██║   ██║╚██████╔╝██║ ╚████║
-╚═╝╚═╝     ╚═╝╚═╝     ╚══════╝╚══════╝╚═╝     ╚═╝╚══════╝╚═╝  ╚═══╝   ╚═╝   ╚═╝  ╚═╝   ╚═╝   ╚═╝ ╚═════╝ ╚═╝  ╚═══╝
-*/
-#if defined( XY_IMPLEMENT )
+/**
+ * Steps the refresh anchor of the given display forward by whole refresh periods.
+ * None of the platforms report when their displays actually refresh, so the anchor is arbitrary (on Linux, it is when the displays were
+ * queried) and the result is a point on a grid with the right spacing but an unknown phase. Code that needs to line up with the real vblank has to measure it,
+ * for instance from the presentation times of its own swap chain, and hand those to xyFramePacer::Reanchor.
+ *
+ * @param rDisplayAdapter The display in question.
+ * @param After The point in time to look from.
+ * @return The first point on the refresh grid after the given time, or the given time itself if the refresh rate is unknown.
+ */
+extern std::chrono::steady_clock::time_point xyGetNextRefresh( const xyDisplayAdapter& rDisplayAdapter, std::chrono::steady_clock::time_point After = std::chrono::steady_clock::now() );
 
-//////////////////////////////////////////////////////////////////////////
-/// Includes
+/**
+ * Registers a function that gets called whenever the given value changes, so that it doesn't have to be polled.
+ * A burst of changes only results in one call. The function is always called on the main thread.
+ *
+ * Note: Only Linux sends notifications for now. On other platforms the function is never called.
+ *
+ * @param Change The value to watch.
+ * @param Callback The function that gets called. Use the corresponding getter to obtain the new value.
+ * @return An ID for the subscription that can be passed to xyUnsubscribe, or 0 if it failed.
+ */
+extern uint64_t xySubscribe( xyChange Change, std::function< void( void ) > Callback );
 
-#include "xy-platforms/xy-android.h"
-#include "xy-platforms/xy-desktop.h"
-#include "xy-platforms/xy-ios.h"
-#include "xy-platforms/xy-macos.h"
-#include "xy-platforms/xy-tvos.h"
-#include "xy-platforms/xy-watchos.h"
-#include "xy-platforms/xy-windows.h"
-#include "xy-platforms/xy-linux.h"
+/**
+ * Removes a subscription that was made with xySubscribe.
+ *
+ * @param SubscriptionID The ID that xySubscribe returned.
+ */
+extern void xyUnsubscribe( uint64_t SubscriptionID );
 
-#if defined( XY_OS_WINDOWS )
-#include <windows.h>
-#include <lmcons.h>
+/**
+ * Takes a snapshot of the call counts and latencies of the system queries, merged from every thread that made a call.
+ * Only recorded when XY_ENABLE_STATS is defined. Otherwise every histogram is empty.
+ *
+ * Example: xyGetStats()[ xyApi::GetDisplayAdapters ].Latency.GetPercentile( 99.0 )
+ *
+ * @return The statistics of every API.
+ */
+extern xyStats xyGetStats( void );
+
+/**
+ * Starts writing trace events to a file as Chrome trace JSON.
+ * Only the trace points that were compiled in with XY_ENABLE_TRACING record anything.
+ *
+ * @param rPath The path of the file to write, which is replaced if it exists.
+ * @return True if tracing was started, false if the file couldn't be opened or tracing was already started.
+ */
+extern bool xyStartTracing( const std::string& rPath );
+
+/**
+ * Stops tracing and finishes the file. This also happens when the process exits.
+ */
+extern void xyStopTracing( void );
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Template functions
+
+/**
+ * Invokes a callable object with arguments from a packed tuple.
+ *
+ * @param rrFunction The object that gets called.
+ * @param rTuple The tuple that gets unpacked into arguments.
+ */
+template< typename Function, typename Tuple, size_t... Is >
+auto xyInvokeWithTuple( Function&& rrFunction, const Tuple& rTuple, std::integer_sequence< size_t, Is... > )
+{
+	return std::invoke( std::forward< Function >( rrFunction ), ( std::get< Is >( rTuple ) )... );
+
+} // xyInvokeWithTuple
+
+/**
+ * Stores a callable object in the job, destroying any previous one.
+ *
+ * @param rrFunction The object that gets called when the job is run.
+ */
+template< typename Function >
+void xyJob::Emplace( Function&& rrFunction )
+{
+	using Callable = std::decay_t< Function >;
+
+	Reset();
+
+	if constexpr( sizeof( Callable ) <= InlineSize && alignof( Callable ) <= alignof( std::max_align_t ) && std::is_nothrow_move_constructible_v< Callable > )
+	{
+		new( Storage ) Callable( std::forward< Function >( rrFunction ) );
+
+		pInvoke   = []( void* pStorage ) { Callable& rCallable = *std::launder( static_cast< Callable* >( pStorage ) ); rCallable(); rCallable.~Callable(); };
+		pDestroy  = []( void* pStorage ) { std::launder( static_cast< Callable* >( pStorage ) )->~Callable(); };
+		pRelocate = []( void* pDst, void* pStorage )
+		{
+			Callable& rCallable = *std::launder( static_cast< Callable* >( pStorage ) );
+			new( pDst ) Callable( std::move( rCallable ) );
+			rCallable.~Callable();
+		};
+	}
+	else
+	{
+		*reinterpret_cast< Callable** >( Storage ) = new Callable( std::forward< Function >( rrFunction ) );
+		HeapAllocations.fetch_add( 1, std::memory_order_relaxed );
+
+		pInvoke   = []( void* pStorage ) { Callable* pCallable = *static_cast< Callable** >( pStorage ); ( *pCallable )(); delete pCallable; };
+		pDestroy  = []( void* pStorage ) { delete *static_cast< Callable** >( pStorage ); };
+		pRelocate = []( void* pDst, void* pStorage ) { *static_cast< Callable** >( pDst ) = *static_cast< Callable** >( pStorage ); };
+	}
+
+} // Emplace
+
+//////////////////////////////////////////////////////////////////////////
+/*
+
+██╗███╗   ███╗██████╗ ██╗     ███████╗███╗   ███╗███████╗███╗   ██╗████████╗ █████╗ ████████╗██╗ ██████╗ ███╗   ██╗
+██║████╗ ████║██╔══██╗██║     ██╔════╝████╗ ████║██╔════╝████╗  ██║╚══██╔══╝██╔══██╗╚══██╔══╝██║██╔═══██╗████╗  ██║
+██║██╔████╔██║██████╔╝██║     █████╗  ██╔████╔██║█████╗  ██╔██╗ ██║   ██║   ███████║   ██║   ██║██║   ██║██╔██╗ ██║
+██║██║╚██╔╝██║██╔═══╝ ██║     ██╔══╝  ██║╚██╔╝██║██╔══╝  ██║╚██╗██║   ██║   ██╔══██║   ██║   ██║██║   ██║██║╚██╗██║
+██║██║ ╚═╝ ██║██║     ███████╗███████╗██║ ╚═╝ ██║███████╗██║ ╚████║   ██║   ██║  ██║   ██║   ██║╚██████╔╝██║ ╚████║
+╚═╝╚═╝     ╚═╝╚═╝     ╚══════╝╚══════╝╚═╝     ╚═╝╚══════╝╚═╝  ╚═══╝   ╚═╝   ╚═╝  ╚═╝   ╚═╝   ╚═╝ ╚═════╝ ╚═╝  ╚═══╝
+*/
+#if defined( XY_IMPLEMENT )
+
+//////////////////////////////////////////////////////////////////////////
+/// Includes
+
+#include "xy-platforms/xy-android.h"
+#include "xy-platforms/xy-linux.h" // Before xy-desktop.h, which reads the mouse through xyPlatformImpl
+#include "xy-platforms/xy-desktop.h"
+#include "xy-platforms/xy-ios.h"
+#include "xy-platforms/xy-macos.h"
+#include "xy-platforms/xy-tvos.h"
+#include "xy-platforms/xy-watchos.h"
+#include "xy-platforms/xy-windows.h"
+
+#if defined( XY_OS_WINDOWS )
+#include <windows.h>
+#include <lmcons.h>
 #elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
 #include <Cocoa/Cocoa.h>
 #include <Foundation/Foundation.h>
@@ -305,720 +1078,2591 @@ extern std::vector< xyDisplayAdapter > xyGetDisplayAdapters( void );
 #include <limits.h>
 #endif // XY_OS_IOS
 
+#if defined( XY_OS_LINUX ) || defined( XY_OS_ANDROID )
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif // XY_OS_LINUX || XY_OS_ANDROID
 
-//////////////////////////////////////////////////////////////////////////
-/// Functions
-
-xyContext& xyGetContext( void )
-{
-	static xyContext Context;
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
-	return Context;
+#if defined( __AVX2__ )
+#define XY_SIMD_AVX2
+#include <immintrin.h>
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) // __AVX2__
+#define XY_SIMD_SSE2
+#include <emmintrin.h>
+#endif // __SSE2__ || _M_X64 || _M_IX86_FP >= 2
 
-} // xyGetContext
 
 //////////////////////////////////////////////////////////////////////////
+/// Unicode transcoding
 
-std::string xyUTF( std::wstring_view String )
+// wchar_t holds UTF-16 code units on Windows and UTF-32 code points everywhere else
+constexpr bool     xyWideIsUTF16          = ( sizeof( wchar_t ) == 2 );
+constexpr size_t   xyMaxUTF8PerWide       = xyWideIsUTF16 ? 3 : 4;
+constexpr char32_t xyReplacementCharacter = 0xFFFD;
+
+/*
+ * Decodes one UTF-8 sequence and advances the source pointer past it.
+ * An invalid sequence decodes into U+FFFD and only consumes its maximal subpart, as recommended by the Unicode standard.
+ * That way a corrupt or truncated sequence never swallows the valid characters that follow it.
+ */
+inline char32_t xyDecodeUTF8Sequence( const uint8_t*& rpSrc, const uint8_t* pSrcEnd )
 {
-	std::string    UTFString;
-	size_t         Size;
-	const wchar_t* pSrc = String.data();
-	mbstate_t      State{};
+	const uint8_t Lead = *rpSrc++;
 
-#if defined( XY_OS_WINDOWS )
-	if( wcsrtombs_s( &Size, nullptr, 0, &pSrc, String.size(), &State ) == 0 )
+	if( Lead < 0x80 )
+		return Lead;
+
+	size_t   Length;
+	char32_t CodePoint;
+	uint8_t  Min = 0x80;
+	uint8_t  Max = 0xBF;
+
+	// The second byte has a narrower range for some lead bytes to reject overlong encodings, surrogates and values above U+10FFFF
+	if(      Lead >= 0xC2 && Lead <= 0xDF ) { Length = 2; CodePoint = Lead & 0x1F; }
+	else if( Lead >= 0xE0 && Lead <= 0xEF ) { Length = 3; CodePoint = Lead & 0x0F; Min = ( Lead == 0xE0 ) ? 0xA0 : 0x80; Max = ( Lead == 0xED ) ? 0x9F : 0xBF; }
+	else if( Lead >= 0xF0 && Lead <= 0xF4 ) { Length = 4; CodePoint = Lead & 0x07; Min = ( Lead == 0xF0 ) ? 0x90 : 0x80; Max = ( Lead == 0xF4 ) ? 0x8F : 0xBF; }
+	else                                    { return xyReplacementCharacter; }
+
+	for( size_t i = 1; i < Length; ++i )
 	{
-		UTFString.resize( Size );
-		wcsrtombs_s( &Size, &UTFString[ 0 ], Size, &pSrc, String.size(), &State );
+		if( rpSrc == pSrcEnd || *rpSrc < Min || *rpSrc > Max )
+			return xyReplacementCharacter;
+
+		CodePoint = ( CodePoint << 6 ) | ( *rpSrc++ & 0x3F );
+		Min       = 0x80;
+		Max       = 0xBF;
 	}
-#else // XY_OS_WINDOWS
-	if( ( Size = wcsrtombs( nullptr, &pSrc, String.size(), &State ) ) > 0 )
+
+	return CodePoint;
+
+} // xyDecodeUTF8Sequence
+
+/*
+ * Obtains the size of the trailing bytes that form the beginning of a valid, but unfinished, UTF-8 sequence.
+ */
+inline size_t xyIncompleteUTF8Tail( const uint8_t* pSrc, size_t Size )
+{
+	for( size_t i = 1; i <= std::min< size_t >( Size, 3 ); ++i )
 	{
-		UTFString.resize( Size );
-		wcsrtombs( &UTFString[ 0 ], &pSrc, String.size(), &State );
-	}
-#endif // !XY_OS_WINDOWS
+		const uint8_t  Lead   = pSrc[ Size - i ];
+		const size_t   Length = ( Lead >= 0xC2 && Lead <= 0xDF ) ? 2 : ( Lead >= 0xE0 && Lead <= 0xEF ) ? 3 : ( Lead >= 0xF0 && Lead <= 0xF4 ) ? 4 : 0;
 
-	return UTFString;
+		// Skip over continuation bytes until we find the lead byte
+		if( Lead >= 0x80 && Lead <= 0xBF )
+			continue;
 
-} // xyUTF
+		if( Length <= i )
+			return 0;
 
-//////////////////////////////////////////////////////////////////////////
+		// Decoding only runs out of input if every byte so far was valid
+		const uint8_t* pSequence = pSrc + Size - i;
+		xyDecodeUTF8Sequence( pSequence, pSrc + Size );
 
-std::wstring xyUnicode( std::string_view String )
-{
-	std::wstring Result;
-	size_t       Size;
-	const char*  pSrc = String.data();
-	mbstate_t    MultiByteState{ };
+		return ( pSequence == pSrc + Size ) ? i : 0;
+	}
 
-#if defined( XY_OS_WINDOWS )
-	if( mbsrtowcs_s( &Size, nullptr, 0, &pSrc, String.size(), &MultiByteState ) == 0 )
+	return 0;
+
+} // xyIncompleteUTF8Tail
+
+/*
+ * Writes a code point as one wide character, or as a surrogate pair if wchar_t is UTF-16 and the code point needs it.
+ */
+inline void xyWriteWide( char32_t CodePoint, wchar_t* pDst )
+{
+	if( xyWideIsUTF16 && CodePoint >= 0x10000 )
 	{
-		Result.resize( Size );
-		mbsrtowcs_s( &Size, &Result[ 0 ], Size, &pSrc, String.size(), &MultiByteState );
+		pDst[ 0 ] = static_cast< wchar_t >( 0xD800 + ( ( CodePoint - 0x10000 ) >> 10 ) );
+		pDst[ 1 ] = static_cast< wchar_t >( 0xDC00 + ( ( CodePoint - 0x10000 ) & 0x3FF ) );
 	}
-#else // XY_OS_WINDOWS
-	if( ( Size = mbsrtowcs( nullptr, &pSrc, String.size(), &MultiByteState ) ) > 0 )
+	else
 	{
-		Result.resize( Size );
-		mbsrtowcs( &Result[ 0 ], &pSrc, String.size(), &MultiByteState );
+		pDst[ 0 ] = static_cast< wchar_t >( CodePoint );
 	}
-#endif // !XY_OS_WINDOWS
 
-	return Result;
+} // xyWriteWide
 
-} // xyUnicode
+/*
+ * Transcodes UTF-8 into wide characters until either the source is exhausted or the destination is full.
+ * Both pointers are advanced past what was consumed and produced, so the conversion can be resumed with a new destination.
+ */
+inline void xyTranscodeUTF8ToWide( const char*& rpSrc, const char* pSrcEnd, wchar_t*& rpDst, wchar_t* pDstEnd )
+{
+	const uint8_t* pSrc = reinterpret_cast< const uint8_t* >( rpSrc );
+	const uint8_t* pEnd = reinterpret_cast< const uint8_t* >( pSrcEnd );
+	wchar_t*       pDst = rpDst;
 
-//////////////////////////////////////////////////////////////////////////
+	while( pSrc < pEnd )
+	{
 
-xyMessageResult xyMessageBox( std::string_view Title, std::string_view Message, xyMessageButtons Buttons )
-{
+#if defined( XY_SIMD_AVX2 )
 
-#if defined( XY_OS_WINDOWS )
+		// ASCII fast path, 32 characters at a time
+		while( ( pEnd - pSrc ) >= 32 && ( pDstEnd - pDst ) >= 32 )
+		{
+			const __m256i  Chunk    = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( pSrc ) );
+			const uint32_t NonASCII = static_cast< uint32_t >( _mm256_movemask_epi8( Chunk ) );
+
+			if( NonASCII )
+			{
+				for( int i = std::countr_zero( NonASCII ); i > 0; --i )
+					*pDst++ = *pSrc++;
+
+				break;
+			}
+
+			if constexpr( xyWideIsUTF16 )
+			{
+				_mm256_storeu_si256( reinterpret_cast< __m256i* >( pDst      ), _mm256_cvtepu8_epi16( _mm256_castsi256_si128( Chunk ) ) );
+				_mm256_storeu_si256( reinterpret_cast< __m256i* >( pDst + 16 ), _mm256_cvtepu8_epi16( _mm256_extracti128_si256( Chunk, 1 ) ) );
+			}
+			else
+			{
+				for( int i = 0; i < 32; i += 8 )
+					_mm256_storeu_si256( reinterpret_cast< __m256i* >( pDst + i ), _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast< const __m128i* >( pSrc + i ) ) ) );
+			}
+
+			pSrc += 32;
+			pDst += 32;
+		}
 
-	const UINT MessageType = [ Buttons ]
-	{
-		switch( Buttons )
+#elif defined( XY_SIMD_SSE2 ) // XY_SIMD_AVX2
+
+		// ASCII fast path, 16 characters at a time
+		while( ( pEnd - pSrc ) >= 16 && ( pDstEnd - pDst ) >= 16 )
 		{
-			default:
-			case xyMessageButtons::Ok:                     return MB_OK;
-			case xyMessageButtons::OkCancel:               return MB_OKCANCEL;
-			case xyMessageButtons::YesNo:                  return MB_YESNO;
-			case xyMessageButtons::YesNoCancel:            return MB_YESNOCANCEL;
-			case xyMessageButtons::AbortRetryIgnore:       return MB_ABORTRETRYIGNORE;
-			case xyMessageButtons::CancelTryagainContinue: return MB_CANCELTRYCONTINUE;
-			case xyMessageButtons::RetryCancel:            return MB_RETRYCANCEL;
+			const __m128i  Chunk    = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pSrc ) );
+			const uint32_t NonASCII = static_cast< uint32_t >( _mm_movemask_epi8( Chunk ) );
+
+			if( NonASCII )
+			{
+				for( int i = std::countr_zero( NonASCII ); i > 0; --i )
+					*pDst++ = *pSrc++;
+
+				break;
+			}
+
+			const __m128i Zero = _mm_setzero_si128();
+			const __m128i Low  = _mm_unpacklo_epi8( Chunk, Zero );
+			const __m128i High = _mm_unpackhi_epi8( Chunk, Zero );
+
+			if constexpr( xyWideIsUTF16 )
+			{
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( pDst     ), Low );
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( pDst + 8 ), High );
+			}
+			else
+			{
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( pDst      ), _mm_unpacklo_epi16( Low,  Zero ) );
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( pDst +  4 ), _mm_unpackhi_epi16( Low,  Zero ) );
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( pDst +  8 ), _mm_unpacklo_epi16( High, Zero ) );
+				_mm_storeu_si128( reinterpret_cast< __m128i* >( pDst + 12 ), _mm_unpackhi_epi16( High, Zero ) );
+			}
+
+			pSrc += 16;
+			pDst += 16;
 		}
-	}();
 
-	// The ANSI version of MessageBox doesn't support UTF-8 strings so we convert it into Unicode and use the Unicode version instead
-	const std::wstring UnicodeTitle   = xyUnicode( Title );
-	const std::wstring UnicodeMessage = xyUnicode( Message );
+#endif // XY_SIMD_SSE2
 
-	int Result;
-	if( !UnicodeMessage.empty() ) Result = MessageBoxW( NULL, UnicodeMessage.data(), UnicodeTitle.data(), MessageType | MB_ICONINFORMATION | MB_TASKMODAL );
-	else                          Result = MessageBoxA( NULL, Message       .data(), Title       .data(), MessageType | MB_ICONINFORMATION | MB_TASKMODAL );
+		// The fast path may have consumed everything that was left
+		if( pSrc == pEnd )
+			break;
 
-	switch( Result )
-	{
-		default:
-		case IDOK:       return xyMessageResult::Ok;
-		case IDCANCEL:   return xyMessageResult::Cancel;
-		case IDABORT:    return xyMessageResult::Abort;
-		case IDRETRY:    return xyMessageResult::Retry;
-		case IDIGNORE:   return xyMessageResult::Ignore;
-		case IDYES:      return xyMessageResult::Yes;
-		case IDNO:       return xyMessageResult::No;
-		case IDTRYAGAIN: return xyMessageResult::Tryagain;
-		case IDCONTINUE: return xyMessageResult::Continue;
+		// Scalar path. Keep going until the next ASCII character so that the fast path gets another chance.
+		do
+		{
+			if( *pSrc < 0x80 )
+			{
+				if( pDst == pDstEnd )
+					goto Done;
+
+				*pDst++ = *pSrc++;
+				continue;
+			}
+
+			const uint8_t* pNext     = pSrc;
+			const char32_t CodePoint = xyDecodeUTF8Sequence( pNext, pEnd );
+
+			const size_t   Units     = ( xyWideIsUTF16 && CodePoint >= 0x10000 ) ? 2 : 1;
+
+			if( ( pDstEnd - pDst ) < static_cast< ptrdiff_t >( Units ) )
+				goto Done;
+
+			xyWriteWide( CodePoint, pDst );
+			pDst += Units;
+			pSrc  = pNext;
+
+		} while( pSrc < pEnd && *pSrc >= 0x80 );
 	}
 
-#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+Done:
 
-	NSAlert*  pAlert           = [ [ NSAlert alloc ] init ];
-	NSString* pMessageText     = [ NSString stringWithUTF8String:Title.data() ];
-	NSString* pInformativeText = [ NSString stringWithUTF8String:Message.data() ];
+	rpSrc = reinterpret_cast< const char* >( pSrc );
+	rpDst = pDst;
 
-	[ pAlert setMessageText:pMessageText ];
-	[ pAlert setInformativeText:pInformativeText ];
-	[ pAlert setAlertStyle:NSAlertStyleInformational ];
+} // xyTranscodeUTF8ToWide
 
-	// Note: Trailing space in "Cancel " is intended
-	// NSAlert has special layouts for common titles (such as "Cancel") that we would like to avoid
-	switch( Buttons )
+/*
+ * Transcodes wide characters into UTF-8 until either the source is exhausted or the destination is full.
+ * Both pointers are advanced past what was consumed and produced, so the conversion can be resumed with a new destination.
+ */
+inline void xyTranscodeWideToUTF8( const wchar_t*& rpSrc, const wchar_t* pSrcEnd, char*& rpDst, char* pDstEnd )
+{
+	using WideUnit = std::make_unsigned_t< wchar_t >;
+
+	const wchar_t* pSrc = rpSrc;
+	char*          pDst = rpDst;
+
+	while( pSrc < pSrcEnd )
 	{
-		case xyMessageButtons::Ok:
-			[ pAlert addButtonWithTitle:@"OK" ].tag = ( NSInteger )xyMessageResult::Ok;
-		break;
 
-		case xyMessageButtons::OkCancel:
-			[ pAlert addButtonWithTitle:@"OK"     ].tag = ( NSInteger )xyMessageResult::Ok;
-			[ pAlert addButtonWithTitle:@"Cancel" ].tag = ( NSInteger )xyMessageResult::Cancel;
-		break;
+#if defined( XY_SIMD_AVX2 )
 
-		case xyMessageButtons::YesNo:
-			[ pAlert addButtonWithTitle:@"Yes" ].tag = ( NSInteger )xyMessageResult::Yes;
-			[ pAlert addButtonWithTitle:@"No"  ].tag = ( NSInteger )xyMessageResult::No;
-		break;
+		// ASCII fast path, 32 characters at a time
+		while( ( pSrcEnd - pSrc ) >= 32 && ( pDstEnd - pDst ) >= 32 )
+		{
+			__m256i Packed;
+
+			if constexpr( xyWideIsUTF16 )
+			{
+				const __m256i A = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( pSrc      ) );
+				const __m256i B = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( pSrc + 16 ) );
+
+				if( !_mm256_testz_si256( _mm256_or_si256( A, B ), _mm256_set1_epi16( static_cast< short >( 0xFF80 ) ) ) )
+					break;
+
+				// Packing works within 128-bit lanes, so the 64-bit halves have to be put back in order afterwards
+				Packed = _mm256_permute4x64_epi64( _mm256_packus_epi16( A, B ), 0xD8 );
+			}
+			else
+			{
+				const __m256i A = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( pSrc      ) );
+				const __m256i B = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( pSrc +  8 ) );
+				const __m256i C = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( pSrc + 16 ) );
+				const __m256i D = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( pSrc + 24 ) );
+
+				if( !_mm256_testz_si256( _mm256_or_si256( _mm256_or_si256( A, B ), _mm256_or_si256( C, D ) ), _mm256_set1_epi32( ~0x7F ) ) )
+					break;
+
+				// Packing works within 128-bit lanes, so the 32-bit groups have to be put back in order afterwards
+				Packed = _mm256_packus_epi16( _mm256_packs_epi32( A, B ), _mm256_packs_epi32( C, D ) );
+				Packed = _mm256_permutevar8x32_epi32( Packed, _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 ) );
+			}
+
+			_mm256_storeu_si256( reinterpret_cast< __m256i* >( pDst ), Packed );
+
+			pSrc += 32;
+			pDst += 32;
+		}
 
-		case xyMessageButtons::YesNoCancel:
-			[ pAlert addButtonWithTitle:@"Yes"     ].tag = ( NSInteger )xyMessageResult::Yes;
-			[ pAlert addButtonWithTitle:@"No"      ].tag = ( NSInteger )xyMessageResult::No;
-			[ pAlert addButtonWithTitle:@"Cancel " ].tag = ( NSInteger )xyMessageResult::Cancel;
-		break;
+#elif defined( XY_SIMD_SSE2 ) // XY_SIMD_AVX2
 
-		case xyMessageButtons::AbortRetryIgnore:
-			[ pAlert addButtonWithTitle:@"Abort"  ].tag = ( NSInteger )xyMessageResult::Abort;
-			[ pAlert addButtonWithTitle:@"Retry"  ].tag = ( NSInteger )xyMessageResult::Retry;
-			[ pAlert addButtonWithTitle:@"Ignore" ].tag = ( NSInteger )xyMessageResult::Ignore;
-		break;
+		// ASCII fast path, 16 characters at a time
+		while( ( pSrcEnd - pSrc ) >= 16 && ( pDstEnd - pDst ) >= 16 )
+		{
+			const __m128i Zero = _mm_setzero_si128();
+			__m128i       Packed;
+
+			if constexpr( xyWideIsUTF16 )
+			{
+				const __m128i A = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pSrc     ) );
+				const __m128i B = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pSrc + 8 ) );
+				const __m128i H = _mm_and_si128( _mm_or_si128( A, B ), _mm_set1_epi16( static_cast< short >( 0xFF80 ) ) );
+
+				if( _mm_movemask_epi8( _mm_cmpeq_epi16( H, Zero ) ) != 0xFFFF )
+					break;
+
+				Packed = _mm_packus_epi16( A, B );
+			}
+			else
+			{
+				const __m128i A = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pSrc      ) );
+				const __m128i B = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pSrc +  4 ) );
+				const __m128i C = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pSrc +  8 ) );
+				const __m128i D = _mm_loadu_si128( reinterpret_cast< const __m128i* >( pSrc + 12 ) );
+				const __m128i H = _mm_and_si128( _mm_or_si128( _mm_or_si128( A, B ), _mm_or_si128( C, D ) ), _mm_set1_epi32( ~0x7F ) );
+
+				if( _mm_movemask_epi8( _mm_cmpeq_epi32( H, Zero ) ) != 0xFFFF )
+					break;
+
+				Packed = _mm_packus_epi16( _mm_packs_epi32( A, B ), _mm_packs_epi32( C, D ) );
+			}
+
+			_mm_storeu_si128( reinterpret_cast< __m128i* >( pDst ), Packed );
+
+			pSrc += 16;
+			pDst += 16;
+		}
 
-		case xyMessageButtons::CancelTryagainContinue:
-			[ pAlert addButtonWithTitle:@"Cancel "   ].tag = ( NSInteger )xyMessageResult::Cancel;
-			[ pAlert addButtonWithTitle:@"Try Again" ].tag = ( NSInteger )xyMessageResult::Tryagain;
-			[ pAlert addButtonWithTitle:@"Continue"  ].tag = ( NSInteger )xyMessageResult::Continue;
-		break;
+#endif // XY_SIMD_SSE2
 
-		case xyMessageButtons::RetryCancel:
-			[ pAlert addButtonWithTitle:@"Retry"   ].tag = ( NSInteger )xyMessageResult::Retry;
-			[ pAlert addButtonWithTitle:@"Cancel " ].tag = ( NSInteger )xyMessageResult::Cancel;
-		break;
+		// The fast path may have consumed everything that was left
+		if( pSrc == pSrcEnd )
+			break;
+
+		// Scalar path. Keep going until the next ASCII character so that the fast path gets another chance.
+		do
+		{
+			char32_t CodePoint = static_cast< WideUnit >( *pSrc );
+			size_t   Consumed  = 1;
+
+			if constexpr( xyWideIsUTF16 )
+			{
+				if( CodePoint >= 0xD800 && CodePoint <= 0xDBFF && ( pSrcEnd - pSrc ) >= 2 )
+				{
+					const char32_t Low = static_cast< WideUnit >( pSrc[ 1 ] );
+
+					if( Low >= 0xDC00 && Low <= 0xDFFF )
+					{
+						CodePoint = 0x10000 + ( ( CodePoint - 0xD800 ) << 10 ) + ( Low - 0xDC00 );
+						Consumed  = 2;
+					}
+				}
+			}
+
+			if( ( CodePoint >= 0xD800 && CodePoint <= 0xDFFF ) || CodePoint > 0x10FFFF )
+				CodePoint = xyReplacementCharacter;
+
+			if( CodePoint < 0x80 )
+			{
+				if( pDst == pDstEnd )
+					goto Done;
+
+				*pDst++ = static_cast< char >( CodePoint );
+			}
+			else if( CodePoint < 0x800 )
+			{
+				if( ( pDstEnd - pDst ) < 2 )
+					goto Done;
+
+				*pDst++ = static_cast< char >( 0xC0 | ( CodePoint >> 6 ) );
+				*pDst++ = static_cast< char >( 0x80 | ( CodePoint & 0x3F ) );
+			}
+			else if( CodePoint < 0x10000 )
+			{
+				if( ( pDstEnd - pDst ) < 3 )
+					goto Done;
+
+				*pDst++ = static_cast< char >( 0xE0 | ( CodePoint >> 12 ) );
+				*pDst++ = static_cast< char >( 0x80 | ( ( CodePoint >> 6 ) & 0x3F ) );
+				*pDst++ = static_cast< char >( 0x80 | ( CodePoint & 0x3F ) );
+			}
+			else
+			{
+				if( ( pDstEnd - pDst ) < 4 )
+					goto Done;
+
+				*pDst++ = static_cast< char >( 0xF0 | ( CodePoint >> 18 ) );
+				*pDst++ = static_cast< char >( 0x80 | ( ( CodePoint >> 12 ) & 0x3F ) );
+				*pDst++ = static_cast< char >( 0x80 | ( ( CodePoint >> 6 ) & 0x3F ) );
+				*pDst++ = static_cast< char >( 0x80 | ( CodePoint & 0x3F ) );
+			}
+
+			pSrc += Consumed;
+
+		} while( pSrc < pSrcEnd && static_cast< WideUnit >( *pSrc ) >= 0x80 );
 	}
 
-	xyMessageResult Result = ( xyMessageResult )[ pAlert runModal ];
+Done:
 
-	[ pInformativeText release ];
-	[ pMessageText release ];
-	[ pAlert release ];
+	rpSrc = pSrc;
+	rpDst = pDst;
 
-	return Result;
+} // xyTranscodeWideToUTF8
 
-#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+/*
+ * Appends UTF-8 to a string. The string starts out with room for pure ASCII and only grows by the worst case of what remains.
+ */
+inline void xyAppendUTF8( std::wstring_view String, std::string& rOutput )
+{
+	const wchar_t* pSrc    = String.data();
+	const wchar_t* pSrcEnd = pSrc + String.size();
+	size_t         Size    = rOutput.size();
 
-	jobject Spinner = xyRunOnJavaThread( []( std::string Title, std::string Message, int Buttons )
+	rOutput.resize( Size + String.size() );
+
+	while( true )
 	{
-		xyContext& rContext = xyGetContext();
-		JNIEnv*    pJNI     = rContext.pPlatformImpl->pNativeActivity->env;
+		char* pDst = rOutput.data() + Size;
+		xyTranscodeWideToUTF8( pSrc, pSrcEnd, pDst, rOutput.data() + rOutput.size() );
+		Size = pDst - rOutput.data();
 
-		// Easy way to tidy up all our local references when we're done
-		pJNI->PushLocalFrame( 16 );
+		if( pSrc == pSrcEnd )
+			break;
 
-		// Obtain all necessary classes and method IDs
-		jclass    ClassBuilder            = pJNI->FindClass( "android/app/AlertDialog$Builder" );
-		jmethodID CtorBuilder             = pJNI->GetMethodID( ClassBuilder, "<init>", "(Landroid/content/Context;)V" );
-		jmethodID MethodSetTitle          = pJNI->GetMethodID( ClassBuilder, "setTitle", "(Ljava/lang/CharSequence;)Landroid/app/AlertDialog$Builder;" );
-		jmethodID MethodSetMessage        = pJNI->GetMethodID( ClassBuilder, "setMessage", "(Ljava/lang/CharSequence;)Landroid/app/AlertDialog$Builder;" );
-		jmethodID MethodSetNeutralButton  = pJNI->GetMethodID( ClassBuilder, "setNeutralButton", "(Ljava/lang/CharSequence;Landroid/content/DialogInterface$OnClickListener;)Landroid/app/AlertDialog$Builder;" );
-		jmethodID MethodSetNegativeButton = pJNI->GetMethodID( ClassBuilder, "setNegativeButton", "(Ljava/lang/CharSequence;Landroid/content/DialogInterface$OnClickListener;)Landroid/app/AlertDialog$Builder;" );
-		jmethodID MethodSetPositiveButton = pJNI->GetMethodID( ClassBuilder, "setPositiveButton", "(Ljava/lang/CharSequence;Landroid/content/DialogInterface$OnClickListener;)Landroid/app/AlertDialog$Builder;" );
-		jmethodID MethodSetCancelable     = pJNI->GetMethodID( ClassBuilder, "setCancelable", "(Z)Landroid/app/AlertDialog$Builder;" );
-		jmethodID MethodShow              = pJNI->GetMethodID( ClassBuilder, "show", "()Landroid/app/AlertDialog;" );
+		rOutput.resize( Size + ( pSrcEnd - pSrc ) * xyMaxUTF8PerWide );
+	}
 
-		// Create a dummy spinner that will keep track of which button was clicked.
-		// This is done because we need a built-in class that implements DialogInterface.OnClickListener and has an easy way to query which button was clicked
-		jclass    ClassSpinner           = pJNI->FindClass( "android/widget/Spinner" );
-		jmethodID CtorSpinner            = pJNI->GetMethodID( ClassSpinner, "<init>", "(Landroid/content/Context;)V" );
-		jmethodID MethodSetSelection     = pJNI->GetMethodID( ClassSpinner, "setSelection", "(I)V" );
-		jobject   Spinner                = pJNI->NewObject( ClassSpinner, CtorSpinner, rContext.pPlatformImpl->pNativeActivity->clazz );
-		Spinner                          = pJNI->NewGlobalRef( Spinner );
-		pJNI->CallVoidMethod( Spinner, MethodSetSelection, 0 );
+	rOutput.resize( Size );
 
-		// Create the alert dialog
-		jobject Builder = pJNI->NewObject( ClassBuilder, CtorBuilder, rContext.pPlatformImpl->pNativeActivity->clazz );
-		pJNI->CallObjectMethod( Builder, MethodSetTitle, pJNI->NewStringUTF( Title.data() ) );
-		pJNI->CallObjectMethod( Builder, MethodSetMessage, pJNI->NewStringUTF( Message.data() ) );
-		pJNI->CallObjectMethod( Builder, MethodSetCancelable, false );
+} // xyAppendUTF8
 
-		switch( ( xyMessageButtons )Buttons )
-		{
-			case xyMessageButtons::Ok:
-				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "OK" ), Spinner );
-			break;
+/*
+ * Appends Unicode to a string. Every byte of UTF-8 produces at most one wide character, so a single pass is always enough.
+ */
+inline void xyAppendWide( std::string_view String, std::wstring& rOutput )
+{
+	const size_t OldSize = rOutput.size();
+	const char*  pSrc    = String.data();
 
-			case xyMessageButtons::OkCancel:
-				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "OK" ),     Spinner );
-				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "Cancel" ), Spinner );
-			break;
+	rOutput.resize( OldSize + String.size() );
 
-			case xyMessageButtons::YesNo:
-				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "Yes" ),  Spinner );
-				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "No" ),   Spinner );
+	wchar_t* pDst = rOutput.data() + OldSize;
+	xyTranscodeUTF8ToWide( pSrc, String.data() + String.size(), pDst, rOutput.data() + rOutput.size() );
+	rOutput.resize( pDst - rOutput.data() );
+
+} // xyAppendWide
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Functions
+
+xyContext& xyGetContext( void )
+{
+	static xyContext Context;
+
+	return Context;
+
+} // xyGetContext
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyAppendJSONString( std::string& rOut, std::string_view Text )
+{
+	rOut += '"';
+
+	for( const char Character : Text )
+	{
+		if( Character == '"' || Character == '\\' ) { rOut += '\\'; rOut += Character; }
+		else if( static_cast< unsigned char >( Character ) >= 0x20 ) { rOut += Character; }
+	}
+
+	rOut += '"';
+
+} // xyAppendJSONString
+
+//////////////////////////////////////////////////////////////////////////
+
+xyStartupTimeline::xyStartupTimeline( void )
+	: Origin( Clock::now() )
+{
+} // xyStartupTimeline
+
+//////////////////////////////////////////////////////////////////////////
+
+xyStartupTimeline::~xyStartupTimeline( void )
+{
+	if( const char* pPath = getenv( "XY_STARTUP_TRACE" ); pPath && *pPath )
+		WriteChromeTrace( pPath );
+
+} // ~xyStartupTimeline
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyStartupTimeline::BeginPhase( std::string_view Name )
+{
+	const Clock::time_point Now         = Clock::now();
+	const uint32_t          ThreadIndex = GetThreadIndex();
+
+	std::scoped_lock Lock( Mutex );
+
+	if( PhaseOpen )
+	{
+		for( auto It = Events.rbegin(); It != Events.rend(); ++It )
+		{
+			if( It->IsPhase )
+			{
+				It->End = Now;
+				break;
+			}
+		}
+	}
+
+	Events.push_back( { .Name=std::string( Name ), .Begin=Now, .End=Now, .ThreadIndex=ThreadIndex, .IsPhase=true } );
+	PhaseOpen = true;
+
+} // BeginPhase
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyStartupTimeline::EndPhase( void )
+{
+	const Clock::time_point Now = Clock::now();
+
+	std::scoped_lock Lock( Mutex );
+
+	if( !PhaseOpen )
+		return;
+
+	for( auto It = Events.rbegin(); It != Events.rend(); ++It )
+	{
+		if( It->IsPhase )
+		{
+			It->End = Now;
 			break;
+		}
+	}
+
+	PhaseOpen = false;
+
+} // EndPhase
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyStartupTimeline::Mark( std::string_view Name )
+{
+	const Clock::time_point Now         = Clock::now();
+	const uint32_t          ThreadIndex = GetThreadIndex();
+
+	std::scoped_lock Lock( Mutex );
+
+	Events.push_back( { .Name=std::string( Name ), .Begin=Now, .End=Now, .ThreadIndex=ThreadIndex, .IsPhase=false } );
+
+} // Mark
+
+//////////////////////////////////////////////////////////////////////////
+
+std::vector< xyStartupTimeline::Event > xyStartupTimeline::GetEvents( void ) const
+{
+	std::scoped_lock Lock( Mutex );
+
+	return Events;
+
+} // GetEvents
+
+//////////////////////////////////////////////////////////////////////////
+
+std::string xyStartupTimeline::ToChromeTrace( void ) const
+{
+	const std::vector< Event > Snapshot = GetEvents();
+	std::string                Trace    = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+	auto Microseconds = [ this ]( Clock::time_point Time )
+	{
+		return std::chrono::duration< double, std::micro >( Time - Origin ).count();
+	};
+
+	for( const Event& rEvent : Snapshot )
+	{
+		char Buffer[ 192 ];
+		if( rEvent.IsPhase ) snprintf( Buffer, sizeof( Buffer ), ",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u},", Microseconds( rEvent.Begin ), Microseconds( rEvent.End ) - Microseconds( rEvent.Begin ), rEvent.ThreadIndex );
+		else                 snprintf( Buffer, sizeof( Buffer ), ",\"cat\":\"mark\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%.3f,\"pid\":1,\"tid\":%u},", Microseconds( rEvent.Begin ), rEvent.ThreadIndex );
+
+		Trace += "{\"name\":";
+		xyAppendJSONString( Trace, rEvent.Name );
+		Trace += Buffer;
+	}
+
+	if( Trace.back() == ',' )
+		Trace.pop_back();
+
+	Trace += "]}\n";
+
+	return Trace;
+
+} // ToChromeTrace
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xyStartupTimeline::WriteChromeTrace( const std::string& rPath ) const
+{
+	const std::string Trace = ToChromeTrace();
+
+	FILE* pFile = fopen( rPath.c_str(), "wb" );
+	if( !pFile )
+		return false;
+
+	const bool Written = fwrite( Trace.data(), 1, Trace.size(), pFile ) == Trace.size();
+
+	return ( fclose( pFile ) == 0 ) && Written;
+
+} // WriteChromeTrace
+
+//////////////////////////////////////////////////////////////////////////
+
+uint32_t xyStartupTimeline::GetThreadIndex( void )
+{
+	static std::atomic< uint32_t > NextIndex = 0;
+	thread_local uint32_t          Index     = NextIndex++;
+
+	return Index;
+
+} // GetThreadIndex
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyCompletion::Signal( void )
+{
+	State.store( 1, std::memory_order_release );
+
+#if defined( XY_OS_LINUX ) || defined( XY_OS_ANDROID )
+	// The waiter may return and release this object as soon as it observes the store above.
+	// A futex wake only uses the address as a key, so unlike notify_all() it never touches the object itself.
+	syscall( SYS_futex, &State, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0 );
+#else // XY_OS_LINUX || XY_OS_ANDROID
+	State.notify_all();
+#endif // !XY_OS_LINUX && !XY_OS_ANDROID
+
+} // Signal
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyCompletion::Wait( void )
+{
+	// Short jobs often finish within a few microseconds, which is cheaper to spin through than to sleep through
+	for( int i = 0; i < 64; ++i )
+	{
+		if( IsSignaled() )
+			return;
+
+		std::this_thread::yield();
+	}
+
+	while( !IsSignaled() )
+	{
+
+#if defined( XY_OS_LINUX ) || defined( XY_OS_ANDROID )
+		syscall( SYS_futex, &State, FUTEX_WAIT_PRIVATE, 0, nullptr, nullptr, 0 );
+#else // XY_OS_LINUX || XY_OS_ANDROID
+		State.wait( 0, std::memory_order_acquire );
+#endif // !XY_OS_LINUX && !XY_OS_ANDROID
+
+	}
+
+} // Wait
+
+//////////////////////////////////////////////////////////////////////////
+
+std::string xyUTF( std::wstring_view String )
+{
+	std::string UTFString;
+	xyUTF( String, UTFString );
+
+	return UTFString;
+
+} // xyUTF
+
+//////////////////////////////////////////////////////////////////////////
+
+std::wstring xyUnicode( std::string_view String )
+{
+	std::wstring Result;
+	xyUnicode( String, Result );
+
+	return Result;
+
+} // xyUnicode
+
+//////////////////////////////////////////////////////////////////////////
+
+xyTranscodeResult xyUTF( std::wstring_view String, std::span< char > Buffer )
+{
+	const wchar_t* pSrc = String.data();
+	char*          pDst = Buffer.data();
+	xyTranscodeWideToUTF8( pSrc, String.data() + String.size(), pDst, Buffer.data() + Buffer.size() );
+
+	return { .Read=static_cast< size_t >( pSrc - String.data() ), .Written=static_cast< size_t >( pDst - Buffer.data() ) };
+
+} // xyUTF
+
+//////////////////////////////////////////////////////////////////////////
+
+xyTranscodeResult xyUnicode( std::string_view String, std::span< wchar_t > Buffer )
+{
+	const char* pSrc = String.data();
+	wchar_t*    pDst = Buffer.data();
+	xyTranscodeUTF8ToWide( pSrc, String.data() + String.size(), pDst, Buffer.data() + Buffer.size() );
+
+	return { .Read=static_cast< size_t >( pSrc - String.data() ), .Written=static_cast< size_t >( pDst - Buffer.data() ) };
+
+} // xyUnicode
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t xyUTF( std::wstring_view String, std::string& rOutput )
+{
+	rOutput.clear();
+	xyAppendUTF8( String, rOutput );
+
+	return rOutput.size();
+
+} // xyUTF
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t xyUnicode( std::string_view String, std::wstring& rOutput )
+{
+	rOutput.clear();
+	xyAppendWide( String, rOutput );
+
+	return rOutput.size();
+
+} // xyUnicode
+
+//////////////////////////////////////////////////////////////////////////
+
+xyTranscodeResult xyUTF8Decoder::Convert( std::string_view Chunk, std::span< wchar_t > Buffer )
+{
+	xyTranscodeResult Result;
+
+	// Finish the sequence that was split by the previous chunk
+	if( PendingSize > 0 )
+	{
+		uint8_t Sequence[ 4 ];
+		size_t  SequenceSize = PendingSize;
+		std::memcpy( Sequence, Pending, PendingSize );
+
+		while( SequenceSize < std::size( Sequence ) && Result.Read < Chunk.size() )
+			Sequence[ SequenceSize++ ] = static_cast< uint8_t >( Chunk[ Result.Read++ ] );
+
+		// Still incomplete. Hold on to everything until the next chunk.
+		if( xyIncompleteUTF8Tail( Sequence, SequenceSize ) == SequenceSize )
+		{
+			std::memcpy( Pending, Sequence, SequenceSize );
+			PendingSize = SequenceSize;
+			return Result;
+		}
+
+		const uint8_t* pSequence = Sequence;
+		const char32_t CodePoint = xyDecodeUTF8Sequence( pSequence, Sequence + SequenceSize );
+		const size_t   Units     = ( xyWideIsUTF16 && CodePoint >= 0x10000 ) ? 2 : 1;
+
+		if( Buffer.size() < Units )
+			return { };
+
+		xyWriteWide( CodePoint, Buffer.data() );
+
+		// The decoded sequence may have been shorter than what was borrowed from the chunk
+		Result.Read    = ( pSequence - Sequence ) - PendingSize;
+		Result.Written = Units;
+		PendingSize    = 0;
+	}
+
+	const std::string_view Rest = Chunk.substr( Result.Read );
+	const size_t           Tail = xyIncompleteUTF8Tail( reinterpret_cast< const uint8_t* >( Rest.data() ), Rest.size() );
+	const char*            pSrc = Rest.data();
+	wchar_t*               pDst = Buffer.data() + Result.Written;
+	xyTranscodeUTF8ToWide( pSrc, Rest.data() + Rest.size() - Tail, pDst, Buffer.data() + Buffer.size() );
+
+	Result.Read   += pSrc - Rest.data();
+	Result.Written = pDst - Buffer.data();
+
+	// Only keep the incomplete tail if everything before it made it into the buffer
+	if( Tail > 0 && pSrc == Rest.data() + Rest.size() - Tail )
+	{
+		std::memcpy( Pending, pSrc, Tail );
+		PendingSize  = Tail;
+		Result.Read += Tail;
+	}
+
+	return Result;
+
+} // Convert
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t xyUTF8Decoder::Convert( std::string_view Chunk, std::wstring& rOutput )
+{
+	const size_t OldSize = rOutput.size();
+
+	// A chunk never produces more characters than it has bytes, plus one for the pending sequence
+	rOutput.resize( OldSize + Chunk.size() + 1 );
+
+	const xyTranscodeResult Result = Convert( Chunk, std::span< wchar_t >( rOutput.data() + OldSize, Chunk.size() + 1 ) );
+	rOutput.resize( OldSize + Result.Written );
+
+	return Result.Written;
+
+} // Convert
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t xyUTF8Decoder::Finish( std::wstring& rOutput )
+{
+	if( PendingSize == 0 )
+		return 0;
+
+	// The stream ended in the middle of a sequence
+	rOutput.push_back( static_cast< wchar_t >( xyReplacementCharacter ) );
+	PendingSize = 0;
+
+	return 1;
+
+} // Finish
+
+//////////////////////////////////////////////////////////////////////////
+
+xyTranscodeResult xyUTF8Encoder::Convert( std::wstring_view Chunk, std::span< char > Buffer )
+{
+	xyTranscodeResult Result;
+
+	// Finish the surrogate pair that was split by the previous chunk
+	if( PendingSize > 0 )
+	{
+		if( Chunk.empty() )
+			return Result;
+
+		// A high surrogate followed by anything but a low surrogate gets replaced on its own
+		const bool     Paired    = ( Chunk[ 0 ] >= 0xDC00 && Chunk[ 0 ] <= 0xDFFF );
+		const wchar_t  Pair[ 2 ] = { Pending, Chunk[ 0 ] };
+		const wchar_t* pSrc      = Pair;
+		char*          pDst      = Buffer.data();
+		xyTranscodeWideToUTF8( pSrc, Pair + ( Paired ? 2 : 1 ), pDst, Buffer.data() + Buffer.size() );
+
+		if( pSrc == Pair )
+			return Result;
+
+		Result.Read    = Paired ? 1 : 0;
+		Result.Written = pDst - Buffer.data();
+		PendingSize    = 0;
+	}
+
+	const std::wstring_view Rest = Chunk.substr( Result.Read );
+	const size_t            Tail = ( xyWideIsUTF16 && !Rest.empty() && Rest.back() >= 0xD800 && Rest.back() <= 0xDBFF ) ? 1 : 0;
+	const wchar_t*          pSrc = Rest.data();
+	char*                   pDst = Buffer.data() + Result.Written;
+	xyTranscodeWideToUTF8( pSrc, Rest.data() + Rest.size() - Tail, pDst, Buffer.data() + Buffer.size() );
+
+	Result.Read   += pSrc - Rest.data();
+	Result.Written = pDst - Buffer.data();
+
+	// Only keep the high surrogate if everything before it made it into the buffer
+	if( Tail > 0 && pSrc == Rest.data() + Rest.size() - Tail )
+	{
+		Pending      = *pSrc;
+		PendingSize  = 1;
+		Result.Read += 1;
+	}
+
+	return Result;
+
+} // Convert
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t xyUTF8Encoder::Convert( std::wstring_view Chunk, std::string& rOutput )
+{
+	const size_t OldSize = rOutput.size();
+	const size_t MaxSize = ( Chunk.size() + PendingSize ) * xyMaxUTF8PerWide + 1;
+
+	rOutput.resize( OldSize + MaxSize );
+
+	const xyTranscodeResult Result = Convert( Chunk, std::span< char >( rOutput.data() + OldSize, MaxSize ) );
+	rOutput.resize( OldSize + Result.Written );
+
+	return Result.Written;
+
+} // Convert
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t xyUTF8Encoder::Finish( std::string& rOutput )
+{
+	if( PendingSize == 0 )
+		return 0;
+
+	// The stream ended with an unpaired high surrogate
+	rOutput.append( "\xEF\xBF\xBD" );
+	PendingSize = 0;
+
+	return 3;
+
+} // Finish
+
+//////////////////////////////////////////////////////////////////////////
+
+xyMessageResult xyMessageBox( std::string_view Title, std::string_view Message, xyMessageButtons Buttons )
+{
+	XY_STAT_SCOPE( MessageBox );
+	XY_TRACE_SCOPE( "xyMessageBox" );
+
+#if defined( XY_OS_WINDOWS )
+
+	const UINT MessageType = [ Buttons ]
+	{
+		switch( Buttons )
+		{
+			default:
+			case xyMessageButtons::Ok:                     return MB_OK;
+			case xyMessageButtons::OkCancel:               return MB_OKCANCEL;
+			case xyMessageButtons::YesNo:                  return MB_YESNO;
+			case xyMessageButtons::YesNoCancel:            return MB_YESNOCANCEL;
+			case xyMessageButtons::AbortRetryIgnore:       return MB_ABORTRETRYIGNORE;
+			case xyMessageButtons::CancelTryagainContinue: return MB_CANCELTRYCONTINUE;
+			case xyMessageButtons::RetryCancel:            return MB_RETRYCANCEL;
+		}
+	}();
+
+	// The ANSI version of MessageBox doesn't support UTF-8 strings so we convert it into Unicode and use the Unicode version instead
+	const std::wstring UnicodeTitle   = xyUnicode( Title );
+	const std::wstring UnicodeMessage = xyUnicode( Message );
+
+	int Result;
+	if( !UnicodeMessage.empty() ) Result = MessageBoxW( NULL, UnicodeMessage.data(), UnicodeTitle.data(), MessageType | MB_ICONINFORMATION | MB_TASKMODAL );
+	else                          Result = MessageBoxA( NULL, Message       .data(), Title       .data(), MessageType | MB_ICONINFORMATION | MB_TASKMODAL );
+
+	switch( Result )
+	{
+		default:
+		case IDOK:       return xyMessageResult::Ok;
+		case IDCANCEL:   return xyMessageResult::Cancel;
+		case IDABORT:    return xyMessageResult::Abort;
+		case IDRETRY:    return xyMessageResult::Retry;
+		case IDIGNORE:   return xyMessageResult::Ignore;
+		case IDYES:      return xyMessageResult::Yes;
+		case IDNO:       return xyMessageResult::No;
+		case IDTRYAGAIN: return xyMessageResult::Tryagain;
+		case IDCONTINUE: return xyMessageResult::Continue;
+	}
+
+#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+
+	NSAlert*  pAlert           = [ [ NSAlert alloc ] init ];
+	NSString* pMessageText     = [ NSString stringWithUTF8String:Title.data() ];
+	NSString* pInformativeText = [ NSString stringWithUTF8String:Message.data() ];
+
+	[ pAlert setMessageText:pMessageText ];
+	[ pAlert setInformativeText:pInformativeText ];
+	[ pAlert setAlertStyle:NSAlertStyleInformational ];
+
+	// Note: Trailing space in "Cancel " is intended
+	// NSAlert has special layouts for common titles (such as "Cancel") that we would like to avoid
+	switch( Buttons )
+	{
+		case xyMessageButtons::Ok:
+			[ pAlert addButtonWithTitle:@"OK" ].tag = ( NSInteger )xyMessageResult::Ok;
+		break;
+
+		case xyMessageButtons::OkCancel:
+			[ pAlert addButtonWithTitle:@"OK"     ].tag = ( NSInteger )xyMessageResult::Ok;
+			[ pAlert addButtonWithTitle:@"Cancel" ].tag = ( NSInteger )xyMessageResult::Cancel;
+		break;
+
+		case xyMessageButtons::YesNo:
+			[ pAlert addButtonWithTitle:@"Yes" ].tag = ( NSInteger )xyMessageResult::Yes;
+			[ pAlert addButtonWithTitle:@"No"  ].tag = ( NSInteger )xyMessageResult::No;
+		break;
+
+		case xyMessageButtons::YesNoCancel:
+			[ pAlert addButtonWithTitle:@"Yes"     ].tag = ( NSInteger )xyMessageResult::Yes;
+			[ pAlert addButtonWithTitle:@"No"      ].tag = ( NSInteger )xyMessageResult::No;
+			[ pAlert addButtonWithTitle:@"Cancel " ].tag = ( NSInteger )xyMessageResult::Cancel;
+		break;
+
+		case xyMessageButtons::AbortRetryIgnore:
+			[ pAlert addButtonWithTitle:@"Abort"  ].tag = ( NSInteger )xyMessageResult::Abort;
+			[ pAlert addButtonWithTitle:@"Retry"  ].tag = ( NSInteger )xyMessageResult::Retry;
+			[ pAlert addButtonWithTitle:@"Ignore" ].tag = ( NSInteger )xyMessageResult::Ignore;
+		break;
+
+		case xyMessageButtons::CancelTryagainContinue:
+			[ pAlert addButtonWithTitle:@"Cancel "   ].tag = ( NSInteger )xyMessageResult::Cancel;
+			[ pAlert addButtonWithTitle:@"Try Again" ].tag = ( NSInteger )xyMessageResult::Tryagain;
+			[ pAlert addButtonWithTitle:@"Continue"  ].tag = ( NSInteger )xyMessageResult::Continue;
+		break;
+
+		case xyMessageButtons::RetryCancel:
+			[ pAlert addButtonWithTitle:@"Retry"   ].tag = ( NSInteger )xyMessageResult::Retry;
+			[ pAlert addButtonWithTitle:@"Cancel " ].tag = ( NSInteger )xyMessageResult::Cancel;
+		break;
+	}
+
+	xyMessageResult Result = ( xyMessageResult )[ pAlert runModal ];
+
+	[ pInformativeText release ];
+	[ pMessageText release ];
+	[ pAlert release ];
+
+	return Result;
+
+#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+
+	jobject Spinner = xyRunOnJavaThread( []( std::string Title, std::string Message, int Buttons )
+	{
+		xyContext& rContext = xyGetContext();
+		JNIEnv*    pJNI     = rContext.pPlatformImpl->pNativeActivity->env;
+
+		// Easy way to tidy up all our local references when we're done
+		pJNI->PushLocalFrame( 16 );
+
+		// Obtain all necessary classes and method IDs
+		jclass    ClassBuilder            = pJNI->FindClass( "android/app/AlertDialog$Builder" );
+		jmethodID CtorBuilder             = pJNI->GetMethodID( ClassBuilder, "<init>", "(Landroid/content/Context;)V" );
+		jmethodID MethodSetTitle          = pJNI->GetMethodID( ClassBuilder, "setTitle", "(Ljava/lang/CharSequence;)Landroid/app/AlertDialog$Builder;" );
+		jmethodID MethodSetMessage        = pJNI->GetMethodID( ClassBuilder, "setMessage", "(Ljava/lang/CharSequence;)Landroid/app/AlertDialog$Builder;" );
+		jmethodID MethodSetNeutralButton  = pJNI->GetMethodID( ClassBuilder, "setNeutralButton", "(Ljava/lang/CharSequence;Landroid/content/DialogInterface$OnClickListener;)Landroid/app/AlertDialog$Builder;" );
+		jmethodID MethodSetNegativeButton = pJNI->GetMethodID( ClassBuilder, "setNegativeButton", "(Ljava/lang/CharSequence;Landroid/content/DialogInterface$OnClickListener;)Landroid/app/AlertDialog$Builder;" );
+		jmethodID MethodSetPositiveButton = pJNI->GetMethodID( ClassBuilder, "setPositiveButton", "(Ljava/lang/CharSequence;Landroid/content/DialogInterface$OnClickListener;)Landroid/app/AlertDialog$Builder;" );
+		jmethodID MethodSetCancelable     = pJNI->GetMethodID( ClassBuilder, "setCancelable", "(Z)Landroid/app/AlertDialog$Builder;" );
+		jmethodID MethodShow              = pJNI->GetMethodID( ClassBuilder, "show", "()Landroid/app/AlertDialog;" );
+
+		// Create a dummy spinner that will keep track of which button was clicked.
+		// This is done because we need a built-in class that implements DialogInterface.OnClickListener and has an easy way to query which button was clicked
+		jclass    ClassSpinner           = pJNI->FindClass( "android/widget/Spinner" );
+		jmethodID CtorSpinner            = pJNI->GetMethodID( ClassSpinner, "<init>", "(Landroid/content/Context;)V" );
+		jmethodID MethodSetSelection     = pJNI->GetMethodID( ClassSpinner, "setSelection", "(I)V" );
+		jobject   Spinner                = pJNI->NewObject( ClassSpinner, CtorSpinner, rContext.pPlatformImpl->pNativeActivity->clazz );
+		Spinner                          = pJNI->NewGlobalRef( Spinner );
+		pJNI->CallVoidMethod( Spinner, MethodSetSelection, 0 );
+
+		// Create the alert dialog
+		jobject Builder = pJNI->NewObject( ClassBuilder, CtorBuilder, rContext.pPlatformImpl->pNativeActivity->clazz );
+		pJNI->CallObjectMethod( Builder, MethodSetTitle, pJNI->NewStringUTF( Title.data() ) );
+		pJNI->CallObjectMethod( Builder, MethodSetMessage, pJNI->NewStringUTF( Message.data() ) );
+		pJNI->CallObjectMethod( Builder, MethodSetCancelable, false );
+
+		switch( ( xyMessageButtons )Buttons )
+		{
+			case xyMessageButtons::Ok:
+				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "OK" ), Spinner );
+			break;
+
+			case xyMessageButtons::OkCancel:
+				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "OK" ),     Spinner );
+				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "Cancel" ), Spinner );
+			break;
+
+			case xyMessageButtons::YesNo:
+				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "Yes" ),  Spinner );
+				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "No" ),   Spinner );
+			break;
+
+			case xyMessageButtons::YesNoCancel:
+				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "Yes" ),    Spinner );
+				pJNI->CallObjectMethod( Builder, MethodSetNegativeButton, pJNI->NewStringUTF( "No" ),     Spinner );
+				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "Cancel" ), Spinner );
+			break;
+
+			case xyMessageButtons::AbortRetryIgnore:
+				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "Abort" ),  Spinner );
+				pJNI->CallObjectMethod( Builder, MethodSetNegativeButton, pJNI->NewStringUTF( "Retry" ),  Spinner );
+				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "Ignore" ), Spinner );
+			break;
+
+			case xyMessageButtons::CancelTryagainContinue:
+				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "Cancel" ),    Spinner );
+				pJNI->CallObjectMethod( Builder, MethodSetNegativeButton, pJNI->NewStringUTF( "Try Again" ), Spinner );
+				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "Continue" ),  Spinner );
+			break;
+
+			case xyMessageButtons::RetryCancel:
+				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "Retry" ),  Spinner );
+				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "Cancel" ), Spinner );
+			break;
+		}
+
+		// Show the alert
+		pJNI->CallObjectMethod( Builder, MethodShow );
+
+		pJNI->PopLocalFrame( nullptr );
+
+		return Spinner;
+
+	}, std::string( Title ), std::string( Message ), ( int )Buttons );
+
+	xyContext& rContext = xyGetContext();
+	JavaVM*    pJVM     = rContext.pPlatformImpl->pNativeActivity->vm;
+	JNIEnv*    pJNI;
+	pJVM->AttachCurrentThread( &pJNI, nullptr );
+
+	// Sleep until the alert is closed
+	jclass    ClassSpinner                  = pJNI->GetObjectClass( Spinner );
+	jmethodID MethodGetSelectedItemPosition = pJNI->GetMethodID( ClassSpinner, "getSelectedItemPosition", "()I" );
+	int       Result;
+	while( ( Result = pJNI->CallIntMethod( Spinner, MethodGetSelectedItemPosition ) ) == 0 )
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+
+	pJNI->DeleteGlobalRef( Spinner );
+
+	pJVM->DetachCurrentThread();
+
+	std::array< xyMessageResult, 3 > ResultTable;
+	switch( Buttons )
+	{
+		default:
+		case xyMessageButtons::Ok:                     ResultTable = { xyMessageResult::Ok,       { },                       { }                     }; break;
+		case xyMessageButtons::OkCancel:               ResultTable = { xyMessageResult::Cancel,   { },                       xyMessageResult::Ok     }; break;
+		case xyMessageButtons::YesNo:                  ResultTable = { xyMessageResult::No,       { },                       xyMessageResult::Yes    }; break;
+		case xyMessageButtons::YesNoCancel:            ResultTable = { xyMessageResult::Cancel,   xyMessageResult::No,       xyMessageResult::Yes    }; break;
+		case xyMessageButtons::AbortRetryIgnore:       ResultTable = { xyMessageResult::Ignore,   xyMessageResult::Retry,    xyMessageResult::Abort  }; break;
+		case xyMessageButtons::CancelTryagainContinue: ResultTable = { xyMessageResult::Continue, xyMessageResult::Tryagain, xyMessageResult::Cancel }; break;
+		case xyMessageButtons::RetryCancel:            ResultTable = { xyMessageResult::Cancel,   { },                       xyMessageResult::Retry  }; break;
+	}
+
+	// Results ranges from -1 to -3
+	return ResultTable[ -( Result + 1 ) ];
+
+#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
+
+	__block int Result = -1;
+
+	dispatch_async_and_wait( dispatch_get_main_queue(), ^
+	{
+		UIApplication*     pApplication     = [ UIApplication sharedApplication ];
+		UIScene*           pScene           = [ [ [ pApplication connectedScenes ] allObjects ] firstObject ];
+		UIViewController*  pViewController  = [ [ [ ( UIWindowScene* )pScene windows ] firstObject ] rootViewController ];
+		NSString*          pTitle           = [ NSString stringWithUTF8String:Title.data() ];
+		NSString*          pMessage         = [ NSString stringWithUTF8String:Message.data() ];
+		UIAlertController* pAlertController = [ UIAlertController alertControllerWithTitle:pTitle message:pMessage preferredStyle:UIAlertControllerStyleAlert ];
+
+		switch( Buttons )
+		{
+			case xyMessageButtons::Ok:
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"OK" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Ok; } ] ];
+			break;
+
+			case xyMessageButtons::OkCancel:
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"OK"     style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Ok;     } ] ];
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Cancel" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Cancel; } ] ];
+			break;
+
+			case xyMessageButtons::YesNo:
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Yes" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Yes; } ] ];
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"No"  style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::No;  } ] ];
+			break;
+
+			case xyMessageButtons::YesNoCancel:
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Yes"    style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Yes;    } ] ];
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"No"     style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::No;     } ] ];
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Cancel" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Cancel; } ] ];
+			break;
+
+			case xyMessageButtons::AbortRetryIgnore:
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Abort"  style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Abort;  } ] ];
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Retry"  style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Retry;  } ] ];
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Ignore" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Ignore; } ] ];
+			break;
+
+			case xyMessageButtons::CancelTryagainContinue:
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Cancel"    style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Cancel;   } ] ];
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Try Again" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Tryagain; } ] ];
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Continue"  style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Continue; } ] ];
+			break;
+
+			case xyMessageButtons::RetryCancel:
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Retry"  style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Retry;  } ] ];
+				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Cancel" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Cancel; } ] ];
+			break;
+		}
+
+		[ pViewController presentViewController:pAlertController animated:NO completion:^{ } ];
+	} );
+
+	// Sleep until selection has been made
+	while( Result < 0 )
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	
+	return ( xyMessageResult )Result;
+
+#elif defined( XY_OS_LINUX )
+
+	xyContext&                     rContext = xyGetContext();
+	std::future< xyMessageResult > Result   = xyMessageBoxAsync( Title, Message, Buttons );
+
+	// The box is served by the main thread, so if that is us, we have to keep the event loop going until it is closed
+	if( std::this_thread::get_id() == rContext.pPlatformImpl->MainThreadID )
+	{
+		while( Result.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
+			rContext.pPlatformImpl->EventLoop.RunOnce( -1 );
+	}
+
+	return Result.get();
+
+#endif // XY_OS_IOS
+
+} // xyMessageBox
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyMessageBox( std::string_view Title, std::string_view Message )
+{
+	( void )xyMessageBox( Title, Message, xyMessageButtons::Ok );
+
+} // xyMessageBox
+
+//////////////////////////////////////////////////////////////////////////
+
+std::future< xyMessageResult > xyMessageBoxAsync( std::string_view Title, std::string_view Message, xyMessageButtons Buttons )
+{
+
+#if defined( XY_OS_LINUX )
+
+	// Create a Wayland surface or an XCB window.
+	return xyGetContext().pPlatformImpl->xyCreateMsgBox( Title, Message, Buttons );
+
+#else // XY_OS_LINUX
+
+	// The native message boxes block, so each one gets a thread of its own
+	return std::async( std::launch::async, [ Title = std::string( Title ), Message = std::string( Message ), Buttons ]
+	{
+		return xyMessageBox( Title, Message, Buttons );
+	} );
+
+#endif // !XY_OS_LINUX
+
+} // xyMessageBoxAsync
+
+//////////////////////////////////////////////////////////////////////////
+
+static xyDevice xyReadDevice( void )
+{
+	XY_TRACE_SCOPE( "xyReadDevice" );
+
+#if defined( XY_OS_WINDOWS )
+
+	CHAR  Buffer[ CNLEN + 1 ];
+	DWORD Size = static_cast< DWORD >( std::size( Buffer ) );
+	if( GetComputerNameA( Buffer, &Size ) )
+	{
+		return { .Name={ Buffer, Size } };
+	}
+
+	return { };
+
+#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+
+	NSString* pName = [ [ NSHost currentHost ] name ];
+
+	return { .Name=[ pName UTF8String ] };
+
+#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+
+	xyContext& rContext = xyGetContext();
+	JNIEnv*    pJNI;
+	rContext.pPlatformImpl->pNativeActivity->vm->AttachCurrentThread( &pJNI, nullptr );
+
+	jclass      BuildClass           = pJNI->FindClass( "android/os/Build" );
+	jfieldID    ManufacturerField    = pJNI->GetStaticFieldID( BuildClass, "MANUFACTURER", "Ljava/lang/String;" );
+	jfieldID    ModelField           = pJNI->GetStaticFieldID( BuildClass, "MODEL", "Ljava/lang/String;" );
+	jstring     ManufacturerName     = static_cast< jstring >( pJNI->GetStaticObjectField( BuildClass, ManufacturerField ) );
+	jstring     ModelName            = static_cast< jstring >( pJNI->GetStaticObjectField( BuildClass, ModelField ) );
+	const char* pManufacturerNameUTF = pJNI->GetStringUTFChars( ManufacturerName, nullptr );
+	const char* pModelNameUTF        = pJNI->GetStringUTFChars( ModelName, nullptr );
+	std::string DeviceName           = std::string( pManufacturerNameUTF ) + ' ' + pModelNameUTF;
+
+	pJNI->ReleaseStringUTFChars( ModelName, pModelNameUTF );
+	pJNI->ReleaseStringUTFChars( ManufacturerName, pManufacturerNameUTF );
+	rContext.pPlatformImpl->pNativeActivity->vm->DetachCurrentThread();
+
+	return { .Name=std::move( DeviceName ) };
+
+#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
+
+	NSString* pDeviceName = [ [ UIDevice currentDevice ] name ];
+
+	return { .Name=[ pDeviceName UTF8String ] };
+
+#elif defined( XY_OS_LINUX ) // XY_OS_IOS
+
+	// There is no login name when we have no controlling terminal, such as when started by a service manager
+	const char* pLogin = getlogin();
+
+	return { .Name=pLogin ? pLogin : "" };
+
+#endif // XY_OS_LINUX
+
+} // xyReadDevice
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xySystemInfoCache::RefreshDevice( void )
+{
+	return Device.Publish( xyReadDevice() );
+
+} // RefreshDevice
+
+//////////////////////////////////////////////////////////////////////////
+
+const xyDevice& xyGetDevice( void )
+{
+	XY_STAT_SCOPE( GetDevice );
+
+	xySystemInfoCache& rCache = xyGetContext().SystemInfo;
+
+	// Threads that race to the first call all read it, but the value they publish is the same
+	if( const xyDevice* pDevice = rCache.Device.Get() )
+		return *pDevice;
+
+	rCache.RefreshDevice();
+
+	return *rCache.Device.Get();
+
+} // xyGetDevice
+
+//////////////////////////////////////////////////////////////////////////
+
+xyTheme xyGetPreferredTheme( void )
+{
+	XY_STAT_SCOPE( GetPreferredTheme );
+	XY_TRACE_SCOPE( "xyGetPreferredTheme" );
+
+	// Default to light theme
+	xyTheme Theme = xyTheme::Light;
+
+#if defined( XY_OS_WINDOWS )
+
+	DWORD AppsUseLightTheme;
+	DWORD DataSize = sizeof( AppsUseLightTheme );
+	if( RegGetValueA( HKEY_CURRENT_USER, "Software\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize", "AppsUseLightTheme", RRF_RT_REG_DWORD, NULL, &AppsUseLightTheme, &DataSize ) == ERROR_SUCCESS )
+		Theme = AppsUseLightTheme ? xyTheme::Light : xyTheme::Dark;
+
+#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+
+	NSString* pStyle = [ [ NSUserDefaults standardUserDefaults ] stringForKey:@"AppleInterfaceStyle" ];
+	if( [ pStyle isEqualToString:@"Dark" ] )
+		Theme = xyTheme::Dark;
+
+#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+
+	xyContext& rContext = xyGetContext();
+
+	switch( AConfiguration_getUiModeNight( rContext.pPlatformImpl->pConfiguration ) )
+	{
+		case ACONFIGURATION_UI_MODE_NIGHT_NO:  { Theme = xyTheme::Light; } break;
+		case ACONFIGURATION_UI_MODE_NIGHT_YES: { Theme = xyTheme::Dark;  } break;
+
+		default: break;
+	}
+
+#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
+
+	UITraitCollection* pTraitCollection = [ UITraitCollection currentTraitCollection ];
+
+	switch( [ pTraitCollection userInterfaceStyle ] )
+	{
+		case UIUserInterfaceStyleLight: { Theme = xyTheme::Light; } break;
+		case UIUserInterfaceStyleDark:  { Theme = xyTheme::Dark;  } break;
+
+		default: break;
+	}
+
+#elif defined( XY_OS_LINUX ) // XY_OS_IOS
+
+	// GTK_THEME overrides the settings file, and names a dark variant either with a ':dark' suffix or in the theme name itself
+	auto IsDarkName = []( std::string_view Name )
+	{
+		return std::search( Name.begin(), Name.end(), "dark", "dark" + 4, []( char A, char B ) { return std::tolower( static_cast< unsigned char >( A ) ) == B; } ) != Name.end();
+	};
+
+	if( const char* pThemeOverride = getenv( "GTK_THEME" ); pThemeOverride && *pThemeOverride )
+	{
+		Theme = IsDarkName( pThemeOverride ) ? xyTheme::Dark : xyTheme::Light;
+	}
+	else
+	{
+		const std::string SettingsPath = xyGetConfigDirectory() + "/gtk-3.0/settings.ini";
+
+		if( std::optional< std::string > PreferDark = xyReadConfigValue( SettingsPath, "gtk-application-prefer-dark-theme" ); PreferDark && ( *PreferDark == "1" || *PreferDark == "true" ) )
+			Theme = xyTheme::Dark;
+		else if( std::optional< std::string > ThemeName = xyReadConfigValue( SettingsPath, "gtk-theme-name" ); ThemeName && IsDarkName( *ThemeName ) )
+			Theme = xyTheme::Dark;
+	}
+
+#endif // XY_OS_LINUX
+
+	return Theme;
+
+} // xyGetPreferredTheme
+
+//////////////////////////////////////////////////////////////////////////
+
+static xyLanguage xyReadLanguage( void )
+{
+	XY_TRACE_SCOPE( "xyReadLanguage" );
+
+#if defined( XY_OS_WINDOWS )
+
+	xyLanguage Language;
+	WCHAR      Buffer[ LOCALE_NAME_MAX_LENGTH ];
+	GetUserDefaultLocaleName( Buffer, static_cast< int >( std::size( Buffer ) ) );
+
+	return { .LocaleName=xyUTF( Buffer ) };
+
+#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+
+	NSString* pLanguageCode = [ [ NSLocale currentLocale ] languageCode ];
+
+	return { .LocaleName=[ pLanguageCode UTF8String ] };
+
+#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+
+	xyContext& rContext = xyGetContext();
+	char       LanguageCode[ 2 ];
+	AConfiguration_getLanguage( rContext.pPlatformImpl->pConfiguration, LanguageCode );
+
+	return { .LocaleName=std::string( LanguageCode, 2 ) };
+
+#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
+
+	NSString* pLanguage = [ [ NSLocale preferredLanguages ] firstObject ];
+
+	return { .LocaleName=[ pLanguage UTF8String ] };
+
+#elif defined( XY_OS_LINUX ) // XY_OS_IOS
+
+	// The environment wins, in the same order of precedence as setlocale() gives it, so that 'LANG=de_DE.UTF-8 ./app' works as expected
+	for( const char* pName : { "LC_ALL", "LC_MESSAGES", "LANG" } )
+	{
+		if( const char* pValue = getenv( pName ); pValue && *pValue )
+			return { .LocaleName=pValue };
+	}
+
+	// Without any of them, go by the configured locale. It is reread on every refresh, so changes to it show up while we run.
+	for( const std::string& rPath : { xyGetConfigDirectory() + "/locale.conf", std::string( "/etc/locale.conf" ), std::string( "/etc/default/locale" ) } )
+	{
+		if( std::optional< std::string > Value = xyReadConfigValue( rPath, "LANG" ) )
+			return { .LocaleName=std::move( *Value ) };
+	}
+
+	return { .LocaleName="C" };
+
+#endif // XY_OS_LINUX
+
+} // xyReadLanguage
+
+//////////////////////////////////////////////////////////////////////////
+
+bool xySystemInfoCache::RefreshLanguage( void )
+{
+	return Language.Publish( xyReadLanguage() );
+
+} // RefreshLanguage
+
+//////////////////////////////////////////////////////////////////////////
+
+const xyLanguage& xyGetLanguage( void )
+{
+	XY_STAT_SCOPE( GetLanguage );
+
+	xySystemInfoCache& rCache = xyGetContext().SystemInfo;
+
+	if( const xyLanguage* pLanguage = rCache.Language.Get() )
+		return *pLanguage;
+
+	rCache.RefreshLanguage();
+
+	return *rCache.Language.Get();
+
+} // xyGetLanguage
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyRefreshSystemInfo( void )
+{
+	xySystemInfoCache& rCache = xyGetContext().SystemInfo;
+
+	rCache.RefreshDevice();
+	rCache.RefreshLanguage();
+
+} // xyRefreshSystemInfo
+
+//////////////////////////////////////////////////////////////////////////
+
+xyBatteryState xyGetBatteryState( void )
+{
+	XY_STAT_SCOPE( GetBatteryState );
+	XY_TRACE_SCOPE( "xyGetBatteryState" );
+
+	xyBatteryState BatteryState;
+
+#if defined( XY_OS_WINDOWS )
+
+	SYSTEM_POWER_STATUS SystemPowerStatus;
+	if( GetSystemPowerStatus( &SystemPowerStatus ) && SystemPowerStatus.BatteryFlag ^ 128 )
+	{
+		BatteryState.CapacityPercentage = SystemPowerStatus.BatteryLifePercent;
+		BatteryState.Charging           = SystemPowerStatus.BatteryFlag & 8;
+		BatteryState.Valid              = true;
+	}
+
+#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+
+	CFMutableDictionaryRef Service = IOServiceMatching( "IOPMPowerSource" );
+	if( io_registry_entry_t Entry = IOServiceGetMatchingService( kIOMasterPortDefault, Service ) )
+	{
+		CFMutableDictionaryRef Properties = nullptr;
+		if( IORegistryEntryCreateCFProperties( Entry, &Properties, nullptr, 0 ) == kIOReturnSuccess )
+		{
+			NSDictionary* pRawProperties = ( NSDictionary* )Properties;
+			bool          IsCharging     = [ [ pRawProperties objectForKey:@"IsCharging" ]      boolValue ];
+			double        Capacity       = [ [ pRawProperties objectForKey:@"CurrentCapacity" ] doubleValue ];
+			double        MaxCapacity    = [ [ pRawProperties objectForKey:@"MaxCapacity" ]     doubleValue ];
+
+			BatteryState.CapacityPercentage = static_cast< uint8_t >( 100.0 * Capacity / MaxCapacity );
+			BatteryState.Charging           = IsCharging;
+			BatteryState.Valid              = true;
+		}
+
+		IOObjectRelease( Entry );
+	}
+
+#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+
+	xyContext& rContext = xyGetContext();
+	JNIEnv*    pEnv;
+	rContext.pPlatformImpl->pNativeActivity->vm->AttachCurrentThread( &pEnv, nullptr );
+
+	jobject   Activity            = rContext.pPlatformImpl->pNativeActivity->clazz;
+	jclass    ActivityClass       = pEnv->GetObjectClass( Activity );
+	jstring   BatteryService      = ( jstring )pEnv->GetStaticObjectField( ActivityClass, pEnv->GetStaticFieldID( ActivityClass, "BATTERY_SERVICE", "Ljava/lang/String;" ) );
+	jobject   BatteryManager      = pEnv->CallObjectMethod( Activity, pEnv->GetMethodID( ActivityClass, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;" ), BatteryService );
+	jclass    BatteryManagerClass = pEnv->GetObjectClass( BatteryManager );
+	jint      PropertyCapacity    = pEnv->GetStaticIntField( BatteryManagerClass, pEnv->GetStaticFieldID( BatteryManagerClass, "BATTERY_PROPERTY_CAPACITY", "I" ) );
+	jint      PropertyStatus      = pEnv->GetStaticIntField( BatteryManagerClass, pEnv->GetStaticFieldID( BatteryManagerClass, "BATTERY_PROPERTY_STATUS",   "I" ) );
+	jint      StatusCharging      = pEnv->GetStaticIntField( BatteryManagerClass, pEnv->GetStaticFieldID( BatteryManagerClass, "BATTERY_STATUS_CHARGING",   "I" ) );
+	jmethodID GetIntProperty      = pEnv->GetMethodID( BatteryManagerClass, "getIntProperty", "(I)I" );
+	jint      Capacity            = pEnv->CallIntMethod( BatteryManager, GetIntProperty, PropertyCapacity );
+	jint      Status              = pEnv->CallIntMethod( BatteryManager, GetIntProperty, PropertyStatus );
+
+	BatteryState.CapacityPercentage = static_cast< uint8_t >( Capacity );
+	BatteryState.Charging           = Status == StatusCharging;
+	BatteryState.Valid              = true;
+
+	rContext.pPlatformImpl->pNativeActivity->vm->DetachCurrentThread();
+
+#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
+	
+	UIDevice*   pDevice = [ UIDevice currentDevice ];
+	const float Level   = [ pDevice batteryLevel ];
+	
+	if( BatteryState.Valid = ( Level >= 0.0f ) )
+	{
+		BatteryState.CapacityPercentage = static_cast< uint8_t >( 100.0f * Level );
+		BatteryState.Charging           = [ pDevice batteryState ] == UIDeviceBatteryStateCharging;
+	}
+
+
+#elif defined( XY_OS_LINUX ) // XY_OS_IOS
+
+	BatteryState = xyGetContext().pPlatformImpl->GetPowerSupplyMonitor().Read();
+
+#endif // XY_OS_LINUX
+
+	return BatteryState;
+
+} // xyGetBatteryState
+
+//////////////////////////////////////////////////////////////////////////
+
+std::vector< xyDisplayAdapter > xyGetDisplayAdapters( void )
+{
+	XY_STAT_SCOPE( GetDisplayAdapters );
+	XY_TRACE_SCOPE( "xyGetDisplayAdapters" );
+
+	std::vector< xyDisplayAdapter > DisplayAdapters;
+
+#if defined( XY_OS_WINDOWS )
+
+	auto EnumProc = []( HMONITOR MonitorHandle, HDC /*DeviceContextHandle*/, LPRECT /*pRect*/, LPARAM UserData ) -> BOOL
+	{
+		auto& rMonitors = *reinterpret_cast< std::vector< xyDisplayAdapter >* >( UserData );
+
+		MONITORINFOEXA Info = { sizeof( MONITORINFOEXA ) };
+		if( GetMonitorInfoA( MonitorHandle, &Info ) )
+		{
+			xyDisplayAdapter Adapter = { .Name     = Info.szDevice,
+										 .FullRect = { .Left=Info.rcMonitor.left, .Top=Info.rcMonitor.top, .Right=Info.rcMonitor.right, .Bottom=Info.rcMonitor.bottom },
+										 .WorkRect = { .Left=Info.rcWork   .left, .Top=Info.rcWork   .top, .Right=Info.rcWork   .right, .Bottom=Info.rcWork   .bottom } };
+
+			// A frequency of 0 or 1 means the hardware default, which doesn't tell us anything
+			DEVMODEA DeviceMode = { .dmSize=sizeof( DEVMODEA ) };
+			if( EnumDisplaySettingsA( Info.szDevice, ENUM_CURRENT_SETTINGS, &DeviceMode ) && DeviceMode.dmDisplayFrequency > 1 )
+				Adapter.RefreshRate = DeviceMode.dmDisplayFrequency;
+
+			DISPLAY_DEVICEA DisplayDevice = { .cb=sizeof( DISPLAY_DEVICEA ) };
+			if( EnumDisplayDevicesA( Adapter.Name.c_str(), 0, &DisplayDevice, 0 ) )
+				Adapter.Name = DisplayDevice.DeviceString;
+
+			rMonitors.emplace_back( std::move( Adapter ) );
+		}
+
+		// Always continue
+		return TRUE;
+	};
+
+	EnumDisplayMonitors( NULL, NULL, EnumProc, reinterpret_cast< LPARAM >( &DisplayAdapters ) );
+
+#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+
+	for( NSScreen* pScreen in [ NSScreen screens ] )
+	{
+		xyDisplayAdapter Adapter = { .Name     = [ [ pScreen localizedName ] UTF8String ],
+									 .FullRect = { .Left=NSMinX( pScreen.frame ),        .Top=NSMinY( pScreen.frame ),        .Right=NSMaxX( pScreen.frame ),        .Bottom=NSMaxY( pScreen.frame ) },
+									 .WorkRect = { .Left=NSMinX( pScreen.visibleFrame ), .Top=NSMinY( pScreen.visibleFrame ), .Right=NSMaxX( pScreen.visibleFrame ), .Bottom=NSMaxY( pScreen.visibleFrame ) } };
+
+		Adapter.ScaleFactor = [ pScreen backingScaleFactor ];
+
+		if( @available( macOS 12.0, * ) )
+			Adapter.RefreshRate = [ pScreen maximumFramesPerSecond ];
+
+		DisplayAdapters.emplace_back( std::move( Adapter ) );
+	}
+
+#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+
+	xyContext& rContext = xyGetContext();
+	JNIEnv*    pJNI;
+	rContext.pPlatformImpl->pNativeActivity->vm->AttachCurrentThread( &pJNI, nullptr );
+
+	jobject      Activity       = rContext.pPlatformImpl->pNativeActivity->clazz;
+	jclass       ActivityClass  = pJNI->GetObjectClass( Activity );
+	jstring      DisplayService = ( jstring )pJNI->GetStaticObjectField( ActivityClass, pJNI->GetStaticFieldID( ActivityClass, "DISPLAY_SERVICE", "Ljava/lang/String;" ) );
+	jobject      DisplayManager = pJNI->CallObjectMethod( Activity, pJNI->GetMethodID( ActivityClass, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;" ), DisplayService );
+	jobjectArray Displays       = ( jobjectArray )pJNI->CallObjectMethod( DisplayManager, pJNI->GetMethodID( pJNI->GetObjectClass( DisplayManager ), "getDisplays", "()[Landroid/view/Display;" ) );
+	jsize        DisplayCount   = pJNI->GetArrayLength( Displays );
+
+	for( jsize i = 0; i < DisplayCount; ++i )
+	{
+		jobject     Display      = pJNI->GetObjectArrayElement( Displays, i );
+		jclass      DisplayClass = pJNI->GetObjectClass( Display );
+		jstring     Name         = ( jstring )pJNI->CallObjectMethod( Display, pJNI->GetMethodID( DisplayClass, "getName", "()Ljava/lang/String;" ) );
+		const char* pNameUTF     = pJNI->GetStringUTFChars( Name, nullptr );
+		jclass      RectClass    = pJNI->FindClass( "android/graphics/Rect" );
+		jobject     Bounds       = pJNI->AllocObject( RectClass );
+
+		xyDisplayAdapter Adapter = { .Name=pNameUTF };
+
+		Adapter.RefreshRate = pJNI->CallFloatMethod( Display, pJNI->GetMethodID( DisplayClass, "getRefreshRate", "()F" ) );
+
+		// NOTE: "getRectSize" is deprecated as of SDK v30.
+		// The documentation suggests using WindowMetric#getBounds(), but there seems to be no way of obtaining the bounds of a specific Display object.
+		pJNI->CallVoidMethod( Display, pJNI->GetMethodID( DisplayClass, "getRectSize", "(Landroid/graphics/Rect;)V" ), Bounds );
+		Adapter.FullRect.Left   = pJNI->GetIntField( Bounds, pJNI->GetFieldID( RectClass, "left",   "I" ) );
+		Adapter.FullRect.Top    = pJNI->GetIntField( Bounds, pJNI->GetFieldID( RectClass, "top",    "I" ) );
+		Adapter.FullRect.Right  = pJNI->GetIntField( Bounds, pJNI->GetFieldID( RectClass, "right",  "I" ) );
+		Adapter.FullRect.Bottom = pJNI->GetIntField( Bounds, pJNI->GetFieldID( RectClass, "bottom", "I" ) );
+
+		if( jobject DisplayCutout = pJNI->CallObjectMethod( Display, pJNI->GetMethodID( DisplayClass, "getCutout", "()Landroid/view/DisplayCutout;" ) ) )
+		{
+			jclass DisplayCutoutClass = pJNI->GetObjectClass( DisplayCutout );
+
+			Adapter.WorkRect.Left   = pJNI->CallIntMethod( DisplayCutout, pJNI->GetMethodID( DisplayCutoutClass, "getSafeInsetLeft",   "()I" ) );
+			Adapter.WorkRect.Top    = pJNI->CallIntMethod( DisplayCutout, pJNI->GetMethodID( DisplayCutoutClass, "getSafeInsetTop",    "()I" ) );
+			Adapter.WorkRect.Right  = pJNI->CallIntMethod( DisplayCutout, pJNI->GetMethodID( DisplayCutoutClass, "getSafeInsetRight",  "()I" ) );
+			Adapter.WorkRect.Bottom = pJNI->CallIntMethod( DisplayCutout, pJNI->GetMethodID( DisplayCutoutClass, "getSafeInsetBottom", "()I" ) );
+		}
+		else
+		{
+			// TODO: There are other ways to obtain the safe area
+			Adapter.WorkRect = Adapter.FullRect;
+		}
+
+		DisplayAdapters.emplace_back( std::move( Adapter ) );
+
+		pJNI->ReleaseStringUTFChars( Name, pNameUTF );
+	}
+
+	rContext.pPlatformImpl->pNativeActivity->vm->DetachCurrentThread();
+
+#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
+	
+	NSArray< UIScreen* >* pScreens = [ UIScreen screens ];
+
+	for( UIScreen* pScreen in pScreens )
+	{
+		NSString*        pScreenName = ( pScreen == [ UIScreen mainScreen ] ) ? @"Main Display" : [ NSString stringWithFormat:@"External Display #%d", [ pScreens indexOfObject:pScreen ] ];
+		CGRect           Bounds      = [ pScreen bounds ];
+		xyDisplayAdapter MainDisplay = { .Name     = [ pScreenName UTF8String ],
+										 .FullRect = { .Left=CGRectGetMinX( Bounds ), .Top=CGRectGetMinY( Bounds ), .Right=CGRectGetMaxX( Bounds ), .Bottom=CGRectGetMaxY( Bounds ) } };
+
+		MainDisplay.ScaleFactor = [ pScreen scale ];
+		MainDisplay.RefreshRate = [ pScreen maximumFramesPerSecond ];
+
+		// TODO: Obtain the safe area
+
+		DisplayAdapters.emplace_back( std::move( MainDisplay ) );
+	}
+
+#elif defined( XY_OS_LINUX ) // XY_OS_IOS
+
+	DisplayAdapters = xyGetContext().pPlatformImpl->GetDisplayAdapters();
+
+#endif // XY_OS_LINUX
+
+	return DisplayAdapters;
+
+} // xyGetDisplayAdapters
+
+//////////////////////////////////////////////////////////////////////////
+
+xySystemSnapshot xyGetSystemSnapshot( std::chrono::milliseconds Timeout )
+{
+	XY_STAT_SCOPE( GetSystemSnapshot );
+	XY_TRACE_SCOPE( "xyGetSystemSnapshot" );
+
+#if defined( XY_OS_LINUX )
+
+	// Queries that run out of time still finish, so they share the snapshot with us rather than borrow it
+	struct State
+	{
+		~State( void ) { if( WakeFD >= 0 ) close( WakeFD ); }
+
+		std::mutex              Mutex;
+		std::condition_variable Finished;
+		xySystemSnapshot        Snapshot;
+		int                     WakeFD    = -1; // Signaled along with Finished, for a main thread that waits on its event loop instead
+		bool                    Abandoned = false; // Set once we have returned, after which late results are dropped
+
+	}; // State
+
+	using Clock = std::chrono::steady_clock;
+
+	const std::shared_ptr< xyPlatformImpl > pPlatformImpl = xyGetContext().pPlatformImpl;
+	xyPlatformImpl&                         rPlatformImpl = *pPlatformImpl;
+	xySystemInfoCache&                      rCache        = xyGetContext().SystemInfo;
+	const auto                              pState        = std::make_shared< State >();
+	const bool                              OnMainThread  = std::this_thread::get_id() == rPlatformImpl.MainThreadID;
+	const Clock::time_point                 Deadline      = Clock::now() + Timeout;
+	const xyDevice*                         pDevice       = rCache.Device.Get();
+	const xyLanguage*                       pLanguage     = rCache.Language.Get();
+	auto                                    Displays      = rPlatformImpl.PeekDisplayAdapters();
+	uint8_t                                 Queried       = 0; // XY_SNAPSHOT_* bits of the fields that we started queries for
+
+	pState->Snapshot.Missing = XY_SNAPSHOT_ALL;
+
+	// The event loop can't wait on a condition variable, but it can wait on this. It exists before the queries do, so they never miss it.
+	if( OnMainThread && ( pState->WakeFD = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) >= 0 )
+	{
+		rPlatformImpl.EventLoop.AddFD( pState->WakeFD, EPOLLIN, [ WakeFD = pState->WakeFD ]( uint32_t )
+		{
+			uint64_t Count;
+			( void )!read( WakeFD, &Count, sizeof( Count ) );
+		} );
+	}
+
+	auto Publish = [ pState ]( uint8_t Field, auto pMember, auto Value )
+	{
+		{
+			std::scoped_lock Lock( pState->Mutex );
+
+			if( pState->Abandoned )
+				return;
+
+			pState->Snapshot.*pMember  = std::move( Value );
+			pState->Snapshot.Missing  &= ~Field;
+		}
+
+		pState->Finished.notify_one();
+
+		if( pState->WakeFD >= 0 )
+		{
+			const uint64_t One = 1;
+			( void )!write( pState->WakeFD, &One, sizeof( One ) );
+		}
+	};
+
+	// Every field gets a query of its own, so that one that hangs holds up none of the others. A field that still has a query running from
+	// an earlier call is left missing, rather than given a second query that would only hang on the same thing and take up another thread.
+	// The queries reach the platform through their own reference, since the context may be gone by the time a late one returns.
+	auto Query = [ & ]( uint8_t Field, auto pMember, auto Read )
+	{
+		if( rPlatformImpl.RunningQueries.fetch_or( Field, std::memory_order_acq_rel ) & Field )
+			return;
+
+		Queried |= Field;
+
+		rPlatformImpl.QueryPool.Post( [ pPlatformImpl, Publish, Field, pMember, Read ]
+		{
+			auto Value = Read( *pPlatformImpl );
+
+			// Done with the source before the result is out, so that a caller who got it can query the field again right away
+			pPlatformImpl->RunningQueries.fetch_and( static_cast< uint8_t >( ~Field ), std::memory_order_release );
+
+			Publish( Field, pMember, std::move( Value ) );
+		} );
+	};
+
+	// Displays may have to connect to the X server, which takes a few round trips, after which all of their requests are sent before any
+	// reply is waited for. The rest come from the environment and small files, which are quick to read until the file system hangs, and
+	// sysfs can stall on the embedded controller. The device and language are read without going through the cache, which may be gone by
+	// the time a late read returns, and are cached by us instead.
+	if( !Displays )  Query( XY_SNAPSHOT_DISPLAYS, &xySystemSnapshot::DisplayAdapters, []( xyPlatformImpl& rPlatform ){ return rPlatform.GetDisplayAdapters(); } );
+	if( !pDevice )   Query( XY_SNAPSHOT_DEVICE,   &xySystemSnapshot::Device,          []( xyPlatformImpl& ){ return xyReadDevice(); } );
+	if( !pLanguage ) Query( XY_SNAPSHOT_LANGUAGE, &xySystemSnapshot::Language,        []( xyPlatformImpl& ){ return xyReadLanguage(); } );
+
+	Query( XY_SNAPSHOT_THEME,   &xySystemSnapshot::Theme,        []( xyPlatformImpl& ){ return xyGetPreferredTheme(); } );
+	Query( XY_SNAPSHOT_BATTERY, &xySystemSnapshot::BatteryState, []( xyPlatformImpl& rPlatform ){ return rPlatform.GetPowerSupplyMonitor().Read(); } );
+
+	std::unique_lock Lock( pState->Mutex );
+
+	// Cached values are in memory, and need no thread to read them
+	if( pDevice )   { pState->Snapshot.Device          = *pDevice;              pState->Snapshot.Missing &= ~XY_SNAPSHOT_DEVICE;   }
+	if( pLanguage ) { pState->Snapshot.Language        = *pLanguage;            pState->Snapshot.Missing &= ~XY_SNAPSHOT_LANGUAGE; }
+	if( Displays )  { pState->Snapshot.DisplayAdapters = std::move( *Displays ); pState->Snapshot.Missing &= ~XY_SNAPSHOT_DISPLAYS; }
+
+	// The queries may need the main thread themselves, so it keeps serving its loop while it waits. Fields that weren't queried won't come.
+	while( ( pState->Snapshot.Missing & Queried ) && Clock::now() < Deadline )
+	{
+		if( OnMainThread )
+		{
+			Lock.unlock();
+			rPlatformImpl.EventLoop.RunOnce( static_cast< int >( std::chrono::ceil< std::chrono::milliseconds >( Deadline - Clock::now() ).count() ) );
+			Lock.lock();
+		}
+		else
+		{
+			pState->Finished.wait_until( Lock, Deadline );
+		}
+	}
+
+	pState->Abandoned = true;
+
+	if( pState->WakeFD >= 0 )
+		rPlatformImpl.EventLoop.RemoveFD( pState->WakeFD );
+
+	xySystemSnapshot Snapshot = std::move( pState->Snapshot );
+
+	Lock.unlock();
+
+	if( !pDevice && Snapshot.Has( XY_SNAPSHOT_DEVICE ) )
+		rCache.Device.Publish( Snapshot.Device );
+
+	if( !pLanguage && Snapshot.Has( XY_SNAPSHOT_LANGUAGE ) )
+		rCache.Language.Publish( Snapshot.Language );
 
-			case xyMessageButtons::YesNoCancel:
-				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "Yes" ),    Spinner );
-				pJNI->CallObjectMethod( Builder, MethodSetNegativeButton, pJNI->NewStringUTF( "No" ),     Spinner );
-				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "Cancel" ), Spinner );
-			break;
+	return Snapshot;
 
-			case xyMessageButtons::AbortRetryIgnore:
-				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "Abort" ),  Spinner );
-				pJNI->CallObjectMethod( Builder, MethodSetNegativeButton, pJNI->NewStringUTF( "Retry" ),  Spinner );
-				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "Ignore" ), Spinner );
-			break;
+#else // XY_OS_LINUX
 
-			case xyMessageButtons::CancelTryagainContinue:
-				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "Cancel" ),    Spinner );
-				pJNI->CallObjectMethod( Builder, MethodSetNegativeButton, pJNI->NewStringUTF( "Try Again" ), Spinner );
-				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "Continue" ),  Spinner );
-			break;
+	// There are no worker threads to spread the queries over
+	( void )Timeout;
 
-			case xyMessageButtons::RetryCancel:
-				pJNI->CallObjectMethod( Builder, MethodSetNeutralButton,  pJNI->NewStringUTF( "Retry" ),  Spinner );
-				pJNI->CallObjectMethod( Builder, MethodSetPositiveButton, pJNI->NewStringUTF( "Cancel" ), Spinner );
-			break;
-		}
+	return { .Device=xyGetDevice(), .Language=xyGetLanguage(), .DisplayAdapters=xyGetDisplayAdapters(), .BatteryState=xyGetBatteryState(), .Theme=xyGetPreferredTheme(), .Missing=0 };
 
-		// Show the alert
-		pJNI->CallObjectMethod( Builder, MethodShow );
+#endif // !XY_OS_LINUX
 
-		pJNI->PopLocalFrame( nullptr );
+} // xyGetSystemSnapshot
 
-		return Spinner;
+//////////////////////////////////////////////////////////////////////////
 
-	}, std::string( Title ), std::string( Message ), ( int )Buttons );
+std::chrono::steady_clock::time_point xyGetNextRefresh( const xyDisplayAdapter& rDisplayAdapter, std::chrono::steady_clock::time_point After )
+{
+	if( rDisplayAdapter.RefreshRate <= 0.0 )
+		return After;
 
-	xyContext& rContext = xyGetContext();
-	JavaVM*    pJVM     = rContext.pPlatformImpl->pNativeActivity->vm;
-	JNIEnv*    pJNI;
-	pJVM->AttachCurrentThread( &pJNI, nullptr );
+	const std::chrono::nanoseconds Period( static_cast< int64_t >( 1e9 / rDisplayAdapter.RefreshRate ) );
+	const std::chrono::nanoseconds Elapsed = After - rDisplayAdapter.RefreshAnchor;
 
-	// Sleep until the alert is closed
-	jclass    ClassSpinner                  = pJNI->GetObjectClass( Spinner );
-	jmethodID MethodGetSelectedItemPosition = pJNI->GetMethodID( ClassSpinner, "getSelectedItemPosition", "()I" );
-	int       Result;
-	while( ( Result = pJNI->CallIntMethod( Spinner, MethodGetSelectedItemPosition ) ) == 0 )
-		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	// Round up to the next whole period, going backwards in time works the same way since the anchor may be in the future
+	int64_t Periods = Elapsed.count() / Period.count();
+	if( Elapsed.count() >= 0 )
+		++Periods;
 
-	pJNI->DeleteGlobalRef( Spinner );
+	return rDisplayAdapter.RefreshAnchor + Periods * Period;
 
-	pJVM->DetachCurrentThread();
+} // xyGetNextRefresh
 
-	std::array< xyMessageResult, 3 > ResultTable;
-	switch( Buttons )
+//////////////////////////////////////////////////////////////////////////
+
+xyFramePacer::xyFramePacer( std::chrono::nanoseconds Period, Clock::time_point Anchor )
+	: Period      ( std::max( Period, std::chrono::nanoseconds( 1 ) ) )
+	, NextDeadline( Anchor )
+{
+
+#if defined( XY_OS_LINUX ) || defined( XY_OS_ANDROID )
+
+	TimerFD = timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC );
+
+#endif // XY_OS_LINUX || XY_OS_ANDROID
+
+} // xyFramePacer
+
+//////////////////////////////////////////////////////////////////////////
+
+xyFramePacer::xyFramePacer( const xyDisplayAdapter& rDisplayAdapter )
+	: xyFramePacer( std::chrono::nanoseconds( static_cast< int64_t >( 1e9 / ( rDisplayAdapter.RefreshRate > 0.0 ? rDisplayAdapter.RefreshRate : 60.0 ) ) ), xyGetNextRefresh( rDisplayAdapter ) )
+{
+} // xyFramePacer
+
+//////////////////////////////////////////////////////////////////////////
+
+xyFramePacer::~xyFramePacer( void )
+{
+
+#if defined( XY_OS_LINUX ) || defined( XY_OS_ANDROID )
+
+	if( TimerFD >= 0 )
+		close( TimerFD );
+
+#endif // XY_OS_LINUX || XY_OS_ANDROID
+
+} // ~xyFramePacer
+
+//////////////////////////////////////////////////////////////////////////
+
+xyFramePacer::Clock::time_point xyFramePacer::WaitForNextFrame( void )
+{
+	Clock::time_point Now = Clock::now();
+
+	// Skip the frames that we are already too late for
+	if( NextDeadline <= Now )
 	{
-		default:
-		case xyMessageButtons::Ok:                     ResultTable = { xyMessageResult::Ok,       { },                       { }                     }; break;
-		case xyMessageButtons::OkCancel:               ResultTable = { xyMessageResult::Cancel,   { },                       xyMessageResult::Ok     }; break;
-		case xyMessageButtons::YesNo:                  ResultTable = { xyMessageResult::No,       { },                       xyMessageResult::Yes    }; break;
-		case xyMessageButtons::YesNoCancel:            ResultTable = { xyMessageResult::Cancel,   xyMessageResult::No,       xyMessageResult::Yes    }; break;
-		case xyMessageButtons::AbortRetryIgnore:       ResultTable = { xyMessageResult::Ignore,   xyMessageResult::Retry,    xyMessageResult::Abort  }; break;
-		case xyMessageButtons::CancelTryagainContinue: ResultTable = { xyMessageResult::Continue, xyMessageResult::Tryagain, xyMessageResult::Cancel }; break;
-		case xyMessageButtons::RetryCancel:            ResultTable = { xyMessageResult::Cancel,   { },                       xyMessageResult::Retry  }; break;
+		const int64_t Missed = ( Now - NextDeadline ) / Period + 1;
+
+		// The very first frame isn't late, there just wasn't a previous one
+		if( Stats.Frames > 0 )
+			Stats.MissedFrames += Missed;
+
+		NextDeadline += Missed * Period;
 	}
 
-	// Results ranges from -1 to -3
-	return ResultTable[ -( Result + 1 ) ];
+	const Clock::time_point Deadline = NextDeadline;
 
-#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
+	if( Deadline - Now > SpinThreshold )
+		SleepUntil( Deadline - SpinThreshold );
 
-	__block int Result = -1;
+	// The kernel won't wake us up on the dot, so spin for the last stretch
+	while( ( Now = Clock::now() ) < Deadline ) { }
 
-	dispatch_async_and_wait( dispatch_get_main_queue(), ^
+	// Welford's method, so that the statistics don't need to keep every sample around
+	const double Jitter = std::chrono::duration< double, std::micro >( Now - Deadline ).count();
+	const double Delta  = Jitter - Stats.MeanJitterMicroseconds;
+
+	++Stats.Frames;
+	Stats.MeanJitterMicroseconds += Delta / Stats.Frames;
+	JitterM2                     += Delta * ( Jitter - Stats.MeanJitterMicroseconds );
+	Stats.JitterDeviation         = Stats.Frames > 1 ? std::sqrt( JitterM2 / ( Stats.Frames - 1 ) ) : 0.0;
+	Stats.MaxJitterMicroseconds   = std::max( Stats.MaxJitterMicroseconds, Jitter );
+
+	NextDeadline += Period;
+
+	return Deadline;
+
+} // WaitForNextFrame
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyFramePacer::Reanchor( Clock::time_point VBlank )
+{
+	// Keep the deadline we were heading for, just move it into phase with the vblank
+	const std::chrono::nanoseconds Offset = ( NextDeadline - VBlank ) % Period;
+
+	NextDeadline -= Offset;
+
+	if( Offset > Period / 2 )
+		NextDeadline += Period;
+	else if( Offset < -Period / 2 )
+		NextDeadline -= Period;
+
+} // Reanchor
+
+//////////////////////////////////////////////////////////////////////////
+
+xyFramePacer::Statistics xyFramePacer::GetStatistics( void ) const
+{
+	return Stats;
+
+} // GetStatistics
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyFramePacer::ResetStatistics( void )
+{
+	Stats    = { };
+	JitterM2 = 0.0;
+
+} // ResetStatistics
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyFramePacer::SleepUntil( Clock::time_point Deadline )
+{
+
+#if defined( XY_OS_LINUX ) || defined( XY_OS_ANDROID )
+
+	// steady_clock is CLOCK_MONOTONIC here, so the deadline can be handed to the timer as is
+	if( TimerFD >= 0 )
 	{
-		UIApplication*     pApplication     = [ UIApplication sharedApplication ];
-		UIScene*           pScene           = [ [ [ pApplication connectedScenes ] allObjects ] firstObject ];
-		UIViewController*  pViewController  = [ [ [ ( UIWindowScene* )pScene windows ] firstObject ] rootViewController ];
-		NSString*          pTitle           = [ NSString stringWithUTF8String:Title.data() ];
-		NSString*          pMessage         = [ NSString stringWithUTF8String:Message.data() ];
-		UIAlertController* pAlertController = [ UIAlertController alertControllerWithTitle:pTitle message:pMessage preferredStyle:UIAlertControllerStyleAlert ];
+		const int64_t    Nanoseconds = std::chrono::duration_cast< std::chrono::nanoseconds >( Deadline.time_since_epoch() ).count();
+		const itimerspec Spec        = { .it_interval={ }, .it_value={ .tv_sec=static_cast< time_t >( Nanoseconds / 1'000'000'000 ), .tv_nsec=static_cast< long >( Nanoseconds % 1'000'000'000 ) } };
+		uint64_t         Expirations;
 
-		switch( Buttons )
+		if( timerfd_settime( TimerFD, TFD_TIMER_ABSTIME, &Spec, nullptr ) == 0 )
 		{
-			case xyMessageButtons::Ok:
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"OK" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Ok; } ] ];
-			break;
+			( void )!read( TimerFD, &Expirations, sizeof( Expirations ) );
+			return;
+		}
+	}
 
-			case xyMessageButtons::OkCancel:
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"OK"     style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Ok;     } ] ];
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Cancel" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Cancel; } ] ];
-			break;
+#endif // XY_OS_LINUX || XY_OS_ANDROID
 
-			case xyMessageButtons::YesNo:
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Yes" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Yes; } ] ];
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"No"  style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::No;  } ] ];
-			break;
+	std::this_thread::sleep_until( Deadline );
 
-			case xyMessageButtons::YesNoCancel:
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Yes"    style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Yes;    } ] ];
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"No"     style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::No;     } ] ];
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Cancel" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Cancel; } ] ];
-			break;
+} // SleepUntil
 
-			case xyMessageButtons::AbortRetryIgnore:
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Abort"  style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Abort;  } ] ];
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Retry"  style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Retry;  } ] ];
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Ignore" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Ignore; } ] ];
-			break;
+//////////////////////////////////////////////////////////////////////////
 
-			case xyMessageButtons::CancelTryagainContinue:
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Cancel"    style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Cancel;   } ] ];
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Try Again" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Tryagain; } ] ];
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Continue"  style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Continue; } ] ];
-			break;
+uint64_t xySubscribe( xyChange Change, std::function< void( void ) > Callback )
+{
 
-			case xyMessageButtons::RetryCancel:
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Retry"  style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Retry;  } ] ];
-				[ pAlertController addAction:[ UIAlertAction actionWithTitle:@"Cancel" style:UIAlertActionStyleDefault handler:^( UIAlertAction* pAction ) { Result = ( int )xyMessageResult::Cancel; } ] ];
-			break;
-		}
+#if defined( XY_OS_LINUX )
 
-		[ pViewController presentViewController:pAlertController animated:NO completion:^{ } ];
+	// The sources are served by the main event loop, so that is where they are set up
+	return xyRunOnMainThread( [ & ]
+	{
+		return xyGetContext().pPlatformImpl->GetChangeNotifier().Subscribe( Change, std::move( Callback ) );
 	} );
 
-	// Sleep until selection has been made
-	while( Result < 0 )
-		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
-	
-	return ( xyMessageResult )Result;
+#else // XY_OS_LINUX
 
-#elif defined( XY_OS_LINUX )
+	( void )Change;
+	( void )Callback;
 
-	// Create an XCB window.
-	xyContext& rContext = xyGetContext();
-	rContext.pPlatformImpl->xyCreateXCBMsgBox( Title.data(), Message.data() );
+	return 0;
 
-#endif // XY_OS_IOS
+#endif // !XY_OS_LINUX
 
-} // xyMessageBox
+} // xySubscribe
 
 //////////////////////////////////////////////////////////////////////////
 
-void xyMessageBox( std::string_view Title, std::string_view Message )
+void xyUnsubscribe( uint64_t SubscriptionID )
 {
-	( void )xyMessageBox( Title, Message, xyMessageButtons::Ok );
 
-} // xyMessageBox
+#if defined( XY_OS_LINUX )
+
+	xyRunOnMainThread( [ SubscriptionID ]
+	{
+		xyGetContext().pPlatformImpl->GetChangeNotifier().Unsubscribe( SubscriptionID );
+	} );
+
+#else // XY_OS_LINUX
+
+	( void )SubscriptionID;
+
+#endif // !XY_OS_LINUX
+
+} // xyUnsubscribe
 
 //////////////////////////////////////////////////////////////////////////
 
-xyDevice xyGetDevice( void )
+size_t xyLatencyHistogram::GetBucketIndex( uint64_t Nanoseconds )
 {
+	// The smallest values get a bucket each. Above those, the bits right below the leading one pick the bucket within the power of two.
+	if( Nanoseconds < SubBucketCount )
+		return static_cast< size_t >( Nanoseconds );
 
-#if defined( XY_OS_WINDOWS )
+	const uint32_t Exponent = static_cast< uint32_t >( std::bit_width( Nanoseconds ) ) - 1;
+	if( Exponent >= MaxExponent )
+		return BucketCount - 1;
 
-	CHAR  Buffer[ CNLEN + 1 ];
-	DWORD Size = static_cast< DWORD >( std::size( Buffer ) );
-	if( GetComputerNameA( Buffer, &Size ) )
+	const uint64_t SubBucket = ( Nanoseconds >> ( Exponent - SubBucketBits ) ) & ( SubBucketCount - 1 );
+
+	return SubBucketCount + ( Exponent - SubBucketBits ) * SubBucketCount + static_cast< size_t >( SubBucket );
+
+} // GetBucketIndex
+
+//////////////////////////////////////////////////////////////////////////
+
+uint64_t xyLatencyHistogram::GetBucketUpperBound( size_t BucketIndex )
+{
+	if( BucketIndex < SubBucketCount )
+		return BucketIndex;
+
+	// The last bucket also holds everything that is too big for the others
+	if( BucketIndex >= BucketCount - 1 )
+		return UINT64_MAX;
+
+	const uint64_t Shift     = ( BucketIndex - SubBucketCount ) / SubBucketCount;
+	const uint64_t SubBucket = ( BucketIndex - SubBucketCount ) % SubBucketCount;
+
+	return ( ( SubBucketCount + SubBucket + 1 ) << Shift ) - 1;
+
+} // GetBucketUpperBound
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyLatencyHistogram::Record( std::chrono::nanoseconds Latency )
+{
+	const uint64_t Nanoseconds = static_cast< uint64_t >( std::max< int64_t >( Latency.count(), 0 ) );
+
+	++Buckets[ GetBucketIndex( Nanoseconds ) ];
+	++Count;
+	Sum += Nanoseconds;
+	Min  = std::min( Min, Nanoseconds );
+	Max  = std::max( Max, Nanoseconds );
+
+} // Record
+
+//////////////////////////////////////////////////////////////////////////
+
+void xyLatencyHistogram::Merge( const xyLatencyHistogram& rOther )
+{
+	for( size_t i = 0; i < BucketCount; ++i )
+		Buckets[ i ] += rOther.Buckets[ i ];
+
+	Count += rOther.Count;
+	Sum   += rOther.Sum;
+	Min    = std::min( Min, rOther.Min );
+	Max    = std::max( Max, rOther.Max );
+
+} // Merge
+
+//////////////////////////////////////////////////////////////////////////
+
+std::chrono::nanoseconds xyLatencyHistogram::GetPercentile( double Percentile ) const
+{
+	if( !Count )
+		return std::chrono::nanoseconds( 0 );
+
+	// The value reported is the highest one that its bucket can hold, so percentiles are never under-reported
+	const uint64_t Rank       = std::max< uint64_t >( static_cast< uint64_t >( std::ceil( std::clamp( Percentile, 0.0, 100.0 ) / 100.0 * Count ) ), 1 );
+	uint64_t       Cumulative = 0;
+
+	for( size_t i = 0; i < BucketCount; ++i )
 	{
-		return { .Name={ Buffer, Size } };
+		Cumulative += Buckets[ i ];
+
+		if( Cumulative >= Rank )
+			return std::chrono::nanoseconds( std::min( GetBucketUpperBound( i ), Max ) );
 	}
 
-	return { };
+	return std::chrono::nanoseconds( Max );
 
-#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+} // GetPercentile
 
-	NSString* pName = [ [ NSHost currentHost ] name ];
+//////////////////////////////////////////////////////////////////////////
 
-	return { .Name=[ pName UTF8String ] };
+#if defined( XY_ENABLE_STATS )
 
-#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+/*
+ * The histograms that one thread records into.
+ * Only the owning thread writes to them, so plain loads and stores are enough, and they are atomic only so that xyGetStats can read them at the same time.
+ */
+struct xyStatsThreadBlock
+{
+	struct Histogram
+	{
+		std::array< std::atomic< uint64_t >, xyLatencyHistogram::BucketCount > Buckets;
+		std::atomic< uint64_t >                                                Count;
+		std::atomic< uint64_t >                                                Sum;
+		std::atomic< uint64_t >                                                Min = UINT64_MAX;
+		std::atomic< uint64_t >                                                Max;
 
-	xyContext& rContext = xyGetContext();
-	JNIEnv*    pJNI;
-	rContext.pPlatformImpl->pNativeActivity->vm->AttachCurrentThread( &pJNI, nullptr );
+	}; // Histogram
 
-	jclass      BuildClass           = pJNI->FindClass( "android/os/Build" );
-	jfieldID    ManufacturerField    = pJNI->GetStaticFieldID( BuildClass, "MANUFACTURER", "Ljava/lang/String;" );
-	jfieldID    ModelField           = pJNI->GetStaticFieldID( BuildClass, "MODEL", "Ljava/lang/String;" );
-	jstring     ManufacturerName     = static_cast< jstring >( pJNI->GetStaticObjectField( BuildClass, ManufacturerField ) );
-	jstring     ModelName            = static_cast< jstring >( pJNI->GetStaticObjectField( BuildClass, ModelField ) );
-	const char* pManufacturerNameUTF = pJNI->GetStringUTFChars( ManufacturerName, nullptr );
-	const char* pModelNameUTF        = pJNI->GetStringUTFChars( ModelName, nullptr );
-	std::string DeviceName           = std::string( pManufacturerNameUTF ) + ' ' + pModelNameUTF;
+	void Record( xyApi Api, uint64_t Nanoseconds )
+	{
+		Histogram& rHistogram = Apis[ static_cast< size_t >( Api ) ];
+		auto       Store      = []( std::atomic< uint64_t >& rValue, uint64_t NewValue ) { rValue.store( NewValue, std::memory_order_relaxed ); };
+		auto       Load       = []( const std::atomic< uint64_t >& rValue ) { return rValue.load( std::memory_order_relaxed ); };
+
+		std::atomic< uint64_t >& rBucket = rHistogram.Buckets[ xyLatencyHistogram::GetBucketIndex( Nanoseconds ) ];
+
+		Store( rBucket,          Load( rBucket ) + 1 );
+		Store( rHistogram.Count, Load( rHistogram.Count ) + 1 );
+		Store( rHistogram.Sum,   Load( rHistogram.Sum ) + Nanoseconds );
+
+		if( Nanoseconds < Load( rHistogram.Min ) ) Store( rHistogram.Min, Nanoseconds );
+		if( Nanoseconds > Load( rHistogram.Max ) ) Store( rHistogram.Max, Nanoseconds );
+	}
+
+	void MergeInto( std::array< xyApiStats, static_cast< size_t >( xyApi::Count ) >& rApis ) const
+	{
+		for( size_t Api = 0; Api < rApis.size(); ++Api )
+		{
+			const Histogram&    rHistogram = Apis[ Api ];
+			xyLatencyHistogram& rTarget    = rApis[ Api ].Latency;
+
+			for( size_t i = 0; i < xyLatencyHistogram::BucketCount; ++i )
+				rTarget.Buckets[ i ] += rHistogram.Buckets[ i ].load( std::memory_order_relaxed );
+
+			rTarget.Count += rHistogram.Count.load( std::memory_order_relaxed );
+			rTarget.Sum   += rHistogram.Sum.load( std::memory_order_relaxed );
+			rTarget.Min    = std::min( rTarget.Min, rHistogram.Min.load( std::memory_order_relaxed ) );
+			rTarget.Max    = std::max( rTarget.Max, rHistogram.Max.load( std::memory_order_relaxed ) );
+		}
+	}
+
+	std::array< Histogram, static_cast< size_t >( xyApi::Count ) > Apis;
+
+}; // xyStatsThreadBlock
+
+/*
+ * Keeps track of the blocks of every thread that is still running, and the sum of the ones that have exited.
+ */
+struct xyStatsRegistry
+{
+	std::mutex                                                      Mutex;
+	std::vector< const xyStatsThreadBlock* >                        Blocks;
+	std::array< xyApiStats, static_cast< size_t >( xyApi::Count ) > Retired;
+
+}; // xyStatsRegistry
+
+//////////////////////////////////////////////////////////////////////////
+
+static xyStatsRegistry& xyGetStatsRegistry( void )
+{
+	// Never destroyed, since threads may still be exiting after static destructors have run
+	static xyStatsRegistry* pRegistry = new xyStatsRegistry;
+
+	return *pRegistry;
+
+} // xyGetStatsRegistry
+
+//////////////////////////////////////////////////////////////////////////
+
+static xyStatsThreadBlock& xyGetStatsThreadBlock( void )
+{
+	// Created on the first call that a thread records, and folded into the retired stats when the thread exits
+	struct Owner
+	{
+		Owner( void )
+		{
+			xyStatsRegistry& rRegistry = xyGetStatsRegistry();
+			std::scoped_lock Lock( rRegistry.Mutex );
+			rRegistry.Blocks.push_back( pBlock.get() );
+		}
 
-	pJNI->ReleaseStringUTFChars( ModelName, pModelNameUTF );
-	pJNI->ReleaseStringUTFChars( ManufacturerName, pManufacturerNameUTF );
-	rContext.pPlatformImpl->pNativeActivity->vm->DetachCurrentThread();
+		~Owner( void )
+		{
+			xyStatsRegistry& rRegistry = xyGetStatsRegistry();
+			std::scoped_lock Lock( rRegistry.Mutex );
+			pBlock->MergeInto( rRegistry.Retired );
+			std::erase( rRegistry.Blocks, pBlock.get() );
+		}
 
-	return { .Name=std::move( DeviceName ) };
+		std::unique_ptr< xyStatsThreadBlock > pBlock = std::make_unique< xyStatsThreadBlock >();
 
-#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
+	}; // Owner
 
-	NSString* pDeviceName = [ [ UIDevice currentDevice ] name ];
+	thread_local Owner ThreadOwner;
 
-	return { .Name=[ pDeviceName UTF8String ] };
+	return *ThreadOwner.pBlock;
 
-#elif defined( XY_OS_LINUX ) // XY_OS_IOS
+} // xyGetStatsThreadBlock
+
+//////////////////////////////////////////////////////////////////////////
 
-	return { .Name={ std::move( getlogin() ) } };
+xyStatScope::~xyStatScope( void )
+{
+	const auto Latency = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - Begin );
 
-#endif // XY_OS_LINUX
+	xyGetStatsThreadBlock().Record( Api, static_cast< uint64_t >( Latency.count() ) );
 
-} // xyGetDevice
+} // ~xyStatScope
+
+#endif // XY_ENABLE_STATS
 
 //////////////////////////////////////////////////////////////////////////
 
-xyTheme xyGetPreferredTheme( void )
+xyStats xyGetStats( void )
 {
-	// Default to light theme
-	xyTheme Theme = xyTheme::Light;
+	constexpr std::array< std::string_view, static_cast< size_t >( xyApi::Count ) > Names =
+	{
+		"xyGetDevice",
+		"xyGetLanguage",
+		"xyGetPreferredTheme",
+		"xyGetBatteryState",
+		"xyGetDisplayAdapters",
+		"xyGetSystemSnapshot",
+		"xyMessageBox",
+	};
 
-#if defined( XY_OS_WINDOWS )
+	xyStats Stats;
 
-	DWORD AppsUseLightTheme;
-	DWORD DataSize = sizeof( AppsUseLightTheme );
-	if( RegGetValueA( HKEY_CURRENT_USER, "Software\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize", "AppsUseLightTheme", RRF_RT_REG_DWORD, NULL, &AppsUseLightTheme, &DataSize ) == ERROR_SUCCESS )
-		Theme = AppsUseLightTheme ? xyTheme::Light : xyTheme::Dark;
+#if defined( XY_ENABLE_STATS )
 
-#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+	xyStatsRegistry& rRegistry = xyGetStatsRegistry();
+	std::scoped_lock Lock( rRegistry.Mutex );
 
-	NSString* pStyle = [ [ NSUserDefaults standardUserDefaults ] stringForKey:@"AppleInterfaceStyle" ];
-	if( [ pStyle isEqualToString:@"Dark" ] )
-		Theme = xyTheme::Dark;
+	Stats.Apis = rRegistry.Retired;
 
-#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+	for( const xyStatsThreadBlock* pBlock : rRegistry.Blocks )
+		pBlock->MergeInto( Stats.Apis );
 
-	xyContext& rContext = xyGetContext();
+#endif // XY_ENABLE_STATS
 
-	switch( AConfiguration_getUiModeNight( rContext.pPlatformImpl->pConfiguration ) )
-	{
-		case ACONFIGURATION_UI_MODE_NIGHT_NO:  { Theme = xyTheme::Light; } break;
-		case ACONFIGURATION_UI_MODE_NIGHT_YES: { Theme = xyTheme::Dark;  } break;
+	for( size_t i = 0; i < Names.size(); ++i )
+		Stats.Apis[ i ].Name = Names[ i ];
 
-		default: break;
-	}
+	return Stats;
 
-#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
+} // xyGetStats
 
-	UITraitCollection* pTraitCollection = [ UITraitCollection currentTraitCollection ];
+//////////////////////////////////////////////////////////////////////////
 
-	switch( [ pTraitCollection userInterfaceStyle ] )
+xyTracer::xyTracer( void )
+{
+} // xyTracer
+
+//////////////////////////////////////////////////////////////////////////
+
+xyTracer& xyTracer::Get( void )
+{
+	// Never destroyed, since other threads may still be recording while static destructors run. The file is finished at exit instead.
+	static xyTracer* pTracer = []
 	{
-		case UIUserInterfaceStyleLight: { Theme = xyTheme::Light; } break;
-		case UIUserInterfaceStyleDark:  { Theme = xyTheme::Dark;  } break;
+		xyTracer* pNewTracer = new xyTracer();
 
-		default: break;
-	}
+		std::atexit( []{ xyTracer::Get().Stop(); } );
 
-#endif // XY_OS_IOS
+		if( const char* pPath = getenv( "XY_TRACE" ); pPath && *pPath )
+			pNewTracer->Start( pPath );
 
-	return Theme;
+		return pNewTracer;
+	}();
 
-} // xyGetPreferredTheme
+	return *pTracer;
+
+} // Get
 
 //////////////////////////////////////////////////////////////////////////
 
-xyLanguage xyGetLanguage( void )
+bool xyTracer::Start( const std::string& rPath )
 {
+	std::scoped_lock ControlLock( ControlMutex );
 
-#if defined( XY_OS_WINDOWS )
+	{
+		std::scoped_lock Lock( Mutex );
 
-	xyLanguage Language;
-	WCHAR      Buffer[ LOCALE_NAME_MAX_LENGTH ];
-	GetUserDefaultLocaleName( Buffer, static_cast< int >( std::size( Buffer ) ) );
+		if( pFile )
+			return false;
 
-	return { .LocaleName=xyUTF( Buffer ) };
+		if( !( pFile = fopen( rPath.c_str(), "wb" ) ) )
+			return false;
 
-#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+		fputs( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", pFile );
 
-	NSString* pLanguageCode = [ [ NSLocale currentLocale ] languageCode ];
+		// Anything still in the rings was recorded by an earlier run
+		for( const std::shared_ptr< Ring >& rpRing : Rings )
+			rpRing->Tail.store( rpRing->Head.load( std::memory_order_acquire ), std::memory_order_release );
 
-	return { .LocaleName=[ pLanguageCode UTF8String ] };
+		Origin     = std::chrono::duration_cast< std::chrono::nanoseconds >( Clock::now().time_since_epoch() ).count();
+		Stopping   = false;
+		FirstEvent = true;
+	}
 
-#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+	FlushThread = std::thread( &xyTracer::FlushThreadMain, this );
+	Active.store( true, std::memory_order_release );
 
-	xyContext& rContext = xyGetContext();
-	char       LanguageCode[ 2 ];
-	AConfiguration_getLanguage( rContext.pPlatformImpl->pConfiguration, LanguageCode );
+	return true;
 
-	return { .LocaleName=std::string( LanguageCode, 2 ) };
+} // Start
 
-#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
+//////////////////////////////////////////////////////////////////////////
 
-	NSString* pLanguage = [ [ NSLocale preferredLanguages ] firstObject ];
+void xyTracer::Stop( void )
+{
+	std::scoped_lock ControlLock( ControlMutex );
 
-	return { .LocaleName=[ pLanguage UTF8String ] };
+	if( !FlushThread.joinable() )
+		return;
 
-#elif defined( XY_OS_LINUX ) // XY_OS_IOS
+	Active.store( false, std::memory_order_release );
+
+	{
+		std::scoped_lock Lock( Mutex );
+		Stopping = true;
+	}
 
-	return { .LocaleName = std::move( std::locale("").name()) };
+	Condition.notify_all();
+	FlushThread.join();
 
-#endif // XY_OS_LINUX
+	std::scoped_lock Lock( Mutex );
 
-} // xyGetLanguage
+	// Whatever was recorded after the last flush
+	Flush();
+
+	fputs( "\n]}\n", pFile );
+	fclose( pFile );
+	pFile = nullptr;
+
+} // Stop
 
 //////////////////////////////////////////////////////////////////////////
 
-xyBatteryState xyGetBatteryState( void )
+void xyTracer::Record( char Phase, const char* pName, int64_t Value )
 {
-	xyBatteryState BatteryState;
+	// The clock is only read once we know that the event is wanted
+	if( IsActive() )
+		Record( Phase, pName, Value, Clock::now() );
 
-#if defined( XY_OS_WINDOWS )
+} // Record
 
-	SYSTEM_POWER_STATUS SystemPowerStatus;
-	if( GetSystemPowerStatus( &SystemPowerStatus ) && SystemPowerStatus.BatteryFlag ^ 128 )
-	{
-		BatteryState.CapacityPercentage = SystemPowerStatus.BatteryLifePercent;
-		BatteryState.Charging           = SystemPowerStatus.BatteryFlag & 8;
-		BatteryState.Valid              = true;
-	}
+//////////////////////////////////////////////////////////////////////////
 
-#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+void xyTracer::Record( char Phase, const char* pName, int64_t Value, Clock::time_point Time )
+{
+	if( !IsActive() )
+		return;
 
-	CFMutableDictionaryRef Service = IOServiceMatching( "IOPMPowerSource" );
-	if( io_registry_entry_t Entry = IOServiceGetMatchingService( kIOMasterPortDefault, Service ) )
+	Ring&          rRing = GetThreadRing();
+	const uint64_t Head  = rRing.Head.load( std::memory_order_relaxed );
+
+	// Never wait for the flush thread
+	if( Head - rRing.Tail.load( std::memory_order_acquire ) >= RingCapacity )
 	{
-		CFMutableDictionaryRef Properties = nullptr;
-		if( IORegistryEntryCreateCFProperties( Entry, &Properties, nullptr, 0 ) == kIOReturnSuccess )
-		{
-			NSDictionary* pRawProperties = ( NSDictionary* )Properties;
-			bool          IsCharging     = [ [ pRawProperties objectForKey:@"IsCharging" ]      boolValue ];
-			double        Capacity       = [ [ pRawProperties objectForKey:@"CurrentCapacity" ] doubleValue ];
-			double        MaxCapacity    = [ [ pRawProperties objectForKey:@"MaxCapacity" ]     doubleValue ];
+		DroppedEvents.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
 
-			BatteryState.CapacityPercentage = static_cast< uint8_t >( 100.0 * Capacity / MaxCapacity );
-			BatteryState.Charging           = IsCharging;
-			BatteryState.Valid              = true;
-		}
+	rRing.Events[ Head % RingCapacity ] = { .pName=pName, .Timestamp=std::chrono::duration_cast< std::chrono::nanoseconds >( Time.time_since_epoch() ).count(), .Value=Value, .Phase=Phase };
+	rRing.Head.store( Head + 1, std::memory_order_release );
 
-		IOObjectRelease( Entry );
-	}
+} // Record
 
-#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+//////////////////////////////////////////////////////////////////////////
 
-	xyContext& rContext = xyGetContext();
-	JNIEnv*    pEnv;
-	rContext.pPlatformImpl->pNativeActivity->vm->AttachCurrentThread( &pEnv, nullptr );
+xyTracer::Ring& xyTracer::GetThreadRing( void )
+{
+	// The ring outlives its thread until the flush thread has written what is left in it
+	struct Owner
+	{
+		~Owner( void )
+		{
+			if( pRing )
+				pRing->Orphaned.store( true, std::memory_order_release );
+		}
 
-	jobject   Activity            = rContext.pPlatformImpl->pNativeActivity->clazz;
-	jclass    ActivityClass       = pEnv->GetObjectClass( Activity );
-	jstring   BatteryService      = ( jstring )pEnv->GetStaticObjectField( ActivityClass, pEnv->GetStaticFieldID( ActivityClass, "BATTERY_SERVICE", "Ljava/lang/String;" ) );
-	jobject   BatteryManager      = pEnv->CallObjectMethod( Activity, pEnv->GetMethodID( ActivityClass, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;" ), BatteryService );
-	jclass    BatteryManagerClass = pEnv->GetObjectClass( BatteryManager );
-	jint      PropertyCapacity    = pEnv->GetStaticIntField( BatteryManagerClass, pEnv->GetStaticFieldID( BatteryManagerClass, "BATTERY_PROPERTY_CAPACITY", "I" ) );
-	jint      PropertyStatus      = pEnv->GetStaticIntField( BatteryManagerClass, pEnv->GetStaticFieldID( BatteryManagerClass, "BATTERY_PROPERTY_STATUS",   "I" ) );
-	jint      StatusCharging      = pEnv->GetStaticIntField( BatteryManagerClass, pEnv->GetStaticFieldID( BatteryManagerClass, "BATTERY_STATUS_CHARGING",   "I" ) );
-	jmethodID GetIntProperty      = pEnv->GetMethodID( BatteryManagerClass, "getIntProperty", "(I)I" );
-	jint      Capacity            = pEnv->CallIntMethod( BatteryManager, GetIntProperty, PropertyCapacity );
-	jint      Status              = pEnv->CallIntMethod( BatteryManager, GetIntProperty, PropertyStatus );
+		std::shared_ptr< Ring > pRing;
 
-	BatteryState.CapacityPercentage = static_cast< uint8_t >( Capacity );
-	BatteryState.Charging           = Status == StatusCharging;
-	BatteryState.Valid              = true;
+	}; // Owner
 
-	rContext.pPlatformImpl->pNativeActivity->vm->DetachCurrentThread();
+	thread_local Owner ThreadOwner;
 
-#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
-	
-	UIDevice*   pDevice = [ UIDevice currentDevice ];
-	const float Level   = [ pDevice batteryLevel ];
-	
-	if( BatteryState.Valid = ( Level >= 0.0f ) )
+	if( !ThreadOwner.pRing )
 	{
-		BatteryState.CapacityPercentage = static_cast< uint8_t >( 100.0f * Level );
-		BatteryState.Charging           = [ pDevice batteryState ] == UIDeviceBatteryStateCharging;
+		auto pRing = std::make_shared< Ring >();
+
+		std::scoped_lock Lock( Mutex );
+		pRing->ThreadIndex = NextThreadIndex++;
+		Rings.push_back( pRing );
+		ThreadOwner.pRing = std::move( pRing );
 	}
 
+	return *ThreadOwner.pRing;
 
-#elif defined( XY_OS_LINUX ) // XY_OS_IOS
+} // GetThreadRing
 
-#endif // XY_OS_LINUX
+//////////////////////////////////////////////////////////////////////////
 
-	return BatteryState;
+void xyTracer::FlushThreadMain( void )
+{
+	std::unique_lock Lock( Mutex );
 
-} // xyGetBatteryState
+	while( !Stopping )
+	{
+		Condition.wait_for( Lock, std::chrono::milliseconds( 50 ) );
+		Flush();
+	}
+
+} // FlushThreadMain
 
 //////////////////////////////////////////////////////////////////////////
 
-std::vector< xyDisplayAdapter > xyGetDisplayAdapters( void )
+void xyTracer::Flush( void )
 {
-	std::vector< xyDisplayAdapter > DisplayAdapters;
-
-#if defined( XY_OS_WINDOWS )
+	Buffer.clear();
 
-	auto EnumProc = []( HMONITOR MonitorHandle, HDC /*DeviceContextHandle*/, LPRECT /*pRect*/, LPARAM UserData ) -> BOOL
+	for( auto It = Rings.begin(); It != Rings.end(); )
 	{
-		auto& rMonitors = *reinterpret_cast< std::vector< xyDisplayAdapter >* >( UserData );
+		Ring&          rRing    = **It;
+		const bool     Orphaned = rRing.Orphaned.load( std::memory_order_acquire );
+		const uint64_t Head     = rRing.Head.load( std::memory_order_acquire );
 
-		MONITORINFOEXA Info = { sizeof( MONITORINFOEXA ) };
-		if( GetMonitorInfoA( MonitorHandle, &Info ) )
-		{
-			xyDisplayAdapter Adapter = { .Name     = Info.szDevice,
-										 .FullRect = { .Left=Info.rcMonitor.left, .Top=Info.rcMonitor.top, .Right=Info.rcMonitor.right, .Bottom=Info.rcMonitor.bottom },
-										 .WorkRect = { .Left=Info.rcWork   .left, .Top=Info.rcWork   .top, .Right=Info.rcWork   .right, .Bottom=Info.rcWork   .bottom } };
+		for( uint64_t i = rRing.Tail.load( std::memory_order_relaxed ); i < Head; ++i )
+			Append( rRing.Events[ i % RingCapacity ], rRing.ThreadIndex );
 
-			DISPLAY_DEVICEA DisplayDevice = { .cb=sizeof( DISPLAY_DEVICEA ) };
-			if( EnumDisplayDevicesA( Adapter.Name.c_str(), 0, &DisplayDevice, 0 ) )
-				Adapter.Name = DisplayDevice.DeviceString;
+		rRing.Tail.store( Head, std::memory_order_release );
 
-			rMonitors.emplace_back( std::move( Adapter ) );
-		}
+		// The thread has exited, so nothing more can be added
+		if( Orphaned ) It = Rings.erase( It );
+		else           ++It;
+	}
 
-		// Always continue
-		return TRUE;
-	};
+	if( !Buffer.empty() )
+		fwrite( Buffer.data(), 1, Buffer.size(), pFile );
 
-	EnumDisplayMonitors( NULL, NULL, EnumProc, reinterpret_cast< LPARAM >( &DisplayAdapters ) );
+} // Flush
 
-#elif defined( XY_OS_MACOS ) // XY_OS_WINDOWS
+//////////////////////////////////////////////////////////////////////////
 
-	for( NSScreen* pScreen in [ NSScreen screens ] )
-	{
-		xyDisplayAdapter Adapter = { .Name     = [ [ pScreen localizedName ] UTF8String ],
-									 .FullRect = { .Left=NSMinX( pScreen.frame ),        .Top=NSMinY( pScreen.frame ),        .Right=NSMaxX( pScreen.frame ),        .Bottom=NSMaxY( pScreen.frame ) },
-									 .WorkRect = { .Left=NSMinX( pScreen.visibleFrame ), .Top=NSMinY( pScreen.visibleFrame ), .Right=NSMaxX( pScreen.visibleFrame ), .Bottom=NSMaxY( pScreen.visibleFrame ) } };
+void xyTracer::Append( const xyTraceEvent& rEvent, uint32_t ThreadIndex )
+{
+	const double    Microseconds = static_cast< double >( rEvent.Timestamp - Origin ) / 1000.0;
+	const long long Value        = static_cast< long long >( rEvent.Value );
+	char            Line[ 128 ];
 
-		DisplayAdapters.emplace_back( std::move( Adapter ) );
+	if( !std::exchange( FirstEvent, false ) )
+		Buffer += ",\n";
+
+	// Thread names are metadata, and the name of the event is fixed
+	if( rEvent.Phase == 'M' )
+	{
+		Buffer += "{\"name\":\"thread_name\",\"ph\":\"M\",\"args\":{\"name\":";
+		xyAppendJSONString( Buffer, rEvent.pName );
+		snprintf( Line, sizeof( Line ), "},\"pid\":1,\"tid\":%u}", ThreadIndex );
+		Buffer += Line;
+		return;
 	}
 
-#elif defined( XY_OS_ANDROID ) // XY_OS_MACOS
+	Buffer += "{\"name\":";
+	xyAppendJSONString( Buffer, rEvent.pName );
 
-	xyContext& rContext = xyGetContext();
-	JNIEnv*    pJNI;
-	rContext.pPlatformImpl->pNativeActivity->vm->AttachCurrentThread( &pJNI, nullptr );
+	switch( rEvent.Phase )
+	{
+		case 'X': { snprintf( Line, sizeof( Line ), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f", Microseconds, static_cast< double >( Value ) / 1000.0 ); } break;
+		case 'C': { snprintf( Line, sizeof( Line ), ",\"ph\":\"C\",\"ts\":%.3f,\"args\":{\"value\":%lld}", Microseconds, Value );                 } break;
+		case 's': { snprintf( Line, sizeof( Line ), ",\"ph\":\"s\",\"cat\":\"flow\",\"id\":%lld,\"ts\":%.3f", Value, Microseconds );             } break;
+		case 'f': { snprintf( Line, sizeof( Line ), ",\"ph\":\"f\",\"bp\":\"e\",\"cat\":\"flow\",\"id\":%lld,\"ts\":%.3f", Value, Microseconds ); } break;
+		case 'b':
+		case 'e': { snprintf( Line, sizeof( Line ), ",\"ph\":\"%c\",\"cat\":\"async\",\"id\":%lld,\"ts\":%.3f", rEvent.Phase, Value, Microseconds ); } break;
+		case 'i': { snprintf( Line, sizeof( Line ), ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f", Microseconds );                                  } break;
+		default:  { snprintf( Line, sizeof( Line ), ",\"ph\":\"%c\",\"ts\":%.3f", rEvent.Phase, Microseconds );                               } break;
+	}
 
-	jobject      Activity       = rContext.pPlatformImpl->pNativeActivity->clazz;
-	jclass       ActivityClass  = pJNI->GetObjectClass( Activity );
-	jstring      DisplayService = ( jstring )pJNI->GetStaticObjectField( ActivityClass, pJNI->GetStaticFieldID( ActivityClass, "DISPLAY_SERVICE", "Ljava/lang/String;" ) );
-	jobject      DisplayManager = pJNI->CallObjectMethod( Activity, pJNI->GetMethodID( ActivityClass, "getSystemService", "(Ljava/lang/String;)Ljava/lang/Object;" ), DisplayService );
-	jobjectArray Displays       = ( jobjectArray )pJNI->CallObjectMethod( DisplayManager, pJNI->GetMethodID( pJNI->GetObjectClass( DisplayManager ), "getDisplays", "()[Landroid/view/Display;" ) );
-	jsize        DisplayCount   = pJNI->GetArrayLength( Displays );
+	Buffer += Line;
 
-	for( jsize i = 0; i < DisplayCount; ++i )
-	{
-		jobject     Display      = pJNI->GetObjectArrayElement( Displays, i );
-		jclass      DisplayClass = pJNI->GetObjectClass( Display );
-		jstring     Name         = ( jstring )pJNI->CallObjectMethod( Display, pJNI->GetMethodID( DisplayClass, "getName", "()Ljava/lang/String;" ) );
-		const char* pNameUTF     = pJNI->GetStringUTFChars( Name, nullptr );
-		jclass      RectClass    = pJNI->FindClass( "android/graphics/Rect" );
-		jobject     Bounds       = pJNI->AllocObject( RectClass );
+	snprintf( Line, sizeof( Line ), ",\"pid\":1,\"tid\":%u}", ThreadIndex );
+	Buffer += Line;
 
-		xyDisplayAdapter Adapter = { .Name=pNameUTF };
+} // Append
 
-		// NOTE: "getRectSize" is deprecated as of SDK v30.
-		// The documentation suggests using WindowMetric#getBounds(), but there seems to be no way of obtaining the bounds of a specific Display object.
-		pJNI->CallVoidMethod( Display, pJNI->GetMethodID( DisplayClass, "getRectSize", "(Landroid/graphics/Rect;)V" ), Bounds );
-		Adapter.FullRect.Left   = pJNI->GetIntField( Bounds, pJNI->GetFieldID( RectClass, "left",   "I" ) );
-		Adapter.FullRect.Top    = pJNI->GetIntField( Bounds, pJNI->GetFieldID( RectClass, "top",    "I" ) );
-		Adapter.FullRect.Right  = pJNI->GetIntField( Bounds, pJNI->GetFieldID( RectClass, "right",  "I" ) );
-		Adapter.FullRect.Bottom = pJNI->GetIntField( Bounds, pJNI->GetFieldID( RectClass, "bottom", "I" ) );
+//////////////////////////////////////////////////////////////////////////
 
-		if( jobject DisplayCutout = pJNI->CallObjectMethod( Display, pJNI->GetMethodID( DisplayClass, "getCutout", "()Landroid/view/DisplayCutout;" ) ) )
-		{
-			jclass DisplayCutoutClass = pJNI->GetObjectClass( DisplayCutout );
+#if defined( XY_ENABLE_TRACING )
 
-			Adapter.WorkRect.Left   = pJNI->CallIntMethod( DisplayCutout, pJNI->GetMethodID( DisplayCutoutClass, "getSafeInsetLeft",   "()I" ) );
-			Adapter.WorkRect.Top    = pJNI->CallIntMethod( DisplayCutout, pJNI->GetMethodID( DisplayCutoutClass, "getSafeInsetTop",    "()I" ) );
-			Adapter.WorkRect.Right  = pJNI->CallIntMethod( DisplayCutout, pJNI->GetMethodID( DisplayCutoutClass, "getSafeInsetRight",  "()I" ) );
-			Adapter.WorkRect.Bottom = pJNI->CallIntMethod( DisplayCutout, pJNI->GetMethodID( DisplayCutoutClass, "getSafeInsetBottom", "()I" ) );
-		}
-		else
-		{
-			// TODO: There are other ways to obtain the safe area
-			Adapter.WorkRect = Adapter.FullRect;
-		}
+xyTraceScope::~xyTraceScope( void )
+{
+	if( !pName )
+		return;
 
-		DisplayAdapters.emplace_back( std::move( Adapter ) );
+	const auto Duration = std::chrono::duration_cast< std::chrono::nanoseconds >( xyTracer::Clock::now() - Begin );
 
-		pJNI->ReleaseStringUTFChars( Name, pNameUTF );
-	}
+	xyTracer::Get().Record( 'X', pName, Duration.count(), Begin );
 
-	rContext.pPlatformImpl->pNativeActivity->vm->DetachCurrentThread();
+} // ~xyTraceScope
 
-#elif defined( XY_OS_IOS ) // XY_OS_ANDROID
-	
-	NSArray< UIScreen* >* pScreens = [ UIScreen screens ];
+#endif // XY_ENABLE_TRACING
 
-	for( UIScreen* pScreen in pScreens )
-	{
-		NSString*        pScreenName = ( pScreen == [ UIScreen mainScreen ] ) ? @"Main Display" : [ NSString stringWithFormat:@"External Display #%d", [ pScreens indexOfObject:pScreen ] ];
-		CGRect           Bounds      = [ pScreen bounds ];
-		xyDisplayAdapter MainDisplay = { .Name     = [ pScreenName UTF8String ],
-										 .FullRect = { .Left=CGRectGetMinX( Bounds ), .Top=CGRectGetMinY( Bounds ), .Right=CGRectGetMaxX( Bounds ), .Bottom=CGRectGetMaxY( Bounds ) } };
+//////////////////////////////////////////////////////////////////////////
 
-		// TODO: Obtain the safe area
+bool xyStartTracing( const std::string& rPath )
+{
+	return xyTracer::Get().Start( rPath );
 
-		DisplayAdapters.emplace_back( std::move( MainDisplay ) );
-	}
+} // xyStartTracing
 
-#endif // XY_OS_IOS
+//////////////////////////////////////////////////////////////////////////
 
-	return DisplayAdapters;
+void xyStopTracing( void )
+{
+	xyTracer::Get().Stop();
 
-} // xyGetDisplayAdapters
+} // xyStopTracing
 
 
 #endif // XY_IMPLEMENT
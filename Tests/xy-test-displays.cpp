@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2021 Sebastian Kylander https://gaztin.com/
+ *
+ * This software is provided 'as-is', without any express or implied warranty. In no event will
+ * the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not claim that you wrote the
+ *    original software. If you use this software in a product, an acknowledgment in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+ *    being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+/*
+ * Checks xyGetDisplayAdapters on an X server whose screen is split into two RandR monitors, like 'xrandr --setmonitor' does.
+ * Xvfb only has the one output, so the monitors are how it can show more than one display. Run it under xvfb-run on hosts without a display.
+ */
+
+#define XY_IMPLEMENT
+#include "xy-main.h"
+#include "xy-test.h"
+
+#if defined( XY_OS_LINUX ) && defined( XY_HAS_XCB_RANDR )
+
+#include <dlfcn.h>
+
+static bool operator==( const xyRect& rA, const xyRect& rB )
+{
+	return rA.Left == rB.Left && rA.Top == rB.Top && rA.Right == rB.Right && rA.Bottom == rB.Bottom;
+
+} // operator==
+
+//////////////////////////////////////////////////////////////////////////
+
+static std::vector< xyDisplayAdapter > xyTestDisplayAdapters( void )
+{
+	// Setting monitors is not something we listen for, so the cache has to be told
+	xyRunOnMainThread( []{ xyGetContext().pPlatformImpl->InvalidateDisplayAdapters(); } );
+
+	return xyGetDisplayAdapters();
+
+} // xyTestDisplayAdapters
+
+//////////////////////////////////////////////////////////////////////////
+
+int xyMain( void )
+{
+	xyXCBConnection* pXCB = xyGetContext().pPlatformImpl->GetXCB();
+
+	if( !pXCB )
+	{
+		printf( "Skipped: no X server\n" );
+		return XY_TEST_SKIPPED;
+	}
+
+	if( !pXCB->RandRMonitors )
+	{
+		printf( "Skipped: the X server doesn't support RandR 1.5\n" );
+		return XY_TEST_SKIPPED;
+	}
+
+	// Setting monitors is only done by tools like xrandr, so the library doesn't load these functions
+	void* pRandR         = dlopen( "libxcb-randr.so.0", RTLD_NOW | RTLD_LOCAL );
+	auto  pSetMonitor    = reinterpret_cast< decltype( &xcb_randr_set_monitor_checked ) >( dlsym( pRandR, "xcb_randr_set_monitor_checked" ) );
+	auto  pDeleteMonitor = reinterpret_cast< decltype( &xcb_randr_delete_monitor_checked ) >( dlsym( pRandR, "xcb_randr_delete_monitor_checked" ) );
+
+	if( !pSetMonitor || !pDeleteMonitor )
+	{
+		printf( "Skipped: libxcb-randr can't set monitors\n" );
+		return XY_TEST_SKIPPED;
+	}
+
+	xcb_connection_t*  pConnection = pXCB->pConnection;
+	const xcb_window_t Root        = pXCB->pScreen->root;
+	const int32_t      Width       = pXCB->pScreen->width_in_pixels;
+	const int32_t      Height      = pXCB->pScreen->height_in_pixels;
+
+	// The one output of the screen, and the refresh rate of the mode it shows
+	xcb_randr_output_t Output      = XCB_NONE;
+	std::string        OutputName;
+	double             RefreshRate = 0.0;
+
+	if( xcb_randr_get_screen_resources_current_reply_t* pResources = xyXCB.randr_get_screen_resources_current_reply( pConnection, xyXCB.randr_get_screen_resources_current( pConnection, Root ), nullptr ) )
+	{
+		for( int i = 0; i < xyXCB.randr_get_screen_resources_current_crtcs_length( pResources ) && !Output; ++i )
+		{
+			xcb_randr_get_crtc_info_reply_t* pCRTC = xyXCB.randr_get_crtc_info_reply( pConnection, xyXCB.randr_get_crtc_info( pConnection, xyXCB.randr_get_screen_resources_current_crtcs( pResources )[ i ], pResources->config_timestamp ), nullptr );
+			if( !pCRTC )
+				continue;
+
+			for( xcb_randr_mode_info_iterator_t It = xyXCB.randr_get_screen_resources_current_modes_iterator( pResources ); It.rem; xyXCB.randr_mode_info_next( &It ) )
+			{
+				if( It.data->id == pCRTC->mode && It.data->htotal && It.data->vtotal )
+					RefreshRate = static_cast< double >( It.data->dot_clock ) / ( static_cast< double >( It.data->htotal ) * It.data->vtotal );
+			}
+
+			if( pCRTC->mode != XCB_NONE && pCRTC->num_outputs > 0 )
+			{
+				Output = reinterpret_cast< const xcb_randr_output_t* >( pCRTC + 1 )[ 0 ];
+
+				if( xcb_randr_get_output_info_reply_t* pOutput = xyXCB.randr_get_output_info_reply( pConnection, xyXCB.randr_get_output_info( pConnection, Output, pResources->config_timestamp ), nullptr ) )
+				{
+					OutputName.assign( reinterpret_cast< const char* >( xyXCB.randr_get_output_info_name( pOutput ) ), xyXCB.randr_get_output_info_name_length( pOutput ) );
+					free( pOutput );
+				}
+			}
+
+			free( pCRTC );
+		}
+
+		free( pResources );
+	}
+
+	XY_CHECK( Output != XCB_NONE );
+
+	const xyRect Screen    = { 0,         0, Width,     Height };
+	const xyRect LeftHalf  = { 0,         0, Width / 2, Height };
+	const xyRect RightHalf = { Width / 2, 0, Width,     Height };
+
+	// To begin with, the output is the one display
+	std::vector< xyDisplayAdapter > Adapters = xyTestDisplayAdapters();
+
+	XY_CHECK( Adapters.size() == 1 );
+
+	if( !Adapters.empty() )
+	{
+		XY_CHECK( Adapters[ 0 ].Name == OutputName );
+		XY_CHECK( Adapters[ 0 ].FullRect == Screen );
+		XY_CHECK( Adapters[ 0 ].WorkRect == Adapters[ 0 ].FullRect );
+		XY_CHECK( Adapters[ 0 ].RefreshRate == RefreshRate );
+	}
+
+	// Split the screen in two. The left half keeps the output, and the right half is made up and made the primary display.
+	auto Intern = [ & ]( const char* pName )
+	{
+		xcb_atom_t Atom = XCB_ATOM_NONE;
+
+		if( xcb_intern_atom_reply_t* pReply = xyXCB.intern_atom_reply( pConnection, xyXCB.intern_atom( pConnection, 0, static_cast< uint16_t >( strlen( pName ) ), pName ), nullptr ) )
+		{
+			Atom = pReply->atom;
+			free( pReply );
+		}
+
+		return Atom;
+	};
+
+	const xcb_atom_t Left  = Intern( "XY-LEFT" );
+	const xcb_atom_t Right = Intern( "XY-RIGHT" );
+
+	// The outputs of a monitor follow right after it
+	struct
+	{
+		xcb_randr_monitor_info_t Info;
+		xcb_randr_output_t       Outputs[ 1 ];
+
+	} LeftMonitor = { }, RightMonitor = { };
+
+	LeftMonitor.Info         = { .name=Left,  .primary=0, .automatic=0, .nOutput=1, .x=0,                                  .y=0, .width=static_cast< uint16_t >( Width / 2 ),         .height=static_cast< uint16_t >( Height ), .width_in_millimeters=0, .height_in_millimeters=0 };
+	LeftMonitor.Outputs[ 0 ] = Output;
+	RightMonitor.Info        = { .name=Right, .primary=1, .automatic=0, .nOutput=0, .x=static_cast< int16_t >( Width / 2 ), .y=0, .width=static_cast< uint16_t >( Width - Width / 2 ), .height=static_cast< uint16_t >( Height ), .width_in_millimeters=0, .height_in_millimeters=0 };
+
+	auto Succeeded = [ & ]( xcb_void_cookie_t Cookie )
+	{
+		xcb_generic_error_t* pError = xyXCB.request_check( pConnection, Cookie );
+		free( pError );
+
+		return pError == nullptr;
+	};
+
+	XY_CHECK( Succeeded( pSetMonitor( pConnection, Root, &LeftMonitor.Info ) ) );
+	XY_CHECK( Succeeded( pSetMonitor( pConnection, Root, &RightMonitor.Info ) ) );
+
+	Adapters = xyTestDisplayAdapters();
+
+	// The primary display comes first. The output is in the left monitor, so it no longer gets one of its own.
+	XY_CHECK( Adapters.size() == 2 );
+
+	if( Adapters.size() == 2 )
+	{
+		XY_CHECK( Adapters[ 0 ].Name == "XY-RIGHT" );
+		XY_CHECK( Adapters[ 0 ].FullRect == RightHalf );
+		XY_CHECK( Adapters[ 0 ].WorkRect == Adapters[ 0 ].FullRect );
+		XY_CHECK( Adapters[ 1 ].Name == "XY-LEFT" );
+		XY_CHECK( Adapters[ 1 ].FullRect == LeftHalf );
+		XY_CHECK( Adapters[ 1 ].WorkRect == Adapters[ 1 ].FullRect );
+
+		// Either through its output, or through the CRTC that it is on
+		XY_CHECK( Adapters[ 0 ].RefreshRate == RefreshRate );
+		XY_CHECK( Adapters[ 1 ].RefreshRate == RefreshRate );
+	}
+
+	// And back to the way it was
+	XY_CHECK( Succeeded( pDeleteMonitor( pConnection, Root, Left ) ) );
+	XY_CHECK( Succeeded( pDeleteMonitor( pConnection, Root, Right ) ) );
+
+	Adapters = xyTestDisplayAdapters();
+
+	XY_CHECK( Adapters.size() == 1 && Adapters[ 0 ].Name == OutputName );
+
+	return xyTestResult();
+
+} // xyMain
+
+#else // XY_OS_LINUX && XY_HAS_XCB_RANDR
+
+int xyMain( void )
+{
+	printf( "Skipped: built without RandR\n" );
+	return XY_TEST_SKIPPED;
+
+} // xyMain
+
+#endif // !XY_OS_LINUX || !XY_HAS_XCB_RANDR
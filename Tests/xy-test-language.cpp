@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2021 Sebastian Kylander https://gaztin.com/
+ *
+ * This software is provided 'as-is', without any express or implied warranty. In no event will
+ * the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not claim that you wrote the
+ *    original software. If you use this software in a product, an acknowledgment in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+ *    being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+/*
+ * Checks where xyGetLanguage finds the language on Linux: the environment first, and then the configured locale.
+ */
+
+#define XY_IMPLEMENT
+#include "xy-main.h"
+#include "xy-test.h"
+
+#if defined( XY_OS_LINUX )
+
+#include <filesystem>
+#include <fstream>
+
+static std::string xyTestLanguage( void )
+{
+	xyRefreshSystemInfo();
+
+	return xyGetLanguage().LocaleName;
+
+} // xyTestLanguage
+
+//////////////////////////////////////////////////////////////////////////
+
+int xyMain( void )
+{
+	char Template[] = "/tmp/xy-test-language-XXXXXX";
+	if( !mkdtemp( Template ) )
+		return 1;
+
+	const std::filesystem::path ConfigDirectory( Template );
+	std::ofstream( ConfigDirectory / "locale.conf" ) << "LANG=fr_FR.UTF-8\n";
+
+	setenv( "XDG_CONFIG_HOME", Template, 1 );
+	unsetenv( "LC_ALL" );
+	unsetenv( "LC_MESSAGES" );
+
+	// LANG on the command line beats the configured locale
+	setenv( "LANG", "de_DE.UTF-8", 1 );
+	XY_CHECK( xyTestLanguage() == "de_DE.UTF-8" );
+
+	setenv( "LC_MESSAGES", "sv_SE.UTF-8", 1 );
+	XY_CHECK( xyTestLanguage() == "sv_SE.UTF-8" );
+
+	setenv( "LC_ALL", "ja_JP.UTF-8", 1 );
+	XY_CHECK( xyTestLanguage() == "ja_JP.UTF-8" );
+
+	// Empty variables count as unset
+	setenv( "LC_ALL", "", 1 );
+	unsetenv( "LC_MESSAGES" );
+	unsetenv( "LANG" );
+	XY_CHECK( xyTestLanguage() == "fr_FR.UTF-8" );
+
+	// A change to the configured locale shows up on the next refresh, and the old value stays valid
+	const xyLanguage& rOld = xyGetLanguage();
+	std::ofstream( ConfigDirectory / "locale.conf", std::ios::trunc ) << "LANG=\"pt_BR.UTF-8\"\n";
+	XY_CHECK( xyTestLanguage() == "pt_BR.UTF-8" );
+	XY_CHECK( rOld.LocaleName == "fr_FR.UTF-8" );
+
+	std::filesystem::remove_all( ConfigDirectory );
+
+	return xyTestResult();
+
+} // xyMain
+
+#else // XY_OS_LINUX
+
+int xyMain( void )
+{
+	return XY_TEST_SKIPPED;
+
+} // xyMain
+
+#endif // !XY_OS_LINUX
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2021 Sebastian Kylander https://gaztin.com/
+ *
+ * This software is provided 'as-is', without any express or implied warranty. In no event will
+ * the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not claim that you wrote the
+ *    original software. If you use this software in a product, an acknowledgment in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+ *    being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+
+/*
+ * Clicks every button of every message box layout on a Wayland compositor, and checks the result that the box returns.
+ * Clients can't make up input under Wayland, so the clicks are handed to the box where the pointer listener would hand them, and
+ * the compositor only gets to host the surfaces. Run it through xy-weston-run.sh on hosts without a compositor.
+ */
+
+#define XY_IMPLEMENT
+#include "xy-main.h"
+#include "xy-test.h"
+
+#if defined( XY_OS_LINUX )
+
+struct xyTestLayout
+{
+	xyMessageButtons                 Buttons;
+	std::vector< xyMessageResult >   Results; // Left to right
+	xyMessageResult                  CloseResult;
+
+}; // xyTestLayout
+
+static const xyTestLayout gLayouts[] =
+{
+	{ xyMessageButtons::Ok,                     { xyMessageResult::Ok },                                                              xyMessageResult::Ok },
+	{ xyMessageButtons::OkCancel,               { xyMessageResult::Ok,     xyMessageResult::Cancel },                                 xyMessageResult::Cancel },
+	{ xyMessageButtons::YesNo,                  { xyMessageResult::Yes,    xyMessageResult::No },                                     xyMessageResult::No },
+	{ xyMessageButtons::YesNoCancel,            { xyMessageResult::Yes,    xyMessageResult::No,       xyMessageResult::Cancel },      xyMessageResult::Cancel },
+	{ xyMessageButtons::AbortRetryIgnore,       { xyMessageResult::Abort,  xyMessageResult::Retry,    xyMessageResult::Ignore },      xyMessageResult::Abort },
+	{ xyMessageButtons::CancelTryagainContinue, { xyMessageResult::Cancel, xyMessageResult::Tryagain, xyMessageResult::Continue },    xyMessageResult::Cancel },
+	{ xyMessageButtons::RetryCancel,            { xyMessageResult::Retry,  xyMessageResult::Cancel },                                 xyMessageResult::Cancel },
+};
+
+struct xyTestBox
+{
+	std::future< xyMessageResult > Result;
+	wl_proxy*                      pSurface = nullptr;
+	uint16_t                       Width    = 0;
+	uint16_t                       Height   = 0;
+
+}; // xyTestBox
+
+//////////////////////////////////////////////////////////////////////////
+
+// A box that couldn't be put on Wayland has no surface
+static xyTestBox xyTestOpenBox( xyMessageButtons Buttons )
+{
+	xyPlatformImpl& rPlatformImpl = *xyGetContext().pPlatformImpl;
+	xyTestBox       Box;
+
+	Box.Result = xyMessageBoxAsync( "xy-test", "Which one?", Buttons );
+
+	// Jobs run in the order they were posted, so the box exists by the time this runs
+	xyRunOnMainThread( [ & ]
+	{
+		if( rPlatformImpl.WaylandMessageBoxes.empty() )
+			return;
+
+		auto& [ pSurface, pBox ] = *rPlatformImpl.WaylandMessageBoxes.begin();
+
+		Box.pSurface = pSurface;
+		Box.Width    = pBox->m_Width;
+		Box.Height   = pBox->m_Height;
+	} );
+
+	return Box;
+
+} // xyTestOpenBox
+
+//////////////////////////////////////////////////////////////////////////
+
+// The buttons are 80x28, 8 apart, and right-aligned along the bottom with a 16 pixel margin
+static std::pair< int32_t, int32_t > xyTestButtonCenter( const xyTestBox& rBox, size_t Index, size_t Count )
+{
+	const int Left = rBox.Width - 16 - static_cast< int >( Count ) * 80 - ( static_cast< int >( Count ) - 1 ) * 8;
+
+	return { Left + static_cast< int >( Index ) * ( 80 + 8 ) + 40, rBox.Height - 16 - 14 };
+
+} // xyTestButtonCenter
+
+//////////////////////////////////////////////////////////////////////////
+
+// A press and a release, followed by what the event handler does once the events are dispatched
+static void xyTestClick( const xyTestBox& rBox, std::pair< int32_t, int32_t > PressPosition, std::pair< int32_t, int32_t > ReleasePosition )
+{
+	xyPlatformImpl& rPlatformImpl = *xyGetContext().pPlatformImpl;
+
+	xyRunOnMainThread( [ & ]
+	{
+		rPlatformImpl.OnWaylandButton( rBox.pSurface, PressPosition.first,   PressPosition.second,   true );
+		rPlatformImpl.OnWaylandButton( rBox.pSurface, ReleasePosition.first, ReleasePosition.second, false );
+		rPlatformImpl.ResolveWaylandMessageBoxes();
+	} );
+
+} // xyTestClick
+
+//////////////////////////////////////////////////////////////////////////
+
+// The same as what the close handler of the toplevel does, when the compositor asks for it
+static void xyTestClose( const xyTestBox& rBox )
+{
+	xyPlatformImpl& rPlatformImpl = *xyGetContext().pPlatformImpl;
+
+	xyRunOnMainThread( [ & ]
+	{
+		if( auto It = rPlatformImpl.WaylandMessageBoxes.find( rBox.pSurface ); It != rPlatformImpl.WaylandMessageBoxes.end() )
+			It->second->m_pSurface->Close();
+
+		rPlatformImpl.ResolveWaylandMessageBoxes();
+	} );
+
+} // xyTestClose
+
+//////////////////////////////////////////////////////////////////////////
+
+static std::optional< xyMessageResult > xyTestWaitForResult( xyTestBox& rBox, std::chrono::milliseconds Timeout )
+{
+	if( rBox.Result.wait_for( Timeout ) != std::future_status::ready )
+		return std::nullopt;
+
+	return rBox.Result.get();
+
+} // xyTestWaitForResult
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyTestLayoutClicks( const xyTestLayout& rLayout )
+{
+	const size_t Count = rLayout.Results.size();
+
+	for( size_t Index = 0; Index < Count; ++Index )
+	{
+		xyTestBox Box = xyTestOpenBox( rLayout.Buttons );
+
+		xyTestClick( Box, xyTestButtonCenter( Box, Index, Count ), xyTestButtonCenter( Box, Index, Count ) );
+
+		const std::optional< xyMessageResult > Result = xyTestWaitForResult( Box, std::chrono::seconds( 5 ) );
+
+		XY_CHECK_MESSAGE( Result == rLayout.Results[ Index ], "layout %d, button %zu", static_cast< int >( rLayout.Buttons ), Index );
+
+		// The next box must not find this one still open
+		if( !Result )
+		{
+			xyTestClose( Box );
+			xyTestWaitForResult( Box, std::chrono::seconds( 5 ) );
+		}
+	}
+
+	// Neither a click next to the buttons, nor a press on one button and a release on another, does anything
+	xyTestBox Box = xyTestOpenBox( rLayout.Buttons );
+
+	xyTestClick( Box, { 4, 4 }, { 4, 4 } );
+	xyTestClick( Box, xyTestButtonCenter( Box, 0, Count ), { xyTestButtonCenter( Box, Count - 1, Count ).first + 50, xyTestButtonCenter( Box, 0, Count ).second } );
+
+	XY_CHECK_MESSAGE( !xyTestWaitForResult( Box, std::chrono::milliseconds( 200 ) ), "layout %d, missed clicks", static_cast< int >( rLayout.Buttons ) );
+
+	// Closing the window gives the most passive choice
+	xyTestClose( Box );
+
+	XY_CHECK_MESSAGE( xyTestWaitForResult( Box, std::chrono::seconds( 5 ) ) == rLayout.CloseResult, "layout %d, closed", static_cast< int >( rLayout.Buttons ) );
+
+} // xyTestLayoutClicks
+
+//////////////////////////////////////////////////////////////////////////
+
+int xyMain( void )
+{
+	if( !xyGetContext().pPlatformImpl->GetWayland() )
+	{
+		printf( "Skipped: no Wayland compositor\n" );
+		return XY_TEST_SKIPPED;
+	}
+
+	// Boxes draw their own text under Wayland, and go through XWayland when there is no font to draw it with
+	xyTestBox Probe = xyTestOpenBox( xyMessageButtons::Ok );
+	if( !Probe.pSurface )
+	{
+		printf( "Skipped: message boxes aren't put on Wayland in this build\n" );
+		return XY_TEST_SKIPPED;
+	}
+
+	xyTestClose( Probe );
+	xyTestWaitForResult( Probe, std::chrono::seconds( 5 ) );
+
+	for( const xyTestLayout& rLayout : gLayouts )
+		xyTestLayoutClicks( rLayout );
+
+	return xyTestResult();
+
+} // xyMain
+
+#else // XY_OS_LINUX
+
+int xyMain( void )
+{
+	return XY_TEST_SKIPPED;
+
+} // xyMain
+
+#endif // !XY_OS_LINUX
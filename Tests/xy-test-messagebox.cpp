@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2021 Sebastian Kylander https://gaztin.com/
+ *
+ * This software is provided 'as-is', without any express or implied warranty. In no event will
+ * the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not claim that you wrote the
+ *    original software. If you use this software in a product, an acknowledgment in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+ *    being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+/*
+ * Clicks every button of every message box layout on an X server, and checks the result that the box returns.
+ * The clicks are sent to the box as synthetic events, so no window manager nor input device is needed. Run it under xvfb-run on hosts
+ * without a display.
+ */
+
+#define XY_IMPLEMENT
+#include "xy-main.h"
+#include "xy-test.h"
+
+#if defined( XY_OS_LINUX )
+
+struct xyTestLayout
+{
+	xyMessageButtons                 Buttons;
+	std::vector< xyMessageResult >   Results; // Left to right
+	xyMessageResult                  CloseResult;
+
+}; // xyTestLayout
+
+static const xyTestLayout gLayouts[] =
+{
+	{ xyMessageButtons::Ok,                     { xyMessageResult::Ok },                                                              xyMessageResult::Ok },
+	{ xyMessageButtons::OkCancel,               { xyMessageResult::Ok,     xyMessageResult::Cancel },                                 xyMessageResult::Cancel },
+	{ xyMessageButtons::YesNo,                  { xyMessageResult::Yes,    xyMessageResult::No },                                     xyMessageResult::No },
+	{ xyMessageButtons::YesNoCancel,            { xyMessageResult::Yes,    xyMessageResult::No,       xyMessageResult::Cancel },      xyMessageResult::Cancel },
+	{ xyMessageButtons::AbortRetryIgnore,       { xyMessageResult::Abort,  xyMessageResult::Retry,    xyMessageResult::Ignore },      xyMessageResult::Abort },
+	{ xyMessageButtons::CancelTryagainContinue, { xyMessageResult::Cancel, xyMessageResult::Tryagain, xyMessageResult::Continue },    xyMessageResult::Cancel },
+	{ xyMessageButtons::RetryCancel,            { xyMessageResult::Retry,  xyMessageResult::Cancel },                                 xyMessageResult::Cancel },
+};
+
+struct xyTestBox
+{
+	std::future< xyMessageResult > Result;
+	xcb_window_t                   Window = 0;
+	uint16_t                       Width  = 0;
+	uint16_t                       Height = 0;
+
+}; // xyTestBox
+
+//////////////////////////////////////////////////////////////////////////
+
+static xyTestBox xyTestOpenBox( xyMessageButtons Buttons )
+{
+	xyPlatformImpl& rPlatformImpl = *xyGetContext().pPlatformImpl;
+	xyTestBox       Box;
+
+	Box.Result = xyMessageBoxAsync( "xy-test", "Which one?", Buttons );
+
+	// Jobs run in the order they were posted, so the box exists by the time this runs
+	xyRunOnMainThread( [ & ]
+	{
+		auto& [ Window, pBox ] = *rPlatformImpl.MessageBoxes.begin();
+
+		Box.Window = Window;
+		Box.Width  = pBox->m_Width;
+		Box.Height = pBox->m_Height;
+	} );
+
+	return Box;
+
+} // xyTestOpenBox
+
+//////////////////////////////////////////////////////////////////////////
+
+// The buttons are 80x28, 8 apart, and right-aligned along the bottom with a 16 pixel margin
+static std::pair< int16_t, int16_t > xyTestButtonCenter( const xyTestBox& rBox, size_t Index, size_t Count )
+{
+	const int Left = rBox.Width - 16 - static_cast< int >( Count ) * 80 - ( static_cast< int >( Count ) - 1 ) * 8;
+
+	return { static_cast< int16_t >( Left + static_cast< int >( Index ) * ( 80 + 8 ) + 40 ), static_cast< int16_t >( rBox.Height - 16 - 14 ) };
+
+} // xyTestButtonCenter
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyTestSendButton( const xyTestBox& rBox, bool Pressed, std::pair< int16_t, int16_t > Position )
+{
+	xyXCBConnection& rXCB = *xyGetContext().pPlatformImpl->GetXCB();
+
+	xcb_button_press_event_t Event = { };
+	Event.response_type = Pressed ? XCB_BUTTON_PRESS : XCB_BUTTON_RELEASE;
+	Event.detail        = XCB_BUTTON_INDEX_1;
+	Event.root          = rXCB.pScreen->root;
+	Event.event         = rBox.Window;
+	Event.event_x       = Position.first;
+	Event.event_y       = Position.second;
+	Event.same_screen   = 1;
+
+	// Without an event mask, the event goes to the client that created the window, which is us
+	xyXCB.send_event( rXCB.pConnection, 0, rBox.Window, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast< const char* >( &Event ) );
+	xyXCB.flush( rXCB.pConnection );
+
+} // xyTestSendButton
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyTestClose( const xyTestBox& rBox )
+{
+	xyXCBConnection& rXCB = *xyGetContext().pPlatformImpl->GetXCB();
+
+	xcb_client_message_event_t Event = { };
+	Event.response_type  = XCB_CLIENT_MESSAGE;
+	Event.format         = 32;
+	Event.window         = rBox.Window;
+	Event.type           = rXCB.WMProtocols;
+	Event.data.data32[0] = rXCB.WMDeleteWindow;
+
+	xyXCB.send_event( rXCB.pConnection, 0, rBox.Window, XCB_EVENT_MASK_NO_EVENT, reinterpret_cast< const char* >( &Event ) );
+	xyXCB.flush( rXCB.pConnection );
+
+} // xyTestClose
+
+//////////////////////////////////////////////////////////////////////////
+
+static std::optional< xyMessageResult > xyTestWaitForResult( xyTestBox& rBox, std::chrono::milliseconds Timeout )
+{
+	if( rBox.Result.wait_for( Timeout ) != std::future_status::ready )
+		return std::nullopt;
+
+	return rBox.Result.get();
+
+} // xyTestWaitForResult
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyTestLayoutClicks( const xyTestLayout& rLayout )
+{
+	const size_t Count = rLayout.Results.size();
+
+	// A press and a release on each button
+	for( size_t Index = 0; Index < Count; ++Index )
+	{
+		xyTestBox Box = xyTestOpenBox( rLayout.Buttons );
+
+		xyTestSendButton( Box, true,  xyTestButtonCenter( Box, Index, Count ) );
+		xyTestSendButton( Box, false, xyTestButtonCenter( Box, Index, Count ) );
+
+		const std::optional< xyMessageResult > Result = xyTestWaitForResult( Box, std::chrono::seconds( 5 ) );
+
+		XY_CHECK_MESSAGE( Result == rLayout.Results[ Index ], "layout %d, button %zu", static_cast< int >( rLayout.Buttons ), Index );
+
+		// The next box must not find this one still open
+		if( !Result )
+		{
+			xyTestClose( Box );
+			xyTestWaitForResult( Box, std::chrono::seconds( 5 ) );
+		}
+	}
+
+	// Neither a click next to the buttons, nor a press on one button and a release on another, does anything
+	xyTestBox Box = xyTestOpenBox( rLayout.Buttons );
+
+	xyTestSendButton( Box, true,  { 4, 4 } );
+	xyTestSendButton( Box, false, { 4, 4 } );
+	xyTestSendButton( Box, true,  xyTestButtonCenter( Box, 0, Count ) );
+	xyTestSendButton( Box, false, { static_cast< int16_t >( xyTestButtonCenter( Box, Count - 1, Count ).first + 50 ), xyTestButtonCenter( Box, 0, Count ).second } );
+
+	XY_CHECK_MESSAGE( !xyTestWaitForResult( Box, std::chrono::milliseconds( 200 ) ), "layout %d, missed clicks", static_cast< int >( rLayout.Buttons ) );
+
+	// Closing the window gives the most passive choice
+	xyTestClose( Box );
+
+	XY_CHECK_MESSAGE( xyTestWaitForResult( Box, std::chrono::seconds( 5 ) ) == rLayout.CloseResult, "layout %d, closed", static_cast< int >( rLayout.Buttons ) );
+
+} // xyTestLayoutClicks
+
+//////////////////////////////////////////////////////////////////////////
+
+int xyMain( void )
+{
+	xyPlatformImpl& rPlatformImpl = *xyGetContext().pPlatformImpl;
+
+	if( !rPlatformImpl.GetXCB() )
+	{
+		printf( "Skipped: no X server\n" );
+		return XY_TEST_SKIPPED;
+	}
+
+	if( rPlatformImpl.GetWayland() )
+	{
+		printf( "Skipped: message boxes are put on Wayland in this session\n" );
+		return XY_TEST_SKIPPED;
+	}
+
+	for( const xyTestLayout& rLayout : gLayouts )
+		xyTestLayoutClicks( rLayout );
+
+	return xyTestResult();
+
+} // xyMain
+
+#else // XY_OS_LINUX
+
+int xyMain( void )
+{
+	return XY_TEST_SKIPPED;
+
+} // xyMain
+
+#endif // !XY_OS_LINUX
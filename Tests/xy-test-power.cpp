@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2021 Sebastian Kylander https://gaztin.com/
+ *
+ * This software is provided 'as-is', without any express or implied warranty. In no event will
+ * the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not claim that you wrote the
+ *    original software. If you use this software in a product, an acknowledgment in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+ *    being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+/*
+ * Checks xyPowerSupplyMonitor against a made-up power supply class in a temporary directory, laid out like the one in sysfs,
+ * and that battery subscriptions give back what they set up.
+ */
+
+#define XY_IMPLEMENT
+#include "xy-main.h"
+#include "xy-test.h"
+
+#if defined( XY_OS_LINUX )
+
+#include <filesystem>
+#include <fstream>
+
+// Writes an attribute the way the kernel does, with a trailing newline. The file is rewritten in place, so open descriptors see the change.
+static void xyTestWriteAttribute( const std::filesystem::path& rDevice, const char* pName, std::string_view Value )
+{
+	std::filesystem::create_directories( rDevice );
+	std::ofstream( rDevice / pName, std::ios::trunc ) << Value << '\n';
+
+} // xyTestWriteAttribute
+
+//////////////////////////////////////////////////////////////////////////
+
+static size_t xyTestCountOpenFiles( void )
+{
+	return std::distance( std::filesystem::directory_iterator( "/proc/self/fd" ), std::filesystem::directory_iterator() );
+
+} // xyTestCountOpenFiles
+
+//////////////////////////////////////////////////////////////////////////
+
+int xyMain( void )
+{
+	char Template[] = "/tmp/xy-test-power-XXXXXX";
+	if( !mkdtemp( Template ) )
+		return 1;
+
+	const std::filesystem::path Root( Template );
+
+	// Nothing there yet, like on a desktop
+	{
+		xyPowerSupplyMonitor Monitor( Root.string() );
+
+		XY_CHECK( !Monitor.Read().Valid );
+	}
+
+	// A laptop battery without a scope, as most of them are
+	xyTestWriteAttribute( Root / "BAT0", "type",        "Battery" );
+	xyTestWriteAttribute( Root / "BAT0", "capacity",    "50" );
+	xyTestWriteAttribute( Root / "BAT0", "status",      "Discharging" );
+	xyTestWriteAttribute( Root / "BAT0", "energy_full", "30000000" );
+
+	// A second, smaller battery that only has charge_full
+	xyTestWriteAttribute( Root / "BAT1", "type",        "Battery" );
+	xyTestWriteAttribute( Root / "BAT1", "scope",       "System" );
+	xyTestWriteAttribute( Root / "BAT1", "capacity",    "100" );
+	xyTestWriteAttribute( Root / "BAT1", "status",      "Full" );
+	xyTestWriteAttribute( Root / "BAT1", "charge_full", "10000000" );
+
+	// A wireless mouse, which has nothing to do with the system
+	xyTestWriteAttribute( Root / "hidpp_battery_0", "type",     "Battery" );
+	xyTestWriteAttribute( Root / "hidpp_battery_0", "scope",    "Device" );
+	xyTestWriteAttribute( Root / "hidpp_battery_0", "capacity", "5" );
+	xyTestWriteAttribute( Root / "hidpp_battery_0", "status",   "Charging" );
+
+	// The power cord
+	xyTestWriteAttribute( Root / "AC", "type",   "Mains" );
+	xyTestWriteAttribute( Root / "AC", "online", "1" );
+
+	xyPowerSupplyMonitor Monitor( Root.string() );
+
+	// ( 50 * 30 + 100 * 10 ) / 40, without the mouse
+	xyBatteryState State = Monitor.Read();
+	XY_CHECK( State.Valid );
+	XY_CHECK( State.CapacityPercentage == 62 );
+	XY_CHECK( !State.Charging );
+
+	// The values are reread from the open files, without discovering the batteries again
+	xyTestWriteAttribute( Root / "BAT0", "capacity", "90" );
+	xyTestWriteAttribute( Root / "BAT0", "status",   "Charging" );
+
+	State = Monitor.Read();
+	XY_CHECK( State.CapacityPercentage == 92 );
+	XY_CHECK( State.Charging );
+
+	// A battery that reports garbage counts for nothing, and doesn't drag the others down either
+	xyTestWriteAttribute( Root / "BAT1", "capacity", "unknown" );
+
+	State = Monitor.Read();
+	XY_CHECK( State.Valid );
+	XY_CHECK( State.CapacityPercentage == 90 );
+
+	xyTestWriteAttribute( Root / "BAT0", "capacity", "" );
+
+	State = Monitor.Read();
+	XY_CHECK( !State.Valid );
+
+	// Out of range values are clamped
+	xyTestWriteAttribute( Root / "BAT0", "capacity", "130" );
+	xyTestWriteAttribute( Root / "BAT1", "capacity", "100" );
+
+	State = Monitor.Read();
+	XY_CHECK( State.CapacityPercentage == 100 );
+
+	// A battery that is plugged in shows up on the next discovery, and one that is gone goes away
+	xyTestWriteAttribute( Root / "BAT2", "type",        "Battery" );
+	xyTestWriteAttribute( Root / "BAT2", "capacity",    "0" );
+	xyTestWriteAttribute( Root / "BAT2", "status",      "Discharging" );
+	xyTestWriteAttribute( Root / "BAT2", "energy_full", "40000000" );
+	xyTestWriteAttribute( Root / "BAT0", "status",      "Discharging" );
+	std::filesystem::remove_all( Root / "BAT1" );
+
+	// Until then, the files that are already open keep their last values
+	XY_CHECK( Monitor.Read().CapacityPercentage == 100 );
+
+	Monitor.Discover();
+
+	// ( 100 * 30 + 0 * 40 ) / 70
+	State = Monitor.Read();
+	XY_CHECK( State.CapacityPercentage == 42 );
+	XY_CHECK( !State.Charging );
+
+	std::filesystem::remove_all( Root );
+
+	// The first subscription also opens the real power supplies, which stay open, so that one is only there to get it out of the way
+	xyUnsubscribe( xySubscribe( xyChange::Battery, [] { } ) );
+
+	// The uevent socket and the poll timer go away along with the last subscriber
+	const size_t   OpenFiles = xyTestCountOpenFiles();
+	const uint64_t First     = xySubscribe( xyChange::Battery, [] { } );
+	const uint64_t Second    = xySubscribe( xyChange::Battery, [] { } );
+	XY_CHECK( xyTestCountOpenFiles() > OpenFiles );
+
+	xyUnsubscribe( First );
+	XY_CHECK( xyTestCountOpenFiles() > OpenFiles );
+
+	xyUnsubscribe( Second );
+	XY_CHECK( xyTestCountOpenFiles() == OpenFiles );
+
+	return xyTestResult();
+
+} // xyMain
+
+#else // XY_OS_LINUX
+
+int xyMain( void )
+{
+	return XY_TEST_SKIPPED;
+
+} // xyMain
+
+#endif // !XY_OS_LINUX
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2021 Sebastian Kylander https://gaztin.com/
+ *
+ * This software is provided 'as-is', without any express or implied warranty. In no event will
+ * the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not claim that you wrote the
+ *    original software. If you use this software in a product, an acknowledgment in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+ *    being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+/*
+ * Checks that a signal reaches its xyEventLoop callback rather than killing the process.
+ * The signal is sent to the whole process while the app thread and the worker pool are running. The kernel is free to pick any of
+ * those threads, so every one of them needs to have it blocked.
+ */
+
+#define XY_IMPLEMENT
+#include "xy-main.h"
+#include "xy-test.h"
+
+#if defined( XY_OS_LINUX )
+
+int xyMain( void )
+{
+	xyPlatformImpl& rPlatformImpl = *xyGetContext().pPlatformImpl;
+
+	// Make sure that the pool threads exist before the signal is sent
+	xyCompletion PoolStarted;
+	rPlatformImpl.GetWorkerPool().Post( [ & ]{ PoolStarted.Signal(); } );
+	PoolStarted.Wait();
+
+	std::atomic< int > Received    = 0;
+	bool               Added       = false;
+	bool               AddedSEGV   = true;
+
+	xyRunOnMainThread( [ & ]
+	{
+		Added     = rPlatformImpl.EventLoop.AddSignal( SIGTERM, [ & ]( const signalfd_siginfo& rInfo ) { if( rInfo.ssi_signo == SIGTERM ) ++Received; } );
+		AddedSEGV = rPlatformImpl.EventLoop.AddSignal( SIGSEGV, []( const signalfd_siginfo& ) { } );
+	} );
+
+	XY_CHECK( Added );
+	XY_CHECK( !AddedSEGV );
+
+	for( int i = 1; i <= 20; ++i )
+	{
+		kill( getpid(), SIGTERM );
+
+		const auto Deadline = std::chrono::steady_clock::now() + std::chrono::seconds( 5 );
+		while( Received < i && std::chrono::steady_clock::now() < Deadline )
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+
+		XY_CHECK( Received == i );
+	}
+
+	xyRunOnMainThread( [ & ]{ rPlatformImpl.EventLoop.RemoveSignal( SIGTERM ); } );
+
+	return xyTestResult();
+
+} // xyMain
+
+#else // XY_OS_LINUX
+
+int xyMain( void )
+{
+	return XY_TEST_SKIPPED;
+
+} // xyMain
+
+#endif // !XY_OS_LINUX
@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2021 Sebastian Kylander https://gaztin.com/
+ *
+ * This software is provided 'as-is', without any express or implied warranty. In no event will
+ * the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not claim that you wrote the
+ *    original software. If you use this software in a product, an acknowledgment in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+ *    being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+/*
+ * Checks xyUTF, xyUnicode and the streaming transcoders against a plain scalar reference.
+ * The inputs put every kind of sequence at every offset around the 16- and 32-byte blocks of the vector paths.
+ * Build with -mavx2 to check the AVX2 path instead of the SSE2 one.
+ */
+
+#define XY_IMPLEMENT
+#include "xy-main.h"
+#include "xy-test.h"
+
+#include <random>
+
+//////////////////////////////////////////////////////////////////////////
+/// Reference
+
+// Decodes one code point at a time. Each maximal subpart of an invalid sequence becomes U+FFFD, as in table 3-8 of the Unicode standard.
+static std::u32string xyReferenceDecode( std::string_view String )
+{
+	std::u32string Result;
+	size_t         Index = 0;
+
+	while( Index < String.size() )
+	{
+		const uint8_t Lead = static_cast< uint8_t >( String[ Index ] );
+		size_t        Length;
+		uint8_t       Min = 0x80;
+		uint8_t       Max = 0xBF;
+
+		if(      Lead <= 0x7F )                { Result += Lead; ++Index; continue; }
+		else if( Lead >= 0xC2 && Lead <= 0xDF ) { Length = 2; }
+		else if( Lead == 0xE0 )                 { Length = 3; Min = 0xA0; }
+		else if( Lead == 0xED )                 { Length = 3; Max = 0x9F; }
+		else if( Lead >= 0xE1 && Lead <= 0xEF ) { Length = 3; }
+		else if( Lead == 0xF0 )                 { Length = 4; Min = 0x90; }
+		else if( Lead == 0xF4 )                 { Length = 4; Max = 0x8F; }
+		else if( Lead >= 0xF1 && Lead <= 0xF3 ) { Length = 4; }
+		else                                    { Result += U'�'; ++Index; continue; }
+
+		char32_t CodePoint = Lead & ( 0x7F >> Length );
+		size_t   Valid     = 1;
+
+		while( Valid < Length && Index + Valid < String.size() )
+		{
+			const uint8_t Byte = static_cast< uint8_t >( String[ Index + Valid ] );
+			if( Byte < Min || Byte > Max )
+				break;
+
+			CodePoint = ( CodePoint << 6 ) | ( Byte & 0x3F );
+			Min       = 0x80;
+			Max       = 0xBF;
+			++Valid;
+		}
+
+		Result += ( Valid == Length ) ? CodePoint : U'�';
+		Index  += Valid;
+	}
+
+	return Result;
+
+} // xyReferenceDecode
+
+//////////////////////////////////////////////////////////////////////////
+
+static std::wstring xyReferenceWide( std::u32string_view CodePoints )
+{
+	std::wstring Result;
+
+	for( const char32_t CodePoint : CodePoints )
+	{
+		if( sizeof( wchar_t ) == 2 && CodePoint >= 0x10000 )
+		{
+			Result += static_cast< wchar_t >( 0xD800 + ( ( CodePoint - 0x10000 ) >> 10 ) );
+			Result += static_cast< wchar_t >( 0xDC00 + ( ( CodePoint - 0x10000 ) & 0x3FF ) );
+		}
+		else
+		{
+			Result += static_cast< wchar_t >( CodePoint );
+		}
+	}
+
+	return Result;
+
+} // xyReferenceWide
+
+//////////////////////////////////////////////////////////////////////////
+
+// Unpaired surrogates and values beyond U+10FFFF become U+FFFD
+static std::string xyReferenceEncode( std::wstring_view String )
+{
+	std::string Result;
+
+	for( size_t Index = 0; Index < String.size(); ++Index )
+	{
+		char32_t CodePoint = static_cast< char32_t >( String[ Index ] );
+
+		if( sizeof( wchar_t ) == 2 && CodePoint >= 0xD800 && CodePoint <= 0xDBFF && Index + 1 < String.size() )
+		{
+			const char32_t Low = static_cast< char32_t >( String[ Index + 1 ] );
+			if( Low >= 0xDC00 && Low <= 0xDFFF )
+			{
+				CodePoint = 0x10000 + ( ( CodePoint - 0xD800 ) << 10 ) + ( Low - 0xDC00 );
+				++Index;
+			}
+		}
+
+		if( ( CodePoint >= 0xD800 && CodePoint <= 0xDFFF ) || CodePoint > 0x10FFFF )
+			CodePoint = 0xFFFD;
+
+		if( CodePoint < 0x80 )
+		{
+			Result += static_cast< char >( CodePoint );
+		}
+		else if( CodePoint < 0x800 )
+		{
+			Result += static_cast< char >( 0xC0 | ( CodePoint >> 6 ) );
+			Result += static_cast< char >( 0x80 | ( CodePoint & 0x3F ) );
+		}
+		else if( CodePoint < 0x10000 )
+		{
+			Result += static_cast< char >( 0xE0 | ( CodePoint >> 12 ) );
+			Result += static_cast< char >( 0x80 | ( ( CodePoint >> 6 ) & 0x3F ) );
+			Result += static_cast< char >( 0x80 | ( CodePoint & 0x3F ) );
+		}
+		else
+		{
+			Result += static_cast< char >( 0xF0 | ( CodePoint >> 18 ) );
+			Result += static_cast< char >( 0x80 | ( ( CodePoint >> 12 ) & 0x3F ) );
+			Result += static_cast< char >( 0x80 | ( ( CodePoint >> 6 ) & 0x3F ) );
+			Result += static_cast< char >( 0x80 | ( CodePoint & 0x3F ) );
+		}
+	}
+
+	return Result;
+
+} // xyReferenceEncode
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Inputs
+
+// Short sequences that are dropped into long runs of ASCII, so that they land on every offset of a vector block
+static const std::string_view gUTF8Pieces[] =
+{
+	"\xC3\xA9",              // U+00E9, two bytes
+	"\xE4\xB8\xAD",          // U+4E2D, three bytes
+	"\xEF\xBF\xBF",          // U+FFFF, the last BMP code point
+	"\xF0\x9F\x98\x80",      // U+1F600, astral
+	"\xF4\x8F\xBF\xBF",      // U+10FFFF, the last code point
+	"\x80",                  // Lone continuation byte
+	"\xC0\xAF",              // Overlong '/'
+	"\xE0\x80\xAF",          // Overlong '/' in three bytes
+	"\xF0\x80\x80\xAF",      // Overlong '/' in four bytes
+	"\xC1\xBF",              // Overlong U+007F
+	"\xED\xA0\x80",          // Encoded high surrogate
+	"\xED\xBF\xBF",          // Encoded low surrogate
+	"\xF4\x90\x80\x80",      // U+110000
+	"\xF5\x80\x80\x80",      // Lead byte that can never appear
+	"\xFF",                  // Ditto
+	"\xE4\xB8",              // Truncated three-byte sequence
+	"\xF0\x9F\x98",          // Truncated four-byte sequence
+};
+
+static const char32_t gWidePieces[] =
+{
+	0x00E9,
+	0x4E2D,
+	0xFFFF,
+	0x1F600,
+	0x10FFFF,
+	0xD800,   // Lone high surrogate
+	0xDFFF,   // Lone low surrogate
+	0x110000, // Beyond Unicode
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+static std::vector< std::string > xyMakeUTF8Inputs( void )
+{
+	std::vector< std::string > Inputs;
+
+	// Every piece at every offset from 0 to 70, which straddles two 32-byte blocks
+	for( const std::string_view Piece : gUTF8Pieces )
+	{
+		for( size_t Offset = 0; Offset <= 70; ++Offset )
+		{
+			Inputs.push_back( std::string( Offset, 'a' ) + std::string( Piece ) + std::string( 70 - Offset, 'b' ) );
+			Inputs.push_back( std::string( Offset, 'a' ) + std::string( Piece ) );
+		}
+	}
+
+	// Plain ASCII of every length around the block sizes
+	for( size_t Length = 0; Length <= 70; ++Length )
+		Inputs.push_back( std::string( Length, 'x' ) );
+
+	// Text that only has multi-byte sequences, which never takes the ASCII shortcut
+	std::string Mixed;
+	for( size_t Index = 0; Index < 40; ++Index )
+		Mixed += gUTF8Pieces[ Index % 5 ];
+	Inputs.push_back( Mixed );
+
+	// Random bytes, half of them ASCII and the other half anything at all
+	std::mt19937                              Random( 1234 );
+	std::uniform_int_distribution< uint32_t > Byte( 0, 255 );
+
+	for( size_t Count = 0; Count < 2000; ++Count )
+	{
+		std::string Input( Count % 97, '\0' );
+
+		for( char& rCharacter : Input )
+			rCharacter = static_cast< char >( ( Byte( Random ) & 1 ) ? ( Byte( Random ) & 0x7F ) : Byte( Random ) );
+
+		Inputs.push_back( std::move( Input ) );
+	}
+
+	// Random valid text of every width
+	std::uniform_int_distribution< uint32_t > Width( 0, 3 );
+	std::uniform_int_distribution< uint32_t > Value( 0, 0x10FFFF );
+
+	for( size_t Count = 0; Count < 500; ++Count )
+	{
+		std::wstring Wide;
+
+		for( size_t Index = 0; Index < Count % 83; ++Index )
+		{
+			char32_t CodePoint = 0;
+			switch( Width( Random ) )
+			{
+				case 0: CodePoint = Value( Random ) & 0x7F;  break;
+				case 1: CodePoint = Value( Random ) & 0x7FF; break;
+				case 2: CodePoint = Value( Random ) & 0xFFFF; break;
+				case 3: CodePoint = Value( Random );         break;
+			}
+
+			if( CodePoint >= 0xD800 && CodePoint <= 0xDFFF )
+				CodePoint = 'z';
+
+			Wide += xyReferenceWide( std::u32string( 1, CodePoint ) );
+		}
+
+		Inputs.push_back( xyReferenceEncode( Wide ) );
+	}
+
+	return Inputs;
+
+} // xyMakeUTF8Inputs
+
+//////////////////////////////////////////////////////////////////////////
+
+static std::vector< std::wstring > xyMakeWideInputs( void )
+{
+	std::vector< std::wstring > Inputs;
+
+	for( const char32_t Piece : gWidePieces )
+	{
+		// The lone surrogates are only representable on their own, not through the reference
+		const std::wstring WidePiece = ( Piece >= 0xD800 && Piece <= 0xDFFF ) || Piece > 0x10FFFF ? std::wstring( 1, static_cast< wchar_t >( Piece ) ) : xyReferenceWide( std::u32string( 1, Piece ) );
+
+		for( size_t Offset = 0; Offset <= 70; ++Offset )
+		{
+			Inputs.push_back( std::wstring( Offset, L'a' ) + WidePiece + std::wstring( 70 - Offset, L'b' ) );
+			Inputs.push_back( std::wstring( Offset, L'a' ) + WidePiece );
+		}
+	}
+
+	for( size_t Length = 0; Length <= 70; ++Length )
+		Inputs.push_back( std::wstring( Length, L'x' ) );
+
+	// Random code units, including ones that are not valid on their own
+	std::mt19937                              Random( 5678 );
+	std::uniform_int_distribution< uint32_t > Kind( 0, 3 );
+	std::uniform_int_distribution< uint32_t > Value( 0, sizeof( wchar_t ) == 2 ? 0xFFFF : 0x10FFFF );
+
+	for( size_t Count = 0; Count < 2000; ++Count )
+	{
+		std::wstring Input( Count % 89, L'\0' );
+
+		for( wchar_t& rCharacter : Input )
+		{
+			switch( Kind( Random ) )
+			{
+				case 0:  rCharacter = static_cast< wchar_t >( Value( Random ) & 0x7F );            break;
+				case 1:  rCharacter = static_cast< wchar_t >( 0xD800 + ( Value( Random ) & 0x7FF ) ); break;
+				default: rCharacter = static_cast< wchar_t >( Value( Random ) );                   break;
+			}
+		}
+
+		Inputs.push_back( std::move( Input ) );
+	}
+
+	return Inputs;
+
+} // xyMakeWideInputs
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Tests
+
+static void xyTestKnownSequences( void )
+{
+	// The example from section 3.9 of the Unicode standard: each maximal subpart becomes one replacement character
+	XY_CHECK( xyUnicode( "\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64" ) == L"a���b�c��d" );
+	XY_CHECK( xyUnicode( "\xED\xA0\x80" ) == L"���" );
+	XY_CHECK( xyUnicode( "\xC0\xAF" )     == L"��" );
+	XY_CHECK( xyUnicode( "\xF0\x9F\x98\x80" ) == xyReferenceWide( U"\U0001F600" ) );
+	XY_CHECK( xyUTF( xyReferenceWide( U"aé中\U0001F600" ) ) == "a\xC3\xA9\xE4\xB8\xAD\xF0\x9F\x98\x80" );
+	XY_CHECK( xyUTF( std::wstring( 1, static_cast< wchar_t >( 0xD800 ) ) ) == "\xEF\xBF\xBD" );
+	XY_CHECK( xyUnicode( "" ).empty() );
+	XY_CHECK( xyUTF( L"" ).empty() );
+
+} // xyTestKnownSequences
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyTestDecode( const std::string& rInput )
+{
+	const std::wstring Expected = xyReferenceWide( xyReferenceDecode( rInput ) );
+
+	XY_CHECK_MESSAGE( xyUnicode( rInput ) == Expected, "input of %zu bytes", rInput.size() );
+
+	// The output string is reused, and must not carry anything over
+	std::wstring Output = L"leftovers";
+	XY_CHECK( xyUnicode( rInput, Output ) == Expected.size() && Output == Expected );
+
+	// A buffer of every size up to the full result. Whatever fits must be a whole prefix of the result.
+	for( size_t Size = 0; Size <= Expected.size(); ++Size )
+	{
+		std::wstring            Buffer( Size, L'\0' );
+		const xyTranscodeResult Result = xyUnicode( rInput, std::span< wchar_t >( Buffer ) );
+		const std::wstring      Prefix = xyReferenceWide( xyReferenceDecode( std::string_view( rInput ).substr( 0, Result.Read ) ) );
+
+		XY_CHECK_MESSAGE( Result.Written <= Size && Buffer.substr( 0, Result.Written ) == Prefix, "input of %zu bytes into %zu characters", rInput.size(), Size );
+		XY_CHECK( Expected.compare( 0, Result.Written, Buffer, 0, Result.Written ) == 0 );
+
+		if( Size == Expected.size() )
+			XY_CHECK( Result.Read == rInput.size() && Result.Written == Expected.size() );
+	}
+
+	// Split in two at every offset, which cuts every sequence in every possible place
+	for( size_t Split = 0; Split <= rInput.size(); ++Split )
+	{
+		xyUTF8Decoder Decoder;
+		std::wstring  Streamed;
+
+		Decoder.Convert( std::string_view( rInput ).substr( 0, Split ), Streamed );
+		Decoder.Convert( std::string_view( rInput ).substr( Split ), Streamed );
+		Decoder.Finish( Streamed );
+
+		XY_CHECK_MESSAGE( Streamed == Expected, "input of %zu bytes split at %zu", rInput.size(), Split );
+	}
+
+	// One byte at a time, which keeps a pending sequence around for as long as possible
+	xyUTF8Decoder Decoder;
+	std::wstring  Streamed;
+
+	for( const char Character : rInput )
+		Decoder.Convert( std::string_view( &Character, 1 ), Streamed );
+
+	Decoder.Finish( Streamed );
+
+	XY_CHECK_MESSAGE( Streamed == Expected, "input of %zu bytes fed one byte at a time", rInput.size() );
+
+} // xyTestDecode
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyTestEncode( const std::wstring& rInput )
+{
+	const std::string Expected = xyReferenceEncode( rInput );
+
+	XY_CHECK_MESSAGE( xyUTF( rInput ) == Expected, "input of %zu characters", rInput.size() );
+
+	std::string Output = "leftovers";
+	XY_CHECK( xyUTF( rInput, Output ) == Expected.size() && Output == Expected );
+
+	for( size_t Size = 0; Size <= Expected.size(); ++Size )
+	{
+		std::string             Buffer( Size, '\0' );
+		const xyTranscodeResult Result = xyUTF( rInput, std::span< char >( Buffer ) );
+		const std::string       Prefix = xyReferenceEncode( std::wstring_view( rInput ).substr( 0, Result.Read ) );
+
+		XY_CHECK_MESSAGE( Result.Written <= Size && Buffer.substr( 0, Result.Written ) == Prefix, "input of %zu characters into %zu bytes", rInput.size(), Size );
+
+		if( Size == Expected.size() )
+			XY_CHECK( Result.Read == rInput.size() && Result.Written == Expected.size() );
+	}
+
+	for( size_t Split = 0; Split <= rInput.size(); ++Split )
+	{
+		xyUTF8Encoder Encoder;
+		std::string   Streamed;
+
+		Encoder.Convert( std::wstring_view( rInput ).substr( 0, Split ), Streamed );
+		Encoder.Convert( std::wstring_view( rInput ).substr( Split ), Streamed );
+		Encoder.Finish( Streamed );
+
+		XY_CHECK_MESSAGE( Streamed == Expected, "input of %zu characters split at %zu", rInput.size(), Split );
+	}
+
+	xyUTF8Encoder Encoder;
+	std::string   Streamed;
+
+	for( const wchar_t Character : rInput )
+		Encoder.Convert( std::wstring_view( &Character, 1 ), Streamed );
+
+	Encoder.Finish( Streamed );
+
+	XY_CHECK_MESSAGE( Streamed == Expected, "input of %zu characters fed one at a time", rInput.size() );
+
+} // xyTestEncode
+
+//////////////////////////////////////////////////////////////////////////
+
+static void xyTestRoundTrip( void )
+{
+	// Every code point survives a round trip, except for the surrogates which can't be encoded in the first place
+	std::u32string CodePoints;
+	for( char32_t CodePoint = 0; CodePoint <= 0x10FFFF; ++CodePoint )
+	{
+		if( CodePoint < 0xD800 || CodePoint > 0xDFFF )
+			CodePoints += CodePoint;
+	}
+
+	const std::wstring Wide = xyReferenceWide( CodePoints );
+	const std::string  UTF8 = xyUTF( Wide );
+
+	XY_CHECK( UTF8 == xyReferenceEncode( Wide ) );
+	XY_CHECK( xyUnicode( UTF8 ) == Wide );
+
+} // xyTestRoundTrip
+
+//////////////////////////////////////////////////////////////////////////
+
+int xyMain( void )
+{
+#if defined( __AVX2__ ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+	if( !__builtin_cpu_supports( "avx2" ) )
+	{
+		printf( "Skipped: this CPU has no AVX2\n" );
+		return XY_TEST_SKIPPED;
+	}
+#endif // __AVX2__ && ( __GNUC__ || __clang__ )
+
+	xyTestKnownSequences();
+
+	for( const std::string& rInput : xyMakeUTF8Inputs() )
+		xyTestDecode( rInput );
+
+	for( const std::wstring& rInput : xyMakeWideInputs() )
+		xyTestEncode( rInput );
+
+	xyTestRoundTrip();
+
+	return xyTestResult();
+
+} // xyMain
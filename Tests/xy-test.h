@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2021 Sebastian Kylander https://gaztin.com/
+ *
+ * This software is provided 'as-is', without any express or implied warranty. In no event will
+ * the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not claim that you wrote the
+ *    original software. If you use this software in a product, an acknowledgment in the product
+ *    documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+ *    being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ */
+
+
+/*
+ * The bare minimum that the tests need to report failures.
+ * A failed check prints where it failed and lets the test carry on, so a single run shows every broken case.
+ */
+
+#pragma once
+
+#include <cstdio>
+
+// Returned by a test that can't run on this host, like when it needs a display server that isn't there
+constexpr int XY_TEST_SKIPPED = 77;
+
+inline int gTestFailures = 0;
+
+#define XY_CHECK( Condition ) \
+	do { if( !( Condition ) ) { ++gTestFailures; fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #Condition ); } } while( false )
+
+#define XY_CHECK_MESSAGE( Condition, ... ) \
+	do { if( !( Condition ) ) { ++gTestFailures; fprintf( stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #Condition ); fprintf( stderr, __VA_ARGS__ ); fputc( '\n', stderr ); } } while( false )
+
+// Returns the exit code of the test
+inline int xyTestResult( void )
+{
+	if( gTestFailures > 0 )
+		fprintf( stderr, "%d checks failed\n", gTestFailures );
+
+	return ( gTestFailures > 0 ) ? 1 : 0;
+
+} // xyTestResult
@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# Runs a test against a headless Weston of its own, the way xvfb-run does for X, and skips it when Weston doesn't come up.
+# X is left out of the environment, so the test can't fall back to XWayland or to whatever display the host has.
+#
+# Usage: xy-weston-run.sh <weston> <test> [args...]
+
+Weston="$1"
+shift
+
+# Weston puts its socket there, and refuses to start without one
+if [ -z "$XDG_RUNTIME_DIR" ]; then
+	XDG_RUNTIME_DIR=$(mktemp -d) || exit 77
+	export XDG_RUNTIME_DIR
+	RemoveRuntimeDir=1
+fi
+
+Socket="xy-test-$$"
+
+"$Weston" --backend=headless-backend.so --socket="$Socket" --idle-time=0 > /dev/null 2>&1 &
+WestonPID=$!
+
+Cleanup()
+{
+	kill "$WestonPID" 2> /dev/null
+	wait "$WestonPID" 2> /dev/null
+	[ -n "$RemoveRuntimeDir" ] && rm -rf "$XDG_RUNTIME_DIR"
+}
+trap Cleanup EXIT
+
+# Weston is ready once the socket is there. Give it five seconds.
+Tries=0
+while [ ! -S "$XDG_RUNTIME_DIR/$Socket" ]; do
+	if ! kill -0 "$WestonPID" 2> /dev/null || [ "$Tries" -ge 50 ]; then
+		echo "Skipped: weston didn't start"
+		exit 77
+	fi
+
+	sleep 0.1
+	Tries=$((Tries + 1))
+done
+
+env -u DISPLAY WAYLAND_DISPLAY="$Socket" "$@"
+Status=$?
+
+exit $Status